@@ -28,6 +28,8 @@
 
 #define USE_RTC				0
 
+#define USE_LOG				1 // Journal binaire différé (LOG) : trames SysEx sur l'UART2, décodées par tools/log_decoder.py
+
 #define USE_ADC				0
 	/* Configuration pour activer les entrées analogiques souhaitées */
 	#define USE_IN1		1 //Broche correspondante: PA0
@@ -53,6 +55,7 @@
 #define USE_WS2812			0 // Matrice de led
 
 /*------------------Capteurs------------------*/
+#define USE_MOTION_MIDI		0 // Contrôleur MIDI gestuel (inclinaison/secousses) --> veuillez aussi activer USE_MPU6050
 #define USE_MPU6050			0 // Acc�l�rom�tre, Gyroscope
 #define USE_APDS9960		0 // Capteur de mouvements, pr�sence, couleurs
 #define USE_BMP180			0 // Capteur de pression atmosph�rique
@@ -73,6 +76,10 @@
 	#define VL_0				GPIOA, GPIO_PIN_0 // Pin de reset
 	//#define VL_1				GPIOD, GPIO_PIN_3
 	//#define VL_2				GPIOE, GPIO_PIN_10
+	//Facultatif : broche reliee a la sortie GPIO1 (donnee prete) du capteur x. Numeros de broche distincts entre capteurs (une ligne EXTI par numero).
+	//Sans VL_x_INT, le capteur x est scrute une fois par cycle de timeslots.
+	#define VL_0_INT			GPIOA, GPIO_PIN_1
+	#define VL53_INTER_MEASUREMENT_MS	0 // 0 : mesure continue (enchainee), sinon periode de mesure en mode "timed" (ms)
 #endif
 
 /*------------------Expanders------------------*/
@@ -15,12 +15,22 @@
 #include "stm32g4_uart.h"
 #include "MatrixKeyboard/stm32g4_matrix_keyboard.h"
 #include "midi.h"
+#include "stm32g4_log.h"
+#include "stm32g4_flash.h"
+#if USE_LOG && LOG_FRAME_MAX_SIZE + MIDI_NOTE_RESERVE_BYTES > MIDI_LINK_BURST_BYTES
+#error "MIDI_LINK_BURST_BYTES : le seau de jetons doit contenir une trame de journal en plus de la réserve des notes"
+#endif
+#if USE_MOTION_MIDI
+#include "motion_midi.h"
+#endif
 
 /* Private defines -----------------------------------------------------------*/
 #define LED_BLINK_PERIOD_MS    1000   // LED heartbeat
 #define KEYBOARD_SCAN_PERIOD_MS 10    // Scan rapide mais pas trop (10ms pour éviter spam)
 #define MAX_MATRIX_KEYS        64     // 8x8 matrix
 #define DEBOUNCE_COUNT         3      // 3 lectures consécutives pour valider un changement
+#define MOTION_SAMPLE_RATE_HZ  1000   // Fréquence d'échantillonnage du MPU6050 (contrôleur gestuel)
+#define MOTION_STATS_PERIOD_MS 10000  // Période d'affichage des compteurs de messages gestuels
 
 /* Piano keyboard mapping pour matrice 8x8 */
 static const char piano_layout[64] = {
@@ -78,7 +88,14 @@ static void LED_Process(void);
 static void Keyboard_MIDI_Process(void);
 static void Process_Key_Changes(KeyboardState_t* kbd_state);
 static void Send_MIDI_Note(int key_index, bool pressed);
+#if USE_LOG
+static void Log_Output(const uint8_t *frame, uint32_t size);
+#endif
 static void Update_Keyboard_State(KeyboardState_t* kbd_state, uint32_t raw_state);
+#if USE_MOTION_MIDI
+static void Motion_MIDI_Init(void);
+static void Motion_MIDI_Process(void);
+#endif
 
 /* Déclaration de la fonction externe du BSP */
 extern uint32_t MATRIX_KEYBOARD_read_all_touchs(void);
@@ -87,6 +104,12 @@ extern uint32_t MATRIX_KEYBOARD_read_all_touchs(void);
 static uint32_t led_last_toggle = 0;
 static uint32_t keyboard_last_scan = 0;
 static KeyboardState_t keyboard_state = {0};
+#if USE_MOTION_MIDI
+static MPU6050_t imu;
+static ATTITUDE_t attitude;
+static bool motion_ready = false;
+static uint32_t motion_last_stats = 0;
+#endif
 
 /**
  * @brief  The application entry point.
@@ -100,7 +123,7 @@ int main(void)
     MX_GPIO_Init();
 
     /* Initialize UART pour debug et MIDI */
-    BSP_UART_init(UART2_ID, 115200);
+    BSP_UART_init(UART2_ID, MIDI_UART_BAUDRATE);
     BSP_SYS_set_std_usart(UART2_ID, UART2_ID, UART2_ID);
 
     /* Application startup */
@@ -114,6 +137,10 @@ int main(void)
     /* Initialize MIDI */
     MIDI_init();
     printf("MIDI initialized - Channel 1, Polyphonic mode\r\n");
+#if USE_LOG
+    /* Journal binaire : trames SysEx sur la liaison MIDI */
+    BSP_LOG_init(Log_Output);
+#endif
 
     /* Initialize matrix keyboard */
     printf("Initializing 8x8 matrix keyboard...\r\n");
@@ -125,6 +152,11 @@ int main(void)
     /* Clear keyboard state */
     memset(&keyboard_state, 0, sizeof(KeyboardState_t));
 
+#if USE_MOTION_MIDI
+    /* Initialize IMU motion controller */
+    Motion_MIDI_Init();
+#endif
+
     printf("Matrix keyboard MIDI controller ready!\r\n");
     printf("Mapping: Position (row,col) -> Note\r\n");
     printf("  (1,1)=Do3, (1,2)=Do#3, (1,3)=Ré3, etc.\r\n");
@@ -140,6 +172,16 @@ int main(void)
     {
         LED_Process();
         Keyboard_MIDI_Process();
+#if USE_MOTION_MIDI
+        Motion_MIDI_Process();
+#endif
+#if USE_LOG
+        /* Vidage du journal, dans la bande passante laissée libre par les notes (trames à la taille du budget) */
+        BSP_LOG_process(MIDI_bandwidth_bytes());
+#endif
+
+        /* Compactage du journal de la flash par petites étapes, hors des écritures (quelques ms, rien à faire sinon) */
+        BSP_FLASH_process();
 
         /* Small delay pour éviter de surcharger le CPU */
         HAL_Delay(2);
@@ -284,16 +326,68 @@ static void Send_MIDI_Note(int key_index, bool pressed)
     if (pressed) {
         /* Envoyer MIDI Note On */
         MIDI_send_note_on(1, midi_note, 100);  // Canal 1, vélocité 100
-        printf("[MIDI] Note ON  - Position (%d,%d) '%c' -> MIDI:%d\r\n",
+        LOG("[MIDI] Note ON  - Position (%d,%d) '%c' -> MIDI:%d\r\n",
                row, col, key_char, midi_note);
     } else {
         /* Envoyer MIDI Note Off */
         MIDI_send_note_off(1, midi_note, 0);   // Canal 1, vélocité 0
-        printf("[MIDI] Note OFF - Position (%d,%d) '%c' -> MIDI:%d\r\n",
+        LOG("[MIDI] Note OFF - Position (%d,%d) '%c' -> MIDI:%d\r\n",
                row, col, key_char, midi_note);
     }
 }
 
+#if USE_LOG
+/**
+ * @brief Envoie une trame du journal sur la liaison MIDI (elle tient dans un seul envoi)
+ */
+static void Log_Output(const uint8_t *frame, uint32_t size)
+{
+    MIDI_send_raw((uint8_t *)frame, (uint8_t)size);
+}
+#endif
+
+#if USE_MOTION_MIDI
+/**
+ * @brief Initialise le MPU6050 en streaming, l'estimateur d'attitude et le contrôleur gestuel
+ *        Broche INT du MPU6050 sur PA1, alimentation sur PA0
+ */
+static void Motion_MIDI_Init(void)
+{
+    if (MPU6050_Init(&imu, GPIOA, GPIO_PIN_0, MPU6050_Device_0, MPU6050_Accelerometer_4G, MPU6050_Gyroscope_500s) != MPU6050_Result_Ok
+        || MPU6050_StreamStart(&imu, MOTION_SAMPLE_RATE_HZ, GPIOA, GPIO_PIN_1) != MPU6050_Result_Ok) {
+        printf("MPU6050 not found - motion controller disabled\r\n");
+        return;
+    }
+    ATTITUDE_Init(&attitude, ATTITUDE_MAHONY, &imu, MOTION_SAMPLE_RATE_HZ);
+    MOTION_MIDI_init(1);
+    motion_ready = true;
+    motion_last_stats = HAL_GetTick();
+    printf("Motion controller ready: roll->PitchBend, pitch->Modulation, shake->Expression\r\n");
+}
+
+/**
+ * @brief Vide le flux du MPU6050, met à jour l'attitude et envoie les messages gestuels autorisés
+ */
+static void Motion_MIDI_Process(void)
+{
+    static MPU6050_Sample_t samples[32];
+    uint16_t n;
+
+    if (!motion_ready) return;
+
+    while ((n = MPU6050_StreamRead(samples, 32)) > 0) {
+        ATTITUDE_UpdateBatch(&attitude, samples, n);
+        MOTION_MIDI_feed(samples, n, &attitude);
+    }
+    MOTION_MIDI_process();
+
+    if (HAL_GetTick() - motion_last_stats >= MOTION_STATS_PERIOD_MS) {
+        motion_last_stats = HAL_GetTick();
+        MOTION_MIDI_print_stats();
+    }
+}
+#endif
+
 /**
  * @brief  Period elapsed callback in non blocking mode
  * @param  htim : TIM handle
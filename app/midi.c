@@ -22,6 +22,24 @@
 /* Private variables ---------------------------------------------------------*/
 static bool midi_initialized = false;
 
+/* Token bucket of the link, in thousandths of a byte (refilled lazily from HAL_GetTick) */
+static int32_t link_tokens = MIDI_LINK_BURST_BYTES * 1000;
+static uint32_t link_last_refill = 0;
+
+/* Private functions ---------------------------------------------------------*/
+static void MIDI_refill_tokens(void)
+{
+    uint32_t now = HAL_GetTick();
+    uint32_t elapsed = now - link_last_refill;
+    link_last_refill = now;
+
+    if (elapsed > 1000) elapsed = 1000;
+    link_tokens += (int32_t)(elapsed * MIDI_LINK_BYTES_PER_S);
+    if (link_tokens > MIDI_LINK_BURST_BYTES * 1000) {
+        link_tokens = MIDI_LINK_BURST_BYTES * 1000;
+    }
+}
+
 /**
  * @brief Initialize MIDI module
  */
@@ -29,6 +47,7 @@ void MIDI_init(void)
 {
     /* UART is already initialized in main.c via BSP_UART_init() */
     midi_initialized = true;
+    link_last_refill = HAL_GetTick();
 
     /* Send initial MIDI reset to clear any stuck notes */
     MIDI_send_all_notes_off(1);
@@ -51,6 +70,32 @@ void MIDI_send_raw(uint8_t *data, uint8_t length)
     for (uint8_t i = 0; i < length; i++) {
         BSP_UART_putc(MIDI_UART_ID, data[i]);
     }
+
+    /* Every message consumes the link budget, notes included (the bucket may go negative) */
+    MIDI_refill_tokens();
+    link_tokens -= (int32_t)length * 1000;
+}
+
+/**
+ * @brief Ask the link token bucket whether a low-priority message can be sent now
+ * @param bytes: Size of the message that the caller intends to send
+ * @retval true if the message fits in the budget, keeping MIDI_NOTE_RESERVE_BYTES for notes
+ */
+bool MIDI_bandwidth_available(uint8_t bytes)
+{
+    MIDI_refill_tokens();
+    return link_tokens >= ((int32_t)bytes + MIDI_NOTE_RESERVE_BYTES) * 1000;
+}
+
+/**
+ * @brief Low-priority budget of the link token bucket
+ * @retval Number of bytes that can be sent now, keeping MIDI_NOTE_RESERVE_BYTES for notes
+ */
+uint32_t MIDI_bandwidth_bytes(void)
+{
+    MIDI_refill_tokens();
+    int32_t bytes = link_tokens / 1000 - MIDI_NOTE_RESERVE_BYTES;
+    return (bytes > 0) ? (uint32_t)bytes : 0;
 }
 
 /**
@@ -19,6 +19,22 @@
 #define MIDI_MAX_VELOCITY       127
 #define MIDI_MAX_NOTE           127
 
+/* MIDI link budget ----------------------------------------------------------*/
+/* Baud rate of the MIDI UART (UART2, shared with printf). The stream reaches the host through the ST-Link
+ * virtual COM port and a serial-to-MIDI bridge; define 31250 when UART2 drives a DIN-MIDI output instead. */
+#ifndef MIDI_UART_BAUDRATE
+#define MIDI_UART_BAUDRATE      115200
+#endif
+/* Bandwidth of the MIDI link in bytes per second (10 bits per byte: start, 8 data bits, stop) */
+#ifndef MIDI_LINK_BYTES_PER_S
+#define MIDI_LINK_BYTES_PER_S   (MIDI_UART_BAUDRATE / 10)
+#endif
+/* Token bucket depth: must hold a whole log frame (LOG_FRAME_MAX_SIZE) on top of the note reserve */
+#ifndef MIDI_LINK_BURST_BYTES
+#define MIDI_LINK_BURST_BYTES   80
+#endif
+#define MIDI_NOTE_RESERVE_BYTES 12      // Budget always left free for note messages (4 notes)
+
 /* MIDI Status Bytes (for Channel 1, add channel-1 for other channels) */
 #define MIDI_NOTE_OFF           0x80    // Note Off
 #define MIDI_NOTE_ON            0x90    // Note On
@@ -114,6 +130,21 @@ void MIDI_send_pitch_bend(uint8_t channel, int16_t value);
  */
 void MIDI_send_raw(uint8_t *data, uint8_t length);
 
+/**
+ * @brief Ask the link token bucket whether a low-priority message can be sent now
+ *        Note messages are never throttled: they are always sent and consume the budget,
+ *        while continuous controllers must leave MIDI_NOTE_RESERVE_BYTES free for them.
+ * @param bytes: Size of the message that the caller intends to send
+ * @retval true if the message fits in the budget
+ */
+bool MIDI_bandwidth_available(uint8_t bytes);
+
+/**
+ * @brief Low-priority budget of the link token bucket
+ * @retval Number of bytes that can be sent now while keeping MIDI_NOTE_RESERVE_BYTES for notes
+ */
+uint32_t MIDI_bandwidth_bytes(void);
+
 /**
  * @brief Send MIDI All Notes Off message
  * @param channel: MIDI channel (1-16)
@@ -0,0 +1,233 @@
+/**
+ *******************************************************************************
+ * @file    motion_midi.c
+ * @author  DEEP Project
+ * @date    Oct 17, 2026
+ * @brief   IMU to MIDI motion controller implementation
+ *
+ *          The IMU runs at up to 1 kHz while the MIDI link carries ~3800 three-byte
+ *          messages per second at 115200 baud (~1000 on a DIN-MIDI port), shared with
+ *          the notes and printf. Each destination therefore goes through:
+ *            source -> dead zone -> response curve -> output value
+ *          and a new value is only sent when
+ *            - it differs from the last sent value by at least min_change,
+ *            - the destination has not sent anything for 1/max_rate_hz,
+ *            - the link token bucket (midi.c) still has room beyond the note reserve.
+ *          Values going back to neutral ignore the threshold so that a released
+ *          gesture always ends on an exact center value.
+ *******************************************************************************
+ */
+
+#include "config.h"
+#if USE_MOTION_MIDI
+
+#include "motion_midi.h"
+#include "midi.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define PITCH_BEND_MAX          8191
+#define CC_MAX                  127
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    MotionMapping_t map;
+    int16_t target;             // Last computed output value
+    int16_t sent;               // Last sent output value
+    int16_t withheld;           // Last target already counted as withheld (counted once, not per loop pass)
+    uint32_t last_sent_tick;
+    MotionDestStats_t stats;
+} MotionDestState_t;
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t midi_channel = 1;
+static float source_values[3] = {0};
+static float shake_envelope = 0.0f;
+static MotionDestState_t dests[MOTION_DEST_NB];
+
+static const MotionMapping_t default_mappings[MOTION_DEST_NB] = {
+    /* Roll +-45 degrees -> pitch bend */
+    [MOTION_DEST_PITCH_BEND] = { true, MOTION_SRC_ROLL,  true,  0.785f, 0.05f, MOTION_CURVE_SQUARE, 64, 100 },
+    /* Forward tilt 0..45 degrees -> modulation */
+    [MOTION_DEST_MODULATION] = { true, MOTION_SRC_PITCH, false, 0.785f, 0.08f, MOTION_CURVE_LINEAR, 2,  50 },
+    /* Shake 0..1.5 g -> expression */
+    [MOTION_DEST_EXPRESSION] = { true, MOTION_SRC_SHAKE, false, 1.5f,   0.1f,  MOTION_CURVE_SQRT,   2,  50 },
+};
+
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief Apply the dead zone and the response curve
+ * @retval Normalized value in [-1, 1] (bipolar) or [0, 1] (unipolar)
+ */
+static float MOTION_shape(const MotionMapping_t* map, float x)
+{
+    float sign = 1.0f;
+    float v;
+
+    if (map->bipolar && x < 0.0f) {
+        sign = -1.0f;
+        x = -x;
+    }
+    if (x <= map->dead_zone) return 0.0f;
+
+    v = (x - map->dead_zone) / (map->range - map->dead_zone);
+    if (v > 1.0f) v = 1.0f;
+
+    switch (map->curve) {
+        case MOTION_CURVE_SQUARE: v = v * v;   break;
+        case MOTION_CURVE_SQRT:   v = sqrtf(v); break;
+        case MOTION_CURVE_LINEAR:
+        default:                  break;
+    }
+    return sign * v;
+}
+
+static void MOTION_send(MotionDest_t dest, int16_t value)
+{
+    switch (dest) {
+        case MOTION_DEST_PITCH_BEND:
+            MIDI_send_pitch_bend(midi_channel, value);
+            break;
+        case MOTION_DEST_MODULATION:
+            MIDI_send_control_change(midi_channel, MIDI_CC_MODULATION, (uint8_t)value);
+            break;
+        case MOTION_DEST_EXPRESSION:
+            MIDI_send_control_change(midi_channel, MIDI_CC_EXPRESSION, (uint8_t)value);
+            break;
+        default:
+            break;
+    }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+/**
+ * @brief Initialize the motion controller with the default mappings
+ * @param channel: MIDI channel (1-16)
+ */
+void MOTION_MIDI_init(uint8_t channel)
+{
+    midi_channel = channel;
+    shake_envelope = 0.0f;
+    memset(source_values, 0, sizeof(source_values));
+    memset(dests, 0, sizeof(dests));
+    for (int i = 0; i < MOTION_DEST_NB; i++) {
+        dests[i].map = default_mappings[i];
+    }
+}
+
+/**
+ * @brief Replace the mapping of a destination
+ */
+void MOTION_MIDI_set_mapping(MotionDest_t dest, const MotionMapping_t* mapping)
+{
+    if (dest >= MOTION_DEST_NB || mapping == NULL) return;
+    dests[dest].map = *mapping;
+}
+
+/**
+ * @brief Feed a batch of IMU samples and the attitude estimated from them
+ */
+void MOTION_MIDI_feed(const MPU6050_Sample_t* samples, uint16_t n, const ATTITUDE_t* att)
+{
+    float yaw;
+
+    /* Shake: peak envelope of the deviation of the acceleration norm from 1 g */
+    for (uint16_t i = 0; i < n; i++) {
+        float ax = (float)samples[i].accel[0];
+        float ay = (float)samples[i].accel[1];
+        float az = (float)samples[i].accel[2];
+        float dev = fabsf(sqrtf(ax * ax + ay * ay + az * az) * att->accel_scale - 1.0f);
+        shake_envelope *= MOTION_SHAKE_DECAY;
+        if (dev > shake_envelope) shake_envelope = dev;
+    }
+    source_values[MOTION_SRC_SHAKE] = shake_envelope;
+
+    /* Tilt: only the latest attitude of the batch matters */
+    ATTITUDE_GetEuler(att, &source_values[MOTION_SRC_ROLL], &source_values[MOTION_SRC_PITCH], &yaw);
+
+    for (int d = 0; d < MOTION_DEST_NB; d++) {
+        MotionDestState_t* s = &dests[d];
+        float v = MOTION_shape(&s->map, source_values[s->map.source]);
+        if (d == MOTION_DEST_PITCH_BEND) {
+            s->target = (int16_t)(v * PITCH_BEND_MAX);
+        } else {
+            if (v < 0.0f) v = 0.0f;
+            s->target = (int16_t)(v * CC_MAX + 0.5f);
+        }
+    }
+}
+
+/**
+ * @brief Send the pending controller updates allowed by the thresholds, the rate limits and the link budget
+ */
+void MOTION_MIDI_process(void)
+{
+    uint32_t now = HAL_GetTick();
+
+    for (int d = 0; d < MOTION_DEST_NB; d++) {
+        MotionDestState_t* s = &dests[d];
+        int16_t delta;
+
+        if (!s->map.enabled || s->target == s->sent) continue;
+
+        /* Minimum change, except when going back to neutral */
+        delta = s->target - s->sent;
+        if (delta < 0) delta = -delta;
+        if (s->target != 0 && delta < (int16_t)s->map.min_change) {
+            if (s->target != s->withheld) s->stats.below_threshold++;
+            s->withheld = s->target;
+            continue;
+        }
+
+        /* Per-destination rate limit */
+        if (s->map.max_rate_hz != 0 && now - s->last_sent_tick < 1000 / s->map.max_rate_hz) {
+            if (s->target != s->withheld) s->stats.rate_limited++;
+            s->withheld = s->target;
+            continue;
+        }
+
+        /* Shared link budget: notes always keep their reserve */
+        if (!MIDI_bandwidth_available(3)) {
+            if (s->target != s->withheld) s->stats.budget_limited++;
+            s->withheld = s->target;
+            continue;
+        }
+
+        MOTION_send((MotionDest_t)d, s->target);
+        s->sent = s->target;
+        s->withheld = s->target;
+        s->last_sent_tick = now;
+        s->stats.sent++;
+    }
+}
+
+/**
+ * @brief Get the message counters of a destination
+ */
+void MOTION_MIDI_get_stats(MotionDest_t dest, MotionDestStats_t* stats)
+{
+    if (dest >= MOTION_DEST_NB || stats == NULL) return;
+    *stats = dests[dest].stats;
+}
+
+/**
+ * @brief Print the message counters of every destination
+ */
+void MOTION_MIDI_print_stats(void)
+{
+    static const char* names[MOTION_DEST_NB] = { "PitchBend", "Modulation", "Expression" };
+
+    for (int d = 0; d < MOTION_DEST_NB; d++) {
+        printf("[MOTION] %-10s sent:%lu thresh:%lu rate:%lu budget:%lu\r\n",
+               names[d],
+               dests[d].stats.sent,
+               dests[d].stats.below_threshold,
+               dests[d].stats.rate_limited,
+               dests[d].stats.budget_limited);
+    }
+}
+
+#endif /* USE_MOTION_MIDI */
@@ -0,0 +1,106 @@
+/**
+ *******************************************************************************
+ * @file    motion_midi.h
+ * @author  DEEP Project
+ * @date    Oct 17, 2026
+ * @brief   IMU to MIDI motion controller
+ *          Maps tilt and shake gestures measured by the MPU6050 to pitch bend,
+ *          modulation and expression, with bandwidth-aware message thinning
+ *******************************************************************************
+ */
+
+#ifndef MOTION_MIDI_H
+#define MOTION_MIDI_H
+
+#include "config.h"
+#if USE_MOTION_MIDI
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "MPU6050/stm32g4_mpu6050_attitude.h"
+
+/* Defines -------------------------------------------------------------------*/
+/* Shake envelope decay per sample (release time ~200 ms at 1 kHz) */
+#ifndef MOTION_SHAKE_DECAY
+#define MOTION_SHAKE_DECAY      0.995f
+#endif
+
+/* Types ---------------------------------------------------------------------*/
+typedef enum {
+    MOTION_SRC_ROLL = 0,        // Roll angle (rad)
+    MOTION_SRC_PITCH,           // Pitch angle (rad)
+    MOTION_SRC_SHAKE            // Shake envelope: deviation of the acceleration norm from 1 g (g)
+} MotionSource_t;
+
+typedef enum {
+    MOTION_CURVE_LINEAR = 0,
+    MOTION_CURVE_SQUARE,        // Fine control near the center, fast at the ends
+    MOTION_CURVE_SQRT           // Fast near the center, fine at the ends
+} MotionCurve_t;
+
+typedef enum {
+    MOTION_DEST_PITCH_BEND = 0,
+    MOTION_DEST_MODULATION,     // CC 1
+    MOTION_DEST_EXPRESSION,     // CC 11
+    MOTION_DEST_NB
+} MotionDest_t;
+
+typedef struct {
+    bool enabled;
+    MotionSource_t source;
+    bool bipolar;               // true: source range is [-range, +range], false: [0, range]
+    float range;                // Source value giving full scale output
+    float dead_zone;            // Source values below this (in magnitude) map to the neutral output
+    MotionCurve_t curve;
+    uint16_t min_change;        // Minimum output change to send a new message (pitch bend: 14-bit units, CC: 7-bit units)
+    uint16_t max_rate_hz;       // Maximum message rate for this destination
+} MotionMapping_t;
+
+typedef struct {
+    uint32_t sent;              // Messages sent
+    /* Each withheld update (new target value) is counted once, under the first reason that held it back */
+    uint32_t below_threshold;   // Updates dropped by the minimum-change threshold
+    uint32_t rate_limited;      // Updates delayed by the per-destination rate limit
+    uint32_t budget_limited;    // Updates delayed because the link budget was reserved for notes
+} MotionDestStats_t;
+
+/* Function Prototypes -------------------------------------------------------*/
+
+/**
+ * @brief Initialize the motion controller with the default mappings
+ *        (roll -> pitch bend, pitch -> modulation, shake -> expression)
+ * @param channel: MIDI channel (1-16)
+ */
+void MOTION_MIDI_init(uint8_t channel);
+
+/**
+ * @brief Replace the mapping of a destination
+ */
+void MOTION_MIDI_set_mapping(MotionDest_t dest, const MotionMapping_t* mapping);
+
+/**
+ * @brief Feed a batch of IMU samples and the attitude estimated from them
+ * @param samples: Samples drained from the MPU6050 stream
+ * @param n: Number of samples
+ * @param att: Attitude estimator already updated with these samples
+ */
+void MOTION_MIDI_feed(const MPU6050_Sample_t* samples, uint16_t n, const ATTITUDE_t* att);
+
+/**
+ * @brief Send the pending controller updates allowed by the thresholds, the rate limits and the link budget
+ *        To be called from the main loop
+ */
+void MOTION_MIDI_process(void);
+
+/**
+ * @brief Get the message counters of a destination
+ */
+void MOTION_MIDI_get_stats(MotionDest_t dest, MotionDestStats_t* stats);
+
+/**
+ * @brief Print the message counters of every destination
+ */
+void MOTION_MIDI_print_stats(void);
+
+#endif /* USE_MOTION_MIDI */
+#endif /* MOTION_MIDI_H */
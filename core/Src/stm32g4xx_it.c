@@ -19,6 +19,7 @@
 #include "config.h"
 #include "stm32g4xx_it.h"
 /* Private includes ----------------------------------------------------------*/
+#include "stm32g4_flash.h"
 
 /* Private typedef -----------------------------------------------------------*/
 
@@ -50,7 +51,9 @@
   */
 void NMI_Handler(void)
 {
-
+  /* Double ECC error while reading the flash journal (doubleword torn by a power cut) : the read is dropped */
+  if (BSP_FLASH_ecc_error_handler())
+    return;
   while (1)
   {
   }
@@ -23,9 +23,65 @@
 #define SID_TOASTER_REQUEST_FOR_PROGRAM 		0x70
 #define SID_BOOTLOADER_PROGRAM_AVAILABLE 		0x71
 #define SID_BOOTLOADER_PROGRAM_NOT_AVAILABLE 	0x72
-#define SID_TOASTER_ASK_FOR_PACKET 				0x73
-#define SID_TOASTER_PACKET 						0x74
-#define PACKET_DATA_SIZE 						16384
+#define SID_TOASTER_SET_BAUDRATE 				0x75
+#define SID_BOOTLOADER_BAUDRATE 				0x76
+#define SID_TOASTER_CHUNK 						0x77
+#define SID_BOOTLOADER_CHUNK_ACK 				0x78
+#define SID_TOASTER_END 						0x79
+#define SID_BOOTLOADER_END 						0x7A
+#define SID_BOOTLOADER_READY 					0x7B
+#define SID_TOASTER_PAGE_CRC 					0x7C
+#define SID_BOOTLOADER_PAGE_CRC 				0x7D
+#define SID_TOASTER_CHUNK_LZ 					0x7E
+
+/*
+ * Transfert en flux : après l'effacement, le bootloader envoie READY. Le TOASTER envoie alors les morceaux (chunks) du programme
+ * sans attendre : jusqu'à STREAM_WINDOW morceaux non acquittés. Le DMA range les octets reçus dans un buffer circulaire pendant
+ * que le CPU programme le morceau précédent (le CPU est bloqué pendant les écritures en flash, pas le DMA).
+ * Chaque morceau est acquitté avec son numéro : le TOASTER ne renvoie que les morceaux non acquittés.
+ * Les morceaux d'une page sont rassemblés en RAM. La page est écrite lorsqu'elle est complète (le dernier morceau est acquitté après
+ * l'écriture) : effacée seulement si son contenu a changé, puis programmée par rangées de 32 doubles mots (programmation rapide)
+ * lorsque la tension du régulateur le permet. Le TOASTER envoie donc les pages l'une après l'autre, la page 0 (vecteur de reset) en dernier.
+ *
+ * Avant les morceaux, le TOASTER peut envoyer le CRC-32 de chaque page de 2ko de l'image (complétée par des 0xFF) : SID_TOASTER_PAGE_CRC, numéro de page, CRC.
+ * Le bootloader le compare à celui de la page programmée et répond 0 si elles sont identiques : la page n'est alors ni effacée, ni renvoyée.
+ *
+ * Trame d'un morceau : SOH | SID_TOASTER_CHUNK | numéro (2 octets) | CHUNK_SIZE octets | CRC-32 du numéro et des données (4 octets) | EOT
+ *
+ * Morceau compressé : SOH | SID_TOASTER_CHUNK_LZ | numéro (2 octets) | taille n (2 octets) | CRC-32 du morceau décompressé (4 octets) | n octets
+ * 						| CRC-32 de tout ce qui précède depuis le numéro (4 octets) | EOT
+ * Les données compressées sont une suite de séquences (à la manière de LZ4) : jeton | littéraux | source de la copie (3 octets)
+ * 	- jeton : nombre de littéraux (4 bits de poids fort) et longueur de la copie - 4 (4 bits de poids faible). 15 : la valeur continue
+ * 	  dans les octets suivants (ajoutés tant qu'ils valent 255), après le jeton pour les littéraux, après la source pour la copie.
+ * 	- source < 0x20000 : adresse dans la flash, relative à son début. Les pages non encore réécrites ont leur ancien contenu, ce qui
+ * 	  permet d'envoyer une mise à jour comme une différence avec le programme installé (delta). La page en cours n'est écrite qu'une
+ * 	  fois complète : son ancien contenu reste disponible pour tous ses morceaux.
+ * 	- source >= 0x800000 : recopie des octets déjà décompressés du morceau, à la distance (source - 0x800000).
+ * 	La dernière séquence n'a que des littéraux. Si le CRC du morceau décompressé est faux (programme installé différent de celui
+ * 	supposé par le TOASTER), le morceau est refusé (BL_FLASH_ERROR_CRC) : le TOASTER le renvoie non compressé.
+ */
+#define CHUNK_SIZE 								256
+#define CHUNK_FRAME_SIZE 						(CHUNK_SIZE + 9)
+#define CHUNK_LZ_HEADER_SIZE 					10		//SOH, SID, numéro, taille, CRC du morceau décompressé
+#define CHUNK_LZ_FRAME_SIZE(n) 					((n) + CHUNK_LZ_HEADER_SIZE + 5)
+#define CHUNKS_PER_PAGE 						(FLASH_PAGE_SIZE / CHUNK_SIZE)
+#define STREAM_WINDOW 							3
+#define STREAM_FORMATS 							0x01	//morceaux compressés acceptés
+#define STREAM_READY 							(CHUNK_SIZE << 16 | STREAM_WINDOW << 8 | STREAM_FORMATS)
+#define STREAM_RING_SIZE 						1024	//puissance de 2, doit contenir STREAM_WINDOW trames
+#define STREAM_IDLE_LOOPS 						20000000	//sans progression pendant ce nombre de boucles, READY est renvoyé
+#define BAUDRATE_CONFIRM_LOOPS 					4000000	//délai de confirmation d'une nouvelle vitesse, sinon retour à l'ancienne
+#define UART_CLOCK 								170000000
+#define BOOTLOADER_START 						0x08000800	//pages 1 à 3, jamais écrasées par le bootloader lui-même
+//Les cartes livrées avec l'ancien bootloader (page 1 seulement, paquets de 16ko) se mettent à jour une fois par SWD :
+//il ne sait pas se remplacer lui-même. tools/toaster_sender.py le détecte et refuse de lui envoyer un programme.
+#define BOOTLOADER_END 							0x08002000
+#define UART_MAX_BAUDRATE 						(UART_CLOCK / 16)
+#define FLASH_START_ADDRESS  					((int)0x08000000)
+#define FLASH_TOTAL_SIZE 						0x20000
+#define VIRTUAL_EEPROM_START 					0x0801F000	//pages 62 et 63 (voir STM32G431KBTX_FLASH.ld et stm32g4_flash.c), jamais écrites par le bootloader
+#define PROGRAM_MAX_SIZE 						(VIRTUAL_EEPROM_START - FLASH_START_ADDRESS)
+#define LZ_LOCAL_COPY 							0x800000
 
 typedef struct
 {
@@ -36,28 +92,43 @@ typedef struct
 
 typedef struct
 {
-	uint32_t size;
-	uint32_t crc;
-	uint32_t crc_calculated;
-	uint8_t packet_nb;
-	uint8_t data[PACKET_DATA_SIZE];
-}packet_t;
+	uint8_t ring[STREAM_RING_SIZE];		//rempli en continu par le DMA
+	uint32_t rd;						//index de lecture dans ring
+	uint32_t nb_chunks;
+	uint32_t to_write[2];				//un bit par page : page à écrire (ni identique, ni déjà écrite)
+	uint32_t page;						//page en cours de réception
+	uint32_t received;					//un bit par morceau reçu de la page en cours
+	uint32_t buffer[FLASH_PAGE_SIZE / 4];	//contenu de la page en cours
+}stream_t;
 
 #define bl_func __attribute__((section(".bootloader"))) static
 
-bl_func FLASH_Status FLASH_write_packet(uint32_t * address, packet_t * packet);
-bl_func void BL_FLASH_Erase(uint32_t program_size);
+bl_func FLASH_Status FLASH_write_page(stream_t * s);
+bl_func FLASH_Status FLASH_program_row(volatile uint32_t * address, uint32_t * row);
+bl_func uint8_t FLASH_check_page(stream_t * s, uint32_t page, uint32_t crc);
+bl_func uint32_t CRC_compute(uint8_t * data, uint32_t size);
+bl_func void FLASH_erase_page(uint32_t page);
 bl_func void Unlock(void);
 bl_func void Lock(void);
 bl_func FLASH_Status WaitForLastOperation(void);
 bl_func FLASH_Status GetStatus(void);
 bl_func void UART_write(uint8_t data);
 bl_func uint8_t UART_read(uint8_t * c);
-bl_func uint8_t TOASTER_receive(msg_t * msg, packet_t * packet, uint32_t timeout_nb_loops);
+bl_func void UART_set_brr(uint32_t brr);
+bl_func uint8_t TOASTER_receive(msg_t * msg, uint32_t timeout_nb_loops);
 bl_func uint8_t TOASTER_receive_B0(uint32_t timeout_nb_loops);
 bl_func void TOASTER_send_request_for_program(void);
-bl_func void TOASTER_ask_for_packet(uint8_t packet_number);
+bl_func void TOASTER_send(uint8_t sid, uint8_t size, uint32_t data);
 bl_func void msgToUART(msg_t * msg);
+bl_func void STREAM_init(stream_t * s, uint32_t nb_chunks);
+bl_func uint32_t STREAM_available(stream_t * s);
+bl_func uint8_t STREAM_peek(stream_t * s, uint32_t offset);
+bl_func uint32_t STREAM_word(stream_t * s, uint32_t offset);
+bl_func uint32_t STREAM_frame_size(stream_t * s, uint32_t available);
+bl_func uint8_t STREAM_check_chunk(stream_t * s, uint32_t frame_size);
+bl_func uint8_t STREAM_decode(stream_t * s, uint8_t * out, uint32_t size);
+bl_func FLASH_Status STREAM_chunk(stream_t * s, uint32_t index, uint32_t size);
+bl_func void STREAM_run(stream_t * s);
 
 //seule fonction publique de ce fichier !
 __attribute__((section(".bootloader.begin"))) void bootloader(uint32_t version_of_toaster)
@@ -89,7 +160,7 @@ __attribute__((section(".bootloader.begin"))) void bootloader(uint32_t version_o
     USART1->CR1 &= ~USART_CR1_UE;		//USART1 OFF
     USART1->CR1 = 0x0000000C;
     USART1->CR2 = 0x00000000;
-    USART1->CR3 = 0x00000000;
+    USART1->CR3 = USART_CR3_OVRDIS;	//en cas de débordement, l'octet perdu sera détecté par le CRC (OVRDIS ne s'écrit que USART désactivé)
     USART1->BRR = 0x00000171;
     USART1->PRESC = 0x00000000;
     CLEAR_BIT(USART1->CR2, (USART_CR2_LINEN | USART_CR2_CLKEN));
@@ -97,7 +168,7 @@ __attribute__((section(".bootloader.begin"))) void bootloader(uint32_t version_o
     USART1->CR1 |= USART_CR1_UE;		//USART1 ON
 
 	msg_t msg;
-	uint32_t nb_packets;
+	uint32_t nb_chunks;
 	uint32_t program_size;
 	uint32_t toaster_version_available;
 
@@ -116,13 +187,13 @@ __attribute__((section(".bootloader.begin"))) void bootloader(uint32_t version_o
 
 	//on attend une r�ponse pendant 10ms
 	uint8_t res;
-	res = TOASTER_receive(&msg, NULL, 40000000);//40000);	//fonction blocante avec timeout.
+	res = TOASTER_receive(&msg, 40000000);//40000);	//fonction blocante avec timeout.
 	//TODO r�duire le timeout lorsque le TOASTER sera correctement impl�ment�...
 
 	if(res == 1 && msg.sid == SID_BOOTLOADER_PROGRAM_AVAILABLE && msg.size >= 8)
 	{
 		toaster_version_available = msg.data[0];
-		nb_packets = U32FROMU8(0x00, msg.data[1], msg.data[2], msg.data[3]);
+		nb_chunks = U32FROMU8(0x00, msg.data[1], msg.data[2], msg.data[3]);
 		program_size = U32FROMU8(msg.data[4], msg.data[5], msg.data[6], msg.data[7]);
 	}
 	else
@@ -131,39 +202,27 @@ __attribute__((section(".bootloader.begin"))) void bootloader(uint32_t version_o
 	if(version_of_toaster == toaster_version_available)
 		return;	//on dispose d�j� de la version qui correspond � notre bluepill toaster... --> on rejoint le programme.
 
-	if (program_size > 120*1024)
+	if (program_size == 0 || program_size > PROGRAM_MAX_SIZE || nb_chunks * CHUNK_SIZE < program_size || nb_chunks * CHUNK_SIZE > PROGRAM_MAX_SIZE)
 		return;	//programme trop gros, on ne peut pas le charger.
 
 	Unlock();
-	//Erase la flash (en fonction de la taille du programme � recevoir)
-	BL_FLASH_Erase(program_size);
+	__HAL_FLASH_DATA_CACHE_DISABLE();	//les comparaisons doivent lire la flash, pas le cache
+	__HAL_FLASH_DATA_CACHE_RESET();
+	//la flash n'est plus effacée ici : chaque page l'est à la réception de son premier morceau, si elle a changé
 
-	FLASH_Status status;
-	packet_t packet;
-	for(int p = nb_packets-1; p>=0; )	//pas de p-- ici, on d�cr�mente qu'apr�s v�rification de validit� du packet.
-	{
-		//demander le packet (en partant du dernier, pour terminer par le d�but, moins risqu� en cas de coupure de communication ou de courant imminente)
-		TOASTER_ask_for_packet(p);
-
-		//r�ception du packet
-		if(TOASTER_receive(&msg, &packet, 400000000) && msg.sid == SID_TOASTER_PACKET)
-		{	//Si ok :
-			//�crire le packet dans la flash
-			uint32_t * address;
-			address = (uint32_t *)(0x08000000 + p * PACKET_DATA_SIZE);
-
-			status = FLASH_write_packet(address, &packet);
-
-			if (status == BL_FLASH_COMPLETE)
-				p--;
-		}
-	}
+	//Quelques centaines d'octets de RAM suffisent : la flash est programmée au fil de la réception
+	stream_t stream;
+	STREAM_init(&stream, nb_chunks);
+	TOASTER_send(SID_BOOTLOADER_READY, 4, STREAM_READY);
+	STREAM_run(&stream);
+	DMA1_Channel1->CCR = 0;		//le buffer est sur la pile
 
 	Lock();
 
 	while((USART1->ISR & USART_ISR_TC) == 0);	//attendre que la transmission soit termin�e !
 	RCC->APB2ENR = 0;
 	RCC->APB1ENR1 &= ~(1<<28);
+	CLEAR_BIT(RCC->AHB1ENR, RCC_AHB1ENR_DMA1EN | RCC_AHB1ENR_DMAMUX1EN | RCC_AHB1ENR_CRCEN);
 	CLEAR_BIT(RCC->AHB2ENR, RCC_AHB2ENR_GPIOAEN);	//GPIOA CLK OFF
 	CLEAR_BIT(RCC->APB2ENR, RCC_APB2ENR_USART1EN); 	//USART1 CLK OFF
 	//Fini, on reset !
@@ -188,6 +247,14 @@ void UART_write(uint8_t c)
 	USART1->TDR = (uint16_t)(c);
 }
 
+void UART_set_brr(uint32_t brr)
+{
+	while((USART1->ISR & USART_ISR_TC) == 0);	//la réponse doit partir à l'ancienne vitesse
+	USART1->CR1 &= ~USART_CR1_UE;
+	USART1->BRR = brr;
+	USART1->CR1 |= USART_CR1_UE;
+}
+
 #define USART_FLAG_ERRORS (USART_ISR_ORE | USART_ISR_NE | USART_ISR_FE | USART_ISR_PE)
 uint8_t UART_read(uint8_t * c)
 {
@@ -212,19 +279,21 @@ void TOASTER_send_request_for_program(void)
 	msg_t msg;
 	msg.sid = SID_TOASTER_REQUEST_FOR_PROGRAM;
 	msg.size = 4;
-	msg.data[0] = PACKET_DATA_SIZE>>24 & 0xFF;
-	msg.data[1] = PACKET_DATA_SIZE>>16 & 0xFF;
-	msg.data[2] = PACKET_DATA_SIZE>>8 & 0xFF;
-	msg.data[3] = PACKET_DATA_SIZE & 0xFF;
+	msg.data[0] = CHUNK_SIZE>>24 & 0xFF;
+	msg.data[1] = CHUNK_SIZE>>16 & 0xFF;
+	msg.data[2] = CHUNK_SIZE>>8 & 0xFF;
+	msg.data[3] = CHUNK_SIZE & 0xFF;
 	msgToUART(&msg);
 }
 
-void TOASTER_ask_for_packet(uint8_t packet_number)
+//envoi d'un message de 0 à 4 octets de données, poids fort en premier
+void TOASTER_send(uint8_t sid, uint8_t size, uint32_t data)
 {
 	msg_t msg;
-	msg.sid = SID_TOASTER_ASK_FOR_PACKET;
-	msg.size = 1;
-	msg.data[0] = packet_number;
+	msg.sid = sid;
+	msg.size = size;
+	for(uint8_t j = 0; j < size; j++)
+		msg.data[j] = data >> (8 * (size - 1 - j)) & 0xFF;
 	msgToUART(&msg);
 }
 
@@ -243,14 +312,13 @@ uint8_t TOASTER_receive_B0(uint32_t timeout_nb_loops)
 
 
 
-uint8_t TOASTER_receive(msg_t * msg, packet_t * packet, uint32_t timeout_nb_loops)
+uint8_t TOASTER_receive(msg_t * msg, uint32_t timeout_nb_loops)
 {
 	typedef enum{
 		WAIT_SOH,
 		WAIT_SID,
 		WAIT_SIZE,
 		RECEIVE_DATA,
-		RECEIVE_PACKET,
 		WAIT_EOT
 		}state_e;
 	state_e state;
@@ -259,7 +327,6 @@ uint8_t TOASTER_receive(msg_t * msg, packet_t * packet, uint32_t timeout_nb_loop
 
 	state = WAIT_SOH;
 
-	uint32_t packet_index;
 	do{
 		if(UART_read(&c))
 		{
@@ -287,37 +354,8 @@ uint8_t TOASTER_receive(msg_t * msg, packet_t * packet, uint32_t timeout_nb_loop
 					msg->data[msg->size - remaining_data] = c;
 					remaining_data--;
 					if(remaining_data == 0)
-					{
 						state = WAIT_EOT;
-						if(msg->sid == SID_TOASTER_PACKET && msg->size == 8)
-						{
-							if(packet != NULL)
-							{
-								state = RECEIVE_PACKET;
-								packet_index = 0;
-								packet->packet_nb = msg->data[0];
-								packet->size = U32FROMU8(0x00, msg->data[1], msg->data[2], msg->data[3]);
-								packet->crc = U32FROMU8(msg->data[4], msg->data[5], msg->data[6], msg->data[7]);
-								packet->crc_calculated = 0;
-							}
-						}
-					}
 				break;
-				case RECEIVE_PACKET:
-					packet->data[packet_index] = c;
-					packet_index++;
-					if(packet_index % 4 == 0)
-					{
-						packet->crc_calculated ^= U32FROMU8(packet->data[packet_index-1], packet->data[packet_index-2], packet->data[packet_index-3], packet->data[packet_index-4]);
-					}
-					if (packet_index == packet->size)
-					{
-						if(packet->crc == packet->crc_calculated)
-							state = WAIT_EOT;
-						else
-							state = WAIT_SOH;
-					}
-					break;
 				case WAIT_EOT:
 					if(c == EOT)
 						return 1;
@@ -350,85 +388,375 @@ void msgToUART(msg_t * msg)
 }
 
 
-#define FLASH_START_ADDRESS  ((int)0x08000000)
+/*
+ * Réception par DMA (DMA1 canal 1) dans le buffer circulaire, et calcul des CRC par l'unité CRC (CRC-32 IEEE 802.3).
+ */
+void STREAM_init(stream_t * s, uint32_t nb_chunks)
+{
+	s->rd = 0;
+	s->nb_chunks = nb_chunks;
+	s->received = 0;
+	s->to_write[0] = 0;
+	s->to_write[1] = 0;
+	//toutes les pages du programme, sauf celles du bootloader, sont à écrire tant que leur CRC n'a pas montré qu'elles n'ont pas changé
+	for(uint32_t page = 0; page <= (nb_chunks * CHUNK_SIZE - 1) / FLASH_PAGE_SIZE; page++)
+		if(page < (BOOTLOADER_START - FLASH_START_ADDRESS) / FLASH_PAGE_SIZE || page >= (BOOTLOADER_END - FLASH_START_ADDRESS) / FLASH_PAGE_SIZE)
+			s->to_write[page / 32] |= 1 << (page % 32);
+
+	RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN | RCC_AHB1ENR_DMAMUX1EN | RCC_AHB1ENR_CRCEN;
+	CRC->POL = 0x04C11DB7;
+	CRC->INIT = 0xFFFFFFFF;
+
+	DMA1_Channel1->CCR = 0;
+	DMAMUX1_Channel0->CCR = DMA_REQUEST_USART1_RX;
+	DMA1_Channel1->CPAR = (uint32_t)&USART1->RDR;
+	DMA1_Channel1->CMAR = (uint32_t)s->ring;
+	DMA1_Channel1->CNDTR = STREAM_RING_SIZE;
+	DMA1_Channel1->CCR = DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_EN;
+	USART1->ICR = USART_FLAG_ERRORS;
+	USART1->CR3 |= USART_CR3_DMAR;
+}
+
+uint32_t STREAM_available(stream_t * s)
+{
+	return (STREAM_RING_SIZE - DMA1_Channel1->CNDTR - s->rd) & (STREAM_RING_SIZE - 1);
+}
+
+uint8_t STREAM_peek(stream_t * s, uint32_t offset)
+{
+	return s->ring[(s->rd + offset) & (STREAM_RING_SIZE - 1)];
+}
 
-static void BL_FLASH_Erase(uint32_t program_size)
+//mot de 32 bits en petit boutiste, tel qu'il sera écrit en flash
+uint32_t STREAM_word(stream_t * s, uint32_t offset)
 {
-	uint32_t last_used_sector;
-	last_used_sector = ((program_size/PACKET_DATA_SIZE+1)*PACKET_DATA_SIZE / 0x800) + 1;
-	//Les secteurs 0 et 1 ne sont pas effac�s, ils contiennent le startup et le bootloader.
-		//le startup sera effac� au dernier moment, lors de son �crasement, pour ne pas risquer de perdre le lien vers le bootloader.
-		//le bootloader n'est jamais �cras� par le bootloader lui-m�me...
-	//on efface les suivants si n�cessaires selon l'adresse de fin du programme.
-	for(uint32_t s = 2; s<=last_used_sector; s++)
+	return U32FROMU8(STREAM_peek(s, offset + 3), STREAM_peek(s, offset + 2), STREAM_peek(s, offset + 1), STREAM_peek(s, offset));
+}
+
+//taille de la trame en tête du buffer, connue dès ses premiers octets. 0 si ces octets ne peuvent pas débuter une trame.
+uint32_t STREAM_frame_size(stream_t * s, uint32_t available)
+{
+	uint32_t size;
+	if(STREAM_peek(s, 0) != SOH)
+		return 0;
+	if(available < 3)
+		return 3;
+	switch(STREAM_peek(s, 1))
 	{
-		MODIFY_REG(FLASH->CR, FLASH_CR_PNB, (s << FLASH_CR_PNB_Pos));
-		FLASH->CR |= FLASH_CR_PER;
-		FLASH->CR |= FLASH_CR_STRT;
-		while(GetStatus() == BL_FLASH_BUSY);
-		CLEAR_BIT(FLASH->CR, (FLASH_CR_PER | FLASH_CR_PNB));
+		case SID_TOASTER_CHUNK:
+			return CHUNK_FRAME_SIZE;
+		case SID_TOASTER_CHUNK_LZ:
+			if(available < 6)
+				return 6;
+			size = U32FROMU8(0x00, 0x00, STREAM_peek(s, 4), STREAM_peek(s, 5));
+			return (size && size <= CHUNK_SIZE) ? CHUNK_LZ_FRAME_SIZE(size) : 0;
+		default:
+			return (STREAM_peek(s, 2) <= 8) ? (uint32_t)STREAM_peek(s, 2) + 4 : 0;
 	}
 }
 
-static FLASH_Status FLASH_write_packet(uint32_t * address, packet_t * packet)
+//vérifie le CRC-32 (depuis le numéro) et l'EOT de la trame de morceau complète en tête du buffer
+uint8_t STREAM_check_chunk(stream_t * s, uint32_t frame_size)
 {
-	FLASH_Status status;
-	uint32_t * data;
-	status = WaitForLastOperation();
+	uint32_t i;
+	CRC->CR = CRC_CR_REV_IN_0 | CRC_CR_REV_OUT | CRC_CR_RESET;
+	for(i = 2; i < frame_size - 5; i++)
+		*(volatile uint8_t *)&CRC->DR = STREAM_peek(s, i);
+	return STREAM_peek(s, frame_size - 1) == EOT
+			&& ~CRC->DR == U32FROMU8(STREAM_peek(s, i), STREAM_peek(s, i + 1), STREAM_peek(s, i + 2), STREAM_peek(s, i + 3));
+}
 
-	if(address == (uint32_t *)(0x08000000))
+//décompression des size octets de données du morceau compressé en tête du buffer : out reçoit exactement CHUNK_SIZE octets
+uint8_t STREAM_decode(stream_t * s, uint8_t * out, uint32_t size)
+{
+	uint32_t in = CHUNK_LZ_HEADER_SIZE;
+	uint32_t end = CHUNK_LZ_HEADER_SIZE + size;
+	uint32_t pos = 0;
+	uint32_t n, source;
+	uint8_t token, c;
+	uint8_t * from;
+
+	while(in < end)
 	{
-		MODIFY_REG(FLASH->CR, FLASH_CR_PNB, (0 << FLASH_CR_PNB_Pos));
-		FLASH->CR |= FLASH_CR_PER;
-		FLASH->CR |= FLASH_CR_STRT;		//on efface le secteur 0
-		while(GetStatus() == BL_FLASH_BUSY);
-		CLEAR_BIT(FLASH->CR, (FLASH_CR_PER | FLASH_CR_PNB));
+		token = STREAM_peek(s, in++);
+		n = token >> 4;
+		if(n == 15)
+			do{
+				c = STREAM_peek(s, in++);
+				n += c;
+			}while(c == 255 && in < end);
+		if(pos + n > CHUNK_SIZE || in + n > end)
+			return 0;
+		while(n--)
+			out[pos++] = STREAM_peek(s, in++);
+		if(in == end)
+			break;		//dernière séquence, sans copie
+
+		source = U32FROMU8(0x00, STREAM_peek(s, in), STREAM_peek(s, in + 1), STREAM_peek(s, in + 2));
+		in += 3;
+		n = (token & 0x0F) + 4;
+		if(n == 19)
+			do{
+				c = STREAM_peek(s, in++);
+				n += c;
+			}while(c == 255 && in < end);
+		if(pos + n > CHUNK_SIZE || in > end)
+			return 0;
+		if(source >= LZ_LOCAL_COPY)
+		{
+			source -= LZ_LOCAL_COPY;
+			if(source == 0 || source > pos)
+				return 0;
+			from = out + pos - source;		//les copies qui se recouvrent répètent un motif
+		}
+		else if(source + n <= FLASH_TOTAL_SIZE)
+			from = (uint8_t *)(FLASH_START_ADDRESS + source);
+		else
+			return 0;
+		while(n--)
+			out[pos++] = *from++;
 	}
+	return pos == CHUNK_SIZE;
+}
 
-	if(status == BL_FLASH_COMPLETE)
+/*
+ * Rangement du morceau en tête du buffer dans la page en cours (size : taille des données compressées, 0 pour un morceau non compressé).
+ * La page est écrite lorsque tous ses morceaux sont arrivés.
+ */
+FLASH_Status STREAM_chunk(stream_t * s, uint32_t index, uint32_t size)
+{
+	uint32_t page = index / CHUNKS_PER_PAGE;
+	uint32_t bit = 1 << (index % CHUNKS_PER_PAGE);
+	uint32_t complete, i;
+	uint8_t * out;
+
+	if((s->to_write[page / 32] & (1 << (page % 32))) == 0)
+		return BL_FLASH_COMPLETE;	//page du bootloader, identique, ou déjà écrite (acquittement perdu)
+	if(s->received && page != s->page)
+		return BL_FLASH_ERROR_PGS;	//une autre page est en cours
+	if(s->received == 0)
 	{
-		//__HAL_FLASH_DATA_CACHE_DISABLE();
+		s->page = page;
+		for(i = 0; i < FLASH_PAGE_SIZE / 4; i++)
+			s->buffer[i] = 0xFFFFFFFF;		//fin de page au-delà du programme
+	}
 
+	out = (uint8_t *)s->buffer + (index % CHUNKS_PER_PAGE) * CHUNK_SIZE;
+	s->received &= ~bit;
+	if(size == 0)
+	{
+		for(i = 0; i < CHUNK_SIZE; i++)
+			out[i] = STREAM_peek(s, 4 + i);
+	}
+	else if(!STREAM_decode(s, out, size)
+			|| CRC_compute(out, CHUNK_SIZE) != U32FROMU8(STREAM_peek(s, 6), STREAM_peek(s, 7), STREAM_peek(s, 8), STREAM_peek(s, 9)))
+		return BL_FLASH_ERROR_CRC;
+	s->received |= bit;
+
+	complete = s->nb_chunks - page * CHUNKS_PER_PAGE;
+	complete = (complete >= CHUNKS_PER_PAGE) ? (1 << CHUNKS_PER_PAGE) - 1 : (1 << complete) - 1;
+	if(s->received != complete)
+		return BL_FLASH_COMPLETE;
+	return FLASH_write_page(s);
+}
 
-		  /* Deactivate the data cache if they are activated to avoid data misbehavior */
-		    if(READ_BIT(FLASH->ACR, FLASH_ACR_DCEN) != 0U)
-		    {
-		      /* Disable data cache  */
-		      __HAL_FLASH_DATA_CACHE_DISABLE();
-		      //pFlash.CacheToReactivate = FLASH_CACHE_DCACHE_ENABLED;
-		    }
+/*
+ * Boucle de réception : traite les trames du buffer circulaire jusqu'au message SID_TOASTER_END.
+ * Un octet qui ne débute pas une trame valide est sauté : après une erreur, la synchronisation est retrouvée sur la trame suivante.
+ */
+void STREAM_run(stream_t * s)
+{
+	msg_t msg;
+	uint32_t available, frame_size, index, brr;
+	uint32_t idle = 0;
+	uint32_t confirm = 0;
+	uint32_t previous_brr = 0;
+	FLASH_Status status;
 
-		    /* Flush the caches to be sure of the data consistency */
-//		    FLASH_FlushCaches();
+	while(1)
+	{
+		if(confirm && --confirm == 0)
+			UART_set_brr(previous_brr);		//la nouvelle vitesse n'a pas été confirmée
 
-		/* if the previous operation is completed, proceed to program the new data */
-	//	FLASH->CR &= CR_PSIZE_MASK;
-	//	FLASH->CR |= FLASH_PSIZE_WORD;
-		FLASH->CR |= FLASH_CR_PG;
+		available = STREAM_available(s);
+		frame_size = available ? STREAM_frame_size(s, available) : 1;
+		if(frame_size == 0)
+		{
+			s->rd = (s->rd + 1) & (STREAM_RING_SIZE - 1);	//octet hors trame
+			continue;
+		}
+		if(available < frame_size)
+		{
+			if(++idle == STREAM_IDLE_LOOPS)
+			{
+				idle = 0;
+				if(available)
+					s->rd = (s->rd + 1) & (STREAM_RING_SIZE - 1);	//début de trame corrompue, jamais complétée
+				TOASTER_send(SID_BOOTLOADER_READY, 4, STREAM_READY);
+			}
+			continue;
+		}
+		idle = 0;
+
+		msg.sid = STREAM_peek(s, 1);
+		if((msg.sid == SID_TOASTER_CHUNK || msg.sid == SID_TOASTER_CHUNK_LZ) ? !STREAM_check_chunk(s, frame_size) : STREAM_peek(s, frame_size - 1) != EOT)
+		{
+			s->rd = (s->rd + 1) & (STREAM_RING_SIZE - 1);
+			continue;
+		}
+		confirm = 0;
 
-		data = (uint32_t *)packet->data;
-		volatile uint32_t * a;
-		for(uint32_t i = 0; i<packet->size/8; i++)
+		if(msg.sid == SID_TOASTER_CHUNK || msg.sid == SID_TOASTER_CHUNK_LZ)
 		{
-			a = (uint32_t*)(address+2*i);
-			if (a < (uint32_t *)0x08000800 || a >= (uint32_t *)0x08001000)	//on �crase pas le secteur 1 (bootloader)!
+			index = U32FROMU8(0x00, 0x00, STREAM_peek(s, 2), STREAM_peek(s, 3));
+			if(index >= s->nb_chunks)
+				status = BL_FLASH_ERROR_PGA;
+			else
+				status = STREAM_chunk(s, index, (msg.sid == SID_TOASTER_CHUNK) ? 0 : frame_size - CHUNK_LZ_FRAME_SIZE(0));
+			s->rd = (s->rd + frame_size) & (STREAM_RING_SIZE - 1);
+			TOASTER_send(SID_BOOTLOADER_CHUNK_ACK, 3, index << 8 | status);
+			continue;
+		}
+
+		msg.size = STREAM_peek(s, 2);
+		for(index = 0; index < msg.size; index++)
+			msg.data[index] = STREAM_peek(s, 3 + index);
+		s->rd = (s->rd + frame_size) & (STREAM_RING_SIZE - 1);
+
+		if(msg.sid == SID_TOASTER_END)
+		{
+			TOASTER_send(SID_BOOTLOADER_END, 0, 0);
+			return;
+		}
+		if(msg.sid == SID_TOASTER_PAGE_CRC && msg.size == 5)
+		{
+			index = msg.data[0];
+			TOASTER_send(SID_BOOTLOADER_PAGE_CRC, 2, index << 8 | FLASH_check_page(s, index, U32FROMU8(msg.data[1], msg.data[2], msg.data[3], msg.data[4])));
+		}
+		if(msg.sid == SID_TOASTER_SET_BAUDRATE && msg.size == 4)
+		{
+			//la réponse est envoyée à la vitesse actuelle. Le TOASTER doit confirmer en renvoyant la même demande à la nouvelle vitesse.
+			index = U32FROMU8(msg.data[0], msg.data[1], msg.data[2], msg.data[3]);
+			brr = (index && index <= UART_MAX_BAUDRATE) ? (UART_CLOCK + index / 2) / index : 0;
+			TOASTER_send(SID_BOOTLOADER_BAUDRATE, 4, brr ? index : 0);
+			if(brr && brr != USART1->BRR)
 			{
-				//uint32_t dh = U32FROMU8(data[4*i], data[4*i+1], data[4*i+2], data[4*i+3]);
-				//uint32_t dl = U32FROMU8(data[4*i+3], data[4*i+2], data[4*i+1], data[4*i]);
-				*a = data[2*i];
-				__ISB();
-				*(a+1) = data[2*i+1];
-				status = WaitForLastOperation();
-				if(*a != data[2*i] || *(a+1) != data[2*i+1])
-					status = BL_FLASH_ERROR_PROGRAM;
+				previous_brr = USART1->BRR;
+				UART_set_brr(brr);
+				confirm = BAUDRATE_CONFIRM_LOOPS;
 			}
-			if (status != BL_FLASH_COMPLETE)
-				break;
 		}
-		/* if the program operation is completed, disable the PG Bit */
-		FLASH->CR &= (~FLASH_CR_PG);
 	}
-	/* Return the Program Status */
+}
+
+static void FLASH_erase_page(uint32_t page)
+{
+	MODIFY_REG(FLASH->CR, FLASH_CR_PNB, (page << FLASH_CR_PNB_Pos));
+	FLASH->CR |= FLASH_CR_PER;
+	FLASH->CR |= FLASH_CR_STRT;
+	while(GetStatus() == BL_FLASH_BUSY);
+	CLEAR_BIT(FLASH->CR, (FLASH_CR_PER | FLASH_CR_PNB));
+}
+
+//CRC-32 de size octets, calculé par l'unité CRC comme celui des trames
+static uint32_t CRC_compute(uint8_t * data, uint32_t size)
+{
+	CRC->CR = CRC_CR_REV_IN_0 | CRC_CR_REV_OUT | CRC_CR_RESET;
+	for(uint32_t i = 0; i < size; i++)
+		*(volatile uint8_t *)&CRC->DR = data[i];
+	return ~CRC->DR;
+}
+
+//renvoie 0 si la page programmée est identique à celle de l'image (elle ne sera pas écrite), 1 si elle doit être envoyée, 0xFF si elle est hors du programme
+static uint8_t FLASH_check_page(stream_t * s, uint32_t page, uint32_t crc)
+{
+	if(page > (s->nb_chunks * CHUNK_SIZE - 1) / FLASH_PAGE_SIZE)
+		return 0xFF;
+	if((s->to_write[page / 32] & (1 << (page % 32))) == 0)
+		return 0;		//page du bootloader, ou déjà reconnue identique
+	if(s->received && page == s->page)
+		return 1;		//page en cours de réception
+	if(CRC_compute((uint8_t *)(FLASH_START_ADDRESS + page * FLASH_PAGE_SIZE), FLASH_PAGE_SIZE) != crc)
+		return 1;
+	s->to_write[page / 32] &= ~(1 << (page % 32));
+	return 0;
+}
+
+/*
+ * Programmation d'une rangée de 32 doubles mots (256 octets) effacée.
+ * En range 1, programmation rapide : les écritures s'enchaînent sans attendre, la haute tension reste appliquée pendant toute la rangée.
+ * Si la programmation rapide échoue (MISERR, FASTERR), la rangée est reprise avec la programmation normale par double mot.
+ */
+static FLASH_Status FLASH_program_row(volatile uint32_t * address, uint32_t * row)
+{
+	FLASH_Status status = BL_FLASH_COMPLETE;
+	uint32_t i;
+
+	for(i = 0; i < CHUNK_SIZE / 4 && row[i] == 0xFFFFFFFF; i++);
+	if(i == CHUNK_SIZE / 4)
+		return status;		//rangée vide : déjà effacée
+
+	if((PWR->CR1 & PWR_CR1_VOS) == PWR_CR1_VOS_0)
+	{
+		FLASH->CR |= FLASH_CR_FSTPG;
+		for(i = 0; i < CHUNK_SIZE / 4; i++)
+			address[i] = row[i];
+		status = WaitForLastOperation();
+		FLASH->CR &= ~FLASH_CR_FSTPG;
+		if(status == BL_FLASH_COMPLETE || (FLASH->SR & (FLASH_FLAG_MISERR | FLASH_FLAG_FASTERR)) == 0)
+			return status;
+		//rangée interrompue (MISERR, FASTERR) : elle est reprise double mot par double mot, sans ceux déjà programmés
+		FLASH->SR = FLASH_FLAG_SR_ERRORS;
+		status = BL_FLASH_COMPLETE;
+	}
+
+	FLASH->CR |= FLASH_CR_PG;
+	for(i = 0; i < CHUNK_SIZE / 4 && status == BL_FLASH_COMPLETE; i += 2)
+	{
+		if(address[i] == row[i] && address[i+1] == row[i+1])
+			continue;
+		address[i] = row[i];
+		__ISB();
+		address[i+1] = row[i+1];
+		status = WaitForLastOperation();
+	}
+	/* if the program operation is completed, disable the PG Bit */
+	FLASH->CR &= (~FLASH_CR_PG);
+	return status;
+}
+
+/*
+ * Ecriture de la page en cours, complète dans le buffer.
+ * Elle n'est effacée que si son contenu a changé. L'effacement et la programmation s'enchaînent : la page 0 (vecteur de reset)
+ * reste vide le moins longtemps possible.
+ */
+static FLASH_Status FLASH_write_page(stream_t * s)
+{
+	FLASH_Status status;
+	volatile uint32_t * a;
+	uint32_t i;
+
+	a = (uint32_t *)(FLASH_START_ADDRESS + s->page * FLASH_PAGE_SIZE);
+	FLASH->SR = FLASH_FLAG_SR_ERRORS;		//une erreur précédente ne doit pas bloquer les pages suivantes
+	status = WaitForLastOperation();
+
+	for(i = 0; i < FLASH_PAGE_SIZE / 4 && a[i] == s->buffer[i]; i++);
+	if(status == BL_FLASH_COMPLETE && i < FLASH_PAGE_SIZE / 4)
+	{
+		FLASH_erase_page(s->page);
+		for(i = 0; i < FLASH_PAGE_SIZE / 4 && status == BL_FLASH_COMPLETE; i += CHUNK_SIZE / 4)
+			status = FLASH_program_row(a + i, s->buffer + i);
+		for(i = 0; i < FLASH_PAGE_SIZE / 4 && status == BL_FLASH_COMPLETE; i++)
+			if(a[i] != s->buffer[i])
+				status = BL_FLASH_ERROR_PROGRAM;
+	}
+
+	//en cas d'erreur, la page reste complète dans le buffer : elle sera réécrite au renvoi de son dernier morceau
+	if(status == BL_FLASH_COMPLETE)
+	{
+		s->to_write[s->page / 32] &= ~(1 << (s->page % 32));
+		s->received = 0;
+	}
 	return status;
 }
 
@@ -465,7 +793,7 @@ static FLASH_Status GetStatus(void)
 		return BL_FLASH_BUSY;
 	if(sr & FLASH_FLAG_WRPERR)
 		return BL_FLASH_ERROR_WRP;
-	if(sr & (uint32_t)0xEF)
+	if(sr & ((uint32_t)0xEF | FLASH_FLAG_MISERR | FLASH_FLAG_FASTERR))
 		return BL_FLASH_ERROR_PROGRAM;
 	if(sr & FLASH_FLAG_OPERR)
 		return BL_FLASH_ERROR_OPERATION;
@@ -81,6 +81,15 @@
  *					6. Quand une IT a été levée, appeler la méthode de traitement de geste créée lors de l'étape 4
  *					   (dans la tâche de fond par exemple).
  *
+ *		    readGesture() bloque le CPU pendant toute la durée du geste. Le moteur de gestes sur interruption fait
+ *		    la même chose en tâche de fond :
+ *					1. Initialiser le capteur : init()
+ *					2. Démarrer le moteur : gesture_start(GPIOB, GPIO_PIN_6) (broche INT du capteur)
+ *					3. Appeler gesture_process_main() dans la tâche de fond
+ *					4. Récupérer les gestes reconnus : gesture_get_event()
+ *			  Chaque IT vide la FIFO du capteur par DMA vers un buffer circulaire, le décodage est fait au fil de l'eau
+ *			  par gesture_process_main() et un événement est produit à la fin de chaque geste.
+ *
  *
  *************************************************************************************************************************
  *
@@ -100,10 +109,29 @@
 #include "stm32g4xx_hal.h"
 #include "stm32g4_gpio.h"
 #include "stm32g4_i2c.h"
+#include "stm32g4_extit.h"
 #include "stm32g4_uart.h"
 #include "stm32g4_utils.h"
 #include "stdlib.h"
 #include <stdio.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define GESTURE_RING_MASK       (APDS9960_GESTURE_RING_SIZE - 1)
+#define GESTURE_EVENTS_MASK     (APDS9960_GESTURE_EVENTS - 1)
+#define GESTURE_FIFO_DATASETS   32      // Capacité de la FIFO du capteur
+
+#if (APDS9960_GESTURE_RING_SIZE & GESTURE_RING_MASK) != 0 || (APDS9960_GESTURE_EVENTS & GESTURE_EVENTS_MASK) != 0
+	#error "APDS9960_GESTURE_RING_SIZE et APDS9960_GESTURE_EVENTS doivent être des puissances de 2"
+#endif
+
+/* Private types -------------------------------------------------------------*/
+typedef enum
+{
+	GESTURE_XFER_IDLE,
+	GESTURE_XFER_LEVEL,		//lecture de GFLVL et GSTATUS
+	GESTURE_XFER_FIFO		//lecture des jeux U/D/L/R
+}gesture_xfer_e;
 
 
 /* Private variables ---------------------------------------------------------*/
@@ -117,6 +145,39 @@ int gesture_far_count_;
 int gesture_state_;
 int gesture_motion_;
 
+/*
+ * Moteur de gestes sur interruption :
+ * 	- l'IT de la broche INT (FIFO au-delà de GFIFOTH) lance la lecture DMA de GFLVL/GSTATUS puis de toute la FIFO,
+ * 	  et on recommence tant que la FIFO n'est pas vide (la broche INT remonte alors),
+ * 	- le callback de fin de transfert sépare les voies U/D/L/R dans des tableaux compacts (buffer circulaire),
+ * 	- APDS9960_gesture_process_main() décode les jeux par fenêtres au fil de l'eau et publie un événement
+ * 	  quand plus aucune donnée n'arrive depuis FIFO_PAUSE_TIME.
+ */
+static volatile bool gesture_running = false;
+static volatile gesture_xfer_e gesture_xfer = GESTURE_XFER_IDLE;
+static GPIO_TypeDef * gesture_int_port;
+static uint16_t gesture_int_pin;
+static uint8_t gesture_pin_number;
+static uint8_t gesture_rx[GESTURE_FIFO_DATASETS * 4];
+static uint8_t gesture_burst;
+
+static uint8_t ring_u[APDS9960_GESTURE_RING_SIZE];
+static uint8_t ring_d[APDS9960_GESTURE_RING_SIZE];
+static uint8_t ring_l[APDS9960_GESTURE_RING_SIZE];
+static uint8_t ring_r[APDS9960_GESTURE_RING_SIZE];
+static volatile uint32_t ring_head = 0;		//écrit par le callback I2C
+static volatile uint32_t ring_tail = 0;		//écrit par gesture_process_main()
+static volatile uint32_t gesture_last_data_ms;
+
+static bool gesture_in_progress = false;	//des jeux ont été reçus, le geste n'est pas encore conclu
+static bool gesture_final_drain = false;	//dernière lecture de la FIFO (jeux sous le seuil d'IT) déjà lancée
+static uint8_t gesture_datasets;
+static APDS9960_gesture_event_t events[APDS9960_GESTURE_EVENTS];
+static uint32_t events_head = 0;
+static uint32_t events_tail = 0;
+
+static volatile APDS9960_gesture_stats_t gesture_stats;
+
 
 /* Private function prototypes -----------------------------------------------*/
 
@@ -125,6 +186,14 @@ void APDS9960_resetGestureParameters();
 bool APDS9960_processGestureData();
 bool APDS9960_decodeGesture();
 
+/* Interrupt-driven gesture engine */
+static void APDS9960_gesture_int_callback(uint8_t pin_number);
+static void APDS9960_gesture_launch(void);
+static void APDS9960_gesture_level_done(HAL_StatusTypeDef status);
+static void APDS9960_gesture_fifo_done(HAL_StatusTypeDef status);
+static void APDS9960_gesture_window(void);
+static void APDS9960_gesture_conclude(void);
+
 /* Proximity Interrupt Threshold */
 uint8_t APDS9960_getProxIntLowThresh();
 void APDS9960_setProxIntLowThresh(uint8_t threshold);
@@ -192,6 +261,9 @@ bool APDS9960_init() {
         return false;
     }
 
+    /* Les écritures d'init sont regroupées (registres contigus fusionnés, envoi par DMA) */
+    BSP_I2C_batch_begin(APDS9960_I2C);
+
     /* Set ENABLE register to 0 (disable all features) */
     APDS9960_setMode(ALL, OFF);
 
@@ -228,6 +300,9 @@ bool APDS9960_init() {
     wireWriteDataByte(APDS9960_GCONF3, DEFAULT_GCONF3);
     APDS9960_setGestureIntEnable(DEFAULT_GIEN);
 
+    if(BSP_I2C_batch_end(APDS9960_I2C) != HAL_OK) {
+        return false;
+    }
 
     /* Gesture config register dump */
     uint8_t reg;
@@ -963,6 +1038,21 @@ void APDS9960_readBlueLight(uint16_t *val) {
     *val = *val + ((uint16_t)val_byte << 8);
 }
 
+/**
+ * @brief Lit les quatre canaux (clair, rouge, vert, bleu) en une seule lecture I2C
+ * @param crgb: tableau de 4 valeurs sur 16 bits, dans l'ordre clair, rouge, vert, bleu
+ * @note  Les 8 registres CDATAL..BDATAH sont contigus : une seule transaction au lieu de 8,
+ *        et les 4 valeurs proviennent du même cycle d'intégration.
+ */
+void APDS9960_readColors(uint16_t crgb[4]) {
+    uint8_t raw[8];
+
+    wireReadDataBlock(APDS9960_CDATAL, raw, sizeof(raw));
+    for(uint8_t i = 0; i < 4; i++) {
+        crgb[i] = (uint16_t)(raw[2*i] | ((uint16_t)raw[2*i + 1] << 8));
+    }
+}
+
 
 /**
  * @brief Lit le niveau de proximité en tant que valeur sur 8 bits
@@ -1079,6 +1169,7 @@ int APDS9960_readGesture() {
  * @param val: la valeur retournée depuis le registre
  */
 void wireReadDataByte(uint8_t reg, uint8_t *val) {
+	BSP_I2C_batch_flush(APDS9960_I2C);	//les écritures en file doivent précéder la lecture
 	BSP_I2C_Read(APDS9960_I2C, APDS9960_I2C_ADDR<<1, reg, val);
 }
 
@@ -1089,6 +1180,7 @@ void wireReadDataByte(uint8_t reg, uint8_t *val) {
  * @param len: nombre d'octets à lire
  */
 void wireReadDataBlock(uint8_t reg, uint8_t *val, unsigned int len) {
+	BSP_I2C_batch_flush(APDS9960_I2C);
 	BSP_I2C_ReadMulti(APDS9960_I2C, APDS9960_I2C_ADDR<<1, reg, val, len);
 }
 
@@ -1112,7 +1204,7 @@ void wireWriteByte(uint8_t val) {
  * @param val: la valeur d'un octet à écrire dans le périphérique I2C
  */
 void wireWriteDataByte(uint8_t reg, uint8_t val) {
-	BSP_I2C_Write(APDS9960_I2C, APDS9960_I2C_ADDR<<1, reg, val);
+	BSP_I2C_batch_write(APDS9960_I2C, APDS9960_I2C_ADDR<<1, reg, &val, 1);
 }
 
 /**
@@ -1122,7 +1214,7 @@ void wireWriteDataByte(uint8_t reg, uint8_t val) {
  * @param len: la longueur (en octets) des données à écrire
  */
 void wireWriteDataBlock(uint8_t reg, uint8_t *val, unsigned int len) {
-	BSP_I2C_WriteMulti(APDS9960_I2C, APDS9960_I2C_ADDR<<1, reg, val, len);
+	BSP_I2C_batch_write(APDS9960_I2C, APDS9960_I2C_ADDR<<1, reg, val, (uint16_t)len);
 }
 
 /* ------------------------------------------------------------- */
@@ -1784,4 +1876,274 @@ bool APDS9960_decodeGesture() {
     return true;
 }
 
+/* ------------------Interrupt-driven gesture engine------------ */
+
+/**
+ * @brief Démarre le moteur de gestes : la FIFO est vidée par DMA à chaque IT et les gestes décodés en tâche de fond
+ * @param GPIOx, GPIO_PIN_x: broche reliée à la sortie INT (drain ouvert, active basse) du capteur
+ * @pre   APDS9960_init() doit avoir été appelée
+ * @note  APDS9960_gesture_process_main() doit ensuite être appelée régulièrement dans la tâche de fond
+ */
+void APDS9960_gesture_start(GPIO_TypeDef * GPIOx, uint16_t GPIO_PIN_x)
+{
+	APDS9960_gesture_stop();
+
+	gesture_int_port = GPIOx;
+	gesture_int_pin = GPIO_PIN_x;
+	gesture_pin_number = BSP_EXTIT_gpiopin_to_pin_number(GPIO_PIN_x);
+	ring_head = ring_tail = 0;
+	events_head = events_tail = 0;
+	gesture_in_progress = false;
+	gesture_final_drain = false;
+	gesture_datasets = 0;
+	memset((void *)&gesture_stats, 0, sizeof(gesture_stats));
+
+	BSP_GPIO_pin_config(GPIOx, GPIO_PIN_x, GPIO_MODE_IT_FALLING, GPIO_PULLUP, GPIO_SPEED_FREQ_HIGH, GPIO_NO_AF);
+	APDS9960_enableGestureSensor(true);
+
+	gesture_running = true;
+	BSP_EXTIT_set_callback(&APDS9960_gesture_int_callback, gesture_pin_number, true);
+}
+
+/**
+ * @brief Arrête le moteur de gestes (IT désactivée, mode geste du capteur désactivé)
+ * @post  Les événements non lus restent disponibles
+ */
+void APDS9960_gesture_stop(void)
+{
+	if(!gesture_running)
+		return;
+	BSP_EXTIT_disable(gesture_pin_number);
+	gesture_running = false;
+	while(gesture_xfer != GESTURE_XFER_IDLE);	//on laisse se terminer la lecture en cours
+	APDS9960_disableGestureSensor();
+}
+
+/**
+ * @brief Décodage des jeux reçus et détection de la fin des gestes. A appeler dans la tâche de fond.
+ */
+void APDS9960_gesture_process_main(void)
+{
+	uint32_t primask;
+	uint32_t idx;
+	uint8_t n;
+
+	if(!gesture_running)
+		return;
+
+	/* La broche INT reste basse tant que la FIFO n'est pas vidée : rattrape une IT survenue alors que le bus était occupé */
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if(gesture_xfer == GESTURE_XFER_IDLE && HAL_GPIO_ReadPin(gesture_int_port, gesture_int_pin) == GPIO_PIN_RESET)
+		APDS9960_gesture_launch();
+	__set_PRIMASK(primask);
+
+	/* Décodage au fil de l'eau, par fenêtres de APDS9960_GESTURE_WINDOW jeux */
+	while(ring_tail != ring_head)
+	{
+		idx = ring_tail & GESTURE_RING_MASK;
+		n = gesture_data_.total_gestures;
+		gesture_data_.u_data[n] = ring_u[idx];
+		gesture_data_.d_data[n] = ring_d[idx];
+		gesture_data_.l_data[n] = ring_l[idx];
+		gesture_data_.r_data[n] = ring_r[idx];
+		gesture_data_.index++;
+		gesture_data_.total_gestures++;
+		ring_tail++;
+
+		if(gesture_datasets < 0xFF)
+			gesture_datasets++;
+		gesture_in_progress = true;
+		gesture_final_drain = false;
+		if(gesture_data_.total_gestures >= APDS9960_GESTURE_WINDOW)
+			APDS9960_gesture_window();
+	}
+
+	/* Fin du geste : plus aucun jeu depuis FIFO_PAUSE_TIME */
+	if(gesture_in_progress && gesture_xfer == GESTURE_XFER_IDLE
+			&& HAL_GetTick() - gesture_last_data_ms > FIFO_PAUSE_TIME)
+	{
+		if(!gesture_final_drain)
+		{
+			/* Les derniers jeux, sous le seuil GFIFOTH, ne déclenchent pas d'IT : on les lit avant de conclure */
+			gesture_final_drain = true;
+			primask = __get_PRIMASK();
+			__disable_irq();
+			if(gesture_xfer == GESTURE_XFER_IDLE)
+				APDS9960_gesture_launch();
+			__set_PRIMASK(primask);
+		}
+		else
+			APDS9960_gesture_conclude();
+	}
+}
+
+/**
+ * @brief Récupère le plus ancien geste reconnu
+ * @return true si un événement a été copié dans event
+ */
+bool APDS9960_gesture_get_event(APDS9960_gesture_event_t * event)
+{
+	if(events_tail == events_head)
+		return false;
+	*event = events[events_tail & GESTURE_EVENTS_MASK];
+	events_tail++;
+	return true;
+}
+
+/**
+ * @brief Copie les statistiques du moteur de gestes
+ */
+void APDS9960_gesture_get_stats(APDS9960_gesture_stats_t * stats)
+{
+	__disable_irq();
+	*stats = gesture_stats;
+	__enable_irq();
+}
+
+/**
+ * @brief Démonstration du moteur de gestes : la tâche de fond reste libre pendant les gestes
+ */
+void APDS9960_demo_gesture(void)
+{
+	static const char * names[] = {"NONE", "LEFT", "RIGHT", "UP", "DOWN", "NEAR", "FAR", "ALL"};
+	APDS9960_gesture_event_t event;
+
+	APDS9960_init();
+	APDS9960_gesture_start(GPIOB, GPIO_PIN_6);
+	while(1)
+	{
+		APDS9960_gesture_process_main();
+		if(APDS9960_gesture_get_event(&event))
+			printf("Geste : %s (%d jeux)\n", names[event.direction], event.datasets);
+	}
+}
+
+/**
+ * @brief IT de la broche INT : la FIFO a atteint son seuil
+ */
+static void APDS9960_gesture_int_callback(uint8_t pin_number)
+{
+	UNUSED(pin_number);
+	if(gesture_xfer == GESTURE_XFER_IDLE)
+		APDS9960_gesture_launch();
+	//sinon, la lecture en cours relira le niveau de la FIFO avant de s'arrêter
+}
+
+/**
+ * @brief Lecture du niveau de la FIFO (GFLVL) et de GSTATUS, registres contigus
+ * @note  Si le bus est occupé par un autre module, APDS9960_gesture_process_main() réessaiera tant que INT est basse
+ */
+static void APDS9960_gesture_launch(void)
+{
+	gesture_xfer = GESTURE_XFER_LEVEL;
+	if(BSP_I2C_ReadMulti_DMA(APDS9960_I2C, APDS9960_I2C_ADDR<<1, APDS9960_GFLVL, gesture_rx, 2, &APDS9960_gesture_level_done) != HAL_OK)
+		gesture_xfer = GESTURE_XFER_IDLE;
+}
+
+static void APDS9960_gesture_level_done(HAL_StatusTypeDef status)
+{
+	uint8_t level;
+	if(status != HAL_OK)
+	{
+		gesture_stats.bus_errors++;
+		gesture_xfer = GESTURE_XFER_IDLE;
+		return;
+	}
+	level = gesture_rx[0];
+	if(gesture_rx[1] & APDS9960_GFOV)
+		gesture_stats.fifo_overflows++;
+	if(level > GESTURE_FIFO_DATASETS)
+		level = GESTURE_FIFO_DATASETS;
+	if(level == 0 || !gesture_running)
+	{
+		gesture_xfer = GESTURE_XFER_IDLE;	//FIFO vide : INT est remontée
+		return;
+	}
+	gesture_burst = level;
+	gesture_xfer = GESTURE_XFER_FIFO;
+	if(BSP_I2C_ReadMulti_DMA(APDS9960_I2C, APDS9960_I2C_ADDR<<1, APDS9960_GFIFO_U, gesture_rx, (uint16_t)(level * 4), &APDS9960_gesture_fifo_done) != HAL_OK)
+		gesture_xfer = GESTURE_XFER_IDLE;
+}
+
+static void APDS9960_gesture_fifo_done(HAL_StatusTypeDef status)
+{
+	uint32_t head;
+	uint32_t idx;
+	uint8_t * p;
+	if(status != HAL_OK)
+	{
+		gesture_stats.bus_errors++;
+		gesture_xfer = GESTURE_XFER_IDLE;
+		return;
+	}
+	head = ring_head;
+	p = gesture_rx;
+	for(uint8_t i = 0; i < gesture_burst; i++, p += 4)
+	{
+		if(head - ring_tail >= APDS9960_GESTURE_RING_SIZE)
+		{
+			gesture_stats.dropped++;	//le décodeur est en retard : on ne détruit pas les jeux non lus
+			continue;
+		}
+		idx = head & GESTURE_RING_MASK;
+		ring_u[idx] = p[0];
+		ring_d[idx] = p[1];
+		ring_l[idx] = p[2];
+		ring_r[idx] = p[3];
+		head++;
+	}
+	ring_head = head;
+	gesture_last_data_ms = HAL_GetTick();
+	gesture_stats.datasets += gesture_burst;
+	gesture_stats.bursts++;
+
+	/* La FIFO a pu se remplir pendant la lecture : on relit son niveau jusqu'à ce qu'elle soit vide */
+	APDS9960_gesture_launch();
+}
+
+/**
+ * @brief Traite une fenêtre de jeux, comme un lot de FIFO de APDS9960_readGesture()
+ */
+static void APDS9960_gesture_window(void)
+{
+	if( APDS9960_processGestureData() ) {
+		APDS9960_decodeGesture();
+	}
+	gesture_data_.index = 0;
+	gesture_data_.total_gestures = 0;
+}
+
+/**
+ * @brief Conclut le geste en cours : direction la plus probable, publication de l'événement, remise à zéro
+ */
+static void APDS9960_gesture_conclude(void)
+{
+	APDS9960_gesture_event_t * event;
+
+	if(gesture_data_.total_gestures)
+		APDS9960_gesture_window();
+	APDS9960_decodeGesture();
+
+	if(gesture_motion_ != DIR_NONE)
+	{
+		if(events_head - events_tail >= APDS9960_GESTURE_EVENTS)
+			gesture_stats.events_lost++;
+		else
+		{
+			event = &events[events_head & GESTURE_EVENTS_MASK];
+			event->direction = (uint8_t)gesture_motion_;
+			event->datasets = gesture_datasets;
+			event->timestamp_ms = gesture_last_data_ms;
+			events_head++;
+		}
+	}
+	APDS9960_resetGestureParameters();
+	gesture_in_progress = false;
+	gesture_final_drain = false;
+	gesture_datasets = 0;
+}
+
+/* ------------------------------------------------------------- */
+
 #endif
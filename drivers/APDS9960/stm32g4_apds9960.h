@@ -38,6 +38,13 @@
 /* Misc parameters */
 #define FIFO_PAUSE_TIME         30      // Wait period (ms) between FIFO reads
 
+/* Interrupt-driven gesture engine */
+#ifndef APDS9960_GESTURE_RING_SIZE
+#define APDS9960_GESTURE_RING_SIZE  64  // U/D/L/R datasets buffered between the I2C callback and the decoder, power of 2
+#endif
+#define APDS9960_GESTURE_WINDOW     8   // Datasets per decoding step (the FIFO batch of the polled version)
+#define APDS9960_GESTURE_EVENTS     8   // Decoded gestures waiting to be read, power of 2
+
 /* APDS-9960 register addresses */
 #define APDS9960_ENABLE         0x80
 #define APDS9960_ATIME          0x81
@@ -98,6 +105,7 @@
 #define APDS9960_PIEN           0b00100000
 #define APDS9960_GEN            0b01000000
 #define APDS9960_GVALID         0b00000001
+#define APDS9960_GFOV           0b00000010
 
 /* On/Off definitions */
 #define OFF                     0
@@ -217,6 +225,22 @@ typedef struct gesture_data_type {
     uint8_t out_threshold;
 } gesture_data_type;
 
+/* Gesture delivered by the interrupt-driven engine */
+typedef struct {
+    uint8_t direction;          // DIR_LEFT ... DIR_FAR
+    uint8_t datasets;           // U/D/L/R datasets received during the gesture
+    uint32_t timestamp_ms;      // HAL_GetTick() of the last dataset
+} APDS9960_gesture_event_t;
+
+typedef struct {
+    uint32_t datasets;          // Datasets read from the FIFO
+    uint32_t bursts;            // FIFO block reads
+    uint32_t dropped;           // Datasets lost because the decoder was late
+    uint32_t fifo_overflows;    // GFOV seen: the sensor FIFO was not drained in time
+    uint32_t bus_errors;
+    uint32_t events_lost;       // Gestures lost because nobody read the events
+} APDS9960_gesture_stats_t;
+
 
 
 /* Exported functions prototypes ---------------------------------------------*/
@@ -284,6 +308,7 @@ void APDS9960_readAmbientLight(uint16_t *val);
 void APDS9960_readRedLight(uint16_t *val);
 void APDS9960_readGreenLight(uint16_t *val);
 void APDS9960_readBlueLight(uint16_t *val);
+void APDS9960_readColors(uint16_t crgb[4]);
 
 /* Proximity methods */
 void APDS9960_readProximity(uint8_t *val);
@@ -292,6 +317,14 @@ void APDS9960_readProximity(uint8_t *val);
 bool APDS9960_isGestureAvailable();
 int APDS9960_readGesture();
 
+/* Interrupt-driven gesture engine (do not mix with readGesture) */
+void APDS9960_gesture_start(GPIO_TypeDef * GPIOx, uint16_t GPIO_PIN_x);
+void APDS9960_gesture_stop(void);
+void APDS9960_gesture_process_main(void);
+bool APDS9960_gesture_get_event(APDS9960_gesture_event_t * event);
+void APDS9960_gesture_get_stats(APDS9960_gesture_stats_t * stats);
+void APDS9960_demo_gesture(void);
+
 #endif // USE_APDS9960
 #endif // BSP_APDS9960_STM32G4_APDS9960_H_
 
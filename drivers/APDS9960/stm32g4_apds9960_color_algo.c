@@ -4,183 +4,324 @@
  * @author 	vchav
  * @date 	May 6, 2024
  * @brief	Ce fichier présente un algorithme visant à rechercher la couleur observée la plus proche parmi des couleurs de références
- * 			(calibrées à la main dans les define ci-dessous).
+ * 			(valeurs par défaut ci-dessous, calibrables à l'exécution et sauvegardées en flash).
  *			Pour plus d'explication, contactez samuel.poiraud@eseo.fr après avoir consulté attentivement ce fichier.
  *******************************************************************************
+ * Une mesure est résumée par deux mots de 32 bits, un octet par composante :
+ *	- caractéristiques : rouge, vert, bleu (fractions du canal clair en virgule fixe 0.8) et luminosité,
+ *	- différences : |rouge - vert|, |rouge - bleu|, |vert - bleu| (0 dans l'octet de poids fort).
+ * La distance à une référence est la somme pondérée des écarts absolus de ces octets :
+ *	USAD8 calcule les 4 écarts d'un mot en une instruction, SMUAD applique les deux poids et les additionne.
+ * Toutes les références sont évaluées en une passe qui conserve la plus proche.
  */
 #include "config.h"
 #if USE_APDS9960
 
-#include "stm32g4_utils.h"
+#include "stm32g4xx_hal.h"
 #include "stm32g4_apds9960.h"
+#include "stm32g4_apds9960_color_algo.h"
+#include "stm32g4_flash.h"
+#include <stdio.h>
 
 /* Private defines ---------------------------------------------------------- */
 #define COLOR_SENSOR_AVERAGE_DIFFRENCIAL_MULTIPLIER			1
 #define COLOR_SENSOR_DIFFRENCIAL_DIFFRENCIAL_MULTIPLIER		0
 
-// Red
-#define COLOR_SENSOR_RED__RED			75
-#define COLOR_SENSOR_RED__GREEN			14
-#define COLOR_SENSOR_RED__BLUE			25
-#define COLOR_SENSOR_RED__RED_GREEN		(ABSOLUTE(COLOR_SENSOR_RED__RED - COLOR_SENSOR_RED__GREEN))
-#define COLOR_SENSOR_RED__RED_BLUE		(ABSOLUTE(COLOR_SENSOR_RED__RED - COLOR_SENSOR_RED__BLUE))
-#define COLOR_SENSOR_RED__GREEN_BLUE	(ABSOLUTE(COLOR_SENSOR_RED__GREEN - COLOR_SENSOR_RED__BLUE))
-
-// Green
-#define COLOR_SENSOR_GREEN__RED				13
-#define COLOR_SENSOR_GREEN__GREEN			51
-#define COLOR_SENSOR_GREEN__BLUE			43
-#define COLOR_SENSOR_GREEN__RED_GREEN		(ABSOLUTE(COLOR_SENSOR_GREEN__RED - COLOR_SENSOR_GREEN__GREEN))
-#define COLOR_SENSOR_GREEN__RED_BLUE		(ABSOLUTE(COLOR_SENSOR_GREEN__RED - COLOR_SENSOR_GREEN__BLUE))
-#define COLOR_SENSOR_GREEN__GREEN_BLUE		(ABSOLUTE(COLOR_SENSOR_GREEN__GREEN - COLOR_SENSOR_GREEN__BLUE))
-
-// Blue
-#define COLOR_SENSOR_BLUE__RED				13
-#define COLOR_SENSOR_BLUE__GREEN			38
-#define COLOR_SENSOR_BLUE__BLUE				55
-#define COLOR_SENSOR_BLUE__RED_GREEN		(ABSOLUTE(COLOR_SENSOR_BLUE__RED - COLOR_SENSOR_BLUE__GREEN))
-#define COLOR_SENSOR_BLUE__RED_BLUE			(ABSOLUTE(COLOR_SENSOR_BLUE__RED - COLOR_SENSOR_BLUE__BLUE))
-#define COLOR_SENSOR_BLUE__GREEN_BLUE		(ABSOLUTE(COLOR_SENSOR_BLUE__GREEN - COLOR_SENSOR_BLUE__BLUE))
-
-// White
-#define COLOR_SENSOR_WHITE__RED				45 //43
-#define COLOR_SENSOR_WHITE__GREEN			32 //60
-#define COLOR_SENSOR_WHITE__BLUE			38 //55
-#define COLOR_SENSOR_WHITE__AMBIANT			255
-#define COLOR_SENSOR_WHITE__RED_GREEN		(ABSOLUTE(COLOR_SENSOR_WHITE__RED - COLOR_SENSOR_WHITE__GREEN))
-#define COLOR_SENSOR_WHITE__RED_BLUE		(ABSOLUTE(COLOR_SENSOR_WHITE__RED - COLOR_SENSOR_WHITE__BLUE))
-#define COLOR_SENSOR_WHITE__GREEN_BLUE		(ABSOLUTE(COLOR_SENSOR_WHITE__GREEN - COLOR_SENSOR_WHITE__BLUE))
-
-// Black
-#define COLOR_SENSOR_BLACK__RED				76 //26
-#define COLOR_SENSOR_BLACK__GREEN			21 //37
-#define COLOR_SENSOR_BLACK__BLUE			32 //35
-#define COLOR_SENSOR_BLACK__AMBIANT			150
-#define COLOR_SENSOR_BLACK__RED_GREEN		(ABSOLUTE(COLOR_SENSOR_BLACK__RED - COLOR_SENSOR_BLACK__GREEN))
-#define COLOR_SENSOR_BLACK__RED_BLUE		(ABSOLUTE(COLOR_SENSOR_BLACK__RED - COLOR_SENSOR_BLACK__BLUE))
-#define COLOR_SENSOR_BLACK__GREEN_BLUE		(ABSOLUTE(COLOR_SENSOR_BLACK__GREEN - COLOR_SENSOR_BLACK__BLUE))
+#define COLOR_FLASH_MAGIC				0x434C
+#define COLOR_USE_BRIGHTNESS			0x80	//dans l'octet d'identifiant d'un enregistrement
+#define COLOR_SAMPLE_PERIOD_MS			110		//> temps d'intégration (DEFAULT_ATIME : 103ms)
 
-/* Private types ------------------------------------------------------------ */
-
-typedef enum{
-	COLOR_SENSOR_NONE,
-	COLOR_SENSOR_RED,
-	COLOR_SENSOR_GREEN,
-	COLOR_SENSOR_BLUE,
-	COLOR_SENSOR_WHITE,
-	COLOR_SENSOR_BLACK,
-	COLOR_SENSOR_NB
-}colorSensor_e;
+/* Instructions SIMD du Cortex-M4, et leur équivalent C pour les autres cibles */
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+	#define COLOR_USAD8(a, b)		__USAD8((a), (b))
+	#define COLOR_SMUAD(a, b)		((uint32_t)__SMUAD((a), (b)))
+#else
+	static inline uint32_t COLOR_USAD8(uint32_t a, uint32_t b)
+	{
+		uint32_t sum = 0;
+		for(uint8_t i = 0; i < 32; i += 8)
+		{
+			uint8_t x = (uint8_t)(a >> i), y = (uint8_t)(b >> i);
+			sum += (x > y) ? (uint32_t)(x - y) : (uint32_t)(y - x);
+		}
+		return sum;
+	}
+	static inline uint32_t COLOR_SMUAD(uint32_t a, uint32_t b)
+	{
+		return (uint32_t)((int32_t)(int16_t)a * (int16_t)b + (int32_t)(int16_t)(a >> 16) * (int16_t)(b >> 16));
+	}
+#endif
 
+#define COLOR_PACK(r, g, b, l)			((uint32_t)(r) | ((uint32_t)(g) << 8) | ((uint32_t)(b) << 16) | ((uint32_t)(l) << 24))
 
+/* Private types ------------------------------------------------------------ */
 typedef struct{
+	uint32_t features;		//rouge, vert, bleu, luminosité (0 si la référence ne tient pas compte de la luminosité)
+	uint32_t differences;	//|r - g|, |r - b|, |g - b|
+	uint32_t mask;			//octets des caractéristiques comparés
 	colorSensor_e color;
-	uint8_t red;
-	uint8_t green;
-	uint8_t blue;
-	uint8_t ambiant;
-	uint8_t proximity;
-}colorSensor_s;
-
+}colorReference_s;
 
-/**
- * @brief Fonction qui cherche la plus petite valeur dans un tableau
- * @param values[]: tableau de valeurs à parcourir
- * @param nbValue: nombre de valeurs à parcourir dans le tableau. Si vous ne voulez pas parcourir tout le tableau, nbValue sera inférieur à sa taille.
- * @return indiceMin: la plus petite valeur trouvé
+/*
+ * Références par défaut, calibrées à la main (fractions du canal clair en 1/256, luminosité en valeur brute du canal clair)
  */
-uint16_t APDS9960_searchMin(int32_t values[], uint16_t nbValue){
-	uint8_t i, indiceMin = 0;
-	for(i=0; i<nbValue; i++){
-		if(values[i] < values[indiceMin]){
-			indiceMin = i;
-		}
-	}
-	return indiceMin;
+static const struct{
+	colorSensor_e color;
+	uint8_t red, green, blue, brightness;
+	bool use_brightness;
+}default_references[] = {
+	{COLOR_SENSOR_RED,		192,	36,		64,		0,		false},
+	{COLOR_SENSOR_GREEN,	33,		131,	110,	0,		false},
+	{COLOR_SENSOR_BLUE,		33,		97,		141,	0,		false},
+	{COLOR_SENSOR_WHITE,	115,	82,		97,		255,	true},
+	{COLOR_SENSOR_BLACK,	195,	54,		82,		150,	true},
+};
+
+/* Private variables -------------------------------------------------------- */
+static colorReference_s references[APDS9960_COLOR_MAX_REFS];
+static uint8_t nb_references = 0;
+static uint32_t weights = COLOR_SENSOR_AVERAGE_DIFFRENCIAL_MULTIPLIER | (COLOR_SENSOR_DIFFRENCIAL_DIFFRENCIAL_MULTIPLIER << 16);
+
+/* Private functions -------------------------------------------------------- */
+static inline uint8_t COLOR_absdiff(uint8_t a, uint8_t b)
+{
+	return (a > b) ? (uint8_t)(a - b) : (uint8_t)(b - a);
 }
 
+static uint32_t APDS9960_color_differences(uint32_t features)
+{
+	uint8_t r = (uint8_t)features, g = (uint8_t)(features >> 8), b = (uint8_t)(features >> 16);
+	return COLOR_PACK(COLOR_absdiff(r, g), COLOR_absdiff(r, b), COLOR_absdiff(g, b), 0);
+}
 
-/**
- * Fonction de reconnaissance de couleurs à partir des composantes R, G et B fournies par le capteur couleur.
- * @param sensor_datas les données du capteur (composantes RGB)
- * @param search les couleurs à rechercher (i.e., les couleurs possibles) sous la forme d'un masque binaire
- * @return color: la couleur déduite
+/*
+ * @brief	Normalisation en virgule fixe : chaque couleur devient une fraction du canal clair (0..255)
+ * @return	false si le canal clair est nul (aucune lumière, pas de couleur)
  */
-static colorSensor_e SENSOR_analyse_color(void)
+static bool APDS9960_color_features(const uint16_t crgb[4], uint32_t * features)
 {
-	uint16_t ambiant, red, blue, green;
-	uint16_t redGreen, redBlue, greenBlue;
-	uint32_t redFound, greenFound, blueFound,whiteFound,blackFound;
-	colorSensor_e color;
-	color = COLOR_SENSOR_NONE;
+	uint32_t clear = crgb[0];
+	uint32_t inverse, v, brightness;
+	uint8_t c[3];
 
+	if(clear == 0)
+		return false;
 
-	APDS9960_readAmbientLight(&ambiant);
-	APDS9960_readRedLight(&red);
-	APDS9960_readBlueLight(&blue);
-	APDS9960_readGreenLight(&green);
+	inverse = (1UL << 24) / clear;		//une seule division pour les trois canaux
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		v = (crgb[i + 1] < clear) ? crgb[i + 1] : clear;	//v * inverse <= 2^24
+		v = (v * inverse) >> 16;
+		c[i] = (v > 255) ? 255 : (uint8_t)v;
+	}
+	brightness = clear >> APDS9960_COLOR_BRIGHTNESS_SHIFT;
+	if(brightness > 255)
+		brightness = 255;
 
+	*features = COLOR_PACK(c[0], c[1], c[2], brightness);
+	return true;
+}
+
+static void APDS9960_color_set_reference(colorSensor_e color, uint32_t features, bool use_brightness)
+{
+	uint8_t i;
+	colorReference_s * ref;
 
-	if(ambiant)
+	for(i = 0; i < nb_references; i++)
+		if(references[i].color == color)
+			break;
+	if(i == nb_references)
 	{
-		//Composantes RGB, ramenés en pourcentage de la mesure de lumière ambiante
-		blue = (uint16_t)(((uint32_t)blue*100)/ambiant);
-		red = (uint16_t)(((uint32_t)red*100)/ambiant);
-		green = (uint16_t)(((uint32_t)green*100)/ambiant);
+		if(nb_references == APDS9960_COLOR_MAX_REFS)
+			return;
+		nb_references++;
 	}
+	ref = &references[i];
+	ref->color = color;
+	ref->mask = use_brightness ? 0xFFFFFFFF : 0x00FFFFFF;
+	ref->features = features & ref->mask;
+	ref->differences = APDS9960_color_differences(features);
+}
 
-	if(ambiant)
-	{
-//		debug_printf("%d, %d, %d, %d\n", red, green, blue, sensors[i].ambiant);
-		redGreen = ABSOLUTE(red - green);
-		redBlue = ABSOLUTE(red - red);
-		greenBlue = ABSOLUTE(green - blue);
+static uint8_t APDS9960_color_record_check(uint64_t record)
+{
+	uint8_t sum = 0x5A;
+	for(uint8_t i = 0; i < 32; i += 8)
+		sum = (uint8_t)(sum * 7 + (uint8_t)(record >> i));
+	return (uint8_t)(sum + (uint8_t)(record >> 40));
+}
 
-		int32_t colors_value[COLOR_SENSOR_NB] = {0};
-		colorSensor_e colors_id[COLOR_SENSOR_NB] = {0};
-		uint8_t nb = 0;
+/* Public functions --------------------------------------------------------- */
 
+/**
+ * @brief	Charge la table des références sauvegardée en flash, ou les références par défaut
+ */
+void APDS9960_color_init(void)
+{
+	uint64_t record;
+
+	nb_references = 0;
+	for(uint8_t slot = 0; slot < APDS9960_COLOR_MAX_REFS; slot++)
+	{
+		record = BSP_FLASH_read_doubleword(APDS9960_COLOR_FLASH_INDEX + slot);
+		if((uint16_t)(record >> 48) != COLOR_FLASH_MAGIC
+				|| (uint8_t)(record >> 32) != APDS9960_color_record_check(record))
+			continue;	//case vide, effacée ou corrompue
+		colorSensor_e color = (colorSensor_e)((record >> 40) & ~COLOR_USE_BRIGHTNESS & 0xFF);
+		if(color == COLOR_SENSOR_NONE || color >= COLOR_SENSOR_NB)
+			continue;
+		APDS9960_color_set_reference(color, (uint32_t)record, ((record >> 40) & COLOR_USE_BRIGHTNESS) != 0);
+	}
 
-		redFound = (ABSOLUTE(red - COLOR_SENSOR_RED__RED) + ABSOLUTE(green - COLOR_SENSOR_RED__GREEN) + ABSOLUTE(blue - COLOR_SENSOR_RED__BLUE)) * COLOR_SENSOR_AVERAGE_DIFFRENCIAL_MULTIPLIER
-					+ (ABSOLUTE(redGreen - COLOR_SENSOR_RED__RED_GREEN) + ABSOLUTE(redBlue - COLOR_SENSOR_RED__RED_BLUE) + ABSOLUTE(greenBlue - COLOR_SENSOR_RED__GREEN_BLUE)) * COLOR_SENSOR_DIFFRENCIAL_DIFFRENCIAL_MULTIPLIER;
-		colors_value[nb] = redFound;
-		colors_id[nb] = COLOR_SENSOR_RED;
-		nb++;
+	if(nb_references == 0)
+		APDS9960_color_reset_defaults();
+}
+
+/**
+ * @brief	Remet les références par défaut (la flash n'est pas modifiée, voir APDS9960_color_save())
+ */
+void APDS9960_color_reset_defaults(void)
+{
+	nb_references = 0;
+	for(uint8_t i = 0; i < sizeof(default_references) / sizeof(default_references[0]); i++)
+		APDS9960_color_set_reference(default_references[i].color,
+				COLOR_PACK(default_references[i].red, default_references[i].green, default_references[i].blue, default_references[i].brightness),
+				default_references[i].use_brightness);
+}
 
+/**
+ * @brief	Règle les poids des écarts de couleurs (absolute) et des écarts entre couleurs (differential)
+ * @note	Chaque poids doit rester inférieur à 32768 (multiplication signée 16 bits)
+ */
+void APDS9960_color_set_weights(uint16_t absolute, uint16_t differential)
+{
+	weights = (uint32_t)(absolute & 0x7FFF) | ((uint32_t)(differential & 0x7FFF) << 16);
+}
 
-		greenFound = (ABSOLUTE(red - COLOR_SENSOR_GREEN__RED) + ABSOLUTE(green - COLOR_SENSOR_GREEN__GREEN) + ABSOLUTE(blue - COLOR_SENSOR_GREEN__BLUE)) * COLOR_SENSOR_AVERAGE_DIFFRENCIAL_MULTIPLIER
-					+ (ABSOLUTE(redGreen - COLOR_SENSOR_GREEN__RED_GREEN) + ABSOLUTE(redBlue - COLOR_SENSOR_GREEN__RED_BLUE) + ABSOLUTE(greenBlue - COLOR_SENSOR_GREEN__GREEN_BLUE)) * COLOR_SENSOR_DIFFRENCIAL_DIFFRENCIAL_MULTIPLIER;
-		colors_value[nb] = greenFound;
-		colors_id[nb] = COLOR_SENSOR_GREEN;
-		nb++;
+/**
+ * @brief	Recherche la référence la plus proche d'une mesure
+ * @param	crgb : canaux clair, rouge, vert, bleu (APDS9960_readColors())
+ * @param	distance : si non NULL, reçoit la distance à la référence retenue
+ * @return	La couleur reconnue, COLOR_SENSOR_NONE si le canal clair est nul
+ */
+colorSensor_e APDS9960_color_classify_crgb(const uint16_t crgb[4], uint32_t * distance)
+{
+	uint32_t features, differences;
+	uint32_t d, best = UINT32_MAX;
+	colorSensor_e color = COLOR_SENSOR_NONE;
 
+	if(!APDS9960_color_features(crgb, &features))
+		return COLOR_SENSOR_NONE;
+	differences = APDS9960_color_differences(features);
 
-		blueFound = (ABSOLUTE(red - COLOR_SENSOR_BLUE__RED) + ABSOLUTE(green - COLOR_SENSOR_BLUE__GREEN) + ABSOLUTE(blue - COLOR_SENSOR_BLUE__BLUE)) * COLOR_SENSOR_AVERAGE_DIFFRENCIAL_MULTIPLIER
-					+ (ABSOLUTE(redGreen - COLOR_SENSOR_BLUE__RED_GREEN) + ABSOLUTE(redBlue - COLOR_SENSOR_BLUE__RED_BLUE) + ABSOLUTE(greenBlue - COLOR_SENSOR_BLUE__GREEN_BLUE)) * COLOR_SENSOR_DIFFRENCIAL_DIFFRENCIAL_MULTIPLIER;
-		colors_value[nb] = blueFound;
-		colors_id[nb] = COLOR_SENSOR_BLUE;
-		nb++;
+	for(uint8_t i = 0; i < nb_references; i++)
+	{
+		const colorReference_s * ref = &references[i];
+		//écarts sur les caractéristiques (16 bits de poids faible) et sur les différences (16 bits de poids fort)
+		d = COLOR_USAD8(features & ref->mask, ref->features) | (COLOR_USAD8(differences, ref->differences) << 16);
+		d = COLOR_SMUAD(d, weights);
+		if(d < best)
+		{
+			best = d;
+			color = ref->color;
+		}
+	}
+	if(distance != NULL)
+		*distance = best;
+	return color;
+}
 
+/**
+ * @brief	Mesure (une lecture I2C des 4 canaux) et reconnaissance de la couleur observée
+ * @param	distance : si non NULL, reçoit la distance à la référence retenue (indice de confiance)
+ * @return	La couleur déduite
+ */
+colorSensor_e APDS9960_color_classify(uint32_t * distance)
+{
+	uint16_t crgb[4];
+	APDS9960_readColors(crgb);
+	return APDS9960_color_classify_crgb(crgb, distance);
+}
 
-		whiteFound = (ABSOLUTE(ambiant - COLOR_SENSOR_WHITE__AMBIANT) + ABSOLUTE(red - COLOR_SENSOR_WHITE__RED) + ABSOLUTE(green - COLOR_SENSOR_WHITE__GREEN) + ABSOLUTE(blue - COLOR_SENSOR_WHITE__BLUE)) * COLOR_SENSOR_AVERAGE_DIFFRENCIAL_MULTIPLIER
-					+ (ABSOLUTE(redGreen - COLOR_SENSOR_WHITE__RED_GREEN) + ABSOLUTE(redBlue - COLOR_SENSOR_WHITE__RED_BLUE) + ABSOLUTE(greenBlue - COLOR_SENSOR_WHITE__GREEN_BLUE)) * COLOR_SENSOR_DIFFRENCIAL_DIFFRENCIAL_MULTIPLIER;
-		colors_value[nb] = whiteFound;
-		colors_id[nb] = COLOR_SENSOR_WHITE;
-		nb++;
+/**
+ * @brief	Calibre une référence sur la couleur présentée au capteur (moyenne de nb_samples mesures)
+ * @param	use_brightness : true si la luminosité doit intervenir (blanc, noir...)
+ * @return	false si aucune lumière n'a été mesurée ou si la table est pleine
+ * @note	Fonction bloquante (nb_samples cycles d'intégration). Appeler APDS9960_color_save() pour conserver le résultat.
+ */
+bool APDS9960_color_calibrate(colorSensor_e color, bool use_brightness, uint8_t nb_samples)
+{
+	uint32_t sum[4] = {0};
+	uint16_t crgb[4];
+	uint32_t features;
 
+	if(color == COLOR_SENSOR_NONE || color >= COLOR_SENSOR_NB || nb_samples == 0)
+		return false;
 
-		blackFound = (ABSOLUTE(ambiant - COLOR_SENSOR_BLACK__AMBIANT) + ABSOLUTE(red - COLOR_SENSOR_BLACK__RED) + ABSOLUTE(green - COLOR_SENSOR_BLACK__GREEN) + ABSOLUTE(blue - COLOR_SENSOR_BLACK__BLUE)) * COLOR_SENSOR_AVERAGE_DIFFRENCIAL_MULTIPLIER
-					+ (ABSOLUTE(redGreen - COLOR_SENSOR_BLACK__RED_GREEN) + ABSOLUTE(redBlue - COLOR_SENSOR_BLACK__RED_BLUE) + ABSOLUTE(greenBlue - COLOR_SENSOR_BLACK__GREEN_BLUE)) * COLOR_SENSOR_DIFFRENCIAL_DIFFRENCIAL_MULTIPLIER;
-		colors_value[nb] = blackFound;
-		colors_id[nb] = COLOR_SENSOR_BLACK;
-		nb++;
+	for(uint8_t n = 0; n < nb_samples; n++)
+	{
+		HAL_Delay(COLOR_SAMPLE_PERIOD_MS);
+		APDS9960_readColors(crgb);
+		for(uint8_t i = 0; i < 4; i++)
+			sum[i] += crgb[i];
+	}
+	for(uint8_t i = 0; i < 4; i++)
+		crgb[i] = (uint16_t)(sum[i] / nb_samples);
+
+	if(!APDS9960_color_features(crgb, &features))
+		return false;
+	APDS9960_color_set_reference(color, features, use_brightness);
+	for(uint8_t i = 0; i < nb_references; i++)
+		if(references[i].color == color)
+			return true;
+	return false;
+}
 
+/**
+ * @brief	Sauvegarde la table des références en flash (une case par référence), en une transaction :
+ * 			une coupure d'alimentation laisse l'ancienne table ou la nouvelle, jamais un mélange des deux.
+ * @pre		Ne pas appeler en interruption : une écriture peut nécessiter un compactage du journal (quelques dizaines de ms)
+ * @return	false si la table n'a pas pu être écrite (journal plein, flash défectueuse) : l'ancienne reste en flash
+ * @note	Les cases déjà à jour ne sont pas réécrites.
+ */
+bool APDS9960_color_save(void)
+{
+	uint32_t indexes[APDS9960_COLOR_MAX_REFS];
+	uint64_t records[APDS9960_COLOR_MAX_REFS];
 
-		uint8_t indiceMin = APDS9960_searchMin(colors_value, nb);
-		color = colors_id[indiceMin];
+	for(uint8_t slot = 0; slot < APDS9960_COLOR_MAX_REFS; slot++)
+	{
+		indexes[slot] = APDS9960_COLOR_FLASH_INDEX + slot;
+		records[slot] = 0xFFFFFFFFFFFFFFFF;		//case libre : vidée, elle n'occupe plus de place dans le journal
+		if(slot < nb_references)
+		{
+			const colorReference_s * ref = &references[slot];
+			uint8_t id = (uint8_t)ref->color | ((ref->mask == 0xFFFFFFFF) ? COLOR_USE_BRIGHTNESS : 0);
+			records[slot] = ((uint64_t)COLOR_FLASH_MAGIC << 48) | ((uint64_t)id << 40) | ref->features;
+			records[slot] |= (uint64_t)APDS9960_color_record_check(records[slot]) << 32;
+		}
 	}
+	return BSP_FLASH_set_doublewords(indexes, records, APDS9960_COLOR_MAX_REFS);
+}
 
-	return color;
+/**
+ * @brief	Démonstration : affichage de la couleur reconnue et de sa distance à la référence
+ */
+void APDS9960_demo_color(void)
+{
+	static const char * names[COLOR_SENSOR_NB] = {"NONE", "RED", "GREEN", "BLUE", "WHITE", "BLACK"};
+	colorSensor_e color;
+	uint32_t distance;
+
+	APDS9960_init();
+	APDS9960_enableLightSensor(false);
+	APDS9960_color_init();
+	while(1)
+	{
+		color = APDS9960_color_classify(&distance);
+		printf("%s (%lu)\n", names[color], distance);
+		HAL_Delay(COLOR_SAMPLE_PERIOD_MS);
+	}
 }
 
 #endif
@@ -0,0 +1,59 @@
+/**
+ *******************************************************************************
+ * @file 	stm32g4_apds9960_color_algo.h
+ * @author 	vchav
+ * @date 	May 6, 2024
+ * @brief	Reconnaissance de la couleur observée la plus proche parmi une table de couleurs de référence
+ *******************************************************************************
+ */
+#ifndef BSP_APDS9960_STM32G4_APDS9960_COLOR_ALGO_H_
+#define BSP_APDS9960_STM32G4_APDS9960_COLOR_ALGO_H_
+
+#include "config.h"
+#if USE_APDS9960
+
+	#include <stdint.h>
+	#include <stdbool.h>
+
+	/* Nombre maximal de couleurs de référence (une case de flash par référence) */
+	#define APDS9960_COLOR_MAX_REFS			8
+
+	/* Première case (double-mot) de la page d'EEPROM virtuelle (stm32g4_flash) utilisée par la table */
+	#ifndef APDS9960_COLOR_FLASH_INDEX
+		#define APDS9960_COLOR_FLASH_INDEX	208
+	#endif
+
+	/* Luminosité = canal clair >> APDS9960_COLOR_BRIGHTNESS_SHIFT, saturée à 255 */
+	#ifndef APDS9960_COLOR_BRIGHTNESS_SHIFT
+		#define APDS9960_COLOR_BRIGHTNESS_SHIFT	0
+	#endif
+
+	typedef enum{
+		COLOR_SENSOR_NONE,
+		COLOR_SENSOR_RED,
+		COLOR_SENSOR_GREEN,
+		COLOR_SENSOR_BLUE,
+		COLOR_SENSOR_WHITE,
+		COLOR_SENSOR_BLACK,
+		COLOR_SENSOR_NB
+	}colorSensor_e;
+
+	void APDS9960_color_init(void);
+
+	colorSensor_e APDS9960_color_classify(uint32_t * distance);
+
+	colorSensor_e APDS9960_color_classify_crgb(const uint16_t crgb[4], uint32_t * distance);
+
+	bool APDS9960_color_calibrate(colorSensor_e color, bool use_brightness, uint8_t nb_samples);
+
+	void APDS9960_color_set_weights(uint16_t absolute, uint16_t differential);
+
+	void APDS9960_color_reset_defaults(void);
+
+	bool APDS9960_color_save(void);
+
+	void APDS9960_demo_color(void);
+
+#endif
+
+#endif /* BSP_APDS9960_STM32G4_APDS9960_COLOR_ALGO_H_ */
@@ -37,6 +37,12 @@
  *  la masse (son adresse sera alors 0x23), l'autre ayant sa broche ADDR alimente par une tension de 3,3V (son adresse
  * sera alors 0x5C).
  * Le capteur est aliment sur sa broche Vcc en 3,3V.
+ *
+ * Service de mesure continue (non bloquant) :
+ * 		BSP_BH1750FVI_service_start() garde le capteur en mesure continue et adapte seul le mode de rsolution et le
+ * 		registre MTreg  l'clairement (de 0.11 lx de rsolution dans l'obscurit  120000 lx en plein soleil).
+ * 		Les lectures sont cadences par le systick et passent par le DMA I2C ; la tche de fond rcupre la
+ * 		dernire mesure horodate avec BSP_BH1750FVI_get_measure() ou BSP_BH1750FVI_get_millilux(), sans accs au bus.
  * @endverbatim
  */
 
@@ -48,7 +54,9 @@
 #include "stm32g4xx_hal.h"
 #include "stm32g4_gpio.h"
 #include "stm32g4_i2c.h"
+#include "stm32g4_systick.h"
 #include "stdio.h"
+#include <string.h>
 //#include "stm32g4xx_nucleo.h"
 
 //Si la pin ADDR n'est pas relie  la masse mais au 3.3V, changer cette macro en lui donnant la valeur BH1750FVI_ADDR_H
@@ -148,5 +156,259 @@ uint16_t BSP_BH1750FVI_read()
 	return ret[1] | ((uint16_t)(ret[0])) << 8;
 }
 
+
+/*
+ * Service de mesure continue :
+ * 	- le capteur reste en mesure continue, la gamme (mode de rsolution + MTreg) est choisie selon l'clairement,
+ * 	- la callback systick (1 ms) cadence les lectures, au temps de mesure maximal de la gamme,
+ * 	- les commandes et lectures passent par le DMA I2C, la conversion et le choix de gamme sont faits dans
+ * 	  le callback de fin de lecture,
+ * 	- la dernire mesure est publie avec son horodatage : l'application la lit sans accs au bus.
+ */
+#define BH1750FVI_H_TIME_MAX_MS		180		//temps de mesure maximal des modes haute rsolution, pour MTreg = 69
+#define BH1750FVI_L_TIME_MAX_MS		24		//idem en basse rsolution
+#define BH1750FVI_FULL_SCALE		65535
+#define BH1750FVI_RANGE_UP			58982	//90 % de la pleine chelle : gamme moins sensible
+#define BH1750FVI_RANGE_DOWN		32768	//mesure estime dans la gamme plus sensible sous 50 % : on y passe
+#define BH1750FVI_RANGE_DEFAULT		2
+#define BH1750FVI_RETRY_MS			10		//aprs une erreur de bus
+
+typedef struct
+{
+	uint8_t mode;
+	uint8_t mtreg;
+}BH1750FVI_range_t;
+
+static const BH1750FVI_range_t ranges[BH1750FVI_RANGE_NB] =
+{
+	{BH1750FVI_CON_H2, BH1750FVI_MTREG_MAX},		//0.11 lx, jusqu' 7400 lx, 660 ms
+	{BH1750FVI_CON_H2, BH1750FVI_MTREG_DEFAULT},	//0.42 lx, jusqu' 27000 lx, 180 ms
+	{BH1750FVI_CON_H1, BH1750FVI_MTREG_DEFAULT},	//0.83 lx, jusqu' 54000 lx, 180 ms
+	{BH1750FVI_CON_H1, BH1750FVI_MTREG_MIN},		//1.85 lx, jusqu' 120000 lx, 81 ms
+};
+
+typedef enum
+{
+	SERVICE_STOPPED,
+	SERVICE_CONFIG,		//envoi des commandes MTreg et mode
+	SERVICE_WAIT,		//mesure en cours dans le capteur
+	SERVICE_READ		//lecture du rsultat
+}service_state_e;
+
+static volatile service_state_e service_state = SERVICE_STOPPED;
+static volatile bool service_in_flight = false;
+static volatile uint16_t service_countdown = 0;		//ms avant la prochaine commande ou lecture
+static uint8_t service_range;
+static uint8_t service_cmd[3];
+static uint8_t service_cmd_index;
+static bool service_discard;		//premire mesure aprs un changement de gamme : faite avec l'ancienne configuration
+static uint8_t service_rx[2];
+static volatile BH1750FVI_measure_t service_measure;
+
+static void BH1750FVI_service_process_ms(void);
+static void BH1750FVI_service_configure(uint8_t range);
+static void BH1750FVI_service_send_command(void);
+static void BH1750FVI_service_command_done(HAL_StatusTypeDef status);
+static void BH1750FVI_service_read(void);
+static void BH1750FVI_service_read_done(HAL_StatusTypeDef status);
+
+/**
+ * @brief	Sensibilit relative d'une gamme (coups par unit d'clairement,  un facteur prs)
+ */
+static uint16_t BH1750FVI_range_sensitivity(uint8_t range)
+{
+	return (uint16_t)ranges[range].mtreg * ((ranges[range].mode == BH1750FVI_CON_H2) ? 2 : 1);
+}
+
+/**
+ * @brief	Temps de mesure maximal d'une gamme, en ms
+ */
+static uint16_t BH1750FVI_range_period_ms(uint8_t range)
+{
+	uint32_t t = (ranges[range].mode == BH1750FVI_CON_L) ? BH1750FVI_L_TIME_MAX_MS : BH1750FVI_H_TIME_MAX_MS;
+	return (uint16_t)((t * ranges[range].mtreg + BH1750FVI_MTREG_DEFAULT - 1) / BH1750FVI_MTREG_DEFAULT);
+}
+
+/**
+ * @brief	Dmarre le service de mesure continue avec changement automatique de gamme
+ * @post	La dernire mesure est disponible via BSP_BH1750FVI_get_measure() ou BSP_BH1750FVI_get_millilux()
+ */
+void BSP_BH1750FVI_service_start(void)
+{
+	BSP_BH1750FVI_service_stop();
+	BSP_BH1750FVI_init();
+	BSP_BH1750FVI_powerOn();
+
+	__disable_irq();
+	memset((void *)&service_measure, 0, sizeof(service_measure));
+	__enable_irq();
+	BH1750FVI_service_configure(BH1750FVI_RANGE_DEFAULT);
+	BSP_systick_add_callback_function(&BH1750FVI_service_process_ms);
+}
+
+/**
+ * @brief	Arrte le service et teint le capteur
+ * @post	La dernire mesure reste disponible
+ */
+void BSP_BH1750FVI_service_stop(void)
+{
+	if(service_state == SERVICE_STOPPED)
+		return;
+	BSP_systick_remove_callback_function(&BH1750FVI_service_process_ms);
+	while(service_in_flight);		//on laisse se terminer le transfert en cours
+	service_state = SERVICE_STOPPED;
+	BSP_BH1750FVI_powerDown();
+}
+
+/**
+ * @brief	Copie la dernire mesure publie par le service (aucun accs au bus)
+ * @return	false si aucune mesure n'a encore t publie
+ */
+bool BSP_BH1750FVI_get_measure(BH1750FVI_measure_t * measure)
+{
+	__disable_irq();
+	*measure = service_measure;
+	__enable_irq();
+	return measure->count != 0;
+}
+
+/**
+ * @brief	Dernier clairement publi par le service, en millilux (aucun accs au bus)
+ */
+uint32_t BSP_BH1750FVI_get_millilux(void)
+{
+	return service_measure.millilux;
+}
+
+/**
+ * @brief	Exemple d'utilisation du service : la tche de fond lit la dernire mesure quand elle le souhaite
+ * @pre		La fonction printf tant appele, il faut avoir initialis au pralable une liaison srie.
+ */
+void BSP_BH1750FVI_demo_service(void)
+{
+	BH1750FVI_measure_t measure;
+	BSP_BH1750FVI_service_start();
+	while(1)
+	{
+		HAL_Delay(500);
+		if(BSP_BH1750FVI_get_measure(&measure))
+			printf("\nLuminosite = %lu.%03lu lx (gamme %d%s)", measure.millilux / 1000, measure.millilux % 1000,
+					measure.range, measure.saturated ? ", saturation" : "");
+	}
+}
+
+/**
+ * @brief	Callback systick (1 ms) : lance la commande ou la lecture suivante  chance
+ */
+static void BH1750FVI_service_process_ms(void)
+{
+	if(service_countdown == 0 || --service_countdown != 0)
+		return;
+	if(service_state == SERVICE_CONFIG)
+		BH1750FVI_service_send_command();
+	else if(service_state == SERVICE_WAIT)
+		BH1750FVI_service_read();
+}
+
+/**
+ * @brief	Prpare les commandes d'une gamme : MTreg (2 commandes) puis mode de mesure continue
+ * @note	L'tat est modifi avant l'chance : la callback systick peut interrompre cette fonction
+ */
+static void BH1750FVI_service_configure(uint8_t range)
+{
+	service_range = range;
+	service_cmd[0] = BH1750FVI_MT_H | (ranges[range].mtreg >> 5);
+	service_cmd[1] = BH1750FVI_MT_L | (ranges[range].mtreg & 0x1F);
+	service_cmd[2] = ranges[range].mode;
+	service_cmd_index = 0;
+	service_state = SERVICE_CONFIG;
+	service_countdown = 1;
+}
+
+static void BH1750FVI_service_send_command(void)
+{
+	service_in_flight = true;
+	if(BSP_I2C_WriteMultiNoRegister_DMA(BH1750FVI_I2C, BH1750FVI_ADDR<<1, &service_cmd[service_cmd_index], 1, &BH1750FVI_service_command_done) != HAL_OK)
+	{
+		service_in_flight = false;
+		service_countdown = 1;		//bus occup : on ressaie  la prochaine ms
+	}
+}
+
+static void BH1750FVI_service_command_done(HAL_StatusTypeDef status)
+{
+	service_in_flight = false;
+	if(status != HAL_OK)
+	{
+		service_cmd_index = 0;		//on reprend la configuration depuis le dbut
+		service_countdown = BH1750FVI_RETRY_MS;
+		return;
+	}
+	if(++service_cmd_index < sizeof(service_cmd))
+	{
+		BH1750FVI_service_send_command();
+		return;
+	}
+	service_discard = true;
+	service_state = SERVICE_WAIT;
+	service_countdown = BH1750FVI_range_period_ms(service_range);
+}
+
+static void BH1750FVI_service_read(void)
+{
+	service_state = SERVICE_READ;
+	service_in_flight = true;
+	if(BSP_I2C_ReadMultiNoRegister_DMA(BH1750FVI_I2C, BH1750FVI_ADDR<<1, service_rx, 2, &BH1750FVI_service_read_done) != HAL_OK)
+	{
+		service_in_flight = false;
+		service_state = SERVICE_WAIT;
+		service_countdown = 1;
+	}
+}
+
+static void BH1750FVI_service_read_done(HAL_StatusTypeDef status)
+{
+	uint16_t raw;
+	uint16_t sensitivity;
+	uint8_t range = service_range;
+
+	service_in_flight = false;
+	if(status != HAL_OK)
+	{
+		service_state = SERVICE_WAIT;
+		service_countdown = BH1750FVI_RETRY_MS;
+		return;
+	}
+
+	raw = (uint16_t)(service_rx[0] << 8 | service_rx[1]);
+	sensitivity = BH1750FVI_range_sensitivity(range);
+	if(service_discard)
+		service_discard = false;
+	else
+	{
+		//lx = raw / 1.2 * 69 / MTreg (/ 2 en mode H2) : en millilux, raw * 57500 / sensibilit (< 2^32)
+		service_measure.millilux = (uint32_t)raw * 57500 / sensitivity;
+		service_measure.raw = raw;
+		service_measure.range = range;
+		service_measure.saturated = (raw == BH1750FVI_FULL_SCALE);
+		service_measure.timestamp_us = BSP_systick_get_time_us();
+		service_measure.count++;
+
+		//auto-ranging, avec hystrsis : aprs un changement, la mesure estime ne dclenche pas le changement inverse
+		if(raw >= BH1750FVI_RANGE_UP && range + 1 < BH1750FVI_RANGE_NB)
+		{
+			BH1750FVI_service_configure(range + 1);
+			return;
+		}
+		if(range > 0 && (uint32_t)raw * BH1750FVI_range_sensitivity(range - 1) / sensitivity < BH1750FVI_RANGE_DOWN)
+		{
+			BH1750FVI_service_configure(range - 1);
+			return;
+		}
+	}
+	service_state = SERVICE_WAIT;
+	service_countdown = BH1750FVI_range_period_ms(range);
+}
+
 #endif
 
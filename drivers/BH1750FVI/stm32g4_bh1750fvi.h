@@ -12,6 +12,7 @@
 
 #include "stm32g4_utils.h"
 #include "stm32g4xx_hal.h"
+#include <stdbool.h>
 
 #define BH1750FVI_I2C 	I2C1
 
@@ -31,7 +32,28 @@
 #define BH1750FVI_ADDR_L	0x23 //Si ADDR est relie  la masse.
 #define BH1750FVI_ADDR_H	0x5C //Si ADDR est relie au 3,3V.
 
+//Registre de temps de mesure (MTreg) : sensibilit et temps de mesure proportionnels  MTreg / 69
+#define BH1750FVI_MT_H		0x40	//+ bits 7:5 de MTreg
+#define BH1750FVI_MT_L		0x60	//+ bits 4:0 de MTreg
+#define BH1750FVI_MTREG_MIN	31
+#define BH1750FVI_MTREG_DEFAULT	69
+#define BH1750FVI_MTREG_MAX	254
+
+//Service de mesure continue : nombre de gammes de l'auto-ranging, de la plus sensible  la plus large
+#define BH1750FVI_RANGE_NB	4
+
+typedef struct
+{
+	uint32_t millilux;		//clairement, en millilux
+	uint32_t timestamp_us;	//instant de la lecture (BSP_systick_get_time_us())
+	uint32_t count;			//nombre de mesures publies depuis le dmarrage du service
+	uint16_t raw;			//valeur brute lue
+	uint8_t range;			//gamme utilise pour cette mesure
+	bool saturated;			//valeur brute  pleine chelle
+}BH1750FVI_measure_t;
+
 void BSP_BH1750FVI_demo(void);
+void BSP_BH1750FVI_demo_service(void);
 
 void BSP_BH1750FVI_init(void);
 void BSP_BH1750FVI_powerOn(void);
@@ -41,4 +63,9 @@ void BSP_BH1750FVI_measureMode(uint8_t mode);
 uint16_t BSP_BH1750FVI_readLuminosity();
 uint16_t BSP_BH1750FVI_read();
 
+void BSP_BH1750FVI_service_start(void);
+void BSP_BH1750FVI_service_stop(void);
+bool BSP_BH1750FVI_get_measure(BH1750FVI_measure_t * measure);
+uint32_t BSP_BH1750FVI_get_millilux(void);
+
 #endif /* LIB_BSP_BH1750FVI_BH1750FVI_H_ */
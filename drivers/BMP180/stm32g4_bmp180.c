@@ -33,22 +33,44 @@
 #include <BMP180/stm32g4_bmp180.h>
 #include <stdio.h>
 #include "stm32g4_gpio.h"
+#include "stm32g4_systick.h"
 
-/* Multiple is faster than divide */
-#define BMP180_1_16     ((float) 0.0625)
-#define BMP180_1_256    ((float) 0.00390625)
-#define BMP180_1_2048   ((float) 0.00048828125)
-#define BMP180_1_4096   ((float) 0.000244140625)
-#define BMP180_1_8192   ((float) 0.0001220703125)
-#define BMP180_1_32768  ((float) 0.000030517578125)
-#define BMP180_1_65536  ((float) 0.0000152587890625)
-#define BMP180_1_101325 ((float) 0.00000986923266726)
+/* Pression standard au niveau de la mer (Pa) */
+#define BMP180_SEA_LEVEL_PRESSURE	101325
+
+/*
+ * Altitude standard (cm) pour p = BMP180_ALTITUDE_P_MIN + i * 512 Pa :
+ * h = 4433000 * (1 - (p / 101325)^0.19029495)
+ * L'interpolation linaire entre deux points donne une erreur infrieure  25 cm sur toute la plage
+ * (quelques cm autour du niveau de la mer), bien en dessous de la prcision absolue du capteur.
+ */
+static const int32_t altitude_table[BMP180_ALTITUDE_POINTS] = {
+	916516, 905173, 893984, 882943, 872047, 861290, 850670, 840181,
+	829822, 819588, 809475, 799482, 789604, 779838, 770183, 760634,
+	751190, 741848, 732606, 723460, 714410, 705452, 696585, 687807,
+	679116, 670509, 661985, 653542, 645179, 636894, 628685, 620550,
+	612489, 604500, 596580, 588730, 580948, 573231, 565580, 557993,
+	550468, 543005, 535603, 528259, 520974, 513747, 506575, 499459,
+	492397, 485389, 478433, 471529, 464676, 457873, 451118, 444413,
+	437755, 431143, 424578, 418059, 411584, 405153, 398766, 392421,
+	386118, 379857, 373637, 367457, 361317, 355216, 349153, 343129,
+	337142, 331192, 325279, 319402, 313560, 307753, 301981, 296242,
+	290538, 284867, 279228, 273622, 268048, 262506, 256994, 251514,
+	246064, 240643, 235253, 229892, 224559, 219256, 213980, 208733,
+	203513, 198320, 193155, 188016, 182903, 177816, 172755, 167720,
+	162709, 157724, 152763, 147827, 142914, 138026, 133161, 128319,
+	123500, 118705, 113931, 109180, 104452, 99745, 95060, 90396,
+	85753, 81131, 76531, 71950, 67391, 62851, 58331, 53831,
+	49351, 44890, 40448, 36026, 31622, 27237, 22870, 18522,
+	14191, 9879, 5585, 1308, -2951, -7193, -11418, -15626,
+	-19817, -23991, -28148, -32290, -36415, -40523, -44616, -48693,
+	-52754, -56800, -60830, -64845, -68844, -72829
+};
 
 
 //Fonction blocante, pour dmo.
 void BSP_BMP180_demo(void)
 {
-	char buffer[500];
 	/* Working structure */
 	BMP180_t BMP180_Data;
 
@@ -68,50 +90,55 @@ void BSP_BMP180_demo(void)
 	printf( "Pressure right above the sea: %ld pascals\n", BSP_BMP180_GetPressureAtSeaLevel(95000, 1000));
 	printf("Data were calculated from pressure %ld pascals at know altitude %d meters\n\n\n", 95000, 1000);
 
+	/* Start a measurement at ultra high resolution */
+	BSP_BMP180_run_measure(&BMP180_Data, BMP180_Oversampling_UltraHighResolution);
+	uint32_t next_measure = HAL_GetTick() + 1000;
+
 	while (1)
 	{
-		/* Start temperature conversion */
-		BSP_BMP180_StartTemperature(&BMP180_Data);
-
-		/* Wait delay in microseconds */
-		/* You can do other things here instead of delay */
-		HAL_Delay(BMP180_Data.Delay/1000+1);
-
-		/* Read temperature first */
-		BSP_BMP180_ReadTemperature(&BMP180_Data);
-
-		/* Start pressure conversion at ultra high resolution */
-		BSP_BMP180_StartPressure(&BMP180_Data, BMP180_Oversampling_UltraHighResolution);
-
-		/* Wait delay in microseconds */
-		/* You can do other things here instead of delay */
-		HAL_Delay(BMP180_Data.Delay/1000+1);
+		/* Non blocking: the state machine only issues I2C transfers when a conversion deadline is reached */
+		BSP_BMP180_process_main(&BMP180_Data);
 
-		/* Read pressure value */
-		BMP180_ReadPressure(&BMP180_Data);
+		switch (BSP_BMP180_get_value(&BMP180_Data)) {
+			case BMP180_Result_Ok:
+				printf("Temp: %d (0.1 degrees)\nPressure: %6ld Pascals\nAltitude at current pressure: %ld cm\n\n",
+					BMP180_Data.TemperatureDeci,
+					BMP180_Data.Pressure,
+					BMP180_Data.AltitudeCm
+				);
+				break;
+			case BMP180_Result_Error:
+				printf("BMP180 I2C error\n");
+				break;
+			default:
+				break;
+		}
 
-		/* Format data and print to USART */
-		sprintf(buffer, "Temp: %2.3f degrees\nPressure: %6ld Pascals\nAltitude at current pressure: %3.2f meters\n\n",
-			BMP180_Data.Temperature,
-			BMP180_Data.Pressure,
-			BMP180_Data.Altitude
-		);
-		/* Send to USART */
-		printf(buffer);
-
-		/* Some delay */
-		HAL_Delay(1000);
+		/* One measurement per second, the CPU is free in between */
+		if ((int32_t)(HAL_GetTick() - next_measure) >= 0) {
+			next_measure += 1000;
+			BSP_BMP180_run_measure(&BMP180_Data, BMP180_Oversampling_UltraHighResolution);
+		}
 	}
 }
 
 
 /* EEPROM values */
-int16_t AC1, AC2, AC3, B1, B2, MB, MC, MD;
-uint16_t AC4, AC5, AC6, UT;
-/* OK */
-int32_t X1, X2, X3, B3, B5, B6, T, p;
-uint32_t B4, B7, UP;
-uint8_t lib_initialized = 0;
+static int16_t AC1, AC2, AC3, B1, B2, MB, MC, MD;
+static uint16_t AC4, AC5, AC6;
+/* Valeur intermdiaire du calcul de temprature, rutilise pour la pression */
+static int32_t B5;
+static uint8_t lib_initialized = 0;
+
+/* Transfert I2C asynchrone en cours (un seul capteur par bus) */
+static volatile bool xfer_pending = false;
+static volatile HAL_StatusTypeDef xfer_status = HAL_OK;
+static volatile uint32_t xfer_end_us = 0;
+static uint8_t xfer_buffer[3];
+
+static void BMP180_xfer_callback(HAL_StatusTypeDef status);
+static void BMP180_compute_temperature(BMP180_t* BMP180_Data, uint8_t * data);
+static void BMP180_compute_pressure(BMP180_t* BMP180_Data, uint8_t * data);
 
 
 /*
@@ -131,6 +158,7 @@ BMP180_Result_t BSP_BMP180_Init(BMP180_t* BMP180_Data, GPIO_TypeDef * GPIOx, uin
 		HAL_Delay(10);
 	}
 
+	BMP180_Data->State = BMP180_State_Idle;
 
 	/* Initialize I2C */
 	BSP_I2C_Init(BMP180_I2C, BMP180_I2C_SPEED, true);
@@ -164,6 +192,28 @@ BMP180_Result_t BSP_BMP180_Init(BMP180_t* BMP180_Data, GPIO_TypeDef * GPIOx, uin
 	return BMP180_Result_Ok;
 }
 
+/**
+ * @brief	Dlai maximal de conversion et commande associs  un surchantillonnage
+ */
+static uint8_t BMP180_pressure_command(BMP180_Oversampling_t Oversampling, uint16_t * delay)
+{
+	switch (Oversampling) {
+		case BMP180_Oversampling_Standard:
+			*delay = BMP180_PRESSURE_1_DELAY;
+			return BMP180_COMMAND_PRESSURE_1;
+		case BMP180_Oversampling_HighResolution:
+			*delay = BMP180_PRESSURE_2_DELAY;
+			return BMP180_COMMAND_PRESSURE_2;
+		case BMP180_Oversampling_UltraHighResolution:
+			*delay = BMP180_PRESSURE_3_DELAY;
+			return BMP180_COMMAND_PRESSURE_3;
+		case BMP180_Oversampling_UltraLowPower:
+		default:
+			*delay = BMP180_PRESSURE_0_DELAY;
+			return BMP180_COMMAND_PRESSURE_0;
+	}
+}
+
 BMP180_Result_t BSP_BMP180_StartTemperature(BMP180_t* BMP180_Data) {
 	/* Check for library initialization */
 	if (!lib_initialized) {
@@ -188,19 +238,7 @@ BMP180_Result_t BSP_BMP180_ReadTemperature(BMP180_t* BMP180_Data) {
 	/* Read multi bytes from I2C */
 	BSP_I2C_ReadMulti(BMP180_I2C, BMP180_I2C_ADDRESS, BMP180_REGISTER_RESULT, data, 2);
 	
-	/* Get uncompensated temperature */
-	UT = data[0] << 8 | data[1];
-	
-	/* Calculate true temperature */
-	X1 = (UT - AC6) * AC5 * BMP180_1_32768;
-	if(X1+MD)
-		X2 = MC * 2048 / (X1 + MD);
-	else
-		X2 = 0;
-	B5 = X1 + X2;
-	
-	/* Get temperature in degrees */
-	BMP180_Data->Temperature = (B5 + 8) / ((float)160);
+	BMP180_compute_temperature(BMP180_Data, data);
 	
 	/* Return OK */
 	return BMP180_Result_Ok;
@@ -214,28 +252,7 @@ BMP180_Result_t BSP_BMP180_StartPressure(BMP180_t* BMP180_Data, BMP180_Oversampl
 		return BMP180_Result_LibraryNotInitialized;
 	}
 	
-	switch (Oversampling) {
-		case BMP180_Oversampling_UltraLowPower :
-			command = BMP180_COMMAND_PRESSURE_0;
-			BMP180_Data->Delay = BMP180_PRESSURE_0_DELAY;
-			break;
-		case BMP180_Oversampling_Standard:
-			command = BMP180_COMMAND_PRESSURE_1;
-			BMP180_Data->Delay = BMP180_PRESSURE_1_DELAY;
-			break;
-		case BMP180_Oversampling_HighResolution:
-			command = BMP180_COMMAND_PRESSURE_2;
-			BMP180_Data->Delay = BMP180_PRESSURE_2_DELAY;
-			break;
-		case BMP180_Oversampling_UltraHighResolution:
-			command = BMP180_COMMAND_PRESSURE_3;
-			BMP180_Data->Delay = BMP180_PRESSURE_3_DELAY;
-			break;
-		default:
-			command = BMP180_COMMAND_PRESSURE_0;
-			BMP180_Data->Delay = BMP180_PRESSURE_0_DELAY;
-			break;
-	}
+	command = BMP180_pressure_command(Oversampling, &BMP180_Data->Delay);
 	/* Send to device */
 	BSP_I2C_Write(BMP180_I2C, BMP180_I2C_ADDRESS, BMP180_REGISTER_CONTROL, command);
 	/* Save selected oversampling */
@@ -255,42 +272,244 @@ BMP180_Result_t BMP180_ReadPressure(BMP180_t* BMP180_Data) {
 	/* Read multi bytes from I2C */
 	BSP_I2C_ReadMulti(BMP180_I2C, BMP180_I2C_ADDRESS, BMP180_REGISTER_RESULT, data, 3);
 	
+	BMP180_compute_pressure(BMP180_Data, data);
+	
+	/* Return OK */
+	return BMP180_Result_Ok;
+}
+
+/**
+ * @brief	Compensation de la temprature, en entiers comme dans l'algorithme de la datasheet Bosch
+ * @param	data : 2 octets lus  partir du registre BMP180_REGISTER_RESULT
+ * @post	B5 est mis  jour pour le calcul de pression suivant
+ */
+static void BMP180_compute_temperature(BMP180_t* BMP180_Data, uint8_t * data)
+{
+	int32_t UT, X1, X2;
+
+	/* Get uncompensated temperature */
+	UT = (int32_t)(data[0] << 8 | data[1]);
+
+	/* Calculate true temperature */
+	X1 = ((UT - (int32_t)AC6) * (int32_t)AC5) >> 15;
+	if(X1 + MD)
+		X2 = ((int32_t)MC * 2048) / (X1 + MD);
+	else
+		X2 = 0;
+	B5 = X1 + X2;
+
+	/* Get temperature in 0.1 degrees */
+	BMP180_Data->TemperatureDeci = (int16_t)((B5 + 8) >> 4);
+	BMP180_Data->Temperature = (float)BMP180_Data->TemperatureDeci / 10;
+}
+
+/**
+ * @brief	Compensation de la pression, en entiers comme dans l'algorithme de la datasheet Bosch
+ * @param	data : 3 octets lus  partir du registre BMP180_REGISTER_RESULT
+ * @pre		BMP180_compute_temperature doit avoir t appele (B5)
+ */
+static void BMP180_compute_pressure(BMP180_t* BMP180_Data, uint8_t * data)
+{
+	uint8_t oss = (uint8_t)BMP180_Data->Oversampling;
+	int32_t UP, X1, X2, X3, B3, B6, p;
+	uint32_t B4, B7;
+
 	/* Get uncompensated pressure */
-	UP = (data[0] << 16 | data[1] << 8 | data[2]) >> (8 - (uint8_t)BMP180_Data->Oversampling);
+	UP = (int32_t)(((uint32_t)data[0] << 16 | (uint32_t)data[1] << 8 | data[2]) >> (8 - oss));
 
 	/* Calculate true pressure */
 	B6 = B5 - 4000;
-	X1 = (B2 * (B6 * B6 * BMP180_1_4096)) * BMP180_1_2048;
-	X2 = AC2 * B6 * BMP180_1_2048;
+	X1 = ((int32_t)B2 * ((B6 * B6) >> 12)) >> 11;
+	X2 = ((int32_t)AC2 * B6) >> 11;
 	X3 = X1 + X2;
-	B3 = (((AC1 * 4 + X3) << (uint8_t)BMP180_Data->Oversampling) + 2) * 0.25;
-	X1 = AC3 * B6 * BMP180_1_8192;
-	X2 = (B1 * (B6 * B6 * BMP180_1_4096)) * BMP180_1_65536;
-	X3 = ((X1 + X2) + 2) * 0.25;
-	B4 = AC4 * (uint32_t)(X3 + 32768) * BMP180_1_32768;
-	B7 = ((uint32_t)UP - B3) * (50000 >> (uint8_t)BMP180_Data->Oversampling);
+	B3 = ((((int32_t)AC1 * 4 + X3) * (1 << oss)) + 2) >> 2;
+	X1 = ((int32_t)AC3 * B6) >> 13;
+	X2 = ((int32_t)B1 * ((B6 * B6) >> 12)) >> 16;
+	X3 = ((X1 + X2) + 2) >> 2;
+	B4 = ((uint32_t)AC4 * (uint32_t)(X3 + 32768)) >> 15;
+	B7 = ((uint32_t)UP - (uint32_t)B3) * (uint32_t)(50000 >> oss);
+	if (B4 == 0) {
+		return;
+	}
 	if (B7 < 0x80000000) {
-		p = (B7 * 2) / B4;
+		p = (int32_t)((B7 * 2) / B4);
 	} else {
-		p = (B7 / B4) * 2;
+		p = (int32_t)((B7 / B4) * 2);
 	}
-	X1 = ((float)p * BMP180_1_256) * ((float)p * BMP180_1_256);
-	X1 = (X1 * 3038) * BMP180_1_65536;
-	X2 = (-7357 * p) * BMP180_1_65536;
-	p = p + (X1 + X2 + 3791) * BMP180_1_16;
-	
+	X1 = (p >> 8) * (p >> 8);
+	X1 = (X1 * 3038) >> 16;
+	X2 = (-7357 * p) >> 16;
+	p = p + ((X1 + X2 + 3791) >> 4);
+
 	/* Save pressure */
-	BMP180_Data->Pressure = p;
-	
+	BMP180_Data->Pressure = (uint32_t)p;
+
 	/* Calculate altitude */
-	BMP180_Data->Altitude = (float)44330.0 * (float)((float)1.0 - (float)pow((float)p * BMP180_1_101325, 0.19029495));
-	
-	/* Return OK */
-	return BMP180_Result_Ok;
+	BMP180_Data->AltitudeCm = BSP_BMP180_PressureToAltitudeCm((uint32_t)p);
+	BMP180_Data->Altitude = (float)BMP180_Data->AltitudeCm / 100;
+}
+
+int32_t BSP_BMP180_PressureToAltitudeCm(uint32_t pressure) {
+	uint32_t offset, index, frac;
+
+	if (pressure <= BMP180_ALTITUDE_P_MIN) {
+		return altitude_table[0];
+	}
+	offset = pressure - BMP180_ALTITUDE_P_MIN;
+	index = offset >> BMP180_ALTITUDE_P_STEP_LOG2;
+	if (index >= BMP180_ALTITUDE_POINTS - 1) {
+		return altitude_table[BMP180_ALTITUDE_POINTS - 1];
+	}
+	frac = offset & ((1U << BMP180_ALTITUDE_P_STEP_LOG2) - 1);
+
+	/* Interpolation linaire (la table est dcroissante) */
+	return altitude_table[index]
+		- (int32_t)(((uint32_t)(altitude_table[index] - altitude_table[index + 1]) * frac) >> BMP180_ALTITUDE_P_STEP_LOG2);
 }
 
 uint32_t BSP_BMP180_GetPressureAtSeaLevel(uint32_t pressure, float altitude) {
-	return (uint32_t)((float)pressure / ((float)pow(1 - (float)altitude / (float)44330, 5.255)));
+	int32_t altitude_cm = (int32_t)(altitude * 100);
+	uint32_t low = 0, high = BMP180_ALTITUDE_POINTS - 1, mid;
+	uint32_t standard_pressure;
+
+	/* Recherche dichotomique de l'intervalle de la table contenant l'altitude */
+	if (altitude_cm >= altitude_table[0]) {
+		standard_pressure = BMP180_ALTITUDE_P_MIN;
+	} else if (altitude_cm <= altitude_table[BMP180_ALTITUDE_POINTS - 1]) {
+		standard_pressure = BMP180_ALTITUDE_P_MIN + ((BMP180_ALTITUDE_POINTS - 1) << BMP180_ALTITUDE_P_STEP_LOG2);
+	} else {
+		while (high - low > 1) {
+			mid = (low + high) / 2;
+			if (altitude_table[mid] > altitude_cm)
+				low = mid;
+			else
+				high = mid;
+		}
+		/* Pression standard  cette altitude, par interpolation inverse */
+		standard_pressure = BMP180_ALTITUDE_P_MIN + (low << BMP180_ALTITUDE_P_STEP_LOG2)
+			+ (uint32_t)(((altitude_table[low] - altitude_cm) << BMP180_ALTITUDE_P_STEP_LOG2)
+				/ (altitude_table[low] - altitude_table[high]));
+	}
+
+	/* Le rapport pression mesure / pression standard est le mme au niveau de la mer */
+	return (uint32_t)(((uint64_t)pressure * BMP180_SEA_LEVEL_PRESSURE + standard_pressure / 2) / standard_pressure);
+}
+
+/* Machine  tats non bloquante ---------------------------------------------*/
+
+static void BMP180_xfer_callback(HAL_StatusTypeDef status)
+{
+	xfer_status = status;
+	xfer_end_us = BSP_systick_get_time_us();
+	xfer_pending = false;
+}
+
+/**
+ * @brief	Lance une criture de commande ou une lecture de rsultat par DMA
+ * @retval	HAL_BUSY si le bus est occup par un autre transfert : la machine  tats ressaiera au prochain appel
+ */
+static HAL_StatusTypeDef BMP180_xfer_start(bool read, uint16_t count)
+{
+	HAL_StatusTypeDef ret;
+
+	xfer_pending = true;
+	if (read)
+		ret = BSP_I2C_ReadMulti_DMA(BMP180_I2C, BMP180_I2C_ADDRESS, BMP180_REGISTER_RESULT, xfer_buffer, count, &BMP180_xfer_callback);
+	else
+		ret = BSP_I2C_WriteMulti_DMA(BMP180_I2C, BMP180_I2C_ADDRESS, BMP180_REGISTER_CONTROL, xfer_buffer, count, &BMP180_xfer_callback);
+	if (ret != HAL_OK)
+		xfer_pending = false;
+	return ret;
+}
+
+BMP180_Result_t BSP_BMP180_run_measure(BMP180_t* BMP180_Data, BMP180_Oversampling_t Oversampling) {
+	if (!lib_initialized) {
+		return BMP180_Result_LibraryNotInitialized;
+	}
+	if (BMP180_Data->State != BMP180_State_Idle
+		&& BMP180_Data->State != BMP180_State_DataReady
+		&& BMP180_Data->State != BMP180_State_Error) {
+		return BMP180_Result_Busy;
+	}
+	BMP180_Data->Oversampling = Oversampling;
+	BMP180_Data->State = BMP180_State_TemperatureStart;
+	return BMP180_Result_Ok;
+}
+
+void BSP_BMP180_process_main(BMP180_t* BMP180_Data) {
+	/* Rien  faire tant qu'un transfert est en cours */
+	if (xfer_pending) {
+		return;
+	}
+
+	switch (BMP180_Data->State) {
+		case BMP180_State_TemperatureStart:
+			xfer_buffer[0] = BMP180_COMMAND_TEMPERATURE;
+			if (BMP180_xfer_start(false, 1) == HAL_OK) {
+				BMP180_Data->Delay = BMP180_TEMPERATURE_DELAY;
+				BMP180_Data->State = BMP180_State_TemperatureConversion;
+			}
+			break;
+		case BMP180_State_PressureStart:
+			xfer_buffer[0] = BMP180_pressure_command(BMP180_Data->Oversampling, &BMP180_Data->Delay);
+			if (BMP180_xfer_start(false, 1) == HAL_OK) {
+				BMP180_Data->State = BMP180_State_PressureConversion;
+			}
+			break;
+		case BMP180_State_TemperatureConversion:
+		case BMP180_State_PressureConversion:
+			if (xfer_status != HAL_OK) {
+				BMP180_Data->State = BMP180_State_Error;
+				break;
+			}
+			/* La conversion dmarre  la fin de l'criture de la commande */
+			if ((int32_t)(BSP_systick_get_time_us() - xfer_end_us) < (int32_t)BMP180_Data->Delay) {
+				break;
+			}
+			if (BMP180_Data->State == BMP180_State_TemperatureConversion) {
+				if (BMP180_xfer_start(true, 2) == HAL_OK)
+					BMP180_Data->State = BMP180_State_TemperatureRead;
+			} else {
+				BMP180_Data->Timestamp = xfer_end_us + BMP180_Data->Delay;
+				if (BMP180_xfer_start(true, 3) == HAL_OK)
+					BMP180_Data->State = BMP180_State_PressureRead;
+			}
+			break;
+		case BMP180_State_TemperatureRead:
+			if (xfer_status != HAL_OK) {
+				BMP180_Data->State = BMP180_State_Error;
+				break;
+			}
+			BMP180_compute_temperature(BMP180_Data, xfer_buffer);
+			BMP180_Data->State = BMP180_State_PressureStart;
+			break;
+		case BMP180_State_PressureRead:
+			if (xfer_status != HAL_OK) {
+				BMP180_Data->State = BMP180_State_Error;
+				break;
+			}
+			BMP180_compute_pressure(BMP180_Data, xfer_buffer);
+			BMP180_Data->State = BMP180_State_DataReady;
+			break;
+		case BMP180_State_Idle:
+		case BMP180_State_DataReady:
+		case BMP180_State_Error:
+		default:
+			break;
+	}
+}
+
+BMP180_Result_t BSP_BMP180_get_value(BMP180_t* BMP180_Data) {
+	switch (BMP180_Data->State) {
+		case BMP180_State_DataReady:
+			BMP180_Data->State = BMP180_State_Idle;
+			return BMP180_Result_Ok;
+		case BMP180_State_Error:
+			BMP180_Data->State = BMP180_State_Idle;
+			return BMP180_Result_Error;
+		default:
+			return BMP180_Result_Busy;
+	}
 }
 
 #endif
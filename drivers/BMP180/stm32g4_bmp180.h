@@ -39,8 +39,7 @@ extern "C" {
 #if USE_BMP180
 #include "stm32g4_i2c.h"
 #include "stm32g4xx.h"
-#include "stm32g4_i2c.h"
-#include "math.h"
+#include <stdbool.h>
 
 /* Default I2C pin */
 #ifndef BMP180_I2C
@@ -70,20 +69,42 @@ extern "C" {
 #define	BMP180_COMMAND_PRESSURE_2 	0xB4
 #define	BMP180_COMMAND_PRESSURE_3 	0xF4
 
-/* Minimum waiting delay, in microseconds */
+/* Minimum waiting delay, in microseconds (maximum conversion time from the datasheet) */
 #define BMP180_TEMPERATURE_DELAY	4500
 #define BMP180_PRESSURE_0_DELAY		4500
 #define BMP180_PRESSURE_1_DELAY		7500
-#define BMP180_PRESSURE_2_DELAY		13000
-#define BMP180_PRESSURE_3_DELAY		25000
+#define BMP180_PRESSURE_2_DELAY		13500
+#define BMP180_PRESSURE_3_DELAY		25500
+
+/* Pressure range covered by the altitude table, in pascals (sensor range: 300 to 1100 hPa) */
+#define BMP180_ALTITUDE_P_MIN		30000
+#define BMP180_ALTITUDE_P_STEP_LOG2	9		/* 512 Pa between two points of the table */
+#define BMP180_ALTITUDE_POINTS		158
 
 
 typedef enum {
 	BMP180_Result_Ok = 0x00,            /*!< Everything OK */
 	BMP180_Result_DeviceNotConnected,   /*!< Device is not connected to I2C */
-	BMP180_Result_LibraryNotInitialized /*!< Library is not initialized */
+	BMP180_Result_LibraryNotInitialized, /*!< Library is not initialized */
+	BMP180_Result_Busy,                 /*!< A measurement is in progress, no new data yet */
+	BMP180_Result_Error                 /*!< I2C transfer failed during the last measurement */
 } BMP180_Result_t;
 
+/**
+ * @brief  tats de la machine  tats de mesure (@ref BSP_BMP180_process_main)
+ */
+typedef enum {
+	BMP180_State_Idle = 0,              /*!< No measurement requested */
+	BMP180_State_TemperatureStart,      /*!< Temperature command waiting for the I2C bus */
+	BMP180_State_TemperatureConversion, /*!< Temperature conversion running */
+	BMP180_State_TemperatureRead,       /*!< Temperature result being read */
+	BMP180_State_PressureStart,         /*!< Pressure command waiting for the I2C bus */
+	BMP180_State_PressureConversion,    /*!< Pressure conversion running */
+	BMP180_State_PressureRead,          /*!< Pressure result being read */
+	BMP180_State_DataReady,             /*!< New data available, see @ref BSP_BMP180_get_value */
+	BMP180_State_Error                  /*!< I2C transfer failed */
+} BMP180_State_t;
+
 /**
  * @brief  Options pour les rglages de surchantillonnage
  * @note   Ces rglages varient en nombre d'chantillons pour un rsultat
@@ -101,8 +122,12 @@ typedef struct {
 	float Altitude;                        /*!< Calculated altitude at given read pressure */
 	uint32_t Pressure;                     /*!< Pressure in pascals */
 	float Temperature;                     /*!< Temperature in degrees */
+	int32_t AltitudeCm;                    /*!< Calculated altitude, in centimeters */
+	int16_t TemperatureDeci;               /*!< Temperature, in 0.1 degrees */
 	uint16_t Delay;                        /*!< Number of microseconds, that sensor needs to calculate data that you request to */
 	BMP180_Oversampling_t Oversampling; /*!< Oversampling for pressure calculation */
+	volatile BMP180_State_t State;         /*!< State of the non-blocking measurement */
+	uint32_t Timestamp;                    /*!< Time of the end of the pressure conversion, in microseconds */
 } BMP180_t;
 
 
@@ -164,6 +189,37 @@ BMP180_Result_t BMP180_ReadPressure(BMP180_t* BMP180_Data);
  */
 uint32_t BSP_BMP180_GetPressureAtSeaLevel(uint32_t pressure, float altitude);
 
+/**
+ * @brief  Lance une mesure non bloquante (temprature puis pression)
+ * @note   La mesure avance dans @ref BSP_BMP180_process_main : les commandes et les lectures passent par le DMA I2C
+ *         et chaque conversion est attendue selon son dlai maximal, sans bloquer l'appelant.
+ * @param  *BMP180_Data: Pointeur vers la structure @ref BMP180_t
+ * @param  Oversampling: Option de surchantillonnage pour le calcul de la pression
+ * @retval BMP180_Result_Busy si une mesure est dj en cours, BMP180_Result_Ok sinon
+ */
+BMP180_Result_t BSP_BMP180_run_measure(BMP180_t* BMP180_Data, BMP180_Oversampling_t Oversampling);
+
+/**
+ * @brief  Fait avancer la mesure lance par @ref BSP_BMP180_run_measure,  appeler en tche de fond
+ * @param  *BMP180_Data: Pointeur vers la structure @ref BMP180_t
+ */
+void BSP_BMP180_process_main(BMP180_t* BMP180_Data);
+
+/**
+ * @brief  Indique si la dernire mesure non bloquante est disponible
+ * @param  *BMP180_Data: Pointeur vers la structure @ref BMP180_t
+ * @retval BMP180_Result_Ok si de nouvelles donnes sont disponibles (la machine  tats repasse au repos),
+ *         BMP180_Result_Busy si la mesure est en cours, BMP180_Result_Error si un transfert I2C a chou
+ */
+BMP180_Result_t BSP_BMP180_get_value(BMP180_t* BMP180_Data);
+
+/**
+ * @brief  Calcule l'altitude standard correspondant  une pression (table de 512 Pa interpole, erreur < 25 cm)
+ * @param  pressure: Pression en pascals
+ * @retval Altitude en centimtres
+ */
+int32_t BSP_BMP180_PressureToAltitudeCm(uint32_t pressure);
+
 
 /* C++ detection */
 #ifdef __cplusplus
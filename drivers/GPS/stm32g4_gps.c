@@ -5,18 +5,22 @@
  * @date	1 fvr. 2018	&& Juin 2024 --> portage sur g431
  * @brief	Module pour utiliser le GPS
  *******************************************************************************
+ * Les trames NMEA sont analyses au fil de l'eau, octet par octet, sans recopie de la ligne :
+ * - le checksum est calcul  chaque octet reu,
+ * - l'adresse (metteur + type de trame) est reconnue par un hachage parfait, calcul lui aussi  chaque octet,
+ * - chaque champ est converti en virgule fixe ds qu'il est termin, dans une zone de travail,
+ * - les valeurs ne sont recopies dans gps_datas_t que si le checksum est correct.
+ * Trames gres : RMC, GGA, VTG, GSA, GSV, quel que soit l'metteur ($GP, $GN, $GL, $GA, $GB, $BD, $GQ).
  */
 
 #include "config.h"
 #if USE_GPS
 #include "stm32g4_gps.h"
 #include "stm32g4_uart.h"
-#include <math.h>
-#include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 //Constantes prives
-#define BUFFER_SIZE	256
 
 /** \brief NMEA message start-of-message (SOM) character */
 #define NMEA_MESSAGE_SOM '$'
@@ -27,16 +31,161 @@
 /** \brief NMEA message field separator */
 #define NMEA_MESSAGE_FIELD_SEPARATOR ','
 
-#define PI                     (3.141592653589793)        /**< PI value */
-#define PI180                  (PI / 180)                 /**< PI division by 180 */
-#define EARTHRADIUS_KM         (6378)                     /**< Earth's mean radius in km */
-#define EARTHRADIUS_M          (EARTHRADIUS_KM * 1000)    /**< Earth's mean radius in m */
+#define NMEA_TALKER_SIZE		2		//GP, GN...
+#define NMEA_ADDRESS_SIZE		5		//GPRMC...
+#define NMEA_FIELD_SIZE			16		//Le plus long champ utile est une longitude dddmm.mmmmmm
 
+/*
+ * Hachage parfait des adresses : h = (h ^ c) * 23 sur 8 bits, calcul sparment sur l'metteur et sur le type de trame.
+ * Les 3 bits de poids fort du hachage du type de trame et les 4 bits de poids fort de celui de l'metteur
+ * sont diffrents pour chacune des adresses connues (tables nmea_sentences et nmea_talkers).
+ */
+#define NMEA_HASH_MULTIPLIER	23
+#define NMEA_SENTENCE_SLOT(h)	((h) >> 5)
+#define NMEA_TALKER_SLOT(h)		((h) >> 4)
+
+#define SECONDS_IN_DAY			86400
+
+//Types privs
+typedef enum
+{
+	NMEA_WAIT_SOM = 0,
+	NMEA_ADDRESS,
+	NMEA_FIELDS,
+	NMEA_CHECKSUM_HIGH,
+	NMEA_CHECKSUM_LOW
+}nmea_state_e;
+
+//Zones de travail : les champs d'une trame sont convertis ici, puis recopis une fois le checksum vrifi
+typedef struct
+{
+	uint32_t	time;			//[HHMMSSmmm]
+	bool		active;
+	int32_t		latitude;
+	int32_t		longitude;
+	uint32_t	speed;			//[1e-3 noeud]
+	uint16_t	course;
+	uint32_t	date;			//[DDMMYY]
+}nmea_rmc_t;
+
+typedef struct
+{
+	uint32_t	time;
+	int32_t		latitude;
+	int32_t		longitude;
+	uint8_t		quality;
+	uint8_t		satellites;
+	uint16_t	hdop;
+	int32_t		altitude;
+	int32_t		separation;
+}nmea_gga_t;
+
+typedef struct
+{
+	uint16_t	course;
+	uint32_t	speed;			//[1e-3 km/h]
+	bool		valid;
+}nmea_vtg_t;
+
+typedef struct
+{
+	uint8_t		mode;
+	uint8_t		nb_prn;
+	uint8_t		prn[GPS_MAX_USED_PRN];
+	uint16_t	pdop;
+	uint16_t	hdop;
+	uint16_t	vdop;
+}nmea_gsa_t;
+
+typedef struct
+{
+	uint8_t		message;		//Numro de la trame dans la srie
+	gps_satellite_t	satellites[4];
+}nmea_gsv_t;
+
+typedef struct
+{
+	nmea_state_e	state;
+	nmea_frame_e	frame;		//TRAME_UNKNOW si l'adresse n'est pas gre
+	nmea_talker_e	talker;
+	uint8_t		checksum;		//Ou exclusif des octets reus depuis le '$'
+	uint8_t		received_checksum;
+	uint8_t		hash;
+	uint8_t		talker_hash;
+	uint8_t		index;			//Nombre d'octets reus dans l'adresse ou dans le champ en cours
+	uint8_t		field;			//Numro du champ en cours (1 pour le premier aprs l'adresse)
+	bool		overflow;		//Un champ trop long a t reu
+	char		address[NMEA_ADDRESS_SIZE];
+	char		buffer[NMEA_FIELD_SIZE];
+	uint32_t	present;		//Champs non vides (bit n pour le champ n)
+	union
+	{
+		nmea_rmc_t	rmc;
+		nmea_gga_t	gga;
+		nmea_vtg_t	vtg;
+		nmea_gsa_t	gsa;
+		nmea_gsv_t	gsv;
+	}s;
+}nmea_parser_t;
 
 //Fonctions prives
-static nmea_frame_e GPS_parse(uint8_t * buffer, gps_datas_t * gps_datas);
-static bool GPS_parse_gprmc(uint8_t * string, gps_datas_t * coordinates);
-static uint8_t hextoint(char c);
+static void GPS_start_frame(void);
+static nmea_frame_e GPS_end_frame(gps_datas_t * gps_datas);
+static void GPS_find_address(void);
+static void GPS_end_field(void);
+static void GPS_field_rmc(uint8_t field, const char * s, uint8_t len);
+static void GPS_field_gga(uint8_t field, const char * s, uint8_t len);
+static void GPS_field_vtg(uint8_t field, const char * s, uint8_t len);
+static void GPS_field_gsa(uint8_t field, const char * s, uint8_t len);
+static void GPS_field_gsv(uint8_t field, const char * s, uint8_t len);
+static nmea_frame_e GPS_commit_rmc(gps_datas_t * gps_datas);
+static nmea_frame_e GPS_commit_gga(gps_datas_t * gps_datas);
+static nmea_frame_e GPS_commit_vtg(gps_datas_t * gps_datas);
+static nmea_frame_e GPS_commit_gsa(gps_datas_t * gps_datas);
+static nmea_frame_e GPS_commit_gsv(gps_datas_t * gps_datas);
+static void GPS_set_time(gps_datas_t * gps_datas, uint32_t time);
+static int32_t GPS_to_fixed(const char * s, uint8_t len, uint8_t decimals);
+static int32_t GPS_to_coordinate(const char * s, uint8_t len);
+static int8_t hextoint(char c);
+static void GPS_print_coordinate(int32_t coordinate);
+
+//Variables prives
+static nmea_parser_t nmea;
+
+static const struct
+{
+	char id[NMEA_ADDRESS_SIZE - NMEA_TALKER_SIZE];
+	nmea_frame_e frame;
+}nmea_sentences[8] = {
+	[0] = {"RMC", TRAME_RMC},
+	[2] = {"VTG", TRAME_VTG},
+	[4] = {"GSV", TRAME_GSV},
+	[5] = {"GSA", TRAME_GSA},
+	[6] = {"GGA", TRAME_GGA}
+};
+
+static const struct
+{
+	char id[NMEA_TALKER_SIZE];
+	nmea_talker_e talker;
+}nmea_talkers[16] = {
+	[0] = {"GL", TALKER_GL},
+	[2] = {"GB", TALKER_GB},
+	[3] = {"GN", TALKER_GN},
+	[4] = {"BD", TALKER_BD},
+	[5] = {"GQ", TALKER_GQ},
+	[6] = {"GP", TALKER_GP},
+	[14] = {"GA", TALKER_GA}
+};
+
+//Analyse d'un champ, pour chaque type de trame gr (indice : frame - TRAME_RMC)
+static void (* const nmea_field_parsers[])(uint8_t field, const char * s, uint8_t len) = {
+	GPS_field_rmc, GPS_field_gga, GPS_field_vtg, GPS_field_gsa, GPS_field_gsv
+};
+
+static nmea_frame_e (* const nmea_commits[])(gps_datas_t * gps_datas) = {
+	GPS_commit_rmc, GPS_commit_gga, GPS_commit_vtg, GPS_commit_gsa, GPS_commit_gsv
+};
 
 
 /*
@@ -44,37 +193,39 @@ static uint8_t hextoint(char c);
  * @pre	: cette fonction est conue pour recevoir des trames en provenances de l'UART1 OU de l'UART2, mais pas simultanment !
  * @note : vous pouvez utiliser le fichier docklight_test_gprmc pour tester ce code. Il fournit des trames GPS valides  envoyer sur la liaison srie.
  */
-void GPS_DEMO(void)
+void BSP_GPS_demo(void)
 {
-	uint8_t c;
 	gps_datas_t gps_datas;
-	//GPS_test();		//dcommenter cette ligne permet de tester le parsing de trames
+	uint32_t frames;
+	//BSP_GPS_test();		//dcommenter cette ligne permet de tester le parsing de trames
 	BSP_UART_init(UART1_ID, 9600);		//exemple  adapter  la vitesse de votre GPS
 	BSP_UART_init(UART2_ID, 9600);	//l'UART2 de la nucleo tant accessible via la sonde de dbogage, vous pouvez tester avec de "fausses trames"
 		//uart2 tait  115200
+	memset(&gps_datas, 0, sizeof(gps_datas));
 	while(1)
 	{
-		while(BSP_UART_data_ready(UART1_ID))
+		//on transmet au parser tous les octets reus
+		frames = BSP_GPS_process_uart(UART1_ID, &gps_datas);
+		if(frames & (1UL << TRAME_RMC))
 		{
-			//on rcupre chaque octet reu
-			c = BSP_UART_get_next_byte(UART1_ID);
-
-			//on le transmet au parser
-			if(BSP_GPS_process_rx(c, &gps_datas) == TRAME_GPRMC)
-			{
-				//lorsqu'une trame complte et valide a t reue, on peut traiter les donnes interpretes.
-				printf("UART1 : %lf, %lf\n",gps_datas.latitude_deg, gps_datas.longitude_deg);
-			}
-
+			//lorsqu'une trame complte et valide a t reue, on peut traiter les donnes interpretes.
+			printf("UART1 : ");
+			GPS_print_coordinate(gps_datas.latitude);
+			printf(", ");
+			GPS_print_coordinate(gps_datas.longitude);
+			printf("\n");
 		}
 
 		//Attention, la fonction GPS_process_rx n'est pas rentrante...
 		//Risque de dysfonctionnement si des donnes sont envoyes sur l'UART2 et sur l'UART1 !!!
-		while(BSP_UART_data_ready(UART2_ID))
+		frames = BSP_GPS_process_uart(UART2_ID, &gps_datas);
+		if(frames & (1UL << TRAME_RMC))
 		{
-			c = BSP_UART_get_next_byte(UART2_ID);
-			if(BSP_GPS_process_rx(c, &gps_datas) == TRAME_GPRMC)
-				printf("UART2 : %lf, %lf\n",gps_datas.latitude_deg, gps_datas.longitude_deg);
+			printf("UART2 : ");
+			GPS_print_coordinate(gps_datas.latitude);
+			printf(", ");
+			GPS_print_coordinate(gps_datas.longitude);
+			printf("\n");
 		}
 	}
 }
@@ -88,7 +239,7 @@ void BSP_GPS_test(void)
 {
 	//checksum calculator : http://www.hhhh.org/wiml/proj/nmeaxor.html
 	//https://www.coordonnees-gps.fr/
-	#define NB_TEST_STRINGS 7
+	#define NB_TEST_STRINGS 13
 	char * test_strings[NB_TEST_STRINGS] = {
 			"$GPRMC,063355.00,A,4729.60520,N,00033.05755,W,0.022,,170614,,,D*6F\r\n",
 			"$GPRMC,Q63355.00,A,4729.60520,N,00033.05755,W,0.022,,170614,,,D*6F\r\n",	//checksum fail
@@ -96,20 +247,42 @@ void BSP_GPS_test(void)
 			"$GPRMC,081836,A,3751.65,S,14507.36,E,000.0,360.0,130998,011.3,E*62\r\n",
 			"$GPABC,ABCDEFGHIJKLMNOPQRSTUVWXYZ,E*09\r\n",		//Unknow frame
 			"$GPGLL,3751.65,S,14507.36,E*77\r\n",				//GPGGL
-			"$GPRMC,010203.00,A,8959.99999,N,17959.99999,E,254.000,,010418,,,D*74\r\n"};
-	uint16_t i;
+			"$GPRMC,010203.00,A,8959.99999,N,17959.99999,E,254.000,,010418,,,D*74\r\n",
+			"$GNRMC,101530.20,A,4729.60520,N,00033.05755,W,1.250,87.45,170624,,,A*53\r\n",
+			"$GNGGA,101530.20,4729.60520,N,00033.05755,W,1,12,0.78,52.3,M,49.1,M,,*6B\r\n",
+			"$GNVTG,87.45,T,,M,1.250,N,2.315,K,A*1E\r\n",
+			"$GNGSA,A,3,05,13,15,18,20,23,24,,,,,,1.35,0.78,1.10*1B\r\n",
+			"$GPGSV,2,1,07,05,45,120,38,13,60,255,42,15,12,310,30,18,25,45,35*4E\r\n",
+			"$GLGSV,1,1,02,65,30,100,33,72,70,200,*66\r\n"};
+	uint16_t i, j;
 	gps_datas_t gps_datas;
-	uint8_t buf[128];
 	nmea_frame_e err;
 
+	memset(&gps_datas, 0, sizeof(gps_datas));
 	for(i=0;i<NB_TEST_STRINGS; i++)
 	{
-		sprintf((char*)buf, "%s", (uint8_t*)test_strings[i]);	//On recopie la chaine en RAM
-		err = GPS_parse(buf, &gps_datas);	//On parse
+		err = NO_TRAME_RECEIVED;
+		for(j=0; test_strings[i][j] && err == NO_TRAME_RECEIVED; j++)
+			err = BSP_GPS_process_rx((uint8_t)test_strings[i][j], &gps_datas);	//On parse, octet par octet
 		switch(err)
 		{
-			case TRAME_GPRMC:
-				printf("%lf, %lf\n",gps_datas.latitude_deg, gps_datas.longitude_deg);	//On affiche les coordonnes lues
+			case TRAME_RMC:
+				GPS_print_coordinate(gps_datas.latitude);	//On affiche les coordonnes lues
+				printf(", ");
+				GPS_print_coordinate(gps_datas.longitude);
+				printf(" %lu mm/s %u.%02u deg\n", gps_datas.speed, gps_datas.course/100, gps_datas.course%100);
+				break;
+			case TRAME_GGA:
+				printf("fix %u, %u sat, alt %ld mm, hdop %u\n", gps_datas.fix_quality, gps_datas.satellites_used, gps_datas.altitude, gps_datas.hdop);
+				break;
+			case TRAME_VTG:
+				printf("%lu mm/s %u.%02u deg\n", gps_datas.speed, gps_datas.course/100, gps_datas.course%100);
+				break;
+			case TRAME_GSA:
+				printf("fix %uD, pdop %u hdop %u vdop %u\n", gps_datas.fix_mode, gps_datas.pdop, gps_datas.hdop, gps_datas.vdop);
+				break;
+			case TRAME_GSV:
+				printf("%u satellites en vue\n", gps_datas.satellites_in_view);
 				break;
 			case TRAME_INVALID:
 				printf("Invalid trame\n");
@@ -129,191 +302,462 @@ void BSP_GPS_test(void)
 
 
 /*
- * Cette fonction rcupre le nouveau caractre fourni (c) et le range dans son propre buffer
- * Si l'on atteint le dbut de la trame ($) -> on reset l'index de lecture
- * Lorsqu'on atteint la fin de la trame (dtection d'un caractre '\n') -> on sous-traite le dcoupage de la trame au parser.
+ * Cette fonction rcupre le nouveau caractre fourni (c) et fait avancer l'analyse de la trame en cours.
+ * Si l'on atteint le dbut de la trame ($) -> on recommence l'analyse
+ * Lorsqu'on atteint la fin du checksum -> les donnes de la trame sont recopies dans gps_datas si elle est valide.
  * Une trame correctement lue donne lieu au remplissage de la structure gps_datas et au renvoi d'une valeur de retour diffrente de NO_TRAME_RECEIVED (0)
  */
 nmea_frame_e BSP_GPS_process_rx(uint8_t c, gps_datas_t * gps_datas)
 {
-	static uint8_t buffer[BUFFER_SIZE];
-	static uint16_t index = 0;
+	int8_t digit;
+
+	if(c == NMEA_MESSAGE_SOM)
+	{
+		GPS_start_frame();
+		return NO_TRAME_RECEIVED;
+	}
+
+	switch(nmea.state)
+	{
+		case NMEA_ADDRESS:
+			if(c == NMEA_MESSAGE_EOM)
+			{
+				nmea.frame = TRAME_UNKNOW;
+				nmea.state = NMEA_CHECKSUM_HIGH;
+				break;
+			}
+			nmea.checksum ^= c;
+			if(c == NMEA_MESSAGE_FIELD_SEPARATOR)
+			{
+				GPS_find_address();
+				nmea.state = NMEA_FIELDS;
+			}
+			else if(nmea.index < NMEA_ADDRESS_SIZE)
+			{
+				nmea.address[nmea.index++] = (char)c;
+				nmea.hash = (uint8_t)((nmea.hash ^ c) * NMEA_HASH_MULTIPLIER);
+				if(nmea.index == NMEA_TALKER_SIZE)
+				{
+					nmea.talker_hash = nmea.hash;
+					nmea.hash = 0;
+				}
+			}
+			else
+				nmea.index = NMEA_ADDRESS_SIZE + 1;	//Adresse trop longue
+			break;
+		case NMEA_FIELDS:
+			if(c == NMEA_MESSAGE_EOM)
+			{
+				GPS_end_field();
+				nmea.state = NMEA_CHECKSUM_HIGH;
+			}
+			else if(c == '\r' || c == '\n')
+				nmea.state = NMEA_WAIT_SOM;		//Trame sans checksum : ignore
+			else
+			{
+				nmea.checksum ^= c;
+				if(c == NMEA_MESSAGE_FIELD_SEPARATOR)
+					GPS_end_field();
+				else if(nmea.index < NMEA_FIELD_SIZE)
+					nmea.buffer[nmea.index++] = (char)c;
+				else
+					nmea.overflow = true;
+			}
+			break;
+		case NMEA_CHECKSUM_HIGH:
+			digit = hextoint((char)c);
+			nmea.received_checksum = (uint8_t)(digit << 4);
+			nmea.state = (digit < 0) ? NMEA_WAIT_SOM : NMEA_CHECKSUM_LOW;
+			if(digit < 0)
+				return CHECKSUM_INVALID;
+			break;
+		case NMEA_CHECKSUM_LOW:
+			digit = hextoint((char)c);
+			nmea.received_checksum |= (uint8_t)digit;
+			nmea.state = NMEA_WAIT_SOM;
+			if(digit < 0 || nmea.received_checksum != nmea.checksum)
+				return CHECKSUM_INVALID;
+			return GPS_end_frame(gps_datas);
+		case NMEA_WAIT_SOM:
+			//No break;
+		default:
+			break;
+	}
+	return NO_TRAME_RECEIVED;
+}
+
+/*
+ * Cette fonction transmet au parser tous les octets disponibles sur l'UART.
+ * Elle renvoie l'ensemble des trames valides reues : le bit n est  1 si une trame de type n (TRAME_RMC...) a t lue.
+ */
+uint32_t BSP_GPS_process_uart(uart_id_t uart_id, gps_datas_t * gps_datas)
+{
+	uint32_t frames = 0;
 	nmea_frame_e ret;
-	ret = NO_TRAME_RECEIVED;
 
-	if(c == '$')
-		index = 0;
+	while(BSP_UART_data_ready(uart_id))
+	{
+		ret = BSP_GPS_process_rx(BSP_UART_get_next_byte(uart_id), gps_datas);
+		if(ret >= TRAME_RMC)
+			frames |= 1UL << ret;
+	}
+	return frames;
+}
 
-	buffer[index] = c;
 
-	if(index<BUFFER_SIZE-1)
-		index++;
-	if(c=='\n')
+
+/*
+ * Dbut d'une nouvelle trame ('$' reu) : remise  zro du parser
+ */
+static void GPS_start_frame(void)
+{
+	nmea.state = NMEA_ADDRESS;
+	nmea.frame = TRAME_UNKNOW;
+	nmea.talker = TALKER_UNKNOWN;
+	nmea.checksum = 0;
+	nmea.hash = 0;
+	nmea.index = 0;
+	nmea.field = 1;
+	nmea.overflow = false;
+	nmea.present = 0;
+	memset(&nmea.s, 0, sizeof(nmea.s));
+}
+
+/*
+ * Fin de l'adresse : l'emplacement donn par le hachage est vrifi, une autre adresse peut avoir le mme hachage.
+ */
+static void GPS_find_address(void)
+{
+	uint8_t slot;
+
+	if(nmea.index == NMEA_ADDRESS_SIZE)
+	{
+		slot = NMEA_TALKER_SLOT(nmea.talker_hash);
+		if(!memcmp(nmea_talkers[slot].id, nmea.address, NMEA_TALKER_SIZE))
+			nmea.talker = nmea_talkers[slot].talker;
+
+		slot = NMEA_SENTENCE_SLOT(nmea.hash);
+		if(!memcmp(nmea_sentences[slot].id, &nmea.address[NMEA_TALKER_SIZE], NMEA_ADDRESS_SIZE - NMEA_TALKER_SIZE))
+			nmea.frame = nmea_sentences[slot].frame;
+	}
+	nmea.index = 0;
+}
+
+/*
+ * Fin d'un champ : il est converti par la fonction propre au type de trame
+ */
+static void GPS_end_field(void)
+{
+	if(nmea.frame >= TRAME_RMC && nmea.index)
 	{
-		buffer[index] = '\0';
-		ret = GPS_parse(buffer, gps_datas);	//On sous-traite l'analyse de la trame reue...
-		index = 0;
+		if(nmea.field < 32)
+			nmea.present |= 1UL << nmea.field;
+		nmea_field_parsers[nmea.frame - TRAME_RMC](nmea.field, nmea.buffer, nmea.index);
 	}
-	return ret;
+	if(nmea.field < 255)
+		nmea.field++;
+	nmea.index = 0;
 }
 
+/*
+ * Fin de la trame, checksum correct : les valeurs converties sont recopies dans gps_datas
+ */
+static nmea_frame_e GPS_end_frame(gps_datas_t * gps_datas)
+{
+	if(nmea.frame < TRAME_RMC)
+		return nmea.frame;
+	if(nmea.overflow)
+		return TRAME_INVALID;
+	gps_datas->talker = nmea.talker;
+	gps_datas->checksum = nmea.checksum;
+	return nmea_commits[nmea.frame - TRAME_RMC](gps_datas);
+}
 
+#define FIELD_PRESENT(n)	(nmea.present & (1UL << (n)))
 
 /*
- * Fonction permettant de savoir si la chaine string commence par le contenu de la chaine begin
- * Renvoi vrai si c'est le cas, faux sinon.
+ * RMC : heure, statut, latitude, N/S, longitude, E/W, vitesse [noeuds], cap, date, ...
  */
-static bool string_begins_with(uint8_t * string, uint8_t * begin)
+static void GPS_field_rmc(uint8_t field, const char * s, uint8_t len)
 {
-	bool b;
-	uint16_t i;
-	b = true;	//On fait l'hypothse que tout se passe bien...
-	for(i=0;begin[i];i++)
+	nmea_rmc_t * rmc = &nmea.s.rmc;
+	switch(field)
 	{
-		if(string[i] == '\0' || (string[i] != begin[i]))
-		{
-			b = false;
-			break;
-		}
+		case 1:	rmc->time = (uint32_t)GPS_to_fixed(s, len, 3);					break;
+		case 2:	rmc->active = (s[0] == 'A');									break;
+		case 3:	rmc->latitude = GPS_to_coordinate(s, len);						break;
+		case 4:	if(s[0] == 'S') rmc->latitude = -rmc->latitude;					break;
+		case 5:	rmc->longitude = GPS_to_coordinate(s, len);						break;
+		case 6:	if(s[0] == 'W') rmc->longitude = -rmc->longitude;				break;
+		case 7:	rmc->speed = (uint32_t)GPS_to_fixed(s, len, 3);					break;
+		case 8:	rmc->course = (uint16_t)GPS_to_fixed(s, len, 2);				break;
+		case 9:	rmc->date = (uint32_t)GPS_to_fixed(s, len, 0);					break;
+		default:																break;
 	}
-	return b;
 }
 
 /*
- * Cette fonction a pour but de :
- * - vrifier si la trame founie dans "buffer" commence par un identifiant connu (GPRMC, ...)
- * - vrifier la valeur du checksum
- * - sous-traiter la lecture de la trame reconnue  la bonne fonction
- * Si le checksum est faux -> renvoit CHECKSUM_INVALID
- * Si la trame n'est pas reconnue -> renvoit NO_TRAME_RECEIVED
- * Si la trame est juge invalide par les fonctions sous-traitantes -> renvoit TRAME_INVALID
+ * GGA : heure, latitude, N/S, longitude, E/W, qualit, satellites, HDOP, altitude, M, sparation du gode, M, ...
  */
-static nmea_frame_e GPS_parse(uint8_t * buffer, gps_datas_t * gps_datas)
+static void GPS_field_gga(uint8_t field, const char * s, uint8_t len)
 {
-	const char string_gprmc[] = "$GPRMC";
-	nmea_frame_e ret;
-	uint8_t i, checksum;
-	ret = NO_TRAME_RECEIVED;	//On fait l'hypothse qu'aucune trame correcte est reue
+	nmea_gga_t * gga = &nmea.s.gga;
+	switch(field)
+	{
+		case 1:	gga->time = (uint32_t)GPS_to_fixed(s, len, 3);					break;
+		case 2:	gga->latitude = GPS_to_coordinate(s, len);						break;
+		case 3:	if(s[0] == 'S') gga->latitude = -gga->latitude;					break;
+		case 4:	gga->longitude = GPS_to_coordinate(s, len);						break;
+		case 5:	if(s[0] == 'W') gga->longitude = -gga->longitude;				break;
+		case 6:	gga->quality = (uint8_t)GPS_to_fixed(s, len, 0);				break;
+		case 7:	gga->satellites = (uint8_t)GPS_to_fixed(s, len, 0);				break;
+		case 8:	gga->hdop = (uint16_t)GPS_to_fixed(s, len, 2);					break;
+		case 9:	gga->altitude = GPS_to_fixed(s, len, 3);						break;
+		case 11: gga->separation = GPS_to_fixed(s, len, 3);						break;
+		default:																break;
+	}
+}
+
+/*
+ * VTG : cap vrai, T, cap magntique, M, vitesse [noeuds], N, vitesse [km/h], K, mode
+ */
+static void GPS_field_vtg(uint8_t field, const char * s, uint8_t len)
+{
+	nmea_vtg_t * vtg = &nmea.s.vtg;
+	switch(field)
+	{
+		case 1:	vtg->course = (uint16_t)GPS_to_fixed(s, len, 2);				break;
+		case 7:	vtg->speed = (uint32_t)GPS_to_fixed(s, len, 3);					break;
+		case 9:	vtg->valid = (s[0] != 'N');										break;
+		default:																break;
+	}
+}
 
-	if(string_begins_with(buffer, (uint8_t *)string_gprmc))
-		ret = TRAME_GPRMC;
+/*
+ * GSA : mode A/M, fix 1/2/3, 12 numros de satellites, PDOP, HDOP, VDOP
+ */
+static void GPS_field_gsa(uint8_t field, const char * s, uint8_t len)
+{
+	nmea_gsa_t * gsa = &nmea.s.gsa;
+	if(field >= 3 && field < 3 + GPS_MAX_USED_PRN)
+	{
+		gsa->prn[gsa->nb_prn++] = (uint8_t)GPS_to_fixed(s, len, 0);
+		return;
+	}
+	switch(field)
+	{
+		case 2:	gsa->mode = (uint8_t)GPS_to_fixed(s, len, 0);					break;
+		case 15: gsa->pdop = (uint16_t)GPS_to_fixed(s, len, 2);					break;
+		case 16: gsa->hdop = (uint16_t)GPS_to_fixed(s, len, 2);					break;
+		case 17: gsa->vdop = (uint16_t)GPS_to_fixed(s, len, 2);					break;
+		default:																break;
+	}
+}
 
-	//TODO ajouter d'autres trames si besoin..
+/*
+ * GSV : nombre de trames, numro de la trame, satellites en vue, puis 4 champs par satellite (PRN, lvation, azimut, SNR)
+ * Un ventuel identifiant de signal (NMEA 4.10) suit le dernier satellite : il n'est pas pris pour un satellite car incomplet.
+ */
+static void GPS_field_gsv(uint8_t field, const char * s, uint8_t len)
+{
+	nmea_gsv_t * gsv = &nmea.s.gsv;
+	uint8_t sat;
 
-	if(ret != NO_TRAME_RECEIVED)	//un entte connu a t trouv... calcul du checksum
+	if(field == 2)
+		gsv->message = (uint8_t)GPS_to_fixed(s, len, 0);
+	else if(field >= 4 && field < 4 + 4*4)
 	{
-		checksum = 0;
-		for(i=1; buffer[i]!='*' && buffer[i] != '\0'; i++)
+		sat = (field - 4) / 4;
+		switch((field - 4) % 4)
 		{
-			checksum ^= buffer[i];
+			case 0:	gsv->satellites[sat].prn = (uint8_t)GPS_to_fixed(s, len, 0);		break;
+			case 1:	gsv->satellites[sat].elevation = (int8_t)GPS_to_fixed(s, len, 0);	break;
+			case 2:	gsv->satellites[sat].azimuth = (uint16_t)GPS_to_fixed(s, len, 0);	break;
+			default: gsv->satellites[sat].snr = (uint8_t)GPS_to_fixed(s, len, 0);		break;
 		}
-		if(! (buffer[i] == '*' && (16*hextoint(buffer[i+1]) + hextoint(buffer[i+2]) == checksum)))
-			ret = CHECKSUM_INVALID;	//Trame invalide : pas de checksum *XX ou checksum incorrect
 	}
+}
 
-	switch(ret)
+/*
+ * Conversion de l'heure HHMMSSmmm en heure HHMMSS, secondes depuis 0h et millisecondes
+ */
+static void GPS_set_time(gps_datas_t * gps_datas, uint32_t time)
+{
+	uint32_t hhmmss = time / 1000;
+
+	gps_datas->time = hhmmss;
+	gps_datas->milliseconds = (uint16_t)(time % 1000);
+	gps_datas->seconds = (hhmmss / 10000) * 3600 + ((hhmmss / 100) % 100) * 60 + hhmmss % 100;
+	if(gps_datas->seconds >= SECONDS_IN_DAY)
+		gps_datas->seconds = 0;
+}
+
+static nmea_frame_e GPS_commit_rmc(gps_datas_t * gps_datas)
+{
+	nmea_rmc_t * rmc = &nmea.s.rmc;
+
+	if(!rmc->active || !FIELD_PRESENT(3) || !FIELD_PRESENT(5))	//Notamment lorsque le GPS ne capte pas !
+		return TRAME_INVALID;
+
+	GPS_set_time(gps_datas, rmc->time);
+	gps_datas->latitude = rmc->latitude;
+	gps_datas->longitude = rmc->longitude;
+	gps_datas->speed = rmc->speed * 1852 / 3600;		//1 noeud = 1852 m/h
+	if(FIELD_PRESENT(8))
+		gps_datas->course = rmc->course;
+	if(FIELD_PRESENT(9))
 	{
-		case TRAME_GPRMC:
-			if(!GPS_parse_gprmc(buffer, gps_datas))
-				ret = TRAME_INVALID;
-			break;
-		default:
-			break;
+		gps_datas->day = (uint8_t)(rmc->date / 10000);
+		gps_datas->month = (uint8_t)((rmc->date / 100) % 100);
+		gps_datas->year = (uint16_t)(2000 + rmc->date % 100);
+		gps_datas->date32 = (	((uint32_t)(rmc->date%100) + 20) << 25 ) 	//20 est la diffrence entre 2000 et 1980.
+				| 	((uint32_t)((rmc->date/100)%100) << 21 )
+				| 	((uint32_t)(rmc->date/10000) << 16 )
+				| 	((uint32_t)(gps_datas->time/10000) << 11 )
+				| 	((uint32_t)((gps_datas->time/100)%100) << 5 )
+				| 	((uint32_t)(gps_datas->time%100) >> 1 ) ;
 	}
+	return TRAME_RMC;
+}
 
-	return ret;
+static nmea_frame_e GPS_commit_gga(gps_datas_t * gps_datas)
+{
+	nmea_gga_t * gga = &nmea.s.gga;
+
+	gps_datas->fix_quality = gga->quality;
+	gps_datas->satellites_used = gga->satellites;
+	if(gga->quality == 0 || !FIELD_PRESENT(2) || !FIELD_PRESENT(4))
+		return TRAME_INVALID;
+
+	GPS_set_time(gps_datas, gga->time);
+	gps_datas->latitude = gga->latitude;
+	gps_datas->longitude = gga->longitude;
+	gps_datas->hdop = gga->hdop;
+	if(FIELD_PRESENT(9))
+		gps_datas->altitude = gga->altitude;
+	if(FIELD_PRESENT(11))
+		gps_datas->geoid_separation = gga->separation;
+	return TRAME_GGA;
 }
 
+static nmea_frame_e GPS_commit_vtg(gps_datas_t * gps_datas)
+{
+	nmea_vtg_t * vtg = &nmea.s.vtg;
+
+	if(!vtg->valid || !FIELD_PRESENT(7))
+		return TRAME_INVALID;
+	gps_datas->speed = vtg->speed * 5 / 18;			//1 km/h = 1000/3600 m/s
+	if(FIELD_PRESENT(1))
+		gps_datas->course = vtg->course;
+	return TRAME_VTG;
+}
 
+/*
+ * En multi-constellations ($GNGSA), une trame GSA est mise par constellation : used_prn contient la liste de la dernire.
+ */
+static nmea_frame_e GPS_commit_gsa(gps_datas_t * gps_datas)
+{
+	nmea_gsa_t * gsa = &nmea.s.gsa;
+
+	gps_datas->fix_mode = gsa->mode;
+	memset(gps_datas->used_prn, 0, sizeof(gps_datas->used_prn));
+	memcpy(gps_datas->used_prn, gsa->prn, gsa->nb_prn);
+	gps_datas->pdop = gsa->pdop;
+	gps_datas->hdop = gsa->hdop;
+	gps_datas->vdop = gsa->vdop;
+	return TRAME_GSA;
+}
 
 /*
- * Cette fonction dcoupe une trame GPRMC fournie dans string et remplit la structure coordinates
- * - Si la trame est invalide (notamment lorsque le GPS ne capte pas !) -> renvoit FALSE
- * - Si la trame est valide -> renvoit TRUE
- * Attention, cette fonction crase la chaine passe en remplacant notamment certains caractres ',' par des '\0' !!!
+ * Les satellites de chaque constellation sont dcrits par une srie de trames GSV :
+ * la premire trame de la srie remplace les satellites prcdemment reus pour cette constellation.
  */
-bool GPS_parse_gprmc(uint8_t * string, gps_datas_t * coordinates)
+static nmea_frame_e GPS_commit_gsv(gps_datas_t * gps_datas)
 {
-	uint8_t i;
-	uint8_t *message_field[14] = {'\0'};	//tableau des pointeur sur champ
-	//tableau des pointeurs sur champ dcimal
-	//Header : $GPRMC
-	//Data : 											,hhmmss.sss,A,ddmm.mmmm,N,ddmm.mmmm,W,X,X,ddmmyy,X,X,X*<CR><LF>
-	//Chaine final :							\0		 hhmmss \0 sss \0 A \0 ddmm \0 mmmm \0 N \0 ddmm \0 mmmm \0 W \0 X \0 X \0 ddmmyy \0 X \0 X \0 X \0 <CR><LF>
-	//indice de tableau dans la chaine : F0S0 = \0 ensuite F1	       \0 F2 \0 F3          \0 F4 \ F5           \0 F6\0 F7\0 F8\0 F9	 \0F10\0F11\0F12\0 F13
-
-	i = 0;
-	message_field[i] = string;
-	while (*string != '\0' && *string != '\r' && *string != '\n')
+	nmea_gsv_t * gsv = &nmea.s.gsv;
+	uint8_t i, n;
+
+	if(gsv->message == 1)
+	{
+		for(i = 0, n = 0; i < gps_datas->satellites_in_view; i++)
+			if(gps_datas->satellites[i].talker != nmea.talker)
+				gps_datas->satellites[n++] = gps_datas->satellites[i];
+		gps_datas->satellites_in_view = n;
+	}
+	for(i = 0; i < 4; i++)
 	{
-		if ((*string == NMEA_MESSAGE_FIELD_SEPARATOR) || (*string == NMEA_MESSAGE_EOM) )
+		//un satellite est complet lorsque ses 4 champs ont t reus (le SNR peut tre vide)
+		if(nmea.field > 4 + 4*i + 3 && gsv->satellites[i].prn && gps_datas->satellites_in_view < GPS_MAX_SATELLITES)
 		{
-			// save position of the next token
-			if(i<13)
-				message_field[++i] = string + 1;
-			*string = '\0';	// terminate string after field separator or end-of-message characters
+			gsv->satellites[i].talker = (uint8_t)nmea.talker;
+			gps_datas->satellites[gps_datas->satellites_in_view++] = gsv->satellites[i];
 		}
-		string++;
 	}
+	return TRAME_GSV;
+}
 
-	if(i>2 && *message_field[2] == 'A')
+/*
+ * Conversion d'un nombre dcimal (sign, avec ou sans dcimales) en virgule fixe : valeur * 10^decimals
+ * Les dcimales en trop sont tronques, celles qui manquent sont compltes par des 0.
+ */
+static int32_t GPS_to_fixed(const char * s, uint8_t len, uint8_t decimals)
+{
+	int32_t value = 0;
+	bool negative = false;
+	bool fraction = false;
+	uint8_t i;
+
+	for(i = 0; i < len; i++)
 	{
-		coordinates->time =  (uint32_t)atoi((char*)message_field[1]); //conversion 32 bits
-		coordinates->seconds = 	  ((uint32_t)(message_field[1][0] - '0')) * 36000
-								+ ((uint32_t)(message_field[1][1] - '0')) * 3600
-								+ ((uint32_t)(message_field[1][2] - '0')) * 600
-								+ ((uint32_t)(message_field[1][3] - '0')) * 60
-								+ ((uint32_t)(message_field[1][4] - '0')) * 10
-								+ ((uint32_t)(message_field[1][5] - '0'));
-
-		coordinates->north	= (message_field[4][0] == 'S')?false:true;
-		coordinates->east	= (message_field[6][0] == 'W')?false:true;
-
-		coordinates->lat_minutes = atof((char*)message_field[3]);
-		coordinates->lat_degrees = (int16_t)(trunc(coordinates->lat_minutes));
-		coordinates->lat_minutes -= (float)((coordinates->lat_degrees/100)*100);
-		coordinates->lat_degrees = coordinates->lat_degrees/100;
-		coordinates->latitude_deg = (double)coordinates->lat_degrees + coordinates->lat_minutes/60;
-		if(coordinates->north==0)
-			coordinates->latitude_deg*=-1;
-		coordinates->latitude_rad = coordinates->latitude_deg * PI180;	//--> radians !
-
-		coordinates->long_degrees = (int16_t)atoi((char*)message_field[5]);
-		coordinates->long_minutes = atof((char*)message_field[5]);
-		coordinates->long_minutes -= (float)((coordinates->long_degrees/100)*100);
-		coordinates->long_degrees = coordinates->long_degrees/100;
-		coordinates->longitude_deg = (double)coordinates->long_degrees + coordinates->long_minutes/60;
-		if(coordinates->east==0)
-			coordinates->longitude_deg*=-1;
-		coordinates->longitude_rad = coordinates->longitude_deg * PI180;	//--> radians !
-
-		coordinates->ground_speed =  (uint16_t)atoi((char*)message_field[7]);
-
-		uint32_t current_date;
-		current_date =  (uint32_t)atoi((char*)message_field[9]);
-		coordinates->date32 = 	(	((uint32_t)(current_date%100) + 20) << 25 ) 	//20 est la diffrence entre 2000 et 1980.
-				| 	((uint32_t)((current_date/100)%100) << 21 )
-				| 	((uint32_t)(current_date/10000) << 16 )
-				| 	((uint32_t)(coordinates->time/10000) << 11 )
-				| 	((uint32_t)((coordinates->time/100)%100) << 5 )
-				| 	((uint32_t)(coordinates->time%100) >> 1 ) ;
-
-		return true;
+		if(s[i] == '-')
+			negative = true;
+		else if(s[i] == '.')
+			fraction = true;
+		else if(s[i] >= '0' && s[i] <= '9')
+		{
+			if(fraction)
+			{
+				if(!decimals)
+					break;
+				decimals--;
+			}
+			value = value * 10 + (s[i] - '0');
+		}
 	}
-	return false;
+	for(; decimals; decimals--)
+		value *= 10;
+	return negative ? -value : value;
 }
 
+/*
+ * Conversion d'une coordonne NMEA (d)ddmm.mmmmm en 1e-7 degrs
+ */
+static int32_t GPS_to_coordinate(const char * s, uint8_t len)
+{
+	int32_t value = GPS_to_fixed(s, len, 5);		//dddmm * 1e5 + 1e-5 minutes
+	int32_t degrees = value / 10000000;
+	int32_t minutes = value % 10000000;				//[1e-5 minutes]
+
+	return degrees * 10000000 + (minutes * 5 + 1) / 3;	//1e-5 minute = 1e-7 degr * 10/6
+}
 
-//converti un caractre hexa (par exemple '4', ou 'B') en un nombre (dans cet exemple : 4, 11)
-static uint8_t hextoint(char c)
+//converti un caractre hexa (par exemple '4', ou 'B') en un nombre (dans cet exemple : 4, 11), -1 si ce n'est pas un caractre hexa
+static int8_t hextoint(char c)
 {
 	if(c >= 'A' && c <= 'F')
-		return (uint8_t)(c - 'A' + 10);
+		return (int8_t)(c - 'A' + 10);
 	if(c >= 'a' && c <= 'f')
-		return (uint8_t)(c - 'a' + 10);
+		return (int8_t)(c - 'a' + 10);
 	if(c >= '0' && c <= '9')
-		return (uint8_t)(c - '0');
-	return 0;
+		return (int8_t)(c - '0');
+	return -1;
+}
+
+//Affiche une coordonne en 1e-7 degrs sous la forme -ddd.ddddddd
+static void GPS_print_coordinate(int32_t coordinate)
+{
+	uint32_t abs_coordinate = (coordinate < 0) ? (uint32_t)(-coordinate) : (uint32_t)coordinate;
+	printf("%s%lu.%07lu", (coordinate < 0) ? "-" : "", abs_coordinate / 10000000, abs_coordinate % 10000000);
 }
 
 #endif //USE_GPS
@@ -12,24 +12,61 @@
 #include "config.h"
 #if USE_GPS
 #include "stm32g4_utils.h"
+#include "stm32g4_uart.h"
+
+#define GPS_MAX_SATELLITES	32	//Nombre de satellites en vue mmoriss (toutes constellations confondues)
+#define GPS_MAX_USED_PRN	12	//Nombre de satellites utiliss lists par une trame GSA
+
+typedef enum
+{
+	TALKER_UNKNOWN = 0,
+	TALKER_GP,				//GPS
+	TALKER_GL,				//GLONASS
+	TALKER_GA,				//Galileo
+	TALKER_GB,				//BeiDou
+	TALKER_BD,				//BeiDou (ancien identifiant)
+	TALKER_GQ,				//QZSS
+	TALKER_GN				//Solution multi-constellations
+}nmea_talker_e;
 
+typedef struct
+{
+	uint8_t		prn;
+	int8_t		elevation;		//[deg]
+	uint16_t	azimuth;		//[deg]
+	uint8_t		snr;			//[dBHz], 0 si le satellite n'est pas suivi
+	uint8_t		talker;			//nmea_talker_e : constellation du satellite
+}gps_satellite_t;
+
+/*
+ * Toutes les grandeurs sont en virgule fixe : aucun calcul flottant n'est fait pendant le parsing.
+ */
 typedef struct
 {
 	uint16_t 	id;
-	uint32_t 	time;		//[HHMMSS]
-	uint32_t 	seconds;	//[sec since 0:00:00]
-	double 		latitude_rad;		//rad
-	double 		longitude_rad;		//rad
-	double		latitude_deg;		//deg
-	double		longitude_deg;		//deg
-	int16_t		lat_degrees;	//Partie entire des degrs
-	double		lat_minutes;	//Minutes d'angle, avec dcimales
-	int16_t		long_degrees;	//Partie entire des degrs
-	double		long_minutes;	//Minutes d'angle, avec dcimales
-	bool		north;
-	bool 		east;
-	uint16_t	ground_speed;
-	uint32_t 	date32;
+	nmea_talker_e talker;		//Emetteur de la dernire trame reue
+	uint32_t 	time;			//[HHMMSS]
+	uint32_t 	seconds;		//[sec since 0:00:00]
+	uint16_t	milliseconds;
+	int32_t		latitude;		//[1e-7 deg], positive au nord
+	int32_t		longitude;		//[1e-7 deg], positive  l'est
+	int32_t		altitude;		//[mm] au dessus du niveau moyen des mers (GGA)
+	int32_t		geoid_separation;	//[mm] (GGA)
+	uint32_t	speed;			//[mm/s] vitesse sol (RMC ou VTG)
+	uint16_t	course;			//[1e-2 deg] cap vrai (RMC ou VTG)
+	uint8_t		day;
+	uint8_t		month;
+	uint16_t	year;
+	uint32_t 	date32;			//Date et heure au format FAT
+	uint8_t		fix_quality;	//GGA : 0 pas de fix, 1 GPS, 2 DGPS...
+	uint8_t		fix_mode;		//GSA : 1 pas de fix, 2 fix 2D, 3 fix 3D
+	uint8_t		satellites_used;	//GGA
+	uint16_t	pdop;			//[1e-2] (GSA)
+	uint16_t	hdop;			//[1e-2] (GGA, GSA)
+	uint16_t	vdop;			//[1e-2] (GSA)
+	uint8_t		used_prn[GPS_MAX_USED_PRN];	//GSA
+	uint8_t		satellites_in_view;	//Nombre de satellites du tableau satellites (GSV)
+	gps_satellite_t	satellites[GPS_MAX_SATELLITES];
 	uint8_t checksum;
 }gps_datas_t;
 
@@ -39,14 +76,19 @@ typedef enum
 	CHECKSUM_INVALID,
 	TRAME_INVALID,
 	TRAME_UNKNOW,			//Une trame inconnue a t reue
-	TRAME_GPRMC,			//Une trame GPRMC a t reue
-	TRAME_GPGGA				//Une trame GPGGA a t reue
+	TRAME_RMC,				//Une trame xxRMC a t reue
+	TRAME_GGA,				//Une trame xxGGA a t reue
+	TRAME_VTG,				//Une trame xxVTG a t reue
+	TRAME_GSA,				//Une trame xxGSA a t reue
+	TRAME_GSV,				//Une trame xxGSV a t reue
+	TRAME_GPRMC = TRAME_RMC,
+	TRAME_GPGGA = TRAME_GGA
 }nmea_frame_e;
 
 nmea_frame_e BSP_GPS_process_rx(uint8_t c, gps_datas_t * gps_datas);
+uint32_t BSP_GPS_process_uart(uart_id_t uart_id, gps_datas_t * gps_datas);
 void BSP_GPS_test(void);
 void BSP_GPS_demo(void);
 
 #endif //USE_GPS
 #endif /* GPS_H_ */
-
@@ -0,0 +1,418 @@
+/**
+ *******************************************************************************
+ * @file	stm32g4_gps_pps.c
+ * @author	DEEP Project
+ * @date	Oct 17, 2026
+ * @brief	Base de temps disciplin par le signal PPS du GPS : horodatage UTC  la nanoseconde
+ *******************************************************************************
+ * Le TIMER2 (seul timer 32 bits) compte librement  la frquence de son horloge (170MHz, soit 5,9ns par tick).
+ * Le front montant du PPS du GPS est captur sur son canal 1 (broche PA0) : la valeur capture ne dpend pas
+ * de la latence des interruptions.
+ *
+ * Conversion ticks -> temps : t = t_anchor + (ticks - tick_anchor) * scale
+ * - scale est la dure d'un tick en ns, en virgule fixe Q32 : la rsolution reste bien infrieure  la ns.
+ * - A l'acquisition, scale est calcul  partir du nombre de ticks mesur entre deux impulsions.
+ * - A chaque impulsion suivante, l'cart entre le temps prvu et la seconde entire la plus proche corrige
+ *   la frquence (boucle PI : la correction en ppb vaut err/2 + somme(err)/4). Le temps reste continu :
+ *   l'ancre est dplace sur le temps prvu, sans saut.
+ * - Une impulsion trop loigne de la seconde prvue est ignore. Au bout de GPS_PPS_MAX_OUTLIERS impulsions
+ *   conscutives hors tolrance, l'heure est recale (saut) et la frquence mesure  nouveau.
+ *
+ * La base de temps devient celle de BSP_systick_get_time_us (BSP_systick_set_time_source) : les horodatages en s
+ * des pilotes (MPU6050, VL53L0X, BH1750, BMP180...) sont ceux du temps disciplin, modulo 2^32, et
+ * BSP_GPS_PPS_us_to_ns les convertit en temps complet (UTC). Ils sautent comme lui lors d'un recalage.
+ *
+ * Le PPS ne donne que le dbut de chaque seconde : BSP_GPS_PPS_set_utc() fournit le nombre de secondes,  partir
+ * d'une trame RMC (ou NAV-PVT convertie) reue juste aprs l'impulsion correspondante.
+ *
+ * Exemple :
+ *		BSP_GPS_PPS_init();
+ *		...
+ *		if(BSP_GPS_process_uart(UART1_ID, &gps_datas) & (1UL << TRAME_RMC))
+ *			BSP_GPS_PPS_set_utc(&gps_datas);
+ *		...
+ *		timestamp = BSP_GPS_PPS_get_time_ns();		//ns depuis le 1er janvier 1970 UTC
+ *		utc = BSP_GPS_PPS_us_to_ns(sample.timestamp_us);	//horodatage d'un pilote, en ns UTC
+ */
+
+#include "config.h"
+#if USE_GPS
+#include "stm32g4_gps_pps.h"
+#include "stm32g4_timer.h"
+#include "stm32g4_systick.h"
+#include "stm32g4_uart.h"
+#if USE_RTC
+#include "stm32g4_rtc.h"
+#endif
+#include <stdio.h>
+#include <string.h>
+
+//Constantes prives
+#define NS_PER_SECOND			1000000000ULL
+#define SECONDS_PER_DAY			86400
+#define GPS_PPS_TIMER			TIMER2_ID
+#define GPS_PPS_CHANNEL			TIM_CHANNEL_1
+#define GPS_PPS_REANCHOR_TICKS	(1UL << 28)		//L'cart avec l'ancre reste loin de 2^31 : les ticks un peu anciens restent convertibles
+#define GPS_PPS_UTC_MARGIN_NS	1000000
+
+//Variables prives
+static gps_pps_status_t status;
+static uint32_t nominal_frequency;
+static uint64_t scale0;						//[ns/tick, Q32] dure du tick mesure  l'acquisition
+static uint64_t scale;						//[ns/tick, Q32] dure corrige par la boucle
+static uint64_t t_anchor;					//[ns] temps de l'ancre
+static uint32_t tick_anchor;
+static int64_t integral;					//[ns] somme des carts de phase
+static uint32_t last_capture;
+static bool last_capture_valid = false;
+static uint32_t last_pulse_ms;
+static uint8_t outliers;
+
+//Fonctions prives
+static void GPS_PPS_capture_callback(uint16_t TIM_CHANNEL_x, uint32_t capture);
+static void GPS_PPS_process_ms(void);
+static uint32_t GPS_PPS_get_time_us(void);
+static uint64_t GPS_PPS_convert(uint32_t ticks);
+static uint64_t GPS_PPS_mul_scale(uint32_t delta);
+static bool GPS_PPS_check_period(uint32_t ticks);
+static int32_t GPS_PPS_days_from_civil(int32_t y, uint32_t m, uint32_t d);
+
+
+/*
+ * Lance la base de temps : TIMER2 en comptage libre sur 32 bits et capture du PPS sur PA0.
+ * Tant qu'aucune impulsion n'est reue, le temps compte depuis l'appel de cette fonction,  la frquence nominale.
+ * A appeler au dmarrage, avant les capteurs : BSP_systick_get_time_us compte ensuite dans cette base de temps.
+ */
+void BSP_GPS_PPS_init(void)
+{
+	TIM_HandleTypeDef * handle;
+
+	nominal_frequency = BSP_TIMER_get_clock_frequency(GPS_PPS_TIMER);
+	BSP_TIMER_run_us(GPS_PPS_TIMER, 20000000, false);		//20s : le prescaler reste  1 jusqu' 214MHz
+	handle = BSP_TIMER_get_handler(GPS_PPS_TIMER);
+	__HAL_TIM_DISABLE_IT(handle, TIM_IT_UPDATE);			//seules les captures nous intressent
+	__HAL_TIM_SET_AUTORELOAD(handle, 0xFFFFFFFF);			//comptage sur 32 bits, pour des diffrences modulo 2^32
+	BSP_TIMER_enable_input_capture(GPS_PPS_TIMER, GPS_PPS_CHANNEL, false, &GPS_PPS_capture_callback);	//remet le compteur  0
+
+	memset(&status, 0, sizeof(status));
+	status.state = PPS_NO_SIGNAL;
+	scale0 = (NS_PER_SECOND << 32) / nominal_frequency;
+	scale = scale0;
+	t_anchor = 0;
+	tick_anchor = BSP_TIMER_read(GPS_PPS_TIMER);
+	integral = 0;
+	outliers = 0;
+	last_capture_valid = false;
+
+	BSP_systick_add_callback_function(&GPS_PPS_process_ms);
+	BSP_systick_set_time_source(&GPS_PPS_get_time_us);
+}
+
+/*
+ * Valeur courante du compteur :  mmoriser au plus prs d'un vnement, la conversion peut tre faite plus tard.
+ */
+uint32_t BSP_GPS_PPS_get_ticks(void)
+{
+	return BSP_TIMER_read(GPS_PPS_TIMER);
+}
+
+/*
+ * Conversion d'une valeur du compteur en temps [ns depuis le 1er janvier 1970 UTC, ou depuis l'initialisation tant que
+ * status.utc_valid est faux]. Les ticks doivent dater de moins de 2^31 - 2^28 ticks (11s  170MHz) : l'ancre peut
+ * avoir avanc de 2^28 ticks.
+ */
+uint64_t BSP_GPS_PPS_ticks_to_ns(uint32_t ticks)
+{
+	uint64_t t;
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	t = GPS_PPS_convert(ticks);
+	__set_PRIMASK(primask);
+	return t;
+}
+
+uint64_t BSP_GPS_PPS_get_time_ns(void)
+{
+	return BSP_GPS_PPS_ticks_to_ns(BSP_TIMER_read(GPS_PPS_TIMER));
+}
+
+/*
+ * Conversion d'un horodatage de BSP_systick_get_time_us (s modulo 2^32) en temps [ns, comme BSP_GPS_PPS_get_time_ns].
+ * L'horodatage doit dater de moins de 2^32 s (71 min) et tre postrieur au dernier recalage.
+ */
+uint64_t BSP_GPS_PPS_us_to_ns(uint32_t timestamp_us)
+{
+	uint64_t now_us = BSP_GPS_PPS_get_time_ns() / 1000;
+
+	return (now_us - (uint32_t)((uint32_t)now_us - timestamp_us)) * 1000;
+}
+
+/*
+ * Alignement sur l'UTC,  appeler  la rception d'une trame RMC valide (date et heure renseignes).
+ * La trame donne l'heure de la dernire impulsion : l'cart avec l'heure locale est arrondi  la seconde suprieure,
+ *  condition que la trame soit traite moins d'une seconde aprs l'impulsion.
+ * Renvoie vrai si l'heure a t aligne (il faut que la base de temps soit verrouille sur le PPS).
+ */
+bool BSP_GPS_PPS_set_utc(const gps_datas_t * gps_datas)
+{
+	int64_t utc;
+	int64_t diff;
+	int64_t offset;
+	uint32_t primask;
+
+	if(status.state != PPS_LOCKED || gps_datas->year < 1970 || gps_datas->month == 0 || gps_datas->day == 0)
+		return false;
+
+	utc = (int64_t)GPS_PPS_days_from_civil(gps_datas->year, gps_datas->month, gps_datas->day) * SECONDS_PER_DAY;
+	utc = (utc + gps_datas->seconds) * (int64_t)NS_PER_SECOND + (int64_t)gps_datas->milliseconds * 1000000;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	diff = utc - (int64_t)GPS_PPS_convert(BSP_TIMER_read(GPS_PPS_TIMER)) - GPS_PPS_UTC_MARGIN_NS;	//marge : l'impulsion peut tre vue un peu aprs la seconde prvue
+	offset = diff / (int64_t)NS_PER_SECOND;
+	if(diff > offset * (int64_t)NS_PER_SECOND)
+		offset++;
+	t_anchor += (uint64_t)(offset * (int64_t)NS_PER_SECOND);
+	status.utc_valid = true;
+	__set_PRIMASK(primask);
+	return true;
+}
+
+void BSP_GPS_PPS_get_status(gps_pps_status_t * s)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	*s = status;
+	__set_PRIMASK(primask);
+}
+
+#if USE_RTC
+/*
+ * Mise  l'heure de la RTC au dbut d'une seconde UTC (attente active jusqu' 1s).
+ * @pre	la RTC est initialise et l'heure a t aligne sur l'UTC (BSP_GPS_PPS_set_utc)
+ */
+bool BSP_GPS_PPS_set_rtc(void)
+{
+	RTC_TimeTypeDef time = {0};
+	RTC_DateTypeDef date = {0};
+	uint64_t second;
+	int32_t z, era, doe, yoe, doy, mp, y;
+
+	if(!status.utc_valid)
+		return false;
+
+	second = BSP_GPS_PPS_get_time_ns() / NS_PER_SECOND;
+	while(BSP_GPS_PPS_get_time_ns() / NS_PER_SECOND == second);
+	second++;
+
+	time.Hours = (second % SECONDS_PER_DAY) / 3600;
+	time.Minutes = (second % 3600) / 60;
+	time.Seconds = second % 60;
+
+	//Date civile  partir du nombre de jours depuis 1970 (algorithme de H. Hinnant)
+	z = (int32_t)(second / SECONDS_PER_DAY) + 719468;
+	era = z / 146097;
+	doe = z - era * 146097;
+	yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	mp = (5 * doy + 2) / 153;
+	y = yoe + era * 400;
+	date.Date = doy - (153 * mp + 2) / 5 + 1;
+	date.Month = (mp < 10) ? mp + 3 : mp - 9;
+	date.Year = y + (date.Month <= 2) - 2000;
+
+	BSP_RTC_set_time(&time);
+	BSP_RTC_set_date(&date);
+	return true;
+}
+#endif
+
+/*
+ * Dmo : le PPS du GPS sur PA0, les trames NMEA sur l'UART1. Affiche chaque seconde l'tat de la base de temps.
+ */
+void BSP_GPS_PPS_demo(void)
+{
+	gps_datas_t gps_datas;
+	gps_pps_status_t s;
+	uint64_t t;
+	uint32_t last_print = 0;
+
+	memset(&gps_datas, 0, sizeof(gps_datas));
+	BSP_UART_init(UART1_ID, 9600);
+	BSP_GPS_PPS_init();
+	while(1)
+	{
+		if(BSP_GPS_process_uart(UART1_ID, &gps_datas) & (1UL << TRAME_RMC))
+			BSP_GPS_PPS_set_utc(&gps_datas);
+		if(HAL_GetTick() - last_print >= 1000)
+		{
+			last_print = HAL_GetTick();
+			t = BSP_GPS_PPS_get_time_ns();
+			BSP_GPS_PPS_get_status(&s);
+			printf("t=%lu.%09lu s etat %d utc %d impulsions %lu erreur %ld ns correction %ld ppb f=%lu Hz sauts %lu\n",
+					(uint32_t)(t / NS_PER_SECOND), (uint32_t)(t % NS_PER_SECOND), s.state, s.utc_valid,
+					s.pulses, s.last_error_ns, s.frequency_ppb, s.ticks_per_second, s.steps);
+		}
+	}
+}
+
+/*
+ * Capture du front du PPS (sous interruption).
+ */
+static void GPS_PPS_capture_callback(uint16_t TIM_CHANNEL_x, uint32_t capture)
+{
+	bool period_valid;
+	uint64_t predicted;
+	uint64_t nearest;
+	int64_t error;
+	int64_t correction;
+	uint32_t primask;
+
+	primask = __get_PRIMASK();
+	__disable_irq();		//l'interruption systick peut dplacer l'ancre
+
+	period_valid = last_capture_valid && GPS_PPS_check_period(capture - last_capture);
+	if(period_valid)
+		status.ticks_per_second = capture - last_capture;
+	last_capture = capture;
+	last_capture_valid = true;
+	last_pulse_ms = HAL_GetTick();
+	status.pulses++;
+
+	predicted = GPS_PPS_convert(capture);
+	nearest = ((predicted + NS_PER_SECOND / 2) / NS_PER_SECOND) * NS_PER_SECOND;
+	error = (int64_t)(predicted - nearest);
+
+	if(status.state == PPS_LOCKED || status.state == PPS_HOLDOVER)
+	{
+		status.last_error_ns = (int32_t)error;
+		if(error > GPS_PPS_MAX_PHASE_ERROR_NS || error < -GPS_PPS_MAX_PHASE_ERROR_NS)
+		{
+			//impulsion parasite ou manque... ou heure dcale : recalage si cela persiste
+			if(++outliers >= GPS_PPS_MAX_OUTLIERS)
+			{
+				status.state = PPS_ACQUIRING;
+				status.steps++;
+			}
+		}
+		else
+		{
+			outliers = 0;
+			integral += error;
+			if(integral > 4 * GPS_PPS_MAX_CORRECTION_PPB)
+				integral = 4 * GPS_PPS_MAX_CORRECTION_PPB;
+			else if(integral < -4 * GPS_PPS_MAX_CORRECTION_PPB)
+				integral = -4 * GPS_PPS_MAX_CORRECTION_PPB;
+			correction = error / 2 + integral / 4;		//[ppb] : l'cart de phase est mesur sur une seconde
+			if(correction > GPS_PPS_MAX_CORRECTION_PPB)
+				correction = GPS_PPS_MAX_CORRECTION_PPB;
+			else if(correction < -GPS_PPS_MAX_CORRECTION_PPB)
+				correction = -GPS_PPS_MAX_CORRECTION_PPB;
+			status.frequency_ppb = (int32_t)correction;
+			scale = scale0 - (int64_t)scale0 * correction / (int64_t)NS_PER_SECOND;
+			t_anchor = predicted;
+			tick_anchor = capture;
+			status.state = PPS_LOCKED;
+		}
+	}
+	else if(period_valid)
+	{
+		//acquisition : frquence mesure sur la dernire seconde, secondes locales alignes sur l'impulsion
+		scale0 = (NS_PER_SECOND << 32) / status.ticks_per_second;
+		scale = scale0;
+		integral = 0;
+		outliers = 0;
+		status.frequency_ppb = 0;
+		status.last_error_ns = 0;
+		t_anchor = nearest;
+		tick_anchor = capture;
+		status.state = PPS_LOCKED;
+	}
+	else
+		status.state = PPS_ACQUIRING;
+
+	__set_PRIMASK(primask);
+}
+
+/*
+ * Appele chaque ms par le systick : dtection de la perte du PPS, et dplacement de l'ancre en l'absence d'impulsion.
+ */
+static void GPS_PPS_process_ms(void)
+{
+	uint32_t now = BSP_TIMER_read(GPS_PPS_TIMER);
+
+	if(now - tick_anchor > GPS_PPS_REANCHOR_TICKS)
+	{
+		t_anchor = GPS_PPS_convert(now);
+		tick_anchor = now;
+	}
+	if(last_capture_valid && HAL_GetTick() - last_pulse_ms > GPS_PPS_TIMEOUT_MS)
+	{
+		last_capture_valid = false;
+		outliers = 0;
+		if(status.state == PPS_LOCKED)
+			status.state = PPS_HOLDOVER;
+		else if(status.state == PPS_ACQUIRING)
+			status.state = PPS_NO_SIGNAL;
+	}
+}
+
+/*
+ * Source de temps de BSP_systick_get_time_us (appele sous interruption par les pilotes)
+ */
+static uint32_t GPS_PPS_get_time_us(void)
+{
+	return (uint32_t)(BSP_GPS_PPS_get_time_ns() / 1000);
+}
+
+/*
+ * Conversion ticks -> ns,  appeler interruptions masques. Les ticks peuvent tre antrieurs  l'ancre.
+ */
+static uint64_t GPS_PPS_convert(uint32_t ticks)
+{
+	int32_t delta = (int32_t)(ticks - tick_anchor);
+
+	if(delta >= 0)
+		return t_anchor + GPS_PPS_mul_scale((uint32_t)delta);
+	else
+		return t_anchor - GPS_PPS_mul_scale((uint32_t)(-(int64_t)delta));
+}
+
+/*
+ * delta * scale en ns (scale en Q32). scale vaut environ 5,9 x 2^32 : le produit direct sur 64 bits dborde
+ * ds 7,3e8 ticks. Il est donc fait en deux moitis, partie entire et partie fractionnaire de scale.
+ */
+static uint64_t GPS_PPS_mul_scale(uint32_t delta)
+{
+	return (uint64_t)delta * (scale >> 32) + (((uint64_t)delta * (uint32_t)scale) >> 32);
+}
+
+/*
+ * Vrifie qu'une dure mesure entre deux impulsions est proche d'une seconde (impulsion manque ou parasite sinon).
+ */
+static bool GPS_PPS_check_period(uint32_t ticks)
+{
+	uint32_t tolerance = nominal_frequency / 1000000 * GPS_PPS_MAX_FREQUENCY_ERROR_PPM;
+
+	return ticks > nominal_frequency - tolerance && ticks < nominal_frequency + tolerance;
+}
+
+/*
+ * Nombre de jours depuis le 1er janvier 1970 (algorithme de H. Hinnant, calendrier grgorien).
+ */
+static int32_t GPS_PPS_days_from_civil(int32_t y, uint32_t m, uint32_t d)
+{
+	int32_t era;
+	uint32_t yoe, doy, doe;
+
+	y -= (m <= 2);
+	era = y / 400;
+	yoe = (uint32_t)(y - era * 400);
+	doy = (153 * ((m > 2) ? m - 3 : m + 9) + 2) / 5 + d - 1;
+	doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + (int32_t)doe - 719468;
+}
+
+#endif //USE_GPS
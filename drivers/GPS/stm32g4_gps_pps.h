@@ -0,0 +1,55 @@
+/**
+ *******************************************************************************
+ * @file	stm32g4_gps_pps.h
+ * @author	DEEP Project
+ * @date	Oct 17, 2026
+ * @brief	Base de temps disciplin par le signal PPS du GPS : horodatage UTC  la nanoseconde
+ *******************************************************************************
+ */
+
+#ifndef GPS_PPS_H_
+#define GPS_PPS_H_
+#include "config.h"
+#if USE_GPS
+#include "stm32g4_utils.h"
+#include "stm32g4_gps.h"
+
+#define GPS_PPS_MAX_FREQUENCY_ERROR_PPM	500		//Ecart tolr entre la seconde mesure et la frquence nominale du timer
+#define GPS_PPS_MAX_PHASE_ERROR_NS		50000	//Au del, l'impulsion est ignore...
+#define GPS_PPS_MAX_OUTLIERS			3		//...et aprs ce nombre d'impulsions conscutives hors tolrance, l'heure est recale
+#define GPS_PPS_MAX_CORRECTION_PPB		200000	//Correction maximale de frquence applique par la boucle
+#define GPS_PPS_TIMEOUT_MS				1500	//Sans impulsion pendant cette dure, la base de temps passe en holdover
+
+typedef enum
+{
+	PPS_NO_SIGNAL = 0,		//Aucune impulsion reue : la base de temps utilise la frquence nominale du timer
+	PPS_ACQUIRING,			//Mesure de la premire seconde en cours
+	PPS_LOCKED,				//Les secondes locales sont alignes sur les impulsions
+	PPS_HOLDOVER			//Impulsions perdues : la dernire frquence mesure est conserve
+}gps_pps_state_e;
+
+typedef struct
+{
+	gps_pps_state_e	state;
+	uint32_t		pulses;				//Nombre d'impulsions reues
+	int32_t			last_error_ns;		//Ecart de la dernire impulsion avec la seconde prvue
+	int32_t			frequency_ppb;		//Correction applique  la frquence mesure  l'acquisition
+	uint32_t		ticks_per_second;	//Nombre de ticks du timer entre les deux dernires impulsions
+	uint32_t		steps;				//Nombre de recalages de l'heure
+	bool			utc_valid;			//L'heure a t aligne sur l'UTC (BSP_GPS_PPS_set_utc)
+}gps_pps_status_t;
+
+void BSP_GPS_PPS_init(void);
+uint32_t BSP_GPS_PPS_get_ticks(void);
+uint64_t BSP_GPS_PPS_ticks_to_ns(uint32_t ticks);
+uint64_t BSP_GPS_PPS_get_time_ns(void);
+uint64_t BSP_GPS_PPS_us_to_ns(uint32_t timestamp_us);
+bool BSP_GPS_PPS_set_utc(const gps_datas_t * gps_datas);
+void BSP_GPS_PPS_get_status(gps_pps_status_t * status);
+#if USE_RTC
+bool BSP_GPS_PPS_set_rtc(void);
+#endif
+void BSP_GPS_PPS_demo(void);
+
+#endif //USE_GPS
+#endif /* GPS_PPS_H_ */
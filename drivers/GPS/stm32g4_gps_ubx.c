@@ -0,0 +1,423 @@
+/**
+ *******************************************************************************
+ * @file	stm32g4_gps_ubx.c
+ * @author	DEEP Project
+ * @date	Oct 17, 2026
+ * @brief	Protocole binaire UBX des GPS u-blox : configuration et trames NAV-PVT
+ *******************************************************************************
+ * Une trame UBX : 0xB5 0x62 | classe | identifiant | longueur (2 octets, poids faible en premier) | donnes | CK_A CK_B
+ * Le checksum est un Fletcher 8 bits calcul de la classe  la fin des donnes.
+ *
+ * Une trame NAV-PVT (92 octets sur u-blox 7, 100 ensuite) remplace  chaque poque les trames RMC, GGA, VTG et GSA (plus de 300 caractres),
+ * et ne demande aucune conversion de texte. Le dcodeur avance octet par octet, directement depuis le buffer de
+ * rception de l'UART : les octets qui n'appartiennent pas  une trame UBX sont transmis au parser NMEA.
+ *
+ * Attention : le buffer de rception de l'UART fait 128 octets. A 115200 bauds, il faut le vider au moins toutes les 10ms.
+ */
+
+#include "config.h"
+#if USE_GPS
+#include "stm32g4_gps_ubx.h"
+#include <stdio.h>
+#include <string.h>
+
+//Constantes prives
+#define UBX_SYNC_CHAR_1			0xB5
+#define UBX_SYNC_CHAR_2			0x62
+#define UBX_NAV_PVT_MIN_LENGTH	84			//u-blox 7 : 84 octets, u-blox 8 et suivants : 92 (champs ajouts  la fin)
+
+#define UBX_CFG_PRT_UART1		1
+#define UBX_CFG_PRT_MODE_8N1	0x000008D0
+#define UBX_PROTO_UBX			0x0001
+#define UBX_PROTO_NMEA			0x0002
+
+//Types privs
+typedef enum
+{
+	UBX_WAIT_SYNC_1 = 0,
+	UBX_WAIT_SYNC_2,
+	UBX_CLASS,
+	UBX_ID,
+	UBX_LENGTH_LOW,
+	UBX_LENGTH_HIGH,
+	UBX_PAYLOAD,
+	UBX_CK_A,
+	UBX_CK_B
+}ubx_state_e;
+
+typedef struct
+{
+	ubx_state_e	state;
+	uint8_t		msg_class;
+	uint8_t		msg_id;
+	uint16_t	length;
+	uint16_t	index;
+	uint8_t		ck_a;
+	uint8_t		ck_b;
+	uint8_t		payload[UBX_MAX_PAYLOAD];
+}ubx_parser_t;
+
+//Fonctions prives
+static ubx_frame_e GPS_UBX_end_frame(ubx_nav_pvt_t * pvt);
+static void GPS_UBX_decode_nav_pvt(const uint8_t * p, ubx_nav_pvt_t * pvt);
+static bool GPS_UBX_wait_ack(uart_id_t uart_id, uint8_t msg_class, uint8_t msg_id);
+static void GPS_UBX_set_port(uart_id_t uart_id, uint32_t baudrate, uint8_t nmea_kept);
+static void GPS_UBX_set_message_rate(uart_id_t uart_id, uint8_t msg_class, uint8_t msg_id, uint8_t rate);
+static uint16_t GPS_UBX_u16(const uint8_t * p);
+static uint32_t GPS_UBX_u32(const uint8_t * p);
+static void GPS_UBX_put_u16(uint8_t * p, uint16_t v);
+static void GPS_UBX_put_u32(uint8_t * p, uint32_t v);
+
+//Variables prives
+static ubx_parser_t ubx;
+static uint8_t ack_class;		//Message acquitt par la dernire trame ACK-ACK ou ACK-NAK
+static uint8_t ack_id;
+
+//Identifiants des trames NMEA, dans l'ordre des bits UBX_KEEP_NMEA_xxx
+static const uint8_t nmea_ids[] = {0x00 /*GGA*/, 0x01 /*GLL*/, 0x02 /*GSA*/, 0x03 /*GSV*/, 0x04 /*RMC*/, 0x05 /*VTG*/};
+
+
+/*
+ * Dmo : configuration du GPS (UART1)  115200 bauds, 10 Hz, sans NMEA, puis affichage de chaque position reue.
+ */
+void BSP_GPS_UBX_demo(void)
+{
+	ubx_nav_pvt_t pvt;
+
+	if(!BSP_GPS_UBX_init(UART1_ID, 115200, 100, UBX_KEEP_NO_NMEA))
+		printf("GPS : configuration UBX non acquittee\n");
+	while(1)
+	{
+		if(BSP_GPS_UBX_process_uart(UART1_ID, &pvt, NULL) & UBX_NAV_PVT_RECEIVED)
+			printf("%02u:%02u:%02u.%03ld fix %u sat %u lat %ld lon %ld alt %ld mm v %ld mm/s\n",
+					pvt.hour, pvt.minute, pvt.second, (pvt.nano > 0) ? pvt.nano / 1000000 : 0,
+					pvt.fix_type, pvt.satellites_used, pvt.latitude, pvt.longitude, pvt.altitude, pvt.ground_speed);
+	}
+}
+
+/*
+ * Configuration du GPS :
+ * - vitesse de l'UART du GPS (la commande est envoye  la vitesse par dfaut puis  la nouvelle vitesse,
+ *   pour le cas o le GPS aurait dj t configur)
+ * - priode de navigation (100  200ms pour 10  5 Hz)
+ * - dsactivation des trames NMEA qui ne sont pas dans nmea_kept, activation de la trame NAV-PVT
+ * Renvoie vrai si toutes les commandes ont t acquittes.
+ */
+bool BSP_GPS_UBX_init(uart_id_t uart_id, uint32_t baudrate, uint16_t period_ms, uint8_t nmea_kept)
+{
+	uint8_t payload[6];
+	uint8_t i;
+	bool ok;
+
+	BSP_UART_init(uart_id, UBX_DEFAULT_BAUDRATE);
+	GPS_UBX_set_port(uart_id, baudrate, nmea_kept);
+	HAL_Delay(100);		//Le GPS change de vitesse une fois la rponse envoye
+	BSP_UART_init(uart_id, baudrate);
+	GPS_UBX_set_port(uart_id, baudrate, nmea_kept);
+	ok = GPS_UBX_wait_ack(uart_id, UBX_CLASS_CFG, UBX_CFG_PRT);
+
+	GPS_UBX_put_u16(&payload[0], period_ms);	//measRate
+	GPS_UBX_put_u16(&payload[2], 1);			//navRate : une solution par mesure
+	GPS_UBX_put_u16(&payload[4], 1);			//timeRef : temps GPS
+	BSP_GPS_UBX_send(uart_id, UBX_CLASS_CFG, UBX_CFG_RATE, payload, 6);
+	ok &= GPS_UBX_wait_ack(uart_id, UBX_CLASS_CFG, UBX_CFG_RATE);
+
+	for(i = 0; i < sizeof(nmea_ids); i++)
+	{
+		GPS_UBX_set_message_rate(uart_id, UBX_CLASS_NMEA, nmea_ids[i], (nmea_kept & (1 << i)) ? 1 : 0);
+		ok &= GPS_UBX_wait_ack(uart_id, UBX_CLASS_CFG, UBX_CFG_MSG);
+	}
+	GPS_UBX_set_message_rate(uart_id, UBX_CLASS_NAV, UBX_NAV_PVT, 1);
+	ok &= GPS_UBX_wait_ack(uart_id, UBX_CLASS_CFG, UBX_CFG_MSG);
+	return ok;
+}
+
+/*
+ * Envoi d'une trame UBX : entte, donnes et checksum
+ */
+void BSP_GPS_UBX_send(uart_id_t uart_id, uint8_t msg_class, uint8_t msg_id, const uint8_t * payload, uint16_t len)
+{
+	uint8_t header[6] = {UBX_SYNC_CHAR_1, UBX_SYNC_CHAR_2, msg_class, msg_id, (uint8_t)len, (uint8_t)(len >> 8)};
+	uint8_t checksum[2] = {0, 0};
+	uint16_t i;
+
+	for(i = 2; i < 6; i++)
+	{
+		checksum[0] += header[i];
+		checksum[1] += checksum[0];
+	}
+	for(i = 0; i < len; i++)
+	{
+		checksum[0] += payload[i];
+		checksum[1] += checksum[0];
+	}
+	BSP_UART_puts(uart_id, header, 6);
+	if(len)
+		BSP_UART_puts(uart_id, payload, len);
+	BSP_UART_puts(uart_id, checksum, 2);
+}
+
+/*
+ * Cette fonction rcupre le nouvel octet fourni (c) et fait avancer le dcodage de la trame UBX en cours.
+ * Lorsqu'une trame NAV-PVT complte et valide a t reue, pvt est rempli et la fonction renvoie UBX_FRAME_NAV_PVT.
+ */
+ubx_frame_e BSP_GPS_UBX_process_rx(uint8_t c, ubx_nav_pvt_t * pvt)
+{
+	if(ubx.state >= UBX_CLASS && ubx.state <= UBX_PAYLOAD)
+	{
+		ubx.ck_a += c;
+		ubx.ck_b += ubx.ck_a;
+	}
+
+	switch(ubx.state)
+	{
+		case UBX_WAIT_SYNC_1:
+			if(c == UBX_SYNC_CHAR_1)
+				ubx.state = UBX_WAIT_SYNC_2;
+			break;
+		case UBX_WAIT_SYNC_2:
+			if(c == UBX_SYNC_CHAR_2)
+			{
+				ubx.ck_a = 0;
+				ubx.ck_b = 0;
+				ubx.state = UBX_CLASS;
+			}
+			else
+				ubx.state = (c == UBX_SYNC_CHAR_1) ? UBX_WAIT_SYNC_2 : UBX_WAIT_SYNC_1;
+			break;
+		case UBX_CLASS:
+			ubx.msg_class = c;
+			ubx.state = UBX_ID;
+			break;
+		case UBX_ID:
+			ubx.msg_id = c;
+			ubx.state = UBX_LENGTH_LOW;
+			break;
+		case UBX_LENGTH_LOW:
+			ubx.length = c;
+			ubx.state = UBX_LENGTH_HIGH;
+			break;
+		case UBX_LENGTH_HIGH:
+			ubx.length |= (uint16_t)(c << 8);
+			ubx.index = 0;
+			ubx.state = ubx.length ? UBX_PAYLOAD : UBX_CK_A;
+			break;
+		case UBX_PAYLOAD:
+			if(ubx.index < UBX_MAX_PAYLOAD)
+				ubx.payload[ubx.index] = c;
+			if(++ubx.index == ubx.length)
+				ubx.state = UBX_CK_A;
+			break;
+		case UBX_CK_A:
+			ubx.state = (c == ubx.ck_a) ? UBX_CK_B : UBX_WAIT_SYNC_1;
+			if(c != ubx.ck_a)
+				return UBX_CHECKSUM_INVALID;
+			break;
+		case UBX_CK_B:
+			ubx.state = UBX_WAIT_SYNC_1;
+			if(c != ubx.ck_b)
+				return UBX_CHECKSUM_INVALID;
+			return GPS_UBX_end_frame(pvt);
+		default:
+			ubx.state = UBX_WAIT_SYNC_1;
+			break;
+	}
+	return UBX_NO_FRAME_RECEIVED;
+}
+
+/*
+ * Cette fonction traite tous les octets disponibles sur l'UART :
+ * les trames UBX sont dcodes, les autres octets sont transmis au parser NMEA (si gps_datas n'est pas NULL).
+ * A chaque trame NAV-PVT, pvt est rempli, ainsi que gps_datas (si il n'est pas NULL).
+ * Renvoie UBX_NAV_PVT_RECEIVED si une trame NAV-PVT a t reue, et le bit n pour chaque trame NMEA de type n reue.
+ */
+uint32_t BSP_GPS_UBX_process_uart(uart_id_t uart_id, ubx_nav_pvt_t * pvt, gps_datas_t * gps_datas)
+{
+	uint32_t frames = 0;
+	nmea_frame_e nmea;
+	uint8_t c;
+
+	while(BSP_UART_data_ready(uart_id))
+	{
+		c = BSP_UART_get_next_byte(uart_id);
+		if(ubx.state != UBX_WAIT_SYNC_1 || c == UBX_SYNC_CHAR_1)
+		{
+			if(BSP_GPS_UBX_process_rx(c, pvt) == UBX_FRAME_NAV_PVT)
+			{
+				frames |= UBX_NAV_PVT_RECEIVED;
+				if(gps_datas)
+					BSP_GPS_UBX_to_gps_datas(pvt, gps_datas);
+			}
+		}
+		else if(gps_datas)
+		{
+			nmea = BSP_GPS_process_rx(c, gps_datas);
+			if(nmea >= TRAME_RMC)
+				frames |= 1UL << nmea;
+		}
+	}
+	return frames;
+}
+
+/*
+ * Recopie une solution NAV-PVT dans la structure utilise pour les trames NMEA
+ */
+void BSP_GPS_UBX_to_gps_datas(const ubx_nav_pvt_t * pvt, gps_datas_t * gps_datas)
+{
+	int32_t ms;		//[ms] depuis 0h
+
+	ms = (((int32_t)pvt->hour * 60 + pvt->minute) * 60 + pvt->second) * 1000 + pvt->nano / 1000000;
+	if(ms < 0)
+		ms += 86400000;
+	gps_datas->seconds = (uint32_t)ms / 1000;
+	gps_datas->milliseconds = (uint16_t)((uint32_t)ms % 1000);
+	gps_datas->time = (gps_datas->seconds / 3600) * 10000 + ((gps_datas->seconds / 60) % 60) * 100 + gps_datas->seconds % 60;
+	gps_datas->day = pvt->day;
+	gps_datas->month = pvt->month;
+	gps_datas->year = pvt->year;
+	gps_datas->date32 = (	((uint32_t)(pvt->year - 1980)) << 25 )
+			| 	((uint32_t)pvt->month << 21 )
+			| 	((uint32_t)pvt->day << 16 )
+			| 	((uint32_t)pvt->hour << 11 )
+			| 	((uint32_t)pvt->minute << 5 )
+			| 	((uint32_t)pvt->second >> 1 ) ;
+
+	gps_datas->latitude = pvt->latitude;
+	gps_datas->longitude = pvt->longitude;
+	gps_datas->altitude = pvt->altitude;
+	gps_datas->geoid_separation = pvt->height - pvt->altitude;
+	gps_datas->speed = (uint32_t)pvt->ground_speed;
+	gps_datas->course = (uint16_t)(pvt->heading / 1000);
+	gps_datas->fix_quality = (pvt->flags & 0x01) ? ((pvt->flags & 0x02) ? 2 : 1) : 0;
+	gps_datas->fix_mode = (pvt->fix_type == 2) ? 2 : (pvt->fix_type == 3 || pvt->fix_type == 4) ? 3 : 1;
+	gps_datas->satellites_used = pvt->satellites_used;
+	gps_datas->pdop = pvt->pdop;
+}
+
+
+
+/*
+ * Fin d'une trame dont le checksum est correct
+ */
+static ubx_frame_e GPS_UBX_end_frame(ubx_nav_pvt_t * pvt)
+{
+	if(ubx.msg_class == UBX_CLASS_NAV && ubx.msg_id == UBX_NAV_PVT && ubx.length >= UBX_NAV_PVT_MIN_LENGTH)
+	{
+		GPS_UBX_decode_nav_pvt(ubx.payload, pvt);
+		return UBX_FRAME_NAV_PVT;
+	}
+	if(ubx.msg_class == UBX_CLASS_ACK && ubx.length == 2)
+	{
+		ack_class = ubx.payload[0];
+		ack_id = ubx.payload[1];
+		return (ubx.msg_id == UBX_ACK_ACK) ? UBX_FRAME_ACK : UBX_FRAME_NAK;
+	}
+	return UBX_FRAME_UNKNOW;
+}
+
+/*
+ * Les champs sont lus aux positions dfinies par u-blox, poids faible en premier.
+ * Seuls les champs communs  toutes les versions (les 78 premiers octets) sont lus.
+ */
+static void GPS_UBX_decode_nav_pvt(const uint8_t * p, ubx_nav_pvt_t * pvt)
+{
+	pvt->itow = GPS_UBX_u32(&p[0]);
+	pvt->year = GPS_UBX_u16(&p[4]);
+	pvt->month = p[6];
+	pvt->day = p[7];
+	pvt->hour = p[8];
+	pvt->minute = p[9];
+	pvt->second = p[10];
+	pvt->valid = p[11];
+	pvt->time_accuracy = GPS_UBX_u32(&p[12]);
+	pvt->nano = (int32_t)GPS_UBX_u32(&p[16]);
+	pvt->fix_type = p[20];
+	pvt->flags = p[21];
+	pvt->satellites_used = p[23];
+	pvt->longitude = (int32_t)GPS_UBX_u32(&p[24]);
+	pvt->latitude = (int32_t)GPS_UBX_u32(&p[28]);
+	pvt->height = (int32_t)GPS_UBX_u32(&p[32]);
+	pvt->altitude = (int32_t)GPS_UBX_u32(&p[36]);
+	pvt->horizontal_accuracy = GPS_UBX_u32(&p[40]);
+	pvt->vertical_accuracy = GPS_UBX_u32(&p[44]);
+	pvt->velocity_north = (int32_t)GPS_UBX_u32(&p[48]);
+	pvt->velocity_east = (int32_t)GPS_UBX_u32(&p[52]);
+	pvt->velocity_down = (int32_t)GPS_UBX_u32(&p[56]);
+	pvt->ground_speed = (int32_t)GPS_UBX_u32(&p[60]);
+	pvt->heading = (int32_t)GPS_UBX_u32(&p[64]);
+	pvt->speed_accuracy = GPS_UBX_u32(&p[68]);
+	pvt->heading_accuracy = GPS_UBX_u32(&p[72]);
+	pvt->pdop = GPS_UBX_u16(&p[76]);
+}
+
+/*
+ * Attend l'acquittement (ACK-ACK) d'une commande de configuration. Les autres octets reus sont ignors.
+ */
+static bool GPS_UBX_wait_ack(uart_id_t uart_id, uint8_t msg_class, uint8_t msg_id)
+{
+	uint32_t t = HAL_GetTick();
+	ubx_frame_e frame;
+	ubx_nav_pvt_t pvt;		//Les trames NAV-PVT dj actives peuvent arriver pendant l'attente
+
+	while(HAL_GetTick() - t < UBX_ACK_TIMEOUT_MS)
+	{
+		if(!BSP_UART_data_ready(uart_id))
+			continue;
+		frame = BSP_GPS_UBX_process_rx(BSP_UART_get_next_byte(uart_id), &pvt);
+		if((frame == UBX_FRAME_ACK || frame == UBX_FRAME_NAK) && ack_class == msg_class && ack_id == msg_id)
+			return frame == UBX_FRAME_ACK;
+	}
+	return false;
+}
+
+/*
+ * CFG-PRT : vitesse et protocoles de l'UART1 du GPS (UBX en entre et en sortie, NMEA en sortie si des trames sont conserves)
+ */
+static void GPS_UBX_set_port(uart_id_t uart_id, uint32_t baudrate, uint8_t nmea_kept)
+{
+	uint8_t payload[20];
+
+	memset(payload, 0, sizeof(payload));
+	payload[0] = UBX_CFG_PRT_UART1;
+	GPS_UBX_put_u32(&payload[4], UBX_CFG_PRT_MODE_8N1);
+	GPS_UBX_put_u32(&payload[8], baudrate);
+	GPS_UBX_put_u16(&payload[12], UBX_PROTO_UBX | UBX_PROTO_NMEA);
+	GPS_UBX_put_u16(&payload[14], nmea_kept ? (UBX_PROTO_UBX | UBX_PROTO_NMEA) : UBX_PROTO_UBX);
+	BSP_GPS_UBX_send(uart_id, UBX_CLASS_CFG, UBX_CFG_PRT, payload, sizeof(payload));
+}
+
+/*
+ * CFG-MSG : frquence d'mission d'un message sur le port courant (1  chaque solution, 0 jamais)
+ */
+static void GPS_UBX_set_message_rate(uart_id_t uart_id, uint8_t msg_class, uint8_t msg_id, uint8_t rate)
+{
+	uint8_t payload[3] = {msg_class, msg_id, rate};
+
+	BSP_GPS_UBX_send(uart_id, UBX_CLASS_CFG, UBX_CFG_MSG, payload, sizeof(payload));
+}
+
+static uint16_t GPS_UBX_u16(const uint8_t * p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t GPS_UBX_u32(const uint8_t * p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void GPS_UBX_put_u16(uint8_t * p, uint16_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+}
+
+static void GPS_UBX_put_u32(uint8_t * p, uint32_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+	p[2] = (uint8_t)(v >> 16);
+	p[3] = (uint8_t)(v >> 24);
+}
+
+#endif //USE_GPS
@@ -0,0 +1,98 @@
+/**
+ *******************************************************************************
+ * @file	stm32g4_gps_ubx.h
+ * @author	DEEP Project
+ * @date	Oct 17, 2026
+ * @brief	Protocole binaire UBX des GPS u-blox : configuration et trames NAV-PVT
+ *******************************************************************************
+ */
+
+#ifndef GPS_UBX_H_
+#define GPS_UBX_H_
+#include "config.h"
+#if USE_GPS
+#include "stm32g4_utils.h"
+#include "stm32g4_uart.h"
+#include "stm32g4_gps.h"
+
+#define UBX_DEFAULT_BAUDRATE	9600		//Vitesse du GPS  la mise sous tension
+#define UBX_MAX_PAYLOAD			100			//Les trames plus longues sont vrifies mais pas mmorises
+#define UBX_ACK_TIMEOUT_MS		500
+
+//Classes et identifiants des messages utiliss
+#define UBX_CLASS_NAV			0x01
+#define UBX_CLASS_ACK			0x05
+#define UBX_CLASS_CFG			0x06
+#define UBX_CLASS_NMEA			0xF0
+#define UBX_NAV_PVT				0x07
+#define UBX_ACK_NAK				0x00
+#define UBX_ACK_ACK				0x01
+#define UBX_CFG_PRT				0x00
+#define UBX_CFG_MSG				0x01
+#define UBX_CFG_RATE			0x08
+
+//Trames NMEA conserves par BSP_GPS_UBX_init (paramtre nmea_kept)
+#define UBX_KEEP_NO_NMEA		0x00
+#define UBX_KEEP_NMEA_GGA		0x01
+#define UBX_KEEP_NMEA_GLL		0x02
+#define UBX_KEEP_NMEA_GSA		0x04
+#define UBX_KEEP_NMEA_GSV		0x08
+#define UBX_KEEP_NMEA_RMC		0x10
+#define UBX_KEEP_NMEA_VTG		0x20
+
+//Bit renvoy par BSP_GPS_UBX_process_uart lorsqu'une trame NAV-PVT a t reue (les bits de poids faible sont ceux des trames NMEA)
+#define UBX_NAV_PVT_RECEIVED	(1UL << 16)
+
+typedef enum
+{
+	UBX_NO_FRAME_RECEIVED = 0,	//Une trame est en cours de rception
+	UBX_CHECKSUM_INVALID,
+	UBX_FRAME_UNKNOW,			//Une trame valide mais non gre a t reue
+	UBX_FRAME_NAV_PVT,
+	UBX_FRAME_ACK,
+	UBX_FRAME_NAK
+}ubx_frame_e;
+
+/*
+ * Contenu d'une trame NAV-PVT (u-blox 7 et suivants) : position, vitesse et heure d'une mme poque de navigation.
+ */
+typedef struct
+{
+	uint32_t	itow;				//[ms] temps GPS dans la semaine
+	uint16_t	year;
+	uint8_t		month;
+	uint8_t		day;
+	uint8_t		hour;
+	uint8_t		minute;
+	uint8_t		second;
+	uint8_t		valid;				//bit 0 date valide, bit 1 heure valide, bit 2 heure compltement rsolue
+	uint32_t	time_accuracy;		//[ns]
+	int32_t		nano;				//[ns] fraction de seconde, de -1e9  1e9
+	uint8_t		fix_type;			//0 pas de fix, 1 estim, 2 fix 2D, 3 fix 3D, 4 GNSS + estime, 5 temps seulement
+	uint8_t		flags;				//bit 0 fix valide (gnssFixOK), bit 1 correction diffrentielle
+	uint8_t		satellites_used;
+	int32_t		longitude;			//[1e-7 deg]
+	int32_t		latitude;			//[1e-7 deg]
+	int32_t		height;				//[mm] au dessus de l'ellipsode
+	int32_t		altitude;			//[mm] au dessus du niveau moyen des mers
+	uint32_t	horizontal_accuracy;	//[mm]
+	uint32_t	vertical_accuracy;	//[mm]
+	int32_t		velocity_north;		//[mm/s]
+	int32_t		velocity_east;		//[mm/s]
+	int32_t		velocity_down;		//[mm/s]
+	int32_t		ground_speed;		//[mm/s]
+	int32_t		heading;			//[1e-5 deg] cap du dplacement
+	uint32_t	speed_accuracy;		//[mm/s]
+	uint32_t	heading_accuracy;	//[1e-5 deg]
+	uint16_t	pdop;				//[1e-2]
+}ubx_nav_pvt_t;
+
+bool BSP_GPS_UBX_init(uart_id_t uart_id, uint32_t baudrate, uint16_t period_ms, uint8_t nmea_kept);
+void BSP_GPS_UBX_send(uart_id_t uart_id, uint8_t msg_class, uint8_t msg_id, const uint8_t * payload, uint16_t len);
+ubx_frame_e BSP_GPS_UBX_process_rx(uint8_t c, ubx_nav_pvt_t * pvt);
+uint32_t BSP_GPS_UBX_process_uart(uart_id_t uart_id, ubx_nav_pvt_t * pvt, gps_datas_t * gps_datas);
+void BSP_GPS_UBX_to_gps_datas(const ubx_nav_pvt_t * pvt, gps_datas_t * gps_datas);
+void BSP_GPS_UBX_demo(void);
+
+#endif //USE_GPS
+#endif /* GPS_UBX_H_ */
@@ -54,7 +54,62 @@
 #include "stm32g4_i2c.h"
 #include "stm32g4_mpu6050.h"
 #include "stm32g4_gpio.h"
+#include "stm32g4_extit.h"
+#include "stm32g4_systick.h"
 #include <stdio.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define STREAM_RING_MASK		(MPU6050_STREAM_RING_SIZE - 1)
+#define STREAM_PENDING_SIZE		128		//> capacité de la FIFO du capteur (85 échantillons)
+#define STREAM_PENDING_MASK		(STREAM_PENDING_SIZE - 1)
+
+#if (MPU6050_STREAM_RING_SIZE & STREAM_RING_MASK) != 0
+	#error "MPU6050_STREAM_RING_SIZE doit être une puissance de 2"
+#endif
+
+/* Private types -------------------------------------------------------------*/
+typedef enum
+{
+	STREAM_IDLE,
+	STREAM_READ_COUNT,
+	STREAM_READ_DATA,
+	STREAM_RESET_FIFO
+}stream_state_e;
+
+/* Private variables ---------------------------------------------------------*/
+/*
+ * Mode streaming :
+ * 	- l'IT "data ready" (broche INT -> EXTI) horodate chaque échantillon dans pending_ts[],
+ * 	- dès que MPU6050_STREAM_BLOCK_SAMPLES échantillons sont en attente, on lit FIFO_COUNT puis toute la FIFO en une rafale DMA,
+ * 	- le callback de fin de transfert associe les échantillons aux horodatages et les range dans ring[].
+ * Le CPU n'intervient donc que quelques µs par échantillon et une fois par rafale.
+ */
+static MPU6050_t * stream_dev = NULL;
+static volatile stream_state_e stream_state = STREAM_IDLE;
+static uint8_t stream_pin_number;
+static uint32_t stream_period_us;
+static uint32_t stream_last_ts;
+static uint8_t stream_rx[MPU6050_STREAM_BURST_MAX * MPU6050_FIFO_SAMPLE_SIZE];
+static uint8_t stream_ctrl;
+static uint16_t stream_burst_samples;
+
+static volatile uint32_t pending_ts[STREAM_PENDING_SIZE];
+static volatile uint32_t pending_head = 0;	//écrit par l'IT EXTI
+static volatile uint32_t pending_tail = 0;	//écrit par le callback I2C
+
+static MPU6050_Sample_t ring[MPU6050_STREAM_RING_SIZE];
+static volatile uint32_t ring_head = 0;		//écrit par le callback I2C
+static volatile uint32_t ring_tail = 0;		//écrit par le consommateur
+
+static volatile MPU6050_StreamStats_t stream_stats;
+
+/* Private functions declarations --------------------------------------------*/
+static void MPU6050_stream_int_callback(uint8_t pin_number);
+static void MPU6050_stream_launch(void);
+static void MPU6050_stream_count_done(HAL_StatusTypeDef status);
+static void MPU6050_stream_data_done(HAL_StatusTypeDef status);
+static void MPU6050_stream_reset_done(HAL_StatusTypeDef status);
 
 /**
  * @brief	Initialise le module MPU6050 en activant son alimentation, puis en configurant les registres internes du MPU6050.
@@ -80,8 +135,8 @@ MPU6050_Result_t MPU6050_Init(MPU6050_t* DataStruct, GPIO_TypeDef * GPIOx, uint1
 	/* Formate l'addresse de l'I2C */
 	DataStruct->Address = MPU6050_I2C_ADDR | (uint8_t)DeviceNumber;
 
-	/* Initialise l'I2C */
-	BSP_I2C_Init(MPU6050_I2C, STANDARD_MODE, true);
+	/* Initialise l'I2C, une fois pour toutes (le mode streaming ne le reconfigure pas) */
+	BSP_I2C_Init(MPU6050_I2C, (MPU6050_I2C_CLOCK >= 400000) ? FAST_MODE : STANDARD_MODE, true);
 
 	/* On vérifie que le capteur est bien connecté */
 	if (!BSP_I2C_IsDeviceConnected(MPU6050_I2C, DataStruct->Address)) {
@@ -195,7 +250,7 @@ MPU6050_Result_t MPU6050_ReadTemperature(MPU6050_t* DataStruct) {
 
 	/* On met au bon format */
 	temp = (int16_t)(data[0] << 8 | data[1]);
-	DataStruct->Temperature = (float)((int16_t)temp / (float)340.0 + (float)36.53);
+	DataStruct->Temperature = (float)temp * MPU6050_TEMP_MULT + MPU6050_TEMP_OFFSET;
 
 	return MPU6050_Result_Ok;
 }
@@ -218,7 +273,7 @@ MPU6050_Result_t MPU6050_ReadAll(MPU6050_t* DataStruct) {
 	DataStruct->Accelerometer_Z = (int16_t)(data[4] << 8 | data[5]);
 
 	temp = (int16_t)(data[6] << 8 | data[7]);
-	DataStruct->Temperature = (float)((float)((int16_t)temp) / (float)340.0 + (float)36.53);
+	DataStruct->Temperature = (float)temp * MPU6050_TEMP_MULT + MPU6050_TEMP_OFFSET;
 
 	DataStruct->Gyroscope_X = (int16_t)(data[8] << 8 | data[9]);
 	DataStruct->Gyroscope_Y = (int16_t)(data[10] << 8 | data[11]);
@@ -227,16 +282,255 @@ MPU6050_Result_t MPU6050_ReadAll(MPU6050_t* DataStruct) {
 	return MPU6050_Result_Ok;
 }
 
+/**
+ * @brief	Démarre le mode streaming : la FIFO du capteur est remplie à sample_rate_hz,
+ * 			et l'IT de la broche INT déclenche des lectures en rafale (I2C asynchrone) de blocs entiers de la FIFO.
+ * @param	DataStruct : structure initialisée par MPU6050_Init (elle doit rester valide pendant le streaming)
+ * @param	sample_rate_hz : fréquence d'échantillonnage, de 4 à 1000 Hz
+ * @param	GPIOx et GPIO_PIN_x : broche reliée à la sortie INT du MPU6050
+ * @pre		L'I2C a été configuré par MPU6050_Init à MPU6050_I2C_CLOCK : 400kHz sont nécessaires pour 1000 échantillons
+ * 			de 12 octets par seconde. Le bus, partagé avec d'autres capteurs, n'est pas réinitialisé ici.
+ * @note	La fréquence obtenue est 1000 / (SMPLRT_DIV + 1) Hz : pour une fréquence qui ne divise pas 1kHz,
+ * 			c'est la fréquence programmée qui sert à horodater les échantillons.
+ */
+MPU6050_Result_t MPU6050_StreamStart(MPU6050_t* DataStruct, uint16_t sample_rate_hz, GPIO_TypeDef * GPIOx, uint16_t GPIO_PIN_x)
+{
+	if(sample_rate_hz > 1000)
+		sample_rate_hz = 1000;
+	if(sample_rate_hz < 4)
+		sample_rate_hz = 4;
+
+	MPU6050_StreamStop();
+
+	if (!BSP_I2C_IsDeviceConnected(MPU6050_I2C, DataStruct->Address))
+		return MPU6050_Result_DeviceNotConnected;
+
+	uint8_t divider = (uint8_t)(1000 / sample_rate_hz - 1);
+
+	stream_dev = DataStruct;
+	stream_period_us = 1000 * ((uint32_t)divider + 1);	//période réellement programmée
+	stream_pin_number = BSP_EXTIT_gpiopin_to_pin_number(GPIO_PIN_x);
+	pending_head = pending_tail = 0;
+	ring_head = ring_tail = 0;
+	memset((void *)&stream_stats, 0, sizeof(stream_stats));
+	stream_state = STREAM_IDLE;
+
+	uint8_t config[2];
+	BSP_I2C_batch_begin(MPU6050_I2C);
+
+	/* Fréquence interne de 1kHz (DLPF actif), divisée par SMPLRT_DIV + 1 (registres contigus : une seule transaction) */
+	config[0] = divider;
+	config[1] = MPU6050_CONFIG_DLPF_188HZ;
+	BSP_I2C_batch_write(MPU6050_I2C, DataStruct->Address, MPU6050_SMPLRT_DIV, &config[0], 1);
+	BSP_I2C_batch_write(MPU6050_I2C, DataStruct->Address, MPU6050_CONFIG, &config[1], 1);
+
+	/* Broche INT : impulsion active haut, acquittée par toute lecture */
+	config[0] = MPU6050_INT_CFG_RD_CLEAR;
+	BSP_I2C_batch_write(MPU6050_I2C, DataStruct->Address, MPU6050_INT_PIN_CFG, &config[0], 1);
+
+	/* Accéléromètre et gyroscope dans la FIFO, que l'on vide avant de l'activer */
+	config[0] = MPU6050_FIFO_EN_ACCEL_GYRO;
+	BSP_I2C_batch_write(MPU6050_I2C, DataStruct->Address, MPU6050_FIFO_EN, &config[0], 1);
+	config[0] = MPU6050_USER_CTRL_FIFO_RST;
+	BSP_I2C_batch_write(MPU6050_I2C, DataStruct->Address, MPU6050_USER_CTRL, &config[0], 1);
+	config[0] = MPU6050_USER_CTRL_FIFO_EN;
+	BSP_I2C_batch_write(MPU6050_I2C, DataStruct->Address, MPU6050_USER_CTRL, &config[0], 1);
+
+	if(BSP_I2C_batch_end(MPU6050_I2C) != HAL_OK)
+		return MPU6050_Result_DeviceNotConnected;	//la configuration n'a pas été acquittée
+
+	BSP_GPIO_pin_config(GPIOx, GPIO_PIN_x, GPIO_MODE_IT_RISING, GPIO_PULLDOWN, GPIO_SPEED_FREQ_HIGH, GPIO_NO_AF);
+	BSP_EXTIT_set_callback(&MPU6050_stream_int_callback, stream_pin_number, true);
+
+	BSP_I2C_Write(MPU6050_I2C, DataStruct->Address, MPU6050_INT_ENABLE, MPU6050_INT_DATA_RDY_EN);
+
+	return MPU6050_Result_Ok;
+}
+
+/**
+ * @brief	Arrête le mode streaming (IT et FIFO du capteur désactivées)
+ * @post	Les échantillons encore présents dans le buffer circulaire restent disponibles
+ */
+void MPU6050_StreamStop(void)
+{
+	if(stream_dev == NULL)
+		return;
+	BSP_EXTIT_disable(stream_pin_number);
+	while(stream_state != STREAM_IDLE)		//on laisse se terminer la rafale en cours (IT I2C)
+		__WFI();
+	BSP_I2C_Write(MPU6050_I2C, stream_dev->Address, MPU6050_INT_ENABLE, 0x00);
+	BSP_I2C_Write(MPU6050_I2C, stream_dev->Address, MPU6050_USER_CTRL, 0x00);
+	BSP_I2C_Write(MPU6050_I2C, stream_dev->Address, MPU6050_FIFO_EN, 0x00);
+	stream_dev = NULL;
+}
+
+/**
+ * @brief	Copie jusqu'à max échantillons du buffer circulaire vers samples (du plus ancien au plus récent)
+ * @return	Le nombre d'échantillons copiés
+ */
+uint16_t MPU6050_StreamRead(MPU6050_Sample_t* samples, uint16_t max)
+{
+	uint32_t tail = ring_tail;
+	uint32_t available = ring_head - tail;
+	uint16_t n = (available < max) ? (uint16_t)available : max;
+	for(uint16_t i = 0; i < n; i++)
+		samples[i] = ring[(tail + i) & STREAM_RING_MASK];
+	ring_tail = tail + n;
+	return n;
+}
+
+/**
+ * @brief	Nombre d'échantillons disponibles dans le buffer circulaire
+ */
+uint16_t MPU6050_StreamAvailable(void)
+{
+	return (uint16_t)(ring_head - ring_tail);
+}
+
+/**
+ * @brief	Copie les statistiques du mode streaming
+ */
+void MPU6050_StreamGetStats(MPU6050_StreamStats_t* stats)
+{
+	__disable_irq();
+	*stats = stream_stats;
+	__enable_irq();
+}
+
+/**
+ * @brief	IT "data ready" : horodatage de l'échantillon, puis lecture en rafale dès qu'un bloc est complet
+ */
+static void MPU6050_stream_int_callback(uint8_t pin_number)
+{
+	UNUSED(pin_number);
+	if(pending_head - pending_tail >= STREAM_PENDING_SIZE)
+		pending_tail++;			//ne devrait pas arriver : la FIFO du capteur aurait débordé avant
+	pending_ts[pending_head & STREAM_PENDING_MASK] = BSP_systick_get_time_us();
+	pending_head++;
+	if(stream_state == STREAM_IDLE && pending_head - pending_tail >= MPU6050_STREAM_BLOCK_SAMPLES)
+		MPU6050_stream_launch();
+}
+
+/**
+ * @brief	Première étape d'une rafale : lecture du nombre d'octets présents dans la FIFO
+ * @note	Si le bus est occupé par un autre module, on réessaiera à la prochaine IT "data ready"
+ */
+static void MPU6050_stream_launch(void)
+{
+	stream_state = STREAM_READ_COUNT;
+	if(BSP_I2C_ReadMulti_DMA(MPU6050_I2C, stream_dev->Address, MPU6050_FIFO_COUNTH, stream_rx, 2, &MPU6050_stream_count_done) != HAL_OK)
+		stream_state = STREAM_IDLE;
+}
+
+static void MPU6050_stream_count_done(HAL_StatusTypeDef status)
+{
+	uint16_t count;
+	uint16_t n;
+	if(status != HAL_OK)
+	{
+		stream_stats.bus_errors++;
+		stream_state = STREAM_IDLE;
+		return;
+	}
+	count = (uint16_t)(stream_rx[0] << 8 | stream_rx[1]);
+	if(count > MPU6050_FIFO_SIZE - MPU6050_FIFO_SAMPLE_SIZE)
+	{
+		/* La FIFO a débordé : son contenu n'est plus aligné sur les échantillons, on la vide */
+		stream_state = STREAM_RESET_FIFO;
+		stream_ctrl = MPU6050_USER_CTRL_FIFO_EN | MPU6050_USER_CTRL_FIFO_RST;
+		if(BSP_I2C_WriteMulti_DMA(MPU6050_I2C, stream_dev->Address, MPU6050_USER_CTRL, &stream_ctrl, 1, &MPU6050_stream_reset_done) != HAL_OK)
+			stream_state = STREAM_IDLE;
+		return;
+	}
+	n = count / MPU6050_FIFO_SAMPLE_SIZE;
+	if(n > MPU6050_STREAM_BURST_MAX)
+		n = MPU6050_STREAM_BURST_MAX;
+	if(n == 0)
+	{
+		stream_state = STREAM_IDLE;
+		return;
+	}
+	stream_state = STREAM_READ_DATA;
+	stream_burst_samples = n;
+	if(BSP_I2C_ReadMulti_DMA(MPU6050_I2C, stream_dev->Address, MPU6050_FIFO_R_W, stream_rx, n * MPU6050_FIFO_SAMPLE_SIZE, &MPU6050_stream_data_done) != HAL_OK)
+		stream_state = STREAM_IDLE;
+}
+
+static void MPU6050_stream_data_done(HAL_StatusTypeDef status)
+{
+	uint16_t n;
+	uint32_t head;
+	uint8_t * p;
+	MPU6050_Sample_t * s;
+	if(status != HAL_OK)
+	{
+		stream_stats.bus_errors++;
+		stream_state = STREAM_IDLE;
+		return;
+	}
+	n = stream_burst_samples;
+	head = ring_head;
+	p = stream_rx;
+	for(uint16_t i = 0; i < n; i++, p += MPU6050_FIFO_SAMPLE_SIZE)
+	{
+		/* Les horodatages sont consommés dans l'ordre : l'échantillon le plus ancien de la FIFO correspond à la plus ancienne IT */
+		if(pending_tail != pending_head)
+			stream_last_ts = pending_ts[pending_tail++ & STREAM_PENDING_MASK];
+		else
+			stream_last_ts += stream_period_us;
+
+		if(head - ring_tail >= MPU6050_STREAM_RING_SIZE)
+		{
+			stream_stats.dropped++;		//le consommateur est en retard : on ne détruit pas les échantillons non lus
+			continue;
+		}
+		s = &ring[head & STREAM_RING_MASK];
+		s->timestamp_us = stream_last_ts;
+		s->accel[0] = (int16_t)(p[0] << 8 | p[1]);
+		s->accel[1] = (int16_t)(p[2] << 8 | p[3]);
+		s->accel[2] = (int16_t)(p[4] << 8 | p[5]);
+		s->gyro[0] = (int16_t)(p[6] << 8 | p[7]);
+		s->gyro[1] = (int16_t)(p[8] << 8 | p[9]);
+		s->gyro[2] = (int16_t)(p[10] << 8 | p[11]);
+		head++;
+	}
+	ring_head = head;
+	stream_stats.samples += n;
+	stream_stats.bursts++;
+	stream_state = STREAM_IDLE;
+
+	/* Si des échantillons se sont accumulés pendant la rafale, on enchaîne */
+	if(pending_head - pending_tail >= MPU6050_STREAM_BLOCK_SAMPLES)
+		MPU6050_stream_launch();
+}
+
+static void MPU6050_stream_reset_done(HAL_StatusTypeDef status)
+{
+	if(status != HAL_OK)
+		stream_stats.bus_errors++;
+	stream_stats.dropped += pending_head - pending_tail;
+	pending_tail = pending_head;
+	stream_state = STREAM_IDLE;
+}
+
 /**
  * @brief Fonction de démo pour prendre en main le capteur rapidement.
  * @pre /!\ Cette fonction est blocante /!\
+ * @note Le capteur est utilisé en mode streaming à 1kHz : sa broche INT doit être reliée à PA1.
+ * 		 Le CPU ne fait qu'accumuler les échantillons, toutes les 500ms on affiche la moyenne du dernier bloc.
  */
 void MPU6050_demo(void){
 
 	MPU6050_t MPU6050_Data;
+	MPU6050_Sample_t samples[64];
+	MPU6050_StreamStats_t stats;
+	int32_t acc[3] = {0};
+	int32_t gyro[3] = {0};
 	int32_t gyro_x = 0;
 	int32_t gyro_y = 0;
 	int32_t gyro_z = 0;
+	uint32_t nb = 0;
+	uint32_t tlast = 0;
 
 	/* Initialise le MPU6050 */
 	if (MPU6050_Init(&MPU6050_Data, GPIOA, GPIO_PIN_0, MPU6050_Device_0, MPU6050_Accelerometer_8G, MPU6050_Gyroscope_2000s) != MPU6050_Result_Ok) {
@@ -251,45 +545,50 @@ void MPU6050_demo(void){
 		// Boucle infinie
 		while (1);
 	}
+	if (MPU6050_StreamStart(&MPU6050_Data, 1000, GPIOA, GPIO_PIN_1) != MPU6050_Result_Ok) {
+		printf("MPU6050 Stream Error\n");
+		while (1);
+	}
 	while (1) {
-		// On
-		MPU6050_ReadAll(&MPU6050_Data);
-
-		gyro_x += MPU6050_Data.Gyroscope_X;
-		gyro_y += MPU6050_Data.Gyroscope_Y;
-		gyro_z += MPU6050_Data.Gyroscope_Z;
-		/*
-		// Affiche avec le debug_printf
-		debug_printf("AX%4d\tAY%4d\tAZ%4d\tGX%4d\tGY%4d\tGZ%4d\tgx%4ld\tgy%4ld\tgz%4ld\tT%3.1f\n",
-						MPU6050_Data.Accelerometer_X/410,	//environ en %
-						MPU6050_Data.Accelerometer_Y/410,	//environ en %
-						MPU6050_Data.Accelerometer_Z/410,	//environ en %
-						MPU6050_Data.Gyroscope_X,
-						MPU6050_Data.Gyroscope_Y,
-						MPU6050_Data.Gyroscope_Z,
-						gyro_x/16400,						//environ en °
-						gyro_y/16400,						//environ en °
-						gyro_z/16400,						//environ en °
-						MPU6050_Data.Temperature);
-
-		*/
-		 // Affiche avec l'UART
-		 printf("AX%4d\tAY%4d\tAZ%4d\tGX%4d\tGY%4d\tGZ%4d\tgx%4ld\tgy%4ld\tgz%4ld\tT%3d\n",
-					    (uint16_t)MPU6050_Data.Accelerometer_X/410,	//environ en %
-					    (uint16_t)MPU6050_Data.Accelerometer_Y/410,	//environ en %
-					    (uint16_t)MPU6050_Data.Accelerometer_Z/410,	//environ en %
-					    (uint16_t)MPU6050_Data.Gyroscope_X,
-					    (uint16_t)MPU6050_Data.Gyroscope_Y,
-					    (uint16_t)MPU6050_Data.Gyroscope_Z,
-						(uint32_t)gyro_x/16400,						//environ en °
-						(uint32_t)gyro_y/16400,						//environ en °
-						(uint32_t)gyro_z/16400,						//environ en °
-						(uint16_t)MPU6050_Data.Temperature);
-
-
-
-		// Un petit délai pour éviter d'avoir un raz-de-marée d'information
-		HAL_Delay(500);
+		// On vide le buffer circulaire par paquets : la lecture du capteur se fait en tâche de fond
+		uint16_t n = MPU6050_StreamRead(samples, 64);
+		for(uint16_t i = 0; i < n; i++)
+		{
+			for(uint8_t axis = 0; axis < 3; axis++)
+			{
+				acc[axis] += samples[i].accel[axis];
+				gyro[axis] += samples[i].gyro[axis];
+			}
+			gyro_x += samples[i].gyro[0];
+			gyro_y += samples[i].gyro[1];
+			gyro_z += samples[i].gyro[2];
+		}
+		nb += n;
+
+		// Affichage toutes les 500ms, pour éviter d'avoir un raz-de-marée d'information
+		if(HAL_GetTick() - tlast >= 500 && nb > 0)
+		{
+			tlast = HAL_GetTick();
+			MPU6050_StreamGetStats(&stats);
+			printf("AX%4ld\tAY%4ld\tAZ%4ld\tGX%4ld\tGY%4ld\tGZ%4ld\tgx%4ld\tgy%4ld\tgz%4ld\tn%4lu\tlost%lu\n",
+					acc[0] / (int32_t)nb / 41,		//environ en % (8G)
+					acc[1] / (int32_t)nb / 41,
+					acc[2] / (int32_t)nb / 41,
+					gyro[0] / (int32_t)nb,
+					gyro[1] / (int32_t)nb,
+					gyro[2] / (int32_t)nb,
+					gyro_x / 16400,					//en ° : 16,4 LSB/(°/s) et 1000 échantillons par seconde
+					gyro_y / 16400,
+					gyro_z / 16400,
+					nb,
+					stats.dropped);
+			for(uint8_t axis = 0; axis < 3; axis++)
+			{
+				acc[axis] = 0;
+				gyro[axis] = 0;
+			}
+			nb = 0;
+		}
 	}
 }
 
@@ -57,6 +57,7 @@
 #define MPU6050_GYRO_CONFIG			0x1B
 #define MPU6050_ACCEL_CONFIG		0x1C
 #define MPU6050_MOTION_THRESH		0x1F
+#define MPU6050_FIFO_EN				0x23
 #define MPU6050_INT_PIN_CFG			0x37
 #define MPU6050_INT_ENABLE			0x38
 #define MPU6050_INT_STATUS			0x3A
@@ -85,6 +86,35 @@
 #define MPU6050_FIFO_R_W			0x74
 #define MPU6050_WHO_AM_I			0x75
 
+/* Bits des registres de configuration de la FIFO et des interruptions */
+#define MPU6050_FIFO_EN_ACCEL_GYRO	0x78	/*!< XG_FIFO_EN | YG_FIFO_EN | ZG_FIFO_EN | ACCEL_FIFO_EN */
+#define MPU6050_USER_CTRL_FIFO_EN	0x40
+#define MPU6050_USER_CTRL_FIFO_RST	0x04
+#define MPU6050_INT_CFG_RD_CLEAR	0x10	/*!< Toute lecture acquitte l'interruption */
+#define MPU6050_INT_DATA_RDY_EN		0x01
+#define MPU6050_CONFIG_DLPF_188HZ	0x01	/*!< Filtre passe-bas actif : fréquence interne de 1kHz */
+
+/* Taille de la FIFO interne et d'un échantillon accéléro + gyro (sans température) */
+#define MPU6050_FIFO_SIZE			1024
+#define MPU6050_FIFO_SAMPLE_SIZE	12
+
+/* Mode streaming : nombre d'échantillons du buffer circulaire (puissance de 2) */
+#ifndef MPU6050_STREAM_RING_SIZE
+	#define MPU6050_STREAM_RING_SIZE	256
+#endif
+
+/* Mode streaming : nombre d'échantillons accumulés dans la FIFO avant de déclencher une lecture en rafale */
+#ifndef MPU6050_STREAM_BLOCK_SAMPLES
+	#define MPU6050_STREAM_BLOCK_SAMPLES	8
+#endif
+
+/* Mode streaming : nombre maximal d'échantillons lus en une seule rafale */
+#define MPU6050_STREAM_BURST_MAX	32
+
+/* Conversion de la température brute : T = raw / 340 + 36.53 (la division est remplacée par une multiplication) */
+#define MPU6050_TEMP_MULT			((float) (1.0 / 340.0))
+#define MPU6050_TEMP_OFFSET			((float) 36.53)
+
 /* Sensibilités du gyroscope en °/s */
 #define MPU6050_GYRO_SENS_250		((float) 131)
 #define MPU6050_GYRO_SENS_500		((float) 65.5)
@@ -149,6 +179,21 @@ typedef struct {
 	float Temperature;       /*!< Température en degrés */
 } MPU6050_t;
 
+/* Échantillon brut produit par le mode streaming */
+typedef struct {
+	uint32_t timestamp_us;   /*!< Instant de l'interruption "data ready" correspondant à l'échantillon (cf BSP_systick_get_time_us) */
+	int16_t accel[3];        /*!< Accéléromètre X, Y, Z (brut) */
+	int16_t gyro[3];         /*!< Gyroscope X, Y, Z (brut) */
+} MPU6050_Sample_t;
+
+/* Statistiques du mode streaming */
+typedef struct {
+	uint32_t samples;        /*!< Nombre d'échantillons lus dans la FIFO */
+	uint32_t bursts;         /*!< Nombre de lectures en rafale */
+	uint32_t dropped;        /*!< Échantillons perdus (buffer circulaire plein ou FIFO du capteur débordée) */
+	uint32_t bus_errors;     /*!< Transferts I2C en erreur */
+} MPU6050_StreamStats_t;
+
 
 /**
  * @defgroup MPU6050_Functions
@@ -215,6 +260,39 @@ MPU6050_Result_t MPU6050_ReadTemperature(MPU6050_t* DataStruct);
  */
 MPU6050_Result_t MPU6050_ReadAll(MPU6050_t* DataStruct);
 
+/**
+ * @brief  Starts streaming mode: the sensor FIFO is filled at sample_rate_hz, the INT pin triggers
+ *         burst reads of whole FIFO blocks over asynchronous I2C, and samples are timestamped and stored in a ring
+ * @param  *DataStruct: Pointer to @ref MPU6050_t structure initialized by @ref MPU6050_Init
+ * @param  sample_rate_hz: Sample rate, from 4 to 1000 Hz
+ * @param  GPIOx, GPIO_PIN_x: Pin wired to the INT output of the sensor
+ * @retval Member of @ref MPU6050_Result_t
+ */
+MPU6050_Result_t MPU6050_StreamStart(MPU6050_t* DataStruct, uint16_t sample_rate_hz, GPIO_TypeDef * GPIOx, uint16_t GPIO_PIN_x);
+
+/**
+ * @brief  Stops streaming mode (FIFO and data ready interrupt are disabled)
+ */
+void MPU6050_StreamStop(void);
+
+/**
+ * @brief  Drains up to max samples from the streaming ring
+ * @param  *samples: Destination array
+ * @param  max: Size of the destination array
+ * @retval Number of samples copied
+ */
+uint16_t MPU6050_StreamRead(MPU6050_Sample_t* samples, uint16_t max);
+
+/**
+ * @brief  Number of samples waiting in the streaming ring
+ */
+uint16_t MPU6050_StreamAvailable(void);
+
+/**
+ * @brief  Returns a copy of the streaming statistics
+ */
+void MPU6050_StreamGetStats(MPU6050_StreamStats_t* stats);
+
 
 #endif /* BSP_MPU6050_STM32G4_MPU6050_H_ */
 #endif
@@ -0,0 +1,291 @@
+/**
+ *******************************************************************************
+ * @file 	stm32g4_mpu6050_attitude.c
+ * @author 	DEEP Project
+ * @date 	Oct 17, 2026
+ * @brief	Estimation d'attitude à partir des échantillons bruts du MPU6050 (cf MPU6050_StreamRead).
+ *
+ * 			Deux filtres sont proposés :
+ * 			- un filtre complémentaire (roulis et tangage uniquement),
+ * 			- un filtre de Mahony, qui maintient un quaternion d'orientation.
+ *
+ * 			Les calculs sont faits en flottant simple précision : sur Cortex-M4F, chaque opération est une instruction FPU
+ * 			(VSQRT et VDIV : 14 cycles). Aucune fonction de la libm n'est appelée dans la boucle, le coût d'une mise à jour
+ * 			est donc fixe : ~150 cycles pour le filtre complémentaire, ~200 cycles pour Mahony, soit moins de 0,15% du CPU
+ * 			à 1kHz et 170MHz. Le coût réellement mesuré (compteur DWT) est disponible dans cycles_per_sample.
+ *
+ * 			Le biais du gyroscope est ré-estimé automatiquement à chaque fois que le capteur reste immobile
+ * 			pendant ATTITUDE_REST_SAMPLES échantillons.
+ *
+ * 			Test sur PC (test/attitude_replay.c, "make test" dans test/) : rejeu de journaux IMU et comparaison
+ * 			à une référence en double précision.
+ *******************************************************************************
+ */
+#include "config.h"
+#if USE_MPU6050
+
+#include "stm32g4_mpu6050_attitude.h"
+#include <math.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DEG_TO_RAD			0.017453293f
+#define PI_F				3.14159265f
+#define HALF_PI_F			1.57079633f
+
+#if (ATTITUDE_REST_SAMPLES & (ATTITUDE_REST_SAMPLES - 1)) != 0
+	#error "ATTITUDE_REST_SAMPLES doit être une puissance de 2"
+#endif
+
+/* Private functions declarations --------------------------------------------*/
+static float ATTITUDE_get_dt(ATTITUDE_t* att, uint32_t timestamp_us);
+static void ATTITUDE_track_rest(ATTITUDE_t* att, const MPU6050_Sample_t* s, float accel_norm2_g);
+static void ATTITUDE_update_complementary(ATTITUDE_t* att, const MPU6050_Sample_t* s, float dt);
+static void ATTITUDE_update_mahony(ATTITUDE_t* att, const MPU6050_Sample_t* s, float dt);
+
+/* Public functions definitions ----------------------------------------------*/
+/**
+ * @brief	Initialise l'estimateur d'attitude
+ * @param	att : structure d'état de l'estimateur
+ * @param	filter : filtre utilisé
+ * @param	imu : structure du capteur, initialisée par MPU6050_Init (pour les sensibilités)
+ * @param	sample_rate_hz : fréquence d'échantillonnage nominale, utilisée si les horodatages sont inexploitables
+ */
+void ATTITUDE_Init(ATTITUDE_t* att, ATTITUDE_Filter_t filter, const MPU6050_t* imu, uint16_t sample_rate_hz)
+{
+	memset(att, 0, sizeof(ATTITUDE_t));
+	att->filter = filter;
+	att->gyro_scale = imu->Gyro_Mult * DEG_TO_RAD;
+	att->accel_scale = imu->Acce_Mult;
+	att->dt_nominal = 1.0f / (float)sample_rate_hz;
+	att->kp = ATTITUDE_MAHONY_KP;
+	att->ki = ATTITUDE_MAHONY_KI;
+	att->alpha = ATTITUDE_COMPLEMENTARY_ALPHA;
+	att->rest_thresh = (int16_t)(ATTITUDE_REST_GYRO_DPS / imu->Gyro_Mult);
+	att->q[0] = 1.0f;
+
+	/* Compteur de cycles du coeur, pour mesurer le coût des mises à jour */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * @brief	Traite un lot d'échantillons (typiquement ceux récupérés par MPU6050_StreamRead)
+ * @param	att : structure d'état de l'estimateur
+ * @param	samples : échantillons, du plus ancien au plus récent
+ * @param	n : nombre d'échantillons
+ */
+void ATTITUDE_UpdateBatch(ATTITUDE_t* att, const MPU6050_Sample_t* samples, uint16_t n)
+{
+	uint32_t start;
+	uint32_t t;
+	uint32_t total = 0;
+	for(uint16_t i = 0; i < n; i++)
+	{
+		const MPU6050_Sample_t * s = &samples[i];
+		start = DWT->CYCCNT;
+		float dt = ATTITUDE_get_dt(att, s->timestamp_us);
+		if(att->filter == ATTITUDE_MAHONY)
+			ATTITUDE_update_mahony(att, s, dt);
+		else
+			ATTITUDE_update_complementary(att, s, dt);
+		t = DWT->CYCCNT - start;
+		total += t;
+		if(t > att->cycles_per_sample_max)
+			att->cycles_per_sample_max = t;
+	}
+	if(n)
+		att->cycles_per_sample = total / n;
+}
+
+/**
+ * @brief	Renvoie le roulis, le tangage et le lacet en radians
+ * @note	Le lacet n'est disponible qu'avec le filtre de Mahony (il dérive, faute de magnétomètre). Il vaut 0 sinon.
+ */
+void ATTITUDE_GetEuler(const ATTITUDE_t* att, float* roll, float* pitch, float* yaw)
+{
+	if(att->filter == ATTITUDE_MAHONY)
+	{
+		float w = att->q[0], x = att->q[1], y = att->q[2], z = att->q[3];
+		float sinp = 2.0f * (w * y - z * x);
+		if(sinp > 1.0f)
+			sinp = 1.0f;
+		else if(sinp < -1.0f)
+			sinp = -1.0f;
+		*roll = ATTITUDE_atan2f(2.0f * (w * x + y * z), 1.0f - 2.0f * (x * x + y * y));
+		*pitch = ATTITUDE_atan2f(sinp, sqrtf(1.0f - sinp * sinp));
+		*yaw = ATTITUDE_atan2f(2.0f * (w * z + x * y), 1.0f - 2.0f * (y * y + z * z));
+	}
+	else
+	{
+		*roll = att->roll;
+		*pitch = att->pitch;
+		*yaw = 0.0f;
+	}
+}
+
+/**
+ * @brief	Approximation rapide de atan2 (polynôme de degré 9, erreur max 2e-5 rad), à coût constant
+ */
+float ATTITUDE_atan2f(float y, float x)
+{
+	float ax = fabsf(x);
+	float ay = fabsf(y);
+	float mx = (ax > ay) ? ax : ay;
+	float mn = (ax > ay) ? ay : ax;
+	float a, s, r;
+	if(mx == 0.0f)
+		return 0.0f;
+	a = mn / mx;
+	s = a * a;
+	r = ((((0.0208351f * s - 0.0851330f) * s + 0.1801410f) * s - 0.3302995f) * s + 0.9998660f) * a;
+	if(ay > ax)
+		r = HALF_PI_F - r;
+	if(x < 0.0f)
+		r = PI_F - r;
+	if(y < 0.0f)
+		r = -r;
+	return r;
+}
+
+/* Private functions definitions ---------------------------------------------*/
+/**
+ * @brief	Période écoulée depuis l'échantillon précédent, d'après les horodatages
+ * 			(on revient à la période nominale au premier échantillon ou en cas de trou de plus de 4 périodes)
+ */
+static float ATTITUDE_get_dt(ATTITUDE_t* att, uint32_t timestamp_us)
+{
+	float dt = att->dt_nominal;
+	if(att->has_last_ts)
+	{
+		uint32_t delta = timestamp_us - att->last_ts;
+		float measured = (float)delta * 1e-6f;
+		if(delta != 0 && measured < 4.0f * att->dt_nominal)
+			dt = measured;
+	}
+	att->last_ts = timestamp_us;
+	att->has_last_ts = true;
+	return dt;
+}
+
+/**
+ * @brief	Détection d'immobilité et estimation du biais du gyroscope
+ *
+ * Le capteur est considéré immobile si la norme de l'accélération vaut 1g (à ATTITUDE_REST_ACCEL_TOL près)
+ * et que le gyroscope ne s'écarte pas de plus de ATTITUDE_REST_GYRO_DPS de sa valeur en début de fenêtre.
+ * Le biais est alors la moyenne du gyroscope sur la fenêtre.
+ */
+static void ATTITUDE_track_rest(ATTITUDE_t* att, const MPU6050_Sample_t* s, float accel_norm2_g)
+{
+	bool still = fabsf(accel_norm2_g - 1.0f) < 2.0f * ATTITUDE_REST_ACCEL_TOL;
+	if(att->rest_count == 0)
+	{
+		for(uint8_t i = 0; i < 3; i++)
+		{
+			att->rest_ref[i] = s->gyro[i];
+			att->rest_sum[i] = 0;
+		}
+	}
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		int32_t diff = (int32_t)s->gyro[i] - att->rest_ref[i];
+		if(diff > att->rest_thresh || diff < -att->rest_thresh)
+			still = false;
+	}
+	if(!still)
+	{
+		att->rest_count = 0;
+		return;
+	}
+	for(uint8_t i = 0; i < 3; i++)
+		att->rest_sum[i] += s->gyro[i];
+	att->rest_count++;
+	if(att->rest_count == ATTITUDE_REST_SAMPLES)
+	{
+		for(uint8_t i = 0; i < 3; i++)
+			att->gyro_bias[i] = (int16_t)(att->rest_sum[i] / ATTITUDE_REST_SAMPLES);
+		att->bias_valid = true;
+		att->rest_count = 0;
+	}
+}
+
+static void ATTITUDE_update_complementary(ATTITUDE_t* att, const MPU6050_Sample_t* s, float dt)
+{
+	float ax = (float)s->accel[0];
+	float ay = (float)s->accel[1];
+	float az = (float)s->accel[2];
+	float gx = (float)(s->gyro[0] - att->gyro_bias[0]) * att->gyro_scale;
+	float gy = (float)(s->gyro[1] - att->gyro_bias[1]) * att->gyro_scale;
+	float ayz2 = ay * ay + az * az;
+	float scale2 = att->accel_scale * att->accel_scale;
+
+	ATTITUDE_track_rest(att, s, (ax * ax + ayz2) * scale2);
+
+	float roll_acc = ATTITUDE_atan2f(ay, az);
+	float pitch_acc = ATTITUDE_atan2f(-ax, sqrtf(ayz2));
+	att->roll = att->alpha * (att->roll + gx * dt) + (1.0f - att->alpha) * roll_acc;
+	att->pitch = att->alpha * (att->pitch + gy * dt) + (1.0f - att->alpha) * pitch_acc;
+}
+
+static void ATTITUDE_update_mahony(ATTITUDE_t* att, const MPU6050_Sample_t* s, float dt)
+{
+	float q0 = att->q[0], q1 = att->q[1], q2 = att->q[2], q3 = att->q[3];
+	float ax = (float)s->accel[0];
+	float ay = (float)s->accel[1];
+	float az = (float)s->accel[2];
+	float gx = (float)(s->gyro[0] - att->gyro_bias[0]) * att->gyro_scale;
+	float gy = (float)(s->gyro[1] - att->gyro_bias[1]) * att->gyro_scale;
+	float gz = (float)(s->gyro[2] - att->gyro_bias[2]) * att->gyro_scale;
+	float norm2 = ax * ax + ay * ay + az * az;
+
+	ATTITUDE_track_rest(att, s, norm2 * att->accel_scale * att->accel_scale);
+
+	if(norm2 > 0.0f)
+	{
+		float recip_norm = 1.0f / sqrtf(norm2);
+		ax *= recip_norm;
+		ay *= recip_norm;
+		az *= recip_norm;
+
+		/* Direction estimée de la gravité (moitié) */
+		float vx = q1 * q3 - q0 * q2;
+		float vy = q0 * q1 + q2 * q3;
+		float vz = q0 * q0 - 0.5f + q3 * q3;
+
+		/* Erreur : produit vectoriel entre gravité mesurée et estimée */
+		float ex = ay * vz - az * vy;
+		float ey = az * vx - ax * vz;
+		float ez = ax * vy - ay * vx;
+
+		if(att->ki > 0.0f)
+		{
+			att->integral[0] += 2.0f * att->ki * ex * dt;
+			att->integral[1] += 2.0f * att->ki * ey * dt;
+			att->integral[2] += 2.0f * att->ki * ez * dt;
+			gx += att->integral[0];
+			gy += att->integral[1];
+			gz += att->integral[2];
+		}
+		gx += 2.0f * att->kp * ex;
+		gy += 2.0f * att->kp * ey;
+		gz += 2.0f * att->kp * ez;
+	}
+
+	/* Intégration de la dérivée du quaternion */
+	gx *= 0.5f * dt;
+	gy *= 0.5f * dt;
+	gz *= 0.5f * dt;
+	float qa = q0, qb = q1, qc = q2;
+	q0 += -qb * gx - qc * gy - q3 * gz;
+	q1 += qa * gx + qc * gz - q3 * gy;
+	q2 += qa * gy - qb * gz + q3 * gx;
+	q3 += qa * gz + qb * gy - qc * gx;
+
+	float recip_norm = 1.0f / sqrtf(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+	att->q[0] = q0 * recip_norm;
+	att->q[1] = q1 * recip_norm;
+	att->q[2] = q2 * recip_norm;
+	att->q[3] = q3 * recip_norm;
+}
+
+#endif
@@ -0,0 +1,96 @@
+/**
+ *******************************************************************************
+ * @file 	stm32g4_mpu6050_attitude.h
+ * @author 	DEEP Project
+ * @date 	Oct 17, 2026
+ * @brief	Estimation d'attitude (roulis, tangage, quaternion) à partir des échantillons du MPU6050.
+ *******************************************************************************
+ */
+
+#ifndef BSP_MPU6050_STM32G4_MPU6050_ATTITUDE_H_
+#define BSP_MPU6050_STM32G4_MPU6050_ATTITUDE_H_
+#include "config.h"
+#if USE_MPU6050
+
+#include "stm32g4_mpu6050.h"
+
+/* Exported macros -----------------------------------------------------------*/
+/* Gains par défaut du filtre de Mahony */
+#ifndef ATTITUDE_MAHONY_KP
+	#define ATTITUDE_MAHONY_KP			1.0f
+#endif
+#ifndef ATTITUDE_MAHONY_KI
+	#define ATTITUDE_MAHONY_KI			0.0f
+#endif
+
+/* Coefficient par défaut du filtre complémentaire (part du gyroscope) */
+#ifndef ATTITUDE_COMPLEMENTARY_ALPHA
+	#define ATTITUDE_COMPLEMENTARY_ALPHA	0.98f
+#endif
+
+/* Détection d'immobilité pour l'estimation du biais du gyroscope */
+#define ATTITUDE_REST_GYRO_DPS		3.0f	/*!< Variation maximale du gyroscope (°/s) */
+#define ATTITUDE_REST_ACCEL_TOL		0.1f	/*!< Écart maximal de la norme de l'accélération à 1g */
+#define ATTITUDE_REST_SAMPLES		256		/*!< Nombre d'échantillons immobiles consécutifs avant mise à jour du biais (puissance de 2) */
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+	ATTITUDE_COMPLEMENTARY = 0,	/*!< Roulis/tangage : intégration du gyroscope recalée par l'accéléromètre */
+	ATTITUDE_MAHONY				/*!< Quaternion : filtre de Mahony (correction PI de l'erreur de gravité) */
+} ATTITUDE_Filter_t;
+
+typedef struct {
+	/* Privé */
+	ATTITUDE_Filter_t filter;
+	float gyro_scale;        /*!< rad/s par LSB */
+	float accel_scale;       /*!< g par LSB */
+	float dt_nominal;        /*!< Période d'échantillonnage nominale (s) */
+	float kp;
+	float ki;
+	float alpha;
+	float integral[3];
+	uint32_t last_ts;
+	bool has_last_ts;
+	int16_t rest_ref[3];
+	int32_t rest_sum[3];
+	uint16_t rest_count;
+	int16_t rest_thresh;     /*!< ATTITUDE_REST_GYRO_DPS converti en LSB */
+	/* Public */
+	float q[4];              /*!< Quaternion (w, x, y, z) - filtre de Mahony */
+	float roll;              /*!< Roulis (rad) - filtre complémentaire */
+	float pitch;             /*!< Tangage (rad) - filtre complémentaire */
+	int16_t gyro_bias[3];    /*!< Biais du gyroscope estimé au repos (LSB) */
+	bool bias_valid;         /*!< Au moins une estimation du biais a été faite */
+	uint32_t cycles_per_sample;     /*!< Coût moyen d'une mise à jour lors du dernier lot (cycles CPU) */
+	uint32_t cycles_per_sample_max; /*!< Coût maximal observé d'une mise à jour (cycles CPU) */
+} ATTITUDE_t;
+
+/**
+ * @brief  Initializes the attitude estimator
+ * @param  *att: Estimator state
+ * @param  filter: Filter used, value of @ref ATTITUDE_Filter_t
+ * @param  *imu: Sensor structure initialized by @ref MPU6050_Init (used for the sensitivities)
+ * @param  sample_rate_hz: Nominal sample rate, used when consecutive timestamps are unusable
+ */
+void ATTITUDE_Init(ATTITUDE_t* att, ATTITUDE_Filter_t filter, const MPU6050_t* imu, uint16_t sample_rate_hz);
+
+/**
+ * @brief  Feeds a batch of samples (typically drained with @ref MPU6050_StreamRead)
+ * @param  *att: Estimator state
+ * @param  *samples: Samples, oldest first
+ * @param  n: Number of samples
+ */
+void ATTITUDE_UpdateBatch(ATTITUDE_t* att, const MPU6050_Sample_t* samples, uint16_t n);
+
+/**
+ * @brief  Returns roll, pitch and yaw in radians (yaw is only available with the Mahony filter, 0 otherwise)
+ */
+void ATTITUDE_GetEuler(const ATTITUDE_t* att, float* roll, float* pitch, float* yaw);
+
+/**
+ * @brief  Fast atan2 approximation (max error 2e-5 rad), constant cost
+ */
+float ATTITUDE_atan2f(float y, float x);
+
+#endif
+#endif /* BSP_MPU6050_STM32G4_MPU6050_ATTITUDE_H_ */
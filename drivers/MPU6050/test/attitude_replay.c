@@ -0,0 +1,319 @@
+/**
+ *******************************************************************************
+ * @file 	attitude_replay.c
+ * @author 	DEEP Project
+ * @date 	Oct 17, 2026
+ * @brief	Test sur PC du module d'attitude : rejeu de journaux IMU et comparaison à une référence en double précision.
+ *******************************************************************************
+ * Chaque journal (format décrit dans imu_log_gen.py : un MPU6050_Sample_t brut par ligne) est rejoué par lots de
+ * MPU6050_STREAM_BLOCK_SAMPLES dans stm32g4_mpu6050_attitude.c (flottants simple précision, atan2 approché),
+ * et échantillon par échantillon dans une copie des mêmes filtres en double précision (atan2 de la libm).
+ * L'écart angulaire entre les deux est mesuré pour les deux filtres :
+ * 	- filtre complémentaire : roulis et tangage,
+ * 	- filtre de Mahony : angle de la rotation entre les deux quaternions (pas d'angles d'Euler, singuliers à 90°).
+ * Le test échoue si l'écart maximal dépasse --max-error-deg, ou si le biais du gyroscope estimé diffère.
+ *
+ * Usage : attitude_replay [--max-error-deg 0.1] journal.csv...
+ */
+#include "stm32g4_mpu6050_attitude.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REPLAY_MAX_SAMPLES		200000
+#define RAD_TO_DEG				57.29577951308232
+
+CoreDebug_Type host_core_debug;
+DWT_Type host_dwt;
+
+/* Référence en double précision : mêmes équations que stm32g4_mpu6050_attitude.c */
+typedef struct {
+	ATTITUDE_Filter_t filter;
+	double gyro_scale;
+	double accel_scale;
+	double dt_nominal;
+	double q[4];
+	double integral[3];
+	double roll;
+	double pitch;
+	uint32_t last_ts;
+	bool has_last_ts;
+	int16_t rest_ref[3];
+	int32_t rest_sum[3];
+	uint16_t rest_count;
+	int16_t rest_thresh;
+	int16_t gyro_bias[3];
+} reference_t;
+
+typedef struct {
+	double max_deg;
+	double sum2;
+	uint32_t n;
+} error_t;
+
+static MPU6050_Sample_t samples[REPLAY_MAX_SAMPLES];
+
+static void reference_init(reference_t* ref, ATTITUDE_Filter_t filter, const MPU6050_t* imu, uint16_t rate_hz)
+{
+	memset(ref, 0, sizeof(*ref));
+	ref->filter = filter;
+	ref->gyro_scale = (double)imu->Gyro_Mult * M_PI / 180.0;
+	ref->accel_scale = imu->Acce_Mult;
+	ref->dt_nominal = 1.0 / rate_hz;
+	ref->rest_thresh = (int16_t)(ATTITUDE_REST_GYRO_DPS / imu->Gyro_Mult);
+	ref->q[0] = 1.0;
+}
+
+static double reference_dt(reference_t* ref, uint32_t ts)
+{
+	double dt = ref->dt_nominal;
+	if(ref->has_last_ts)
+	{
+		uint32_t delta = ts - ref->last_ts;
+		double measured = delta * 1e-6;
+		if(delta != 0 && measured < 4.0 * ref->dt_nominal)
+			dt = measured;
+	}
+	ref->last_ts = ts;
+	ref->has_last_ts = true;
+	return dt;
+}
+
+static void reference_track_rest(reference_t* ref, const MPU6050_Sample_t* s, double accel_norm2_g)
+{
+	bool still = fabs(accel_norm2_g - 1.0) < 2.0 * ATTITUDE_REST_ACCEL_TOL;
+	if(ref->rest_count == 0)
+		for(int i = 0; i < 3; i++)
+		{
+			ref->rest_ref[i] = s->gyro[i];
+			ref->rest_sum[i] = 0;
+		}
+	for(int i = 0; i < 3; i++)
+	{
+		int32_t diff = (int32_t)s->gyro[i] - ref->rest_ref[i];
+		if(diff > ref->rest_thresh || diff < -ref->rest_thresh)
+			still = false;
+	}
+	if(!still)
+	{
+		ref->rest_count = 0;
+		return;
+	}
+	for(int i = 0; i < 3; i++)
+		ref->rest_sum[i] += s->gyro[i];
+	if(++ref->rest_count == ATTITUDE_REST_SAMPLES)
+	{
+		for(int i = 0; i < 3; i++)
+			ref->gyro_bias[i] = (int16_t)(ref->rest_sum[i] / ATTITUDE_REST_SAMPLES);
+		ref->rest_count = 0;
+	}
+}
+
+static void reference_update(reference_t* ref, const MPU6050_Sample_t* s)
+{
+	double dt = reference_dt(ref, s->timestamp_us);
+	double ax = s->accel[0], ay = s->accel[1], az = s->accel[2];
+	double g[3];
+	for(int i = 0; i < 3; i++)
+		g[i] = (s->gyro[i] - ref->gyro_bias[i]) * ref->gyro_scale;
+	double norm2 = ax * ax + ay * ay + az * az;
+
+	reference_track_rest(ref, s, norm2 * ref->accel_scale * ref->accel_scale);
+
+	if(ref->filter == ATTITUDE_COMPLEMENTARY)
+	{
+		double alpha = ATTITUDE_COMPLEMENTARY_ALPHA;
+		ref->roll = alpha * (ref->roll + g[0] * dt) + (1.0 - alpha) * atan2(ay, az);
+		ref->pitch = alpha * (ref->pitch + g[1] * dt) + (1.0 - alpha) * atan2(-ax, sqrt(ay * ay + az * az));
+		return;
+	}
+
+	double* q = ref->q;
+	if(norm2 > 0.0)
+	{
+		double r = 1.0 / sqrt(norm2);
+		ax *= r;
+		ay *= r;
+		az *= r;
+		double vx = q[1] * q[3] - q[0] * q[2];
+		double vy = q[0] * q[1] + q[2] * q[3];
+		double vz = q[0] * q[0] - 0.5 + q[3] * q[3];
+		double e[3] = {ay * vz - az * vy, az * vx - ax * vz, ax * vy - ay * vx};
+		for(int i = 0; i < 3; i++)
+		{
+			if(ATTITUDE_MAHONY_KI > 0.0f)
+			{
+				ref->integral[i] += 2.0 * ATTITUDE_MAHONY_KI * e[i] * dt;
+				g[i] += ref->integral[i];
+			}
+			g[i] += 2.0 * ATTITUDE_MAHONY_KP * e[i];
+		}
+	}
+	for(int i = 0; i < 3; i++)
+		g[i] *= 0.5 * dt;
+	double q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+	q[0] = q0 - q1 * g[0] - q2 * g[1] - q3 * g[2];
+	q[1] = q1 + q0 * g[0] + q2 * g[2] - q3 * g[1];
+	q[2] = q2 + q0 * g[1] - q1 * g[2] + q3 * g[0];
+	q[3] = q3 + q0 * g[2] + q1 * g[1] - q2 * g[0];
+	double r = 1.0 / sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+	for(int i = 0; i < 4; i++)
+		q[i] *= r;
+}
+
+static void error_add(error_t* e, double rad)
+{
+	double deg = fabs(rad) * RAD_TO_DEG;
+	if(deg > e->max_deg)
+		e->max_deg = deg;
+	e->sum2 += deg * deg;
+	e->n++;
+}
+
+static double wrap(double rad)
+{
+	return remainder(rad, 2.0 * M_PI);
+}
+
+/*
+ * @brief	Lit un journal : première ligne "# accel_g=.. gyro_dps=.. rate_hz=..", puis timestamp_us,ax,ay,az,gx,gy,gz
+ * @return	le nombre d'échantillons lus, 0 en cas d'erreur
+ */
+static uint32_t load_log(const char* path, MPU6050_t* imu, uint16_t* rate_hz)
+{
+	static const struct { int g; float sens; } accel[] = {
+		{2, MPU6050_ACCE_SENS_2}, {4, MPU6050_ACCE_SENS_4}, {8, MPU6050_ACCE_SENS_8}, {16, MPU6050_ACCE_SENS_16}};
+	static const struct { int dps; float sens; } gyro[] = {
+		{250, MPU6050_GYRO_SENS_250}, {500, MPU6050_GYRO_SENS_500}, {1000, MPU6050_GYRO_SENS_1000}, {2000, MPU6050_GYRO_SENS_2000}};
+	char line[256];
+	int accel_g, gyro_dps, rate;
+	uint32_t n = 0;
+	FILE* f = fopen(path, "r");
+	if(f == NULL)
+	{
+		perror(path);
+		return 0;
+	}
+	if(fgets(line, sizeof(line), f) == NULL
+			|| sscanf(line, "# accel_g=%d gyro_dps=%d rate_hz=%d", &accel_g, &gyro_dps, &rate) != 3)
+	{
+		fprintf(stderr, "%s : en-tête attendu \"# accel_g=.. gyro_dps=.. rate_hz=..\"\n", path);
+		fclose(f);
+		return 0;
+	}
+	memset(imu, 0, sizeof(*imu));
+	for(unsigned i = 0; i < 4; i++)
+	{
+		if(accel[i].g == accel_g)
+			imu->Acce_Mult = (float)1 / accel[i].sens;
+		if(gyro[i].dps == gyro_dps)
+			imu->Gyro_Mult = (float)1 / gyro[i].sens;
+	}
+	if(imu->Acce_Mult == 0.0f || imu->Gyro_Mult == 0.0f || rate < 4 || rate > 1000)
+	{
+		fprintf(stderr, "%s : plage ou fréquence invalide\n", path);
+		fclose(f);
+		return 0;
+	}
+	*rate_hz = (uint16_t)rate;
+	while(fgets(line, sizeof(line), f) != NULL && n < REPLAY_MAX_SAMPLES)
+	{
+		unsigned long ts;
+		int v[6];
+		if(line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+			continue;
+		if(sscanf(line, "%lu,%d,%d,%d,%d,%d,%d", &ts, &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) != 7)
+		{
+			fprintf(stderr, "%s : ligne invalide : %s", path, line);
+			fclose(f);
+			return 0;
+		}
+		samples[n].timestamp_us = (uint32_t)ts;
+		for(int i = 0; i < 3; i++)
+		{
+			samples[n].accel[i] = (int16_t)v[i];
+			samples[n].gyro[i] = (int16_t)v[3 + i];
+		}
+		n++;
+	}
+	fclose(f);
+	return n;
+}
+
+/*
+ * @brief	Rejoue un journal dans un filtre
+ * @return	true si l'écart avec la référence reste sous max_error_deg
+ */
+static bool replay(const char* path, ATTITUDE_Filter_t filter, const MPU6050_t* imu, uint16_t rate_hz, uint32_t n, double max_error_deg)
+{
+	ATTITUDE_t att;
+	reference_t ref;
+	error_t err = {0};
+	const char* name = (filter == ATTITUDE_MAHONY) ? "Mahony" : "complémentaire";
+
+	ATTITUDE_Init(&att, filter, imu, rate_hz);
+	reference_init(&ref, filter, imu, rate_hz);
+	for(uint32_t i = 0; i < n; i += MPU6050_STREAM_BLOCK_SAMPLES)
+	{
+		uint16_t batch = (n - i < MPU6050_STREAM_BLOCK_SAMPLES) ? (uint16_t)(n - i) : MPU6050_STREAM_BLOCK_SAMPLES;
+		ATTITUDE_UpdateBatch(&att, &samples[i], batch);
+		for(uint16_t k = 0; k < batch; k++)
+			reference_update(&ref, &samples[i + k]);
+
+		if(filter == ATTITUDE_MAHONY)
+		{
+			double dot = 0.0;
+			for(int k = 0; k < 4; k++)
+				dot += att.q[k] * ref.q[k];
+			error_add(&err, 2.0 * acos(fmin(1.0, fabs(dot))));
+		}
+		else
+		{
+			error_add(&err, wrap(att.roll - ref.roll));
+			error_add(&err, wrap(att.pitch - ref.pitch));
+		}
+	}
+
+	bool bias_ok = memcmp(att.gyro_bias, ref.gyro_bias, sizeof(ref.gyro_bias)) == 0;
+	bool ok = bias_ok && err.max_deg <= max_error_deg;
+	printf("%s : filtre %-14s %6u échantillons, écart max %.5f°, RMS %.5f°, biais (%d, %d, %d)%s : %s\n",
+			path, name, (unsigned)n, err.max_deg, sqrt(err.sum2 / (err.n ? err.n : 1)),
+			att.gyro_bias[0], att.gyro_bias[1], att.gyro_bias[2],
+			bias_ok ? "" : " différent de la référence", ok ? "OK" : "ECHEC");
+	return ok;
+}
+
+int main(int argc, char* argv[])
+{
+	double max_error_deg = 0.1;
+	int files = 0;
+	bool ok = true;
+
+	for(int i = 1; i < argc; i++)
+	{
+		MPU6050_t imu;
+		uint16_t rate_hz;
+		uint32_t n;
+		if(strcmp(argv[i], "--max-error-deg") == 0 && i + 1 < argc)
+		{
+			max_error_deg = atof(argv[++i]);
+			continue;
+		}
+		n = load_log(argv[i], &imu, &rate_hz);
+		files++;
+		if(n == 0)
+		{
+			ok = false;
+			continue;
+		}
+		ok &= replay(argv[i], ATTITUDE_COMPLEMENTARY, &imu, rate_hz, n, max_error_deg);
+		ok &= replay(argv[i], ATTITUDE_MAHONY, &imu, rate_hz, n, max_error_deg);
+	}
+	if(files == 0)
+	{
+		fprintf(stderr, "usage : %s [--max-error-deg d] journal.csv...\n", argv[0]);
+		return 2;
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+"""
+Générateur de journal IMU synthétique pour le test de rejeu du module d'attitude (attitude_replay.c).
+
+Le journal a le format d'un enregistrement du mode streaming (un MPU6050_Sample_t par ligne, valeurs brutes) :
+  # accel_g=4 gyro_dps=500 rate_hz=1000
+  timestamp_us,ax,ay,az,gx,gy,gz
+Les lignes vides ou commençant par # (hors la première) sont ignorées.
+
+La trajectoire est déterministe (graine fixe) : repos (estimation du biais), inclinaisons lentes sur les trois axes,
+secousses, retournement à 150°, puis repos. Le gyroscope a un biais et du bruit, l'accéléromètre du bruit et
+l'accélération des secousses ; les horodatages ont une gigue de quelques µs et un trou de 5 ms.
+
+Usage :
+  imu_log_gen.py synthetic.csv [--seconds 20] [--seed 1]
+"""
+
+import argparse
+import math
+import random
+
+RATE_HZ = 1000
+ACCEL_G = 4
+GYRO_DPS = 500
+ACCEL_LSB = 8192.0     # LSB/g à +-4g (MPU6050_ACCE_SENS_4)
+GYRO_LSB = 65.5        # LSB/(°/s) à +-500°/s (MPU6050_GYRO_SENS_500)
+GYRO_BIAS_LSB = (23, -17, 9)
+
+
+def rates(t):
+    """Vitesse de rotation (rad/s, repère capteur) et accélération propre (g) à l'instant t."""
+    w = [0.0, 0.0, 0.0]
+    lin = [0.0, 0.0, 0.0]
+    if 3.0 <= t < 11.0:
+        w[0] = 1.2 * math.sin(2 * math.pi * 0.25 * (t - 3.0))
+        w[1] = 0.8 * math.sin(2 * math.pi * 0.4 * (t - 3.0))
+        w[2] = 0.5 * math.sin(2 * math.pi * 0.15 * (t - 3.0))
+    elif 11.0 <= t < 13.0:
+        lin[0] = 0.8 * math.sin(2 * math.pi * 6.0 * t)
+        lin[2] = 0.5 * math.sin(2 * math.pi * 9.0 * t)
+        w[0] = 0.6 * math.sin(2 * math.pi * 5.0 * t)
+    elif 13.0 <= t < 14.0:
+        w[1] = math.radians(150.0)
+    elif 15.0 <= t < 16.0:
+        w[1] = -math.radians(150.0)
+    return w, lin
+
+
+def quat_mul(a, b):
+    return (a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3],
+            a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2],
+            a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1],
+            a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0])
+
+
+def gravity_body(q):
+    """Gravité (g) exprimée dans le repère capteur, q passant du repère capteur au repère terrestre."""
+    w, x, y, z = q
+    return (2 * (x * z - w * y), 2 * (w * x + y * z), w * w - x * x - y * y + z * z)
+
+
+def clamp16(v):
+    return max(-32768, min(32767, int(round(v))))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Journal IMU synthétique (format du mode streaming du MPU6050)")
+    parser.add_argument("output")
+    parser.add_argument("--seconds", type=float, default=20.0)
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    q = (1.0, 0.0, 0.0, 0.0)
+    substeps = 10
+    n = int(args.seconds * RATE_HZ)
+    with open(args.output, "w") as f:
+        f.write("# accel_g=%d gyro_dps=%d rate_hz=%d\n" % (ACCEL_G, GYRO_DPS, RATE_HZ))
+        for i in range(n):
+            t = i / RATE_HZ
+            if 7000 <= i < 7005:
+                continue        # trou : échantillons perdus
+            # intégration fine de l'orientation vraie jusqu'à l'instant t
+            h = 1.0 / (RATE_HZ * substeps)
+            for k in range(substeps):
+                w, _ = rates(t - 1.0 / RATE_HZ + (k + 0.5) * h)
+                dq = quat_mul(q, (0.0, w[0], w[1], w[2]))
+                q = tuple(q[j] + 0.5 * h * dq[j] for j in range(4))
+                norm = math.sqrt(sum(c * c for c in q))
+                q = tuple(c / norm for c in q)
+            w, lin = rates(t)
+            g = gravity_body(q)
+            accel = [clamp16((g[j] + lin[j] + rng.gauss(0, 0.004)) * ACCEL_LSB) for j in range(3)]
+            gyro = [clamp16(math.degrees(w[j]) * GYRO_LSB + GYRO_BIAS_LSB[j] + rng.gauss(0, 1.5)) for j in range(3)]
+            ts = 1000000 + i * 1000000 // RATE_HZ + rng.randint(-3, 3)
+            f.write("%d,%d,%d,%d,%d,%d,%d\n" % (ts & 0xFFFFFFFF, *accel, *gyro))
+
+
+if __name__ == "__main__":
+    main()
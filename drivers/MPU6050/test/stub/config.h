@@ -0,0 +1,32 @@
+/**
+ *******************************************************************************
+ * @file 	config.h
+ * @author 	DEEP Project
+ * @date 	Oct 17, 2026
+ * @brief	Configuration minimale pour compiler le module d'attitude sur PC (test de rejeu, cf attitude_replay.c).
+ * 			Remplace app/config.h et la HAL : seuls les types et registres utilisés par le module sont définis.
+ *******************************************************************************
+ */
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define USE_MPU6050			1
+
+typedef struct { uint32_t dummy; } GPIO_TypeDef;
+typedef struct { uint32_t dummy; } I2C_TypeDef;
+
+/* Compteur de cycles : sans objet sur PC, il reste à 0 */
+typedef struct { uint32_t DEMCR; } CoreDebug_Type;
+typedef struct { uint32_t CTRL; uint32_t CYCCNT; } DWT_Type;
+extern CoreDebug_Type host_core_debug;
+extern DWT_Type host_dwt;
+#define CoreDebug						(&host_core_debug)
+#define DWT								(&host_dwt)
+#define CoreDebug_DEMCR_TRCENA_Msk		(1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk			(1UL << 0)
+
+#endif /* CONFIG_H_ */
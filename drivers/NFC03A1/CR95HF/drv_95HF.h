@@ -35,6 +35,7 @@
 #if USE_NFC03A1
 
 #include <stdint.h>
+#include <stdbool.h>
 
 /* Includes ----------------------------------------------------------------------------- */
 
@@ -75,6 +76,13 @@
 /* RF transceiver polling status	------------------------------------------------------- */
 #define RFTRANS_95HF_POLLING_RFTRANS_95HF											0x00
 #define RFTRANS_95HF_POLLING_TIMEOUT													0x01
+#define RFTRANS_95HF_TRANSPORT_BUSY														0x02
+#define RFTRANS_95HF_TRANSPORT_ERROR													0x03
+
+/* Maximum time (ms) between the end of a command and IRQ_OUT going low ---------------- */
+#ifndef RFTRANS_95HF_REPLY_TIMEOUT_MS
+  #define RFTRANS_95HF_REPLY_TIMEOUT_MS												3000
+#endif
 
 /* RF transceiver number of byte of the buffers------------------------------------------ */
 #define RFTRANS_95HF_RESPONSEBUFFER_SIZE											0xFF
@@ -202,6 +210,12 @@ typedef struct {
 	RFTRANS_95HF_SPI_MODE 			uSpiMode;
 	RFTRANS_95HF_PROTOCOL				uCurrentProtocol;
 }drv95HF_ConfigStruct;
+
+/**
+ *	@brief  completion callback of an asynchronous exchange, called in interrupt context
+ *	@brief  status : RFTRANS_95HF_SUCCESS_CODE, RFTRANS_95HF_POLLING_TIMEOUT or RFTRANS_95HF_TRANSPORT_ERROR
+ */
+typedef void (*drv95HF_Callback)(int8_t status);
 /**
   * @}
   */
@@ -231,6 +245,9 @@ void drv95HF_DisableInterrupt(void);
 
 void drv95HF_InitializeUART(const uint32_t BaudRate);
 
+int8_t  drv95HF_SendReceiveAsync(const uint8_t *pCommand, uint8_t *pResponse, drv95HF_Callback Callback);
+bool    drv95HF_IsBusy(void);
+
 /**
   * @}
   */
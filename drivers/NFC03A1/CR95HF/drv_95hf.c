@@ -37,6 +37,8 @@
 #include "../stm32g4_nfc03a1.h"
 #include "stm32g4_gpio.h"
 #include "stm32g4_extit.h"
+#include "stm32g4_systick.h"
+#include <string.h>
 
 /** @addtogroup BSP
   * @{
@@ -53,12 +55,30 @@
 
 /* External variables --------------------------------------------------------*/
 /* Private typedef -----------------------------------------------------------*/
+/**
+ *	@brief  steps of an asynchronous exchange with the 95HF device
+ */
+typedef enum {
+  DRV95HF_ASYNC_IDLE = 0,
+  DRV95HF_ASYNC_SENDING,
+  DRV95HF_ASYNC_WAIT_IRQOUT,
+  DRV95HF_ASYNC_READ_HEADER,
+  DRV95HF_ASYNC_READ_DATA,
+}drv95HF_AsyncState;
 /* Private defines -----------------------------------------------------------*/
 /* Private macros ------------------------------------------------------------*/
 /* Private function prototypes -----------------------------------------------*/
 static void drv95HF_InitializeSPI(void);
 static void drv95HF_SendSPIResetByte(void);
 static int8_t drv95HF_SPIPollingCommand(void);
+static void drv95HF_IRQOutCallback(uint8_t pin_number);
+static void drv95HF_AsyncTick(void);
+static bool drv95HF_AsyncClaim(drv95HF_AsyncState from, drv95HF_AsyncState to);
+static void drv95HF_AsyncSendDone(HAL_StatusTypeDef status);
+static void drv95HF_AsyncReadHeader(void);
+static void drv95HF_AsyncHeaderDone(HAL_StatusTypeDef status);
+static void drv95HF_AsyncDataDone(HAL_StatusTypeDef status);
+static void drv95HF_AsyncComplete(int8_t status);
 /* Global variables ---------------------------------------------------------*/
 /** @defgroup XX95HF_Global variables
   * @{
@@ -80,6 +100,17 @@ bool EnableTimeOut              = true;
 
 /* ConfigStructure */ 										 
 drv95HF_ConfigStruct	        drv95HFConfig;
+
+/* Asynchronous exchange in progress */
+static volatile drv95HF_AsyncState	AsyncState = DRV95HF_ASYNC_IDLE;
+static volatile uint16_t	        AsyncCountdown;
+static volatile int8_t	          AsyncStatus = RFTRANS_95HF_SUCCESS_CODE;
+static uint8_t	                  AsyncCommand;
+static uint8_t	                  *pAsyncResponse;
+static drv95HF_Callback	          AsyncCallback;
+/* SEND control byte + command, then RECEIVE control byte + result code + length */
+static uint8_t	                  AsyncTxBuffer[RFTRANS_95HF_MAX_BUFFER_SIZE+3];
+static uint8_t	                  AsyncHeader[3];
 /**
   * @}
   */ 
@@ -100,7 +131,7 @@ static void drv95HF_InitializeSPI(void)
   BSP_GPIO_pin_config(RFTRANS_95HF_SPI_NSS_GPIO_PORT, RFTRANS_95HF_SPI_NSS_PIN, GPIO_MODE_OUTPUT_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_NO_AF);
   RFTRANS_95HF_NSS_HIGH();
 
-  BSP_EXTIT_set_callback(&RFTRANS_95HF_EXTI_Callback, BSP_EXTIT_gpiopin_to_pin_number(IRQOUT_RFTRANS_95HF_PIN), true);
+  BSP_EXTIT_set_callback(&drv95HF_IRQOutCallback, BSP_EXTIT_gpiopin_to_pin_number(IRQOUT_RFTRANS_95HF_PIN), true);
   BSP_GPIO_pin_config(IRQOUT_RFTRANS_95HF_PORT, IRQOUT_RFTRANS_95HF_PIN, GPIO_MODE_IT_FALLING, GPIO_PULLUP, GPIO_SPEED_FREQ_VERY_HIGH, GPIO_NO_AF);
 
   BSP_GPIO_pin_config(IRQIN_RFTRANS_GPIO_PORT, IRQIN_RFTRANS_95HF_PIN, GPIO_MODE_OUTPUT_PP, GPIO_PULLUP, GPIO_SPEED_FREQ_HIGH, GPIO_NO_AF);
@@ -108,6 +139,8 @@ static void drv95HF_InitializeSPI(void)
   /* Set signal to high */
   RFTRANS_95HF_IRQIN_HIGH();
 
+  /* 1 ms tick : reply timeout and IRQ_OUT level check of the asynchronous exchanges */
+  BSP_systick_add_callback_function(&drv95HF_AsyncTick);
 }
 
 
@@ -145,7 +178,6 @@ static int8_t drv95HF_SPIPollingCommand( void )
       
       /* Low level on NSS  */
       RFTRANS_95HF_NSS_LOW();
-      HAL_Delay(2);
       
       /*  poll the 95HF transceiver until he's ready ! */
       Polling_Status  = BSP_SPI_WriteRead(NFC_SPI, RFTRANS_95HF_COMMAND_POLLING);
@@ -159,9 +191,11 @@ static int8_t drv95HF_SPIPollingCommand( void )
   }	
   else if (drv95HFConfig.uSpiMode == RFTRANS_95HF_SPI_INTERRUPT)
   {
-    /* Wait a low level on the IRQ pin or the timeout  */
+    /* Wait a low level on the IRQ pin or the timeout, sleeping until the next interrupt (EXTI or systick) */
     while( (uDataReady == false) && (HAL_GetTick() - t < 3000) )
-    {	}		
+    {
+      __WFI();
+    }
   }
   
   
@@ -210,6 +244,204 @@ static void drv95HF_ReceiveUARTResponse(uint8_t *pData)
   }
 }
 
+/**
+ *	@brief  Atomically moves the asynchronous exchange from one step to the next one
+ *  @param  from : expected current step
+ *  @param  to : new step
+ *  @retval true if the caller now owns the exchange (EXTI, systick and DMA interrupts may race)
+ */
+static bool drv95HF_AsyncClaim(drv95HF_AsyncState from, drv95HF_AsyncState to)
+{
+  bool claimed = false;
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (AsyncState == from)
+  {
+    AsyncState = to;
+    claimed = true;
+  }
+  __set_PRIMASK(primask);
+  return claimed;
+}
+
+/**
+ *	@brief  IRQ_OUT falling edge : the 95HF device has a response ready
+ *  @param  pin_number : EXTI line
+ *  @retval None
+ */
+static void drv95HF_IRQOutCallback(uint8_t pin_number)
+{
+  if (drv95HF_AsyncClaim(DRV95HF_ASYNC_WAIT_IRQOUT, DRV95HF_ASYNC_READ_HEADER))
+    drv95HF_AsyncReadHeader();
+  else
+    /* Not an answer to an asynchronous exchange (RF event, legacy interrupt mode) */
+    RFTRANS_95HF_EXTI_Callback(pin_number);
+}
+
+/**
+ *	@brief  1 ms tick of the asynchronous exchanges
+ *  @note   The IRQ_OUT level is also checked here, in case the EXTI line was disabled by drvInt_Disable_95HF_IRQ()
+ *  @param  None
+ *  @retval None
+ */
+static void drv95HF_AsyncTick(void)
+{
+  if (AsyncState != DRV95HF_ASYNC_WAIT_IRQOUT)
+    return;
+  
+  if (HAL_GPIO_ReadPin(IRQOUT_RFTRANS_95HF_PORT, IRQOUT_RFTRANS_95HF_PIN) == GPIO_PIN_RESET)
+  {
+    if (drv95HF_AsyncClaim(DRV95HF_ASYNC_WAIT_IRQOUT, DRV95HF_ASYNC_READ_HEADER))
+      drv95HF_AsyncReadHeader();
+  }
+  else if (AsyncCountdown != 0 && --AsyncCountdown == 0)
+  {
+    if (drv95HF_AsyncClaim(DRV95HF_ASYNC_WAIT_IRQOUT, DRV95HF_ASYNC_READ_DATA))
+    {
+      *pAsyncResponse = RFTRANS_95HF_ERRORCODE_TIMEOUT;
+      drv95HF_AsyncComplete(RFTRANS_95HF_POLLING_TIMEOUT);
+    }
+  }
+}
+
+/**
+ *	@brief  End of the command DMA transfer : wait for IRQ_OUT
+ *  @param  status : SPI transfer status
+ *  @retval None
+ */
+static void drv95HF_AsyncSendDone(HAL_StatusTypeDef status)
+{
+  /* Deselect xx95HF over SPI  */
+  RFTRANS_95HF_NSS_HIGH();
+  
+  if (status != HAL_OK)
+  {
+    *pAsyncResponse = RFTRANS_95HF_ERRORCODE_DEFAULT;
+    drv95HF_AsyncComplete(RFTRANS_95HF_TRANSPORT_ERROR);
+    return;
+  }
+  
+  AsyncState = DRV95HF_ASYNC_WAIT_IRQOUT;
+  /* The response may already be there if the edge came before the end of the transfer */
+  if (HAL_GPIO_ReadPin(IRQOUT_RFTRANS_95HF_PORT, IRQOUT_RFTRANS_95HF_PIN) == GPIO_PIN_RESET)
+  {
+    if (drv95HF_AsyncClaim(DRV95HF_ASYNC_WAIT_IRQOUT, DRV95HF_ASYNC_READ_HEADER))
+      drv95HF_AsyncReadHeader();
+  }
+}
+
+/**
+ *	@brief  Reads the RECEIVE control byte, the result code and the length in one DMA transfer
+ *  @param  None
+ *  @retval None
+ */
+static void drv95HF_AsyncReadHeader(void)
+{
+  AsyncHeader[0] = RFTRANS_95HF_COMMAND_RECEIVE;
+  AsyncHeader[1] = DUMMY_BYTE;
+  AsyncHeader[2] = DUMMY_BYTE;
+  
+  /* Select 95HF transceiver over SPI */
+  RFTRANS_95HF_NSS_LOW();
+  if (BSP_SPI_WriteReadBuffer_DMA(NFC_SPI, AsyncHeader, AsyncHeader, sizeof(AsyncHeader), &drv95HF_AsyncHeaderDone) != HAL_OK)
+  {
+    RFTRANS_95HF_NSS_HIGH();
+    *pAsyncResponse = RFTRANS_95HF_ERRORCODE_DEFAULT;
+    drv95HF_AsyncComplete(RFTRANS_95HF_TRANSPORT_ERROR);
+  }
+}
+
+/**
+ *	@brief  Header received : reads the remaining bytes announced by the length in one DMA transfer
+ *  @param  status : SPI transfer status
+ *  @retval None
+ */
+static void drv95HF_AsyncHeaderDone(HAL_StatusTypeDef status)
+{
+  uint8_t *pData = &pAsyncResponse[RFTRANS_95HF_DATA_OFFSET];
+  uint16_t remaining;
+  
+  if (status != HAL_OK)
+  {
+    RFTRANS_95HF_NSS_HIGH();
+    *pAsyncResponse = RFTRANS_95HF_ERRORCODE_DEFAULT;
+    drv95HF_AsyncComplete(RFTRANS_95HF_TRANSPORT_ERROR);
+    return;
+  }
+  
+  pAsyncResponse[RFTRANS_95HF_COMMAND_OFFSET] = AsyncHeader[1];
+  if (AsyncHeader[1] == ECHO || AsyncHeader[1] == 0xFF)
+  {
+    /* No length byte : the second byte is the first of the two trailing bytes (0x85 0x00 after a cancelled listen) */
+    pAsyncResponse[RFTRANS_95HF_LENGTH_OFFSET] = 0x00;
+    pAsyncResponse[RFTRANS_95HF_LENGTH_OFFSET+1] = AsyncHeader[2];
+    pData++;
+    remaining = 1;
+  }
+  else
+  {
+    pAsyncResponse[RFTRANS_95HF_LENGTH_OFFSET] = AsyncHeader[2];
+    remaining = AsyncHeader[2];
+  }
+  
+  if (remaining == 0)
+  {
+    RFTRANS_95HF_NSS_HIGH();
+    drv95HF_AsyncComplete(RFTRANS_95HF_SUCCESS_CODE);
+    return;
+  }
+  
+  AsyncState = DRV95HF_ASYNC_READ_DATA;
+  /* The response buffer is also the dummy bytes source : each byte is sent before being overwritten */
+  memset(pData, DUMMY_BYTE, remaining);
+  if (BSP_SPI_WriteReadBuffer_DMA(NFC_SPI, pData, pData, remaining, &drv95HF_AsyncDataDone) != HAL_OK)
+  {
+    RFTRANS_95HF_NSS_HIGH();
+    *pAsyncResponse = RFTRANS_95HF_ERRORCODE_DEFAULT;
+    drv95HF_AsyncComplete(RFTRANS_95HF_TRANSPORT_ERROR);
+  }
+}
+
+/**
+ *	@brief  End of the response DMA transfer
+ *  @param  status : SPI transfer status
+ *  @retval None
+ */
+static void drv95HF_AsyncDataDone(HAL_StatusTypeDef status)
+{
+  /* Deselect xx95HF over SPI */
+  RFTRANS_95HF_NSS_HIGH();
+  
+  if (status != HAL_OK)
+  {
+    *pAsyncResponse = RFTRANS_95HF_ERRORCODE_DEFAULT;
+    drv95HF_AsyncComplete(RFTRANS_95HF_TRANSPORT_ERROR);
+    return;
+  }
+  drv95HF_AsyncComplete(RFTRANS_95HF_SUCCESS_CODE);
+}
+
+/**
+ *	@brief  Ends the asynchronous exchange and calls the user callback
+ *  @param  status : result of the exchange
+ *  @retval None
+ */
+static void drv95HF_AsyncComplete(int8_t status)
+{
+  drv95HF_Callback callback = AsyncCallback;
+  
+  /* After listen command is sent an interrupt will raise when data from RF will be received */
+  if (AsyncCommand == LISTEN && drv95HFConfig.uSpiMode == RFTRANS_95HF_SPI_INTERRUPT)
+    drvInt_Enable_RFEvent_IRQ( );
+  
+  AsyncStatus = status;
+  AsyncCallback = NULL;
+  /* The transport is released before the call : the callback may start the next exchange */
+  AsyncState = DRV95HF_ASYNC_IDLE;
+  if (callback != NULL)
+    callback(status);
+}
+
 /**
  * @}
  */
@@ -352,8 +584,6 @@ uint8_t drv95HF_GetSerialInterface(void)
  */
 void drv95HF_SendSPICommand(const uint8_t *pData)
 {
-  uint8_t DummyBuffer[MAX_BUFFER_SIZE];
-  
   /* Select xx95HF over SPI */
   RFTRANS_95HF_NSS_LOW();
   
@@ -367,8 +597,8 @@ void drv95HF_SendSPICommand(const uint8_t *pData)
   }
   else
   {
-    /* Transmit the buffer over SPI */
-	BSP_SPI_WriteReadBuffer(NFC_SPI, pData, DummyBuffer, pData[RFTRANS_95HF_LENGTH_OFFSET]+RFTRANS_95HF_DATA_OFFSET);
+    /* Transmit the buffer over SPI, in one transfer */
+	BSP_SPI_WriteMultiNoRegister(NFC_SPI, (uint8_t *)pData, pData[RFTRANS_95HF_LENGTH_OFFSET]+RFTRANS_95HF_DATA_OFFSET);
   }
   
   /* Deselect xx95HF over SPI  */
@@ -431,26 +661,29 @@ int8_t drv95HF_SendReceive(const uint8_t *pCommand, uint8_t *pResponse)
 {		
   uint8_t command = *pCommand;
   
+  if(drv95HFConfig.uInterface == RFTRANS_95HF_INTERFACE_SPI)
+  {
+    /* Wait for a pending asynchronous exchange */
+    while (drv95HF_IsBusy())
+      __WFI();
+    /* Send, wait for IRQ_OUT and read back through the asynchronous transport, sleeping in the meantime */
+    if (drv95HF_SendReceiveAsync(pCommand, pResponse, NULL) != RFTRANS_95HF_SUCCESS_CODE)
+    {
+      *pResponse = RFTRANS_95HF_ERRORCODE_DEFAULT;
+      return RFTRANS_95HF_TRANSPORT_BUSY;
+    }
+    while (drv95HF_IsBusy())
+      __WFI();
+    return AsyncStatus;
+  }
+  
   /* if we want to send a command we are not expected a interrupt from RF event */
   if(drv95HFConfig.uSpiMode == RFTRANS_95HF_SPI_INTERRUPT)
   {	
     drvInt_Enable_Reply_IRQ();
   }
   
-  if(drv95HFConfig.uInterface == RFTRANS_95HF_INTERFACE_SPI)
-  {
-    /* First step  - Sending command 	*/
-    drv95HF_SendSPICommand(pCommand);
-    /* Second step - Polling	*/
-    if (drv95HF_SPIPollingCommand( ) != RFTRANS_95HF_SUCCESS_CODE)
-    {	
-      *pResponse = RFTRANS_95HF_ERRORCODE_TIMEOUT;
-      return RFTRANS_95HF_POLLING_TIMEOUT;	
-    }
-    /* Third step  - Receiving bytes */
-    drv95HF_ReceiveSPIResponse(pResponse);
-  }	
-  else if(drv95HFConfig.uInterface == RFTRANS_95HF_INTERFACE_UART)
+  if(drv95HFConfig.uInterface == RFTRANS_95HF_INTERFACE_UART)
   {
     /* First step  - Sending command	*/
     drv95HF_SendUARTCommand(pCommand);
@@ -469,6 +702,66 @@ int8_t drv95HF_SendReceive(const uint8_t *pCommand, uint8_t *pResponse)
   return RFTRANS_95HF_SUCCESS_CODE; 
 }
 
+/**
+ *	@brief  This function starts an exchange with the 95HF device over SPI and returns without waiting :
+ *				  the command is sent by DMA, IRQ_OUT is awaited by EXTI and the response is read by DMA
+ *  @param  *pCommand  : pointer on the buffer to send to the 95HF device ( Command | Length | Data), copied
+ *  @param  *pResponse : pointer on the 95HF device response ( Command | Length | Data), must stay valid
+ *				  until the end of the exchange (RFTRANS_95HF_MAX_BUFFER_SIZE+3 bytes)
+ *  @param  Callback : function called in interrupt context at the end of the exchange (can be NULL)
+ *  @retval RFTRANS_95HF_SUCCESS_CODE : the exchange is started
+ *  @retval RFTRANS_95HF_TRANSPORT_BUSY : an exchange is already in progress or the SPI bus is busy
+ *  @retval RFTRANS_95HF_TRANSPORT_ERROR : the serial interface is not SPI
+ */
+int8_t drv95HF_SendReceiveAsync(const uint8_t *pCommand, uint8_t *pResponse, drv95HF_Callback Callback)
+{
+  uint16_t length;
+  
+  if (drv95HFConfig.uInterface != RFTRANS_95HF_INTERFACE_SPI)
+    return RFTRANS_95HF_TRANSPORT_ERROR;
+  if (!drv95HF_AsyncClaim(DRV95HF_ASYNC_IDLE, DRV95HF_ASYNC_SENDING))
+    return RFTRANS_95HF_TRANSPORT_BUSY;
+  
+  /* if we want to send a command we are not expected a interrupt from RF event */
+  if (drv95HFConfig.uSpiMode == RFTRANS_95HF_SPI_INTERRUPT)
+    drvInt_Enable_Reply_IRQ();
+  
+  AsyncCommand = *pCommand;
+  pAsyncResponse = pResponse;
+  AsyncCallback = Callback;
+  /* no reply timeout when the caller waits for an event (tag detection, listen) */
+  AsyncCountdown = EnableTimeOut ? RFTRANS_95HF_REPLY_TIMEOUT_MS : 0;
+  
+  /* SEND control byte followed by the command, in one DMA transfer */
+  AsyncTxBuffer[0] = RFTRANS_95HF_COMMAND_SEND;
+  if (*pCommand == ECHO)
+    length = 1;
+  else
+    length = pCommand[RFTRANS_95HF_LENGTH_OFFSET] + RFTRANS_95HF_DATA_OFFSET;
+  memcpy(&AsyncTxBuffer[1], pCommand, length);
+  
+  /* Select xx95HF over SPI */
+  RFTRANS_95HF_NSS_LOW();
+  if (BSP_SPI_WriteMultiNoRegister_DMA(NFC_SPI, AsyncTxBuffer, length + 1, &drv95HF_AsyncSendDone) != HAL_OK)
+  {
+    RFTRANS_95HF_NSS_HIGH();
+    AsyncCallback = NULL;
+    AsyncState = DRV95HF_ASYNC_IDLE;
+    return RFTRANS_95HF_TRANSPORT_BUSY;
+  }
+  return RFTRANS_95HF_SUCCESS_CODE;
+}
+
+/**
+ *	@brief  This function returns the state of the asynchronous transport
+ *  @param  None
+ *  @retval true : an exchange started by drv95HF_SendReceiveAsync is in progress
+ */
+bool drv95HF_IsBusy(void)
+{
+  return AsyncState != DRV95HF_ASYNC_IDLE;
+}
+
 /**
  *	@brief  This function send a command to 95HF device over SPI or UART bus
  *  @param  *pCommand  : pointer on the buffer to send to the 95HF ( Command | Length | Data)
@@ -0,0 +1,326 @@
+/**
+  ******************************************************************************
+  * @file    lib_95HFPresence.c
+  * @author  DEEP Project
+  * @date    Oct 17, 2026
+  * @brief   Low power tag presence service
+  ******************************************************************************
+  * Instead of hunting tags with the field on, the 95HF is put in tag detection mode :
+  * it wakes up every PRESENCE_WU_PERIOD, sends a short burst in the antenna and compares
+  * the swing with the calibrated DAC thresholds. IRQ_OUT goes low when a tag (or any
+  * object detuning the antenna) is detected, which ends the asynchronous Idle exchange.
+  * Meanwhile the MCU only runs its interrupts : Presence_Sleep() enters the Sleep mode,
+  * so the systick callbacks and the timers of the application are still serviced.
+  *
+  * On wake-up a tag hunting is run on the tags types given to Presence_Start(). The
+  * tap to response time is the tag detection period plus this hunting : keep the list
+  * of tag types short to stay under 100 ms. For type 5 the hunting is a one slot
+  * ISO15693_Inventory (ISO15693_GetUID) : the 16 slots fast inventory would cost more
+  * exchanges for a single tag and leave it quiet, so unaddressed reads would then fail.
+  *
+  * Use :
+  *		Presence_Start(TRACK_NFCTYPE2 | TRACK_NFCTYPE5);
+  *		while(1)
+  *		{
+  *			if (Presence_Process() != TRACK_NOTHING)
+  *				Presence_ReadNDEF(&pEntry);	... or any other read, the field is on and the tag selected
+  *			... other tasks
+  *			Presence_Sleep();
+  *		}
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------------------ */
+#include "config.h"
+#if USE_NFC03A1
+#include "lib_95HFPresence.h"
+
+/* Private variables --------------------------------------------------------------------- */
+extern bool EnableTimeOut;
+extern DeviceMode_t devicemode;
+extern TagType_t nfc_tagtype;
+extern uint8_t TagUID[];
+extern ISO14443A_CARD ISO14443A_Card;
+
+static PRESENCE_STATE			State = PRESENCE_STOPPED;
+static PRESENCE_STATS			Stats;
+static uint8_t					TagsToFind;
+static uint8_t					LastTag = TRACK_NOTHING;	/* tag found by the last wake-up */
+static uint8_t					DacDataH;
+static bool						Calibrated = false;
+static uint8_t					FalseWakeUps;
+static uint32_t					LastCheck;
+static volatile bool			WokenUp = false;
+static volatile uint32_t		WakeUpTick;
+/* Idle reply : result code | length | wake-up source */
+static uint8_t					IdleReply[RFTRANS_95HF_MAX_BUFFER_SIZE+3];
+
+/* Private functions --------------------------------------------------------------------- */
+static void Presence_WakeUp ( int8_t status );
+static int8_t Presence_Watch ( void );
+static int8_t Presence_DoCalibration ( void );
+
+/**
+ *	@brief  End of the Idle exchange (interrupt context) : the 95HF has woken up
+ *  @param  status : transport status
+ *  @retval None
+ */
+static void Presence_WakeUp ( int8_t status )
+{
+  WakeUpTick = HAL_GetTick();
+  WokenUp = true;
+}
+
+/**
+ *	@brief  Puts the 95HF in tag detection mode, without waiting for the wake-up
+ *  @param  None
+ *  @retval PRESENCE_SUCCESSCODE : the 95HF is watching the field
+ *  @retval PRESENCE_ERRORCODE_BUSY : the transport is used or the interface is not SPI
+ */
+static int8_t Presence_Watch ( void )
+{
+  /* same settings as PCD_WaitforTagDetection */
+  uint8_t Command[IDLE_CMD_LENTH+2] = { RFTRANS_95HF_COMMAND_IDLE, IDLE_CMD_LENTH, WU_TAG | WU_IRQ, 0x21, 0x00, 0x79, 0x01, 0x18,
+                                        0x00, PRESENCE_WU_PERIOD, 0x60, 0x60, 0x00, 0x00, 0x3F, PRESENCE_NB_TRIALS };
+  int8_t status;
+
+  Command[DACDATAL_OFFSET] = DacDataH - 0x10;
+  Command[DACDATAH_OFFSET] = DacDataH;
+
+  PCD_FieldOff();
+  WokenUp = false;
+  /* the 95HF may sleep as long as no tag comes : no reply timeout */
+  EnableTimeOut = false;
+  status = drv95HF_SendReceiveAsync(Command, IdleReply, &Presence_WakeUp);
+  EnableTimeOut = true;
+
+  if (status != RFTRANS_95HF_SUCCESS_CODE)
+  {
+    State = PRESENCE_STOPPED;
+    return PRESENCE_ERRORCODE_BUSY;
+  }
+  State = PRESENCE_WATCHING;
+  return PRESENCE_SUCCESSCODE;
+}
+
+/**
+ *	@brief  Computes the tag detection thresholds, no tag must be near the antenna
+ *  @param  None
+ *  @retval PRESENCE_SUCCESSCODE : calibration done
+ *  @retval PRESENCE_ERRORCODE_CALIBRATION : the 95HF did not give the expected wake-up events
+ */
+static int8_t Presence_DoCalibration ( void )
+{
+  PCD_FieldOff();
+  Stats.NbCalibrations++;
+  FalseWakeUps = 0;
+  Calibrated = (PCD_TagDetectCalibration(PRESENCE_WU_PERIOD, &DacDataH) == PCD_SUCCESSCODE);
+
+  return Calibrated ? PRESENCE_SUCCESSCODE : PRESENCE_ERRORCODE_CALIBRATION;
+}
+
+/**
+ *	@brief  Starts the presence service (calibrates on the first call)
+ *  @param  tagsToFind : tag types hunted on wake-up (TRACK_xxx flags)
+ *  @retval PRESENCE_SUCCESSCODE : the 95HF is watching the field
+ *  @retval PRESENCE_ERRORCODE_CALIBRATION : calibration failed
+ *  @retval PRESENCE_ERRORCODE_BUSY : the transport is used or the interface is not SPI
+ */
+int8_t Presence_Start ( uint8_t tagsToFind )
+{
+  int8_t status;
+
+  Presence_Stop();
+  TagsToFind = tagsToFind;
+  if (!Calibrated)
+  {
+    status = Presence_DoCalibration();
+    if (status != PRESENCE_SUCCESSCODE)
+      return status;
+  }
+  return Presence_Watch();
+}
+
+/**
+ *	@brief  Stops the service : a pulse on IRQ_IN wakes up the 95HF if it is watching
+ *  @param  None
+ *  @retval None
+ */
+void Presence_Stop ( void )
+{
+  if (State == PRESENCE_WATCHING && !WokenUp)
+  {
+    drv95HF_SendIRQINPulse();
+    while (drv95HF_IsBusy())
+      __WFI();
+  }
+  WokenUp = false;
+  State = PRESENCE_STOPPED;
+}
+
+/**
+ *	@brief  Calibrates the tag detection again (after the antenna environment has changed)
+ *  @param  None
+ *  @retval PRESENCE_SUCCESSCODE : calibration done (the service is resumed if it was running)
+ *  @retval PRESENCE_ERRORCODE_CALIBRATION : calibration failed, the service is stopped
+ */
+int8_t Presence_Calibrate ( void )
+{
+  bool running = (State != PRESENCE_STOPPED);
+  int8_t status;
+
+  Presence_Stop();
+  status = Presence_DoCalibration();
+  if (status == PRESENCE_SUCCESSCODE && running)
+    status = Presence_Watch();
+  return status;
+}
+
+/**
+ *	@brief  Main loop task of the service
+ *  @param  None
+ *  @retval TRACK_NOTHING : no new tag
+ *  @retval TRACK_xxx : a tag has just been put on the reader, it is selected and the field is on
+ */
+uint8_t Presence_Process ( void )
+{
+  uint8_t tag;
+
+  switch (State)
+  {
+    case PRESENCE_WATCHING:
+      if (!WokenUp)
+        return TRACK_NOTHING;
+      WokenUp = false;
+      Stats.NbWakeUps++;
+
+      if ((IdleReply[0] == 0x00) && (IdleReply[1] == 0x01) && (IdleReply[2] & WU_TAG))
+      {
+        tag = ConfigManager_TagHunting(TagsToFind);
+        if (tag != TRACK_NOTHING)
+        {
+          Stats.LastResponseTime = HAL_GetTick() - WakeUpTick;
+          FalseWakeUps = 0;
+          LastCheck = HAL_GetTick();
+          State = PRESENCE_TAG_IN_FIELD;
+          LastTag = tag;
+          return tag;
+        }
+        /* the antenna was detuned by something else than a tag */
+        Stats.NbFalseWakeUps++;
+        if (++FalseWakeUps >= PRESENCE_MAX_FALSE_WAKEUPS)
+        {
+          if (Presence_DoCalibration() != PRESENCE_SUCCESSCODE)
+          {
+            State = PRESENCE_STOPPED;
+            return TRACK_NOTHING;
+          }
+        }
+      }
+      Presence_Watch();
+      return TRACK_NOTHING;
+
+    case PRESENCE_TAG_IN_FIELD:
+      if (HAL_GetTick() - LastCheck < PRESENCE_REMOVAL_PERIOD_MS)
+        return TRACK_NOTHING;
+      LastCheck = HAL_GetTick();
+      /* the tag stays : field off until the next check. Removed : back to tag detection */
+      if (ConfigManager_TagHunting(TagsToFind) != TRACK_NOTHING)
+        PCD_FieldOff();
+      else
+        Presence_Watch();
+      return TRACK_NOTHING;
+
+    default:
+      return TRACK_NOTHING;
+  }
+}
+
+/**
+ *	@brief  Reads the NDEF of the tag just found by Presence_Process, from the cache when the tag is known
+ *				  and has not been rewritten (one probe exchange for type 2 and type 5 tags)
+ *  @param  ppEntry : cache entry of the tag, NULL if it could not be cached
+ *  @retval NDEF_CACHE_HIT : known tag, NDEFCache_ReadNDEF gives its NDEF file
+ *  @retval NDEF_CACHE_MISS : NDEF read from the tag, NDEF_ReadNDEF gives it
+ *  @retval NDEF_ERROR : no tag selected (call it right after Presence_Process returned a tag) or read failed
+ */
+uint16_t Presence_ReadNDEF ( sNDEFCacheEntry_t **ppEntry )
+{
+  const uint8_t *pUID = NULL;
+  uint8_t UIDLength = 0;
+
+  *ppEntry = NULL;
+  if (State != PRESENCE_TAG_IN_FIELD)
+    return NDEF_ERROR;
+
+  devicemode = PCD;
+  switch (LastTag)
+  {
+    case TRACK_NFCTYPE1:
+      nfc_tagtype = TT1;
+      break;
+    case TRACK_NFCTYPE2:
+      nfc_tagtype = TT2;
+      pUID = ISO14443A_Card.UID;
+      UIDLength = ISO14443A_Card.UIDsize;
+      break;
+    case TRACK_NFCTYPE3:
+      nfc_tagtype = TT3;
+      break;
+    case TRACK_NFCTYPE4A:
+      nfc_tagtype = TT4A;
+      pUID = ISO14443A_Card.UID;
+      UIDLength = ISO14443A_Card.UIDsize;
+      break;
+    case TRACK_NFCTYPE4B:
+      nfc_tagtype = TT4B;
+      break;
+    case TRACK_NFCTYPE5:
+      nfc_tagtype = TT5;
+      pUID = TagUID;
+      UIDLength = ISO15693_NBBYTE_UID;
+      break;
+    default:
+      return NDEF_ERROR;
+  }
+
+  /* no UID kept by the tag hunting (types 1, 3 and 4B) : read each time, never cached */
+  return NDEFCache_ReadTag(pUID, UIDLength, ppEntry);
+}
+
+/**
+ *	@brief  Enters the Sleep mode until the next interrupt, unless the 95HF has already woken up.
+ *				  The systick and the peripherals keep running : call it when the main loop has nothing to do.
+ *  @param  None
+ *  @retval None
+ */
+void Presence_Sleep ( void )
+{
+  /* a wake-up between the test and WFI stays pending and ends the WFI */
+  __disable_irq();
+  if (!WokenUp)
+    HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+  __enable_irq();
+}
+
+/**
+ *	@brief  Returns the state of the service
+ *  @param  None
+ *  @retval PRESENCE_STATE
+ */
+PRESENCE_STATE Presence_GetState ( void )
+{
+  return State;
+}
+
+/**
+ *	@brief  Returns the counters of the service
+ *  @param  None
+ *  @retval pointer on the counters
+ */
+const PRESENCE_STATS* Presence_GetStats ( void )
+{
+  return &Stats;
+}
+
+#endif
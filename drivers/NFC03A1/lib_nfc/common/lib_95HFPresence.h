@@ -0,0 +1,71 @@
+/**
+  ******************************************************************************
+  * @file    lib_95HFPresence.h
+  * @author  DEEP Project
+  * @date    Oct 17, 2026
+  * @brief   Low power tag presence service : the 95HF watches the field in tag
+  *          detection mode while the MCU sleeps, a tag hunting is run on wake-up.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion --------------------------------------------*/
+#ifndef _LIB_95HFPRESENCE_H
+#define _LIB_95HFPRESENCE_H
+#include "config.h"
+#if USE_NFC03A1
+
+/* Includes -------------------------------------------------------------------------*/
+#include "lib_95HFConfigManager.h"
+#include "../lib_NDEF/lib_NDEF_Cache.h"
+
+/* Presence status and error code ---------------------------------------------------*/
+#define PRESENCE_SUCCESSCODE										RESULTOK
+#define PRESENCE_ERRORCODE_DEFAULT									0xE1
+#define PRESENCE_ERRORCODE_CALIBRATION								0xE2
+#define PRESENCE_ERRORCODE_BUSY										0xE3
+
+/* Tag detection settings -----------------------------------------------------------*/
+/* Time between two tag detections : 256 x tL x (WU period + 2) x (MaxSleep + 1), with
+   tL = 1/32 kHz and MaxSleep = PRESENCE_NB_TRIALS. 0x03 and 0x01 give about 80 ms */
+#ifndef PRESENCE_WU_PERIOD
+#define PRESENCE_WU_PERIOD											0x03
+#endif
+#ifndef PRESENCE_NB_TRIALS
+#define PRESENCE_NB_TRIALS											0x01
+#endif
+/* Consecutive wake-ups without any tag found before a new calibration (antenna detuned
+   by a metal object, temperature drift...) */
+#ifndef PRESENCE_MAX_FALSE_WAKEUPS
+#define PRESENCE_MAX_FALSE_WAKEUPS									3
+#endif
+/* While a tag stays in the field, it is hunted again with this period (ms) to detect its removal */
+#ifndef PRESENCE_REMOVAL_PERIOD_MS
+#define PRESENCE_REMOVAL_PERIOD_MS									250
+#endif
+
+/* state of the service -------------------------------------------------------------*/
+typedef enum {
+  PRESENCE_STOPPED = 0,
+  PRESENCE_WATCHING,			/* 95HF in tag detection, MCU may sleep */
+  PRESENCE_TAG_IN_FIELD,		/* tag found, waiting for its removal */
+}PRESENCE_STATE;
+
+typedef struct {
+  uint32_t NbWakeUps;
+  uint32_t NbFalseWakeUps;
+  uint32_t NbCalibrations;
+  uint32_t LastResponseTime;	/* ms between the tag detection and the end of the tag hunting */
+}PRESENCE_STATS;
+
+/* public function	 ----------------------------------------------------------------*/
+int8_t Presence_Start ( uint8_t tagsToFind );
+void Presence_Stop ( void );
+int8_t Presence_Calibrate ( void );
+uint8_t Presence_Process ( void );
+uint16_t Presence_ReadNDEF ( sNDEFCacheEntry_t **ppEntry );
+void Presence_Sleep ( void );
+PRESENCE_STATE Presence_GetState ( void );
+const PRESENCE_STATS* Presence_GetStats ( void );
+
+#endif
+#endif
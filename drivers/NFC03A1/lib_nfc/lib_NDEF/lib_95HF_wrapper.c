@@ -33,12 +33,27 @@
 
 #include "lib_wrapper.h"
 #include "lib_ndef.h"
+#include "lib_NDEF_Cache.h"
 
 #include "../lib_pcd/lib_nfctype1pcd.h"
 #include "../lib_pcd/lib_nfctype2pcd.h"
 #include "../lib_pcd/lib_nfctype3pcd.h"
 #include "../lib_pcd/lib_nfctype4pcd.h"
 #include "../lib_pcd/lib_nfctype5pcd.h"
+#include "../lib_pcd/lib_iso15693inventory.h"
+
+/* On-demand read of the NDEF file of the tag in the field (type 2 and type 5) */
+#define TAG_NDEF_READ_CHUNK             32    /* bytes read per exchange on a type 5 tag */
+#define TAG_NDEF_T2_PAGE_SIZE           4
+#define TAG_NDEF_T2_CC_PAGE             3
+#define TAG_NDEF_T2_DATA_START          16    /* page 4 */
+#define TAG_NDEF_T2_MAX_PAGE            0xFF  /* no sector select : first kilobyte only */
+#define TAG_NDEF_T2_SENDRECV_PARAM      0x28  /* 8 significant bits in last byte, append CRC */
+#define TAG_NDEF_T5_CC_MAGIC_EXT        0xE2
+#define TAG_NDEF_CC_SIZE                4
+#define TAG_NDEF_CC_EXT_SIZE            8     /* type 5 : memory size on 2 bytes when CC[2] is 0 */
+#define TAG_NDEF_TLV_TERMINATOR         0xFE
+#define TAG_NDEF_TLV_LENGTH_3_BYTES     0xFF
 
  /* Variables for the different modes */
 extern DeviceMode_t devicemode;
@@ -80,10 +95,121 @@ extern uint8_t TT5Tag[];
   */
 
 
+/* NDEF TLV of the tag in the field, located by OpenTagNDEF : while TagType is defined, ReadData reads the tag */
+static struct
+{
+  TagType_t TagType;
+  uint16_t MessageStart;      /* byte address of the message in the tag memory */
+  uint16_t MessageSize;
+} TagNDEF = { UNDEFINED_TAG_TYPE, 0, 0 };
+
 /** @defgroup lib_95HF_Private_Functions
   * @{
   */ 
 
+static uint16_t TagNDEF_Read( uint16_t Address, uint16_t Size, uint8_t* pData );
+static uint16_t TagNDEF_ReadFile( uint16_t Offset, uint16_t DataSize, uint8_t* pData );
+
+/**
+  * @brief  This fonction reads bytes of the memory of the tag in the field.
+  * @param  Address : byte address in the tag memory (page 0 or block 0 is address 0).
+  * @param  Size : Number of byte to read.
+  * @param  pData : pointer on buffer to store read data.
+  * @retval NDEF_OK : bytes read.
+  * @retval NDEF_ERROR : the tag did not answer or the address is not reachable.
+  */
+static uint16_t TagNDEF_Read( uint16_t Address, uint16_t Size, uint8_t* pData )
+{
+  uint8_t Reply[TAG_NDEF_READ_CHUNK + PCD_DATA_OFFSET + 8];
+  uint16_t First, Skip, Length;
+
+  while( Size > 0 )
+  {
+    switch( TagNDEF.TagType )
+    {
+      case TT2:
+      {
+        /* READ gives 4 pages (16 bytes) from the page requested */
+        uint8_t Command[] = { PCDNFCT2_READ, 0, TAG_NDEF_T2_SENDRECV_PARAM };
+
+        if( Address / TAG_NDEF_T2_PAGE_SIZE > TAG_NDEF_T2_MAX_PAGE )
+          return NDEF_ERROR;
+        Command[1] = (uint8_t)(Address / TAG_NDEF_T2_PAGE_SIZE);
+        if( PCD_SendRecv( sizeof(Command), Command, Reply ) != PCD_SUCCESSCODE )
+          return NDEF_ERROR;
+        if( Reply[PCD_LENGTH_OFFSET] < PCDNFCT2_READ_SIZE )
+          return NDEF_ERROR;
+        First = PCD_DATA_OFFSET;
+        Skip = Address % TAG_NDEF_T2_PAGE_SIZE;
+        Length = PCDNFCT2_READ_SIZE - Skip;
+        break;
+      }
+
+      case TT5:
+      {
+        /* Read Multiple Blocks on the blocks covering the bytes, TAG_NDEF_READ_CHUNK bytes at most */
+        ISO15693_TAG_INFO Tag;
+        uint16_t NbBlocks;
+
+        Skip = Address % ISO15693_NBBYTE_BLOCKLENGTH;
+        NbBlocks = (Skip + Size + ISO15693_NBBYTE_BLOCKLENGTH - 1) / ISO15693_NBBYTE_BLOCKLENGTH;
+        if( NbBlocks > TAG_NDEF_READ_CHUNK / ISO15693_NBBYTE_BLOCKLENGTH )
+          NbBlocks = TAG_NDEF_READ_CHUNK / ISO15693_NBBYTE_BLOCKLENGTH;
+        ISO15693_SetUnaddressedTag( &Tag, ISO15693INV_DEFAULT_FLAGS, ISO15693_NBBYTE_BLOCKLENGTH, (uint8_t)NbBlocks );
+        if( ISO15693_ReadTagMemory( &Tag, Address / ISO15693_NBBYTE_BLOCKLENGTH, NbBlocks, Reply ) != ISO15693_SUCCESSCODE )
+          return NDEF_ERROR;
+        First = 0;
+        Length = NbBlocks * ISO15693_NBBYTE_BLOCKLENGTH - Skip;
+        break;
+      }
+
+      default:
+        return NDEF_ERROR;
+    }
+
+    if( Length > Size )
+      Length = Size;
+    memcpy( pData, &Reply[First + Skip], Length );
+    pData += Length;
+    Address += Length;
+    Size -= Length;
+  }
+  return NDEF_OK;
+}
+
+/**
+  * @brief  This fonction reads the NDEF file (2 bytes of size + message) from the tag in the field.
+  * @param  Offset : Offset in the NDEF file.
+  * @param  DataSize : Number of byte to read.
+  * @param  pData : pointer on buffer to store read data.
+  * @retval NDEF_OK : bytes read, the bytes after the end of the message are set to 0.
+  * @retval NDEF_ERROR : the tag did not answer.
+  */
+static uint16_t TagNDEF_ReadFile( uint16_t Offset, uint16_t DataSize, uint8_t* pData )
+{
+  uint16_t Length;
+
+  /* the size of the file is the length of the TLV, it is not stored as such in the tag */
+  while( (DataSize > 0) && (Offset < FIRST_RECORD_OFFSET) )
+  {
+    *pData++ = (Offset == NDEF_SIZE_OFFSET) ? (uint8_t)(TagNDEF.MessageSize >> 8) : (uint8_t)TagNDEF.MessageSize;
+    Offset++;
+    DataSize--;
+  }
+  if( DataSize == 0 )
+    return NDEF_OK;
+
+  Offset -= FIRST_RECORD_OFFSET;
+  Length = (Offset < TagNDEF.MessageSize) ? (TagNDEF.MessageSize - Offset) : 0;
+  if( Length > DataSize )
+    Length = DataSize;
+  /* a read-ahead window may go past the message : nothing is read there */
+  memset( &pData[Length], 0, DataSize - Length );
+  if( Length == 0 )
+    return NDEF_OK;
+  return TagNDEF_Read( TagNDEF.MessageStart + Offset, Length, pData );
+}
+
 /**
   * @}
   */ 
@@ -102,6 +228,15 @@ extern uint8_t TT5Tag[];
 uint16_t ReadData( uint16_t Offset , uint16_t DataSize , uint8_t* pData )
 {
   uint16_t i;
+
+  /* NDEF file opened on the tag : read on demand, the RAM image is not used */
+  if( TagNDEF.TagType != UNDEFINED_TAG_TYPE )
+  {
+    if( TagNDEF.TagType == nfc_tagtype )
+      return TagNDEF_ReadFile( Offset, DataSize, pData );
+    TagNDEF.TagType = UNDEFINED_TAG_TYPE;
+  }
+
   switch( nfc_tagtype )
   {		
     case TT1:
@@ -249,6 +384,11 @@ uint16_t ReadData( uint16_t Offset , uint16_t DataSize , uint8_t* pData )
 uint16_t WriteData( uint16_t Offset, uint32_t DataSize, uint8_t* pData )
 {
   uint16_t index = 0, i, sum = 0;
+  /* the RAM image is written then copied to the tag : it is the one to read from now on */
+  CloseTagNDEF( );
+  /* the cached content of this tag is no longer valid */
+  if( devicemode == PCD )
+    NDEFCache_Invalidate( );
   switch( nfc_tagtype )
   {
     case TT1:
@@ -381,6 +521,93 @@ uint16_t WriteData( uint16_t Offset, uint32_t DataSize, uint8_t* pData )
   return NDEF_OK;
 }
 
+/**
+  * @brief  This fonction locates the NDEF message in the tag in the field : until CloseTagNDEF, ReadData
+  *         reads the tag on demand instead of the RAM image filled by PCDNFCTx_ReadNDEF.
+  * @note   Tag hunting must have been done (nfc_tagtype). Type 2 and type 5 tags only : the CC and
+  *         the TLVs before the NDEF TLV are read, a few exchanges. The tag must stay in the field.
+  * @retval NDEF_OK : the NDEF message of the tag is found.
+  * @retval NDEF_ERROR : no NDEF TLV, tag not answering or tag type not supported.
+  */
+uint16_t OpenTagNDEF( void )
+{
+  uint8_t CC[TAG_NDEF_CC_EXT_SIZE];
+  uint8_t TLV[4];
+  uint16_t Address, End, Length;
+
+  TagNDEF.TagType = nfc_tagtype;
+  Address = End = 0;
+  switch( nfc_tagtype )
+  {
+    case TT2:
+      /* CC in page 3, then the data area */
+      if( (TagNDEF_Read( TAG_NDEF_T2_CC_PAGE * TAG_NDEF_T2_PAGE_SIZE, TAG_NDEF_CC_SIZE, CC ) == NDEF_OK) &&
+          (CC[0] == PCDNFCT2_NDEF_MNB) )
+      {
+        Address = TAG_NDEF_T2_DATA_START;
+        End = TAG_NDEF_T2_DATA_START + CC[2] * 8;
+      }
+      break;
+
+    case TT5:
+      /* CC in block 0, and block 1 for the 8 bytes CC of the large tags */
+      if( (TagNDEF_Read( 0, TAG_NDEF_CC_EXT_SIZE, CC ) == NDEF_OK) &&
+          ((CC[0] == PCDNFCT2_NDEF_MNB) || (CC[0] == TAG_NDEF_T5_CC_MAGIC_EXT)) )
+      {
+        Address = (CC[2] != 0) ? TAG_NDEF_CC_SIZE : TAG_NDEF_CC_EXT_SIZE;
+        /* the memory size of the CC counts the data area only */
+        End = Address + ((CC[2] != 0) ? (CC[2] * 8) : (uint16_t)( ((CC[6] << 8) | CC[7]) * 8 ));
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  /* lock and memory control TLVs may come before the NDEF TLV */
+  while( Address < End )
+  {
+    if( TagNDEF_Read( Address, sizeof(TLV), TLV ) != NDEF_OK )
+      break;
+    if( TLV[0] == PCDNFCT2_TLV_EMPTY )
+    {
+      Address++;
+      continue;
+    }
+    if( TLV[0] == TAG_NDEF_TLV_TERMINATOR )
+      break;
+    if( TLV[1] == TAG_NDEF_TLV_LENGTH_3_BYTES )
+    {
+      Length = (uint16_t)( (TLV[2] << 8) | TLV[3] );
+      Address += 4;
+    }
+    else
+    {
+      Length = TLV[1];
+      Address += 2;
+    }
+    if( TLV[0] == PCDNFCT2_TLV_NDEF )
+    {
+      if( (uint32_t)Address + Length > End )
+        break;
+      TagNDEF.MessageStart = Address;
+      TagNDEF.MessageSize = Length;
+      return NDEF_OK;
+    }
+    Address += Length;
+  }
+  TagNDEF.TagType = UNDEFINED_TAG_TYPE;
+  return NDEF_ERROR;
+}
+
+/**
+  * @brief  This fonction ends the on-demand read : ReadData reads the RAM image again.
+  */
+void CloseTagNDEF( void )
+{
+  TagNDEF.TagType = UNDEFINED_TAG_TYPE;
+}
+
 /**
   * @}
   */ 
@@ -58,6 +58,9 @@ static void NDEF_ParseForumExternalType( sRecordInfo_t *pRecordStruct );
 static void NDEF_ParseURI( sRecordInfo_t *pRecordStruct );
 static void NDEF_ParseSP( sRecordInfo_t *pRecordStruct );
 static uint16_t NDEF_IdentifySPRecord( sRecordInfo_t *pRecordStruct, uint8_t* pPayload );
+static uint16_t NDEF_IteratorFetch( sNDEFIterator_t *pIterator, uint16_t Offset, uint16_t Size, uint8_t **ppData );
+static uint16_t NDEF_ParseChunkHeader( sNDEFIterator_t *pIterator, uint16_t Offset, uint8_t *pFlags, sNDEFView_t *pType, sNDEFView_t *pID, sNDEFView_t *pPayload );
+static uint8_t NDEF_IsType( const uint8_t *pType, uint8_t TypeLength, const char *pString, uint8_t StringLength );
 
 uint8_t NDEF_Buffer [NDEF_MAX_SIZE];
 
@@ -348,6 +351,112 @@ static void NDEF_ParseSP( sRecordInfo_t *pRecordStruct )
   while( (OffsetInSPPayload < PayloadSize) && RecordPosition<SP_MAX_RECORD); /* there is another record */
 }
 
+/**
+  * @brief  This function gives access to bytes of the NDEF file through the iterator window.
+  * @param  pIterator : iterator owning the window.
+  * @param  Offset : offset in the NDEF file (ReadData offset).
+  * @param  Size : number of bytes needed, at most NDEF_ITERATOR_WINDOW_SIZE.
+  * @param  ppData : set to the bytes in the window.
+  * @retval NDEF_OK : bytes available.
+  * @retval NDEF_ERROR : bytes outside the message or not readable.
+  */
+static uint16_t NDEF_IteratorFetch( sNDEFIterator_t *pIterator, uint16_t Offset, uint16_t Size, uint8_t **ppData )
+{
+  uint32_t Length;
+
+  /* already in the window */
+  if( (Offset >= pIterator->WindowOffset) &&
+      ((uint32_t)Offset + Size <= (uint32_t)pIterator->WindowOffset + pIterator->WindowLength) )
+  {
+    *ppData = &pIterator->Window[Offset - pIterator->WindowOffset];
+    return NDEF_OK;
+  }
+
+  if( (Size > NDEF_ITERATOR_WINDOW_SIZE) || (Offset >= pIterator->MessageEnd) )
+    return NDEF_ERROR;
+
+  /* read ahead : the type and the ID usually follow the header */
+  Length = pIterator->MessageEnd - Offset;
+  if( Length > NDEF_ITERATOR_WINDOW_SIZE )
+    Length = NDEF_ITERATOR_WINDOW_SIZE;
+  if( Length < Size )
+    return NDEF_ERROR;
+
+  pIterator->WindowLength = 0;
+  if( ReadData( Offset, Length, pIterator->Window ) != NDEF_OK )
+    return NDEF_ERROR;
+  pIterator->WindowOffset = Offset;
+  pIterator->WindowLength = Length;
+
+  *ppData = pIterator->Window;
+  return NDEF_OK;
+}
+
+/**
+  * @brief  This function parses the header of a record (or of a chunk of a chunked record).
+  * @param  pIterator : iterator giving the message bounds.
+  * @param  Offset : offset of the header in the NDEF file.
+  * @param  pFlags : record flags.
+  * @param  pType, pID, pPayload : views filled with the position of the fields.
+  * @retval NDEF_OK : header parsed.
+  * @retval NDEF_ERROR : header or payload goes beyond the message.
+  */
+static uint16_t NDEF_ParseChunkHeader( sNDEFIterator_t *pIterator, uint16_t Offset, uint8_t *pFlags, sNDEFView_t *pType, sNDEFView_t *pID, sNDEFView_t *pPayload )
+{
+  uint8_t *pHeader;
+  uint16_t HeaderSize;
+  uint32_t PayloadLength, End;
+  uint8_t TypeLength, IDLength = 0;
+
+  /* flags and type length first, to know the size of the header */
+  if( NDEF_IteratorFetch( pIterator, Offset, RECORD_FLAG_FIELD + TYPE_LENGTH_FIELD, &pHeader ) != NDEF_OK )
+    return NDEF_ERROR;
+
+  HeaderSize = RECORD_FLAG_FIELD + TYPE_LENGTH_FIELD + ((pHeader[0] & SR_Mask) ? 1 : 4) + ((pHeader[0] & IL_Mask) ? ID_LENGTH_FIELD : 0);
+  if( NDEF_IteratorFetch( pIterator, Offset, HeaderSize, &pHeader ) != NDEF_OK )
+    return NDEF_ERROR;
+
+  *pFlags = pHeader[0];
+  TypeLength = pHeader[1];
+  /* it's a SR */
+  if( pHeader[0] & SR_Mask )
+  {
+    PayloadLength = pHeader[2];
+    if( pHeader[0] & IL_Mask )
+      IDLength = pHeader[3];
+  }
+  else
+  {
+    PayloadLength = ((uint32_t)pHeader[2] << 24) | ((uint32_t)pHeader[3] << 16) | ((uint32_t)pHeader[4] << 8) | pHeader[5];
+    if( pHeader[0] & IL_Mask )
+      IDLength = pHeader[6];
+  }
+
+  /* type, ID and payload follow the header in this order */
+  End = (uint32_t)Offset + HeaderSize + TypeLength + IDLength + PayloadLength;
+  if( (PayloadLength > pIterator->MessageEnd) || (End > pIterator->MessageEnd) )
+    return NDEF_ERROR;
+
+  pType->Offset = Offset + HeaderSize;
+  pType->Length = TypeLength;
+  pID->Offset = pType->Offset + TypeLength;
+  pID->Length = IDLength;
+  pPayload->Offset = pID->Offset + IDLength;
+  pPayload->Length = PayloadLength;
+
+  return NDEF_OK;
+}
+
+/**
+  * @brief  This function compares a record type with a type string.
+  * @retval 1 : same type.
+  * @retval 0 : different type.
+  */
+static uint8_t NDEF_IsType( const uint8_t *pType, uint8_t TypeLength, const char *pString, uint8_t StringLength )
+{
+  return (TypeLength == StringLength) && !memcmp( pType, pString, StringLength );
+}
+
 /**
   * @}
   */
@@ -591,6 +700,289 @@ uint16_t NDEF_IdentifyBuffer( sRecordInfo_t *pRecordStruct, uint8_t* pNDEF )
 
   return NDEF_OK;
 }
+
+/**
+  * @brief  This function starts a lazy iteration on the records of the NDEF message stored in tag.
+  * @note   Records are not copied : NDEF_IteratorNext gives the position of their fields,
+  *         the bytes are read with NDEF_ReadView / NDEF_ReadPayload only when needed.
+  * @note   The windows are read with ReadData : from the RAM image of the tag filled by
+  *         PCDNFCTx_ReadNDEF, or from the tag itself after OpenTagNDEF (see NDEF_IteratorInitTag).
+  * @param  pIterator : iterator to initialize.
+  * @retval NDEF_OK : the tag contains a NDEF message.
+  * @retval NDEF_ERROR : no NDEF in the tag.
+  */
+uint16_t NDEF_IteratorInit( sNDEFIterator_t *pIterator )
+{
+  uint16_t FileSize;
+
+  pIterator->Done = 1;
+  pIterator->WindowOffset = NDEF_SIZE_OFFSET;
+  pIterator->WindowLength = 0;
+
+  /* the size and the beginning of the first record in one read */
+  if( ReadData( NDEF_SIZE_OFFSET, NDEF_ITERATOR_WINDOW_SIZE, pIterator->Window ) != NDEF_OK )
+    return NDEF_ERROR;
+
+  FileSize = (uint16_t)( (pIterator->Window[0x00]<<8) | pIterator->Window[0x01] );
+  if( (FileSize == 0) || (FileSize > 0xFFFF - FIRST_RECORD_OFFSET) )
+    return NDEF_ERROR;
+
+  pIterator->Offset = FIRST_RECORD_OFFSET;
+  pIterator->MessageEnd = FIRST_RECORD_OFFSET + FileSize;
+  pIterator->WindowLength = (pIterator->MessageEnd < NDEF_ITERATOR_WINDOW_SIZE) ? pIterator->MessageEnd : NDEF_ITERATOR_WINDOW_SIZE;
+  pIterator->Done = 0;
+
+  return NDEF_OK;
+}
+
+/**
+  * @brief  This function starts a lazy iteration on the records of the tag in the field, read on demand.
+  * @note   Tag hunting must have been done. The tag is not read whole first : once its NDEF TLV is
+  *         located, each window is read from the tag (type 2 READ, type 5 Read Multiple Blocks),
+  *         so a message larger than the RAM images can be walked. Type 2 and type 5 tags only.
+  * @note   ReadData keeps reading the tag until CloseTagNDEF or WriteData.
+  * @param  pIterator : iterator to initialize.
+  * @retval NDEF_OK : the tag contains a NDEF message.
+  * @retval NDEF_ERROR : no NDEF in the tag, or tag type without on-demand read.
+  */
+uint16_t NDEF_IteratorInitTag( sNDEFIterator_t *pIterator )
+{
+  pIterator->Done = 1;
+  pIterator->WindowLength = 0;
+
+  if( OpenTagNDEF( ) != NDEF_OK )
+    return NDEF_ERROR;
+  return NDEF_IteratorInit( pIterator );
+}
+
+/**
+  * @brief  This function starts an iteration on the records nested in a payload (Smart Poster for instance).
+  * @param  pIterator : iterator to initialize.
+  * @param  pRecord : record containing a NDEF message, not chunked.
+  * @retval NDEF_OK : iterator ready.
+  * @retval NDEF_ERROR : empty or chunked payload.
+  */
+uint16_t NDEF_IteratorInitPayload( sNDEFIterator_t *pIterator, const sNDEFRecordView_t *pRecord )
+{
+  pIterator->Done = 1;
+  pIterator->WindowLength = 0;
+
+  if( (pRecord->NbOfChunks != 1) || (pRecord->Payload.Length == 0) )
+    return NDEF_ERROR;
+
+  pIterator->Offset = pRecord->Payload.Offset;
+  pIterator->MessageEnd = pRecord->Payload.Offset + pRecord->Payload.Length;
+  pIterator->Done = 0;
+
+  return NDEF_OK;
+}
+
+/**
+  * @brief  This function gives the next record of the message.
+  * @note   A chunked record is returned as one record : its chunks are walked to get the
+  *         whole payload length, their payloads are read with NDEF_ReadPayload.
+  * @param  pIterator : iterator.
+  * @param  pRecord : record view to fill.
+  * @retval NDEF_OK : record found.
+  * @retval NDEF_ERROR : no more record, or malformed message.
+  */
+uint16_t NDEF_IteratorNext( sNDEFIterator_t *pIterator, sNDEFRecordView_t *pRecord )
+{
+  sNDEFView_t Type, ID, Payload;
+  uint8_t Flags;
+  uint16_t Offset;
+
+  if( pIterator->Done || (pIterator->Offset >= pIterator->MessageEnd) )
+    return NDEF_ERROR;
+
+  Offset = pIterator->Offset;
+  if( NDEF_ParseChunkHeader( pIterator, Offset, &Flags, &pRecord->Type, &pRecord->ID, &pRecord->Payload ) != NDEF_OK )
+    goto Error;
+
+  pRecord->RecordFlags = Flags;
+  pRecord->RecordOffset = Offset;
+  pRecord->PayloadLength = pRecord->Payload.Length;
+  pRecord->NbOfChunks = 1;
+  Offset = pRecord->Payload.Offset + pRecord->Payload.Length;
+
+  /* next chunks : unchanged TNF, no type, CF cleared on the last one */
+  while( Flags & CF_Mask )
+  {
+    if( NDEF_ParseChunkHeader( pIterator, Offset, &Flags, &Type, &ID, &Payload ) != NDEF_OK )
+      goto Error;
+    if( ((Flags & TNF_Mask) != TNF_Unchanged) || (Type.Length != 0) )
+      goto Error;
+
+    pRecord->PayloadLength += Payload.Length;
+    pRecord->NbOfChunks++;
+    Offset = Payload.Offset + Payload.Length;
+  }
+
+  /* ME is carried by the last chunk */
+  pRecord->RecordFlags = (pRecord->RecordFlags & ~ME_Mask) | (Flags & ME_Mask);
+  pRecord->NextOffset = Offset;
+  pRecord->ChunkPayload = pRecord->Payload;
+  pRecord->ChunkStart = 0;
+
+  pIterator->Offset = Offset;
+  if( Flags & ME_Mask )
+    pIterator->Done = 1;
+
+  return NDEF_OK;
+
+Error:
+  pIterator->Done = 1;
+  return NDEF_ERROR;
+}
+
+/**
+  * @brief  This function reads a part of a field (type, ID or payload of one chunk).
+  * @param  pIterator : iterator, its window is used for short reads.
+  * @param  pView : field.
+  * @param  Offset : first byte to read in the field.
+  * @param  Size : number of bytes to read.
+  * @param  pData : buffer to store read data.
+  * @retval NDEF_OK : data read.
+  * @retval NDEF_ERROR : out of the field or not readable.
+  */
+uint16_t NDEF_ReadView( sNDEFIterator_t *pIterator, const sNDEFView_t *pView, uint32_t Offset, uint16_t Size, uint8_t *pData )
+{
+  uint8_t *pWindow;
+
+  if( ((uint32_t)Offset + Size) > pView->Length )
+    return NDEF_ERROR;
+  if( Size == 0 )
+    return NDEF_OK;
+
+  if( (Size <= NDEF_ITERATOR_WINDOW_SIZE) &&
+      (NDEF_IteratorFetch( pIterator, pView->Offset + Offset, Size, &pWindow ) == NDEF_OK) )
+  {
+    memcpy( pData, pWindow, Size );
+    return NDEF_OK;
+  }
+
+  /* long read : straight into the caller buffer */
+  return ReadData( pView->Offset + Offset, Size, pData );
+}
+
+/**
+  * @brief  This function reads a part of the payload of a record, whatever the number of chunks.
+  * @note   Reading the payload in increasing offsets walks each chunk header only once.
+  * @param  pIterator : iterator which gave the record.
+  * @param  pRecord : record, its current chunk is updated.
+  * @param  Offset : first byte to read in the whole payload.
+  * @param  Size : number of bytes to read.
+  * @param  pData : buffer to store read data.
+  * @retval NDEF_OK : data read.
+  * @retval NDEF_ERROR : out of the payload or not readable.
+  */
+uint16_t NDEF_ReadPayload( sNDEFIterator_t *pIterator, sNDEFRecordView_t *pRecord, uint32_t Offset, uint16_t Size, uint8_t *pData )
+{
+  sNDEFView_t Type, ID;
+  uint8_t Flags;
+  uint32_t NbByte;
+
+  if( ((uint32_t)Offset + Size) > pRecord->PayloadLength )
+    return NDEF_ERROR;
+
+  /* going backward : restart from the first chunk */
+  if( Offset < pRecord->ChunkStart )
+  {
+    pRecord->ChunkPayload = pRecord->Payload;
+    pRecord->ChunkStart = 0;
+  }
+
+  while( Size > 0 )
+  {
+    /* walk to the chunk containing Offset */
+    while( Offset >= pRecord->ChunkStart + pRecord->ChunkPayload.Length )
+    {
+      pRecord->ChunkStart += pRecord->ChunkPayload.Length;
+      if( NDEF_ParseChunkHeader( pIterator, pRecord->ChunkPayload.Offset + pRecord->ChunkPayload.Length, &Flags, &Type, &ID, &pRecord->ChunkPayload ) != NDEF_OK )
+        return NDEF_ERROR;
+    }
+
+    NbByte = pRecord->ChunkStart + pRecord->ChunkPayload.Length - Offset;
+    if( NbByte > Size )
+      NbByte = Size;
+    if( NDEF_ReadView( pIterator, &pRecord->ChunkPayload, Offset - pRecord->ChunkStart, NbByte, pData ) != NDEF_OK )
+      return NDEF_ERROR;
+
+    Offset += NbByte;
+    pData += NbByte;
+    Size -= NbByte;
+  }
+
+  return NDEF_OK;
+}
+
+/**
+  * @brief  This function identifies a record like NDEF_IdentifyNDEF, reading only its type
+  *         and the first bytes of its payload.
+  * @param  pIterator : iterator which gave the record.
+  * @param  pRecord : record.
+  * @retval NDEF type of the record.
+  */
+NDEF_TypeDef NDEF_IdentifyRecordView( sNDEFIterator_t *pIterator, const sNDEFRecordView_t *pRecord )
+{
+  uint8_t Type[M24SR_DISCOVERY_APP_STRING_LENGTH];
+  uint8_t Prefix[1 + SMS_TYPE_STRING_LENGTH];   /* URI identifier + "sms:" or "geo:" */
+  uint8_t TypeLength = pRecord->Type.Length;
+
+  /* longer than any type known by the library */
+  if( pRecord->Type.Length > sizeof(Type) )
+    return UNKNOWN_TYPE;
+  if( NDEF_ReadView( pIterator, &pRecord->Type, 0, TypeLength, Type ) != NDEF_OK )
+    return UNKNOWN_TYPE;
+
+  switch( pRecord->RecordFlags & TNF_Mask )
+  {
+    case TNF_WellKnown:
+      if( NDEF_IsType( Type, TypeLength, SMART_POSTER_TYPE_STRING, SMART_POSTER_TYPE_STRING_LENGTH ) )
+        return SMARTPOSTER_TYPE;
+      if( NDEF_IsType( Type, TypeLength, TEXT_TYPE_STRING, TEXT_TYPE_STRING_LENGTH ) )
+        return TEXT_TYPE;
+      if( !NDEF_IsType( Type, TypeLength, URI_TYPE_STRING, URI_TYPE_STRING_LENGTH ) )
+        return UNKNOWN_TYPE;
+
+      /* it's an URI Type check if it's an URL or SMS or ... */
+      memset( Prefix, 0, sizeof(Prefix) );
+      if( NDEF_ReadView( pIterator, &pRecord->Payload, 0,
+                         (pRecord->Payload.Length < sizeof(Prefix)) ? pRecord->Payload.Length : sizeof(Prefix), Prefix ) != NDEF_OK
+          || pRecord->Payload.Length == 0 )
+        return UNKNOWN_TYPE;
+      if( Prefix[0] == URI_ID_0x00 )
+      {
+        if( !memcmp( &Prefix[1], SMS_TYPE_STRING, SMS_TYPE_STRING_LENGTH ) )
+          return URI_SMS_TYPE;
+        if( !memcmp( &Prefix[1], GEO_TYPE_STRING, GEO_TYPE_STRING_LENGTH ) )
+          return URI_GEO_TYPE;
+        return UNKNOWN_TYPE;
+      }
+      /* email special case  */
+      if( Prefix[0] == URI_ID_0x06 )
+        return URI_EMAIL_TYPE;
+      if( Prefix[0] < URI_RFU )
+        return WELL_KNOWN_ABRIDGED_URI_TYPE;
+      return UNKNOWN_TYPE;
+
+    case TNF_MediaType:
+      if( NDEF_IsType( Type, TypeLength, VCARD_TYPE_STRING, VCARD_TYPE_STRING_LENGTH ) ||
+          NDEF_IsType( Type, TypeLength, XVCARD_TYPE_STRING, XVCARD_TYPE_STRING_LENGTH ) ||
+          NDEF_IsType( Type, TypeLength, XVCARD2_TYPE_STRING, XVCARD2_TYPE_STRING_LENGTH ) )
+        return VCARD_TYPE;
+      return UNKNOWN_TYPE;
+
+    case TNF_NFCForumExternal:
+      if( NDEF_IsType( Type, TypeLength, M24SR_DISCOVERY_APP_STRING, M24SR_DISCOVERY_APP_STRING_LENGTH ) )
+        return M24SR_DISCOVERY_APP_TYPE;
+      return UNKNOWN_TYPE;
+
+    default:
+      /* currently not supported or unknown*/
+      return UNKNOWN_TYPE;
+  }
+}
 	
 /**
   * @}
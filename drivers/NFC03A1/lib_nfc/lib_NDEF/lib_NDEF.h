@@ -246,12 +246,59 @@ struct sRecordInfo
   uint8_t NbOfRecordInSPPayload;
 };
 
+/* Zero-copy record iterator --------------------------------------------------*/
+/* bytes read at once from the tag : a record header and a short type fit in one read */
+#ifndef NDEF_ITERATOR_WINDOW_SIZE
+#define NDEF_ITERATOR_WINDOW_SIZE   32
+#endif
+
+/* part of the NDEF file : offset as given to ReadData, nothing is copied */
+typedef struct
+{
+  uint16_t Offset;
+  uint32_t Length;
+} sNDEFView_t;
+
+typedef struct sNDEFRecordView sNDEFRecordView_t;
+struct sNDEFRecordView
+{
+  uint8_t RecordFlags;          /* MB, ME, SR, IL and TNF of the first chunk, ME of the last one */
+  sNDEFView_t Type;
+  sNDEFView_t ID;
+  sNDEFView_t Payload;          /* payload of the first chunk */
+  uint32_t PayloadLength;       /* whole payload, all chunks included */
+  uint16_t RecordOffset;        /* first byte of the record */
+  uint16_t NextOffset;          /* first byte after the last chunk */
+  uint8_t NbOfChunks;
+  /* chunk reached by the last NDEF_ReadPayload */
+  sNDEFView_t ChunkPayload;
+  uint32_t ChunkStart;          /* offset of this chunk in the whole payload */
+};
+
+typedef struct
+{
+  uint16_t Offset;              /* next record */
+  uint16_t MessageEnd;          /* first byte after the message */
+  uint8_t Done;
+  uint16_t WindowOffset;
+  uint16_t WindowLength;
+  uint8_t Window[NDEF_ITERATOR_WINDOW_SIZE];
+} sNDEFIterator_t;
+
 
 uint16_t NDEF_IdentifyNDEF( sRecordInfo_t *pRecordStruct, uint8_t* pNDEF );
 uint16_t NDEF_IdentifyBuffer( sRecordInfo_t *pRecordStruct, uint8_t* pNDEF );
 uint16_t NDEF_ReadNDEF( uint8_t *pNDEF );
 uint16_t NDEF_WriteNDEF( uint8_t *pNDEF );
 
+uint16_t NDEF_IteratorInit( sNDEFIterator_t *pIterator );
+uint16_t NDEF_IteratorInitTag( sNDEFIterator_t *pIterator );
+uint16_t NDEF_IteratorInitPayload( sNDEFIterator_t *pIterator, const sNDEFRecordView_t *pRecord );
+uint16_t NDEF_IteratorNext( sNDEFIterator_t *pIterator, sNDEFRecordView_t *pRecord );
+uint16_t NDEF_ReadView( sNDEFIterator_t *pIterator, const sNDEFView_t *pView, uint32_t Offset, uint16_t Size, uint8_t *pData );
+uint16_t NDEF_ReadPayload( sNDEFIterator_t *pIterator, sNDEFRecordView_t *pRecord, uint32_t Offset, uint16_t Size, uint8_t *pData );
+NDEF_TypeDef NDEF_IdentifyRecordView( sNDEFIterator_t *pIterator, const sNDEFRecordView_t *pRecord );
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,352 @@
+/**
+  ******************************************************************************
+  * @file    lib_NDEF_Cache.c
+  * @author  DEEP Project
+  * @date    Oct 17, 2026
+  * @brief   Cache of the NDEF content of the last tags read, keyed by UID.
+  ******************************************************************************
+  * A tag presented again is recognised by its UID. One short read of the beginning
+  * of its memory (capability container, NDEF TLV length and first records) gives a
+  * fingerprint : if it has not changed since the tag was cached, the summary and the
+  * message are served from RAM instead of reading and parsing the whole tag.
+  *
+  * Only type 2 and type 5 tags have a one-exchange probe. Type 1 tags are read in
+  * one READALL anyway, type 3 and 4 need several exchanges to reach the NDEF file :
+  * they are always read (and still cached, NDEFCache_Lookup can be used with a
+  * fingerprint computed by the application).
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "config.h"
+#if USE_NFC03A1
+#include "lib_NDEF_Cache.h"
+#include "lib_wrapper.h"
+#include "../lib_pcd/lib_iso15693inventory.h"
+#include "../lib_pcd/lib_iso14443A4pcd.h"
+#include "stm32g4_crc.h"
+
+/** @addtogroup NFC_libraries
+  * @{
+  */
+
+/** @addtogroup libNFC_FORUM
+  * @{
+  */
+
+/* Type 2 READ : 16 bytes from page 3 (CC) */
+#define NDEF_CACHE_T2_READ              0x30
+#define NDEF_CACHE_T2_CC_PAGE           0x03
+#define NDEF_CACHE_T2_READ_SIZE         16
+#define NDEF_CACHE_T2_SENDRECV_PARAM    0x28  /* 8 significant bits in last byte, append CRC */
+
+extern TagType_t nfc_tagtype;
+extern uint8_t CardNDEFfileT4A[];
+
+static sNDEFCacheEntry_t NDEFCache[NDEF_CACHE_NB_ENTRIES];
+static uint32_t NDEFCacheClock = 0;
+/* entry of the last tag read : updated on NDEF write */
+static sNDEFCacheEntry_t *pNDEFCacheCurrent = NULL;
+
+/** @defgroup libNDEFCache_Private_Functions
+  * @{
+  */
+
+static uint16_t NDEFCache_ReadNDEFFromTag( void );
+static void NDEFCache_Summarize( sNDEFCacheEntry_t *pEntry );
+
+/**
+  * @brief  This function reads the NDEF of the tag in the field with the PCD library of its type
+  *         (the ISO14443-4 layer for type 4A).
+  * @retval NDEF_OK : the NDEF is in the tag RAM image, ReadData can be used.
+  * @retval NDEF_ERROR : read failed.
+  */
+static uint16_t NDEFCache_ReadNDEFFromTag( void )
+{
+  uint8_t status;
+
+  switch( nfc_tagtype )
+  {
+    case TT1:
+      status = PCDNFCT1_ReadNDEF( );
+      break;
+    case TT2:
+      status = PCDNFCT2_ReadNDEF( );
+      break;
+    case TT3:
+      status = PCDNFCT3_ReadNDEF( );
+      break;
+    case TT4A:
+    {
+      uint16_t Size;
+
+      /* ISO-DEP layer : PPS, full frames and chained READ BINARY. No DESELECT, the next
+         tag hunting switches the field off */
+      if( ISO14443A4_Activate( ) != ISO14443A4_SUCCESSCODE )
+        return NDEF_ERROR;
+      status = (ISO14443A4_ReadNDEFFile( CardNDEFfileT4A, NFCT4A_MAX_NDEFMEMORY, &Size ) == ISO14443A4_SUCCESSCODE) ? PCDNFC_OK : PCDNFC_ERROR;
+      break;
+    }
+    case TT4B:
+      status = PCDNFCT4_ReadNDEF( );
+      break;
+    case TT5:
+      status = PCDNFCT5_ReadNDEF( );
+      break;
+    default:
+      return NDEF_ERROR;
+  }
+
+  return (status == PCDNFC_OK) ? NDEF_OK : NDEF_ERROR;
+}
+
+/**
+  * @brief  This function fills the summary of an entry from the NDEF just read.
+  * @param  pEntry : entry to fill.
+  */
+static void NDEFCache_Summarize( sNDEFCacheEntry_t *pEntry )
+{
+  sNDEFIterator_t Iterator;
+  sNDEFRecordView_t Record;
+
+  pEntry->NDEFSize = 0;
+  pEntry->NbOfRecords = 0;
+  pEntry->MessageValid = 0;
+
+  if( NDEF_IteratorInit( &Iterator ) != NDEF_OK )
+    return;
+  pEntry->NDEFSize = Iterator.MessageEnd - FIRST_RECORD_OFFSET;
+
+  while( NDEF_IteratorNext( &Iterator, &Record ) == NDEF_OK )
+  {
+    if( pEntry->NbOfRecords < NDEF_CACHE_NB_TYPES )
+      pEntry->RecordType[pEntry->NbOfRecords] = NDEF_IdentifyRecordView( &Iterator, &Record );
+    if( pEntry->NbOfRecords < 0xFF )
+      pEntry->NbOfRecords++;
+  }
+
+  /* whole NDEF file, as NDEF_ReadNDEF would give it */
+  if( pEntry->NDEFSize <= NDEF_CACHE_MESSAGE_SIZE )
+  {
+    if( ReadData( NDEF_SIZE_OFFSET, FIRST_RECORD_OFFSET + pEntry->NDEFSize, pEntry->Message ) == NDEF_OK )
+      pEntry->MessageValid = 1;
+  }
+}
+
+/**
+  * @}
+  */
+
+/** @defgroup libNDEFCache_Public_Functions
+  * @{
+  */
+
+/**
+  * @brief  This function reads the beginning of the tag in the field and computes its fingerprint.
+  * @param  pFingerprint : CRC-32 of the bytes read.
+  * @retval NDEF_OK : fingerprint computed.
+  * @retval NDEF_ERROR : read failed or no short read for this tag type.
+  */
+uint16_t NDEFCache_Probe( uint32_t *pFingerprint )
+{
+  uint8_t Probe[NDEF_CACHE_PROBE_SIZE + PCD_DATA_OFFSET + 8];
+  uint16_t ProbeSize;
+
+  switch( nfc_tagtype )
+  {
+    case TT2:
+    {
+      uint8_t Command[] = { NDEF_CACHE_T2_READ, NDEF_CACHE_T2_CC_PAGE, NDEF_CACHE_T2_SENDRECV_PARAM };
+
+      /* pages 3 to 6 : CC, then lock/memory TLVs and the NDEF TLV with its length */
+      if( PCD_SendRecv( sizeof(Command), Command, Probe ) != PCD_SUCCESSCODE )
+        return NDEF_ERROR;
+      if( Probe[PCD_LENGTH_OFFSET] < NDEF_CACHE_T2_READ_SIZE )
+        return NDEF_ERROR;
+      ProbeSize = NDEF_CACHE_T2_READ_SIZE;
+      memmove( Probe, &Probe[PCD_DATA_OFFSET], ProbeSize );
+      break;
+    }
+
+    case TT5:
+    {
+      ISO15693_TAG_INFO Tag;
+
+      /* CC in block 0, NDEF TLV from block 1 : one Read Multiple Blocks */
+      ProbeSize = NDEF_CACHE_PROBE_SIZE - (NDEF_CACHE_PROBE_SIZE % ISO15693_NBBYTE_BLOCKLENGTH);
+      ISO15693_SetUnaddressedTag( &Tag, ISO15693INV_DEFAULT_FLAGS, ISO15693_NBBYTE_BLOCKLENGTH, ProbeSize / ISO15693_NBBYTE_BLOCKLENGTH );
+      if( ISO15693_ReadTagMemory( &Tag, 0, ProbeSize / ISO15693_NBBYTE_BLOCKLENGTH, Probe ) != ISO15693_SUCCESSCODE )
+        return NDEF_ERROR;
+      break;
+    }
+
+    default:
+      return NDEF_ERROR;
+  }
+
+  *pFingerprint = BSP_CRC_compute( CRC_32, Probe, ProbeSize );
+  return NDEF_OK;
+}
+
+/**
+  * @brief  This function searches a tag in the cache.
+  * @param  pUID : UID of the tag.
+  * @param  UIDLength : UID size.
+  * @param  Fingerprint : fingerprint just read on the tag.
+  * @retval the entry of the tag, NULL if unknown or modified since cached.
+  */
+sNDEFCacheEntry_t* NDEFCache_Lookup( const uint8_t *pUID, uint8_t UIDLength, uint32_t Fingerprint )
+{
+  uint8_t i;
+
+  if( (UIDLength == 0) || (UIDLength > NDEF_CACHE_UID_MAX_SIZE) )
+    return NULL;
+
+  for( i = 0; i < NDEF_CACHE_NB_ENTRIES; i++ )
+  {
+    sNDEFCacheEntry_t *pEntry = &NDEFCache[i];
+
+    if( (pEntry->UIDLength != UIDLength) || (pEntry->TagType != nfc_tagtype) || memcmp( pEntry->UID, pUID, UIDLength ) )
+      continue;
+
+    /* same tag, rewritten since : forget it */
+    if( pEntry->Fingerprint != Fingerprint )
+    {
+      pEntry->UIDLength = 0;
+      return NULL;
+    }
+
+    pEntry->LastUse = ++NDEFCacheClock;
+    pNDEFCacheCurrent = pEntry;
+    return pEntry;
+  }
+
+  return NULL;
+}
+
+/**
+  * @brief  This function caches the NDEF just read from the tag (PCDNFCTx_ReadNDEF done).
+  * @note   The least recently used entry is replaced.
+  * @param  pUID : UID of the tag.
+  * @param  UIDLength : UID size.
+  * @param  Fingerprint : fingerprint read before the NDEF.
+  * @retval the entry of the tag, NULL if the UID can not be cached.
+  */
+sNDEFCacheEntry_t* NDEFCache_Store( const uint8_t *pUID, uint8_t UIDLength, uint32_t Fingerprint )
+{
+  sNDEFCacheEntry_t *pEntry = NULL, *pVictim = &NDEFCache[0];
+  uint8_t i;
+
+  if( (UIDLength == 0) || (UIDLength > NDEF_CACHE_UID_MAX_SIZE) )
+    return NULL;
+
+  for( i = 0; i < NDEF_CACHE_NB_ENTRIES; i++ )
+  {
+    /* same tag : update in place */
+    if( (NDEFCache[i].UIDLength == UIDLength) && (NDEFCache[i].TagType == nfc_tagtype) && !memcmp( NDEFCache[i].UID, pUID, UIDLength ) )
+    {
+      pEntry = &NDEFCache[i];
+      break;
+    }
+    /* a free entry, or else the least recently used one */
+    if( (pVictim->UIDLength != 0) && ((NDEFCache[i].UIDLength == 0) || (NDEFCache[i].LastUse < pVictim->LastUse)) )
+      pVictim = &NDEFCache[i];
+  }
+  if( pEntry == NULL )
+    pEntry = pVictim;
+
+  pEntry->TagType = nfc_tagtype;
+  memcpy( pEntry->UID, pUID, UIDLength );
+  pEntry->UIDLength = UIDLength;
+  pEntry->Fingerprint = Fingerprint;
+  pEntry->LastUse = ++NDEFCacheClock;
+  NDEFCache_Summarize( pEntry );
+
+  pNDEFCacheCurrent = pEntry;
+  return pEntry;
+}
+
+/**
+  * @brief  This function gives the NDEF of the tag in the field, from the cache when possible.
+  * @note   Tag hunting must have been done : nfc_tagtype is the type of the tag.
+  * @param  pUID : UID of the tag (anticollision or inventory).
+  * @param  UIDLength : UID size.
+  * @param  ppEntry : entry of the tag.
+  * @retval NDEF_CACHE_HIT : known tag, nothing read but the probe.
+  * @retval NDEF_CACHE_MISS : NDEF read from the tag and cached.
+  * @retval NDEF_ERROR : NDEF can not be read.
+  */
+uint16_t NDEFCache_ReadTag( const uint8_t *pUID, uint8_t UIDLength, sNDEFCacheEntry_t **ppEntry )
+{
+  uint32_t Fingerprint = 0;
+  uint16_t ProbeStatus;
+
+  ProbeStatus = NDEFCache_Probe( &Fingerprint );
+  if( ProbeStatus == NDEF_OK )
+  {
+    *ppEntry = NDEFCache_Lookup( pUID, UIDLength, Fingerprint );
+    if( *ppEntry != NULL )
+      return NDEF_CACHE_HIT;
+  }
+
+  if( NDEFCache_ReadNDEFFromTag( ) != NDEF_OK )
+    return NDEF_ERROR;
+
+  /* without a fingerprint, a cached content can not be trusted next time */
+  if( ProbeStatus != NDEF_OK )
+  {
+    *ppEntry = NULL;
+    return NDEF_CACHE_MISS;
+  }
+
+  *ppEntry = NDEFCache_Store( pUID, UIDLength, Fingerprint );
+  return NDEF_CACHE_MISS;
+}
+
+/**
+  * @brief  This function gives the NDEF file of a cached tag, like NDEF_ReadNDEF.
+  * @param  pEntry : entry of the tag.
+  * @param  pNDEF : buffer to fill (2 bytes of size + message).
+  * @retval NDEF_OK : NDEF copied.
+  * @retval NDEF_ERROR_MEMORY_INTERNAL : message too long to be cached, read it from the tag.
+  */
+uint16_t NDEFCache_ReadNDEF( const sNDEFCacheEntry_t *pEntry, uint8_t *pNDEF )
+{
+  if( (pEntry == NULL) || !pEntry->MessageValid )
+    return NDEF_ERROR_MEMORY_INTERNAL;
+
+  memcpy( pNDEF, pEntry->Message, FIRST_RECORD_OFFSET + pEntry->NDEFSize );
+  return NDEF_OK;
+}
+
+/**
+  * @brief  This function forgets the last tag read, its NDEF is being written.
+  */
+void NDEFCache_Invalidate( void )
+{
+  if( pNDEFCacheCurrent != NULL )
+    pNDEFCacheCurrent->UIDLength = 0;
+  pNDEFCacheCurrent = NULL;
+}
+
+/**
+  * @brief  This function empties the cache.
+  */
+void NDEFCache_Clear( void )
+{
+  memset( NDEFCache, 0, sizeof(NDEFCache) );
+  pNDEFCacheCurrent = NULL;
+}
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+#endif
@@ -0,0 +1,77 @@
+/**
+  ******************************************************************************
+  * @file    lib_NDEF_Cache.h
+  * @author  DEEP Project
+  * @date    Oct 17, 2026
+  * @brief   Cache of the NDEF content of the last tags read, keyed by UID.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __LIB_NDEF_CACHE_H
+#define __LIB_NDEF_CACHE_H
+#include "config.h"
+#if USE_NFC03A1
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "lib_NDEF.h"
+#include "../common/lib_95HF.h"
+
+/* Number of tags remembered (least recently used one is replaced) */
+#ifndef NDEF_CACHE_NB_ENTRIES
+#define NDEF_CACHE_NB_ENTRIES       4
+#endif
+/* NDEF messages up to this size are kept whole, longer ones only as a summary */
+#ifndef NDEF_CACHE_MESSAGE_SIZE
+#define NDEF_CACHE_MESSAGE_SIZE     128
+#endif
+/* Record types kept in the summary */
+#ifndef NDEF_CACHE_NB_TYPES
+#define NDEF_CACHE_NB_TYPES         4
+#endif
+/* Bytes read at the beginning of the tag memory (CC, NDEF TLV length, first records) to check
+   a known tag has not been rewritten : one Read Multiple Blocks for type 5, one READ for type 2 */
+#ifndef NDEF_CACHE_PROBE_SIZE
+#define NDEF_CACHE_PROBE_SIZE       32
+#endif
+#define NDEF_CACHE_UID_MAX_SIZE     10
+
+/* NDEFCache_ReadTag status */
+#define NDEF_CACHE_HIT              0x10
+#define NDEF_CACHE_MISS             0x11
+
+typedef struct
+{
+  TagType_t TagType;
+  uint8_t UID[NDEF_CACHE_UID_MAX_SIZE];
+  uint8_t UIDLength;                    /* 0 : free entry */
+  uint32_t Fingerprint;                 /* CRC-32 of the probe bytes */
+  uint32_t LastUse;
+  /* summary */
+  uint16_t NDEFSize;                    /* size of the message */
+  uint8_t NbOfRecords;
+  NDEF_TypeDef RecordType[NDEF_CACHE_NB_TYPES];
+  /* NDEF file as given by NDEF_ReadNDEF (size + message), if it fits */
+  uint8_t MessageValid;
+  uint8_t Message[FIRST_RECORD_OFFSET + NDEF_CACHE_MESSAGE_SIZE];
+} sNDEFCacheEntry_t;
+
+uint16_t NDEFCache_Probe( uint32_t *pFingerprint );
+sNDEFCacheEntry_t* NDEFCache_Lookup( const uint8_t *pUID, uint8_t UIDLength, uint32_t Fingerprint );
+sNDEFCacheEntry_t* NDEFCache_Store( const uint8_t *pUID, uint8_t UIDLength, uint32_t Fingerprint );
+uint16_t NDEFCache_ReadTag( const uint8_t *pUID, uint8_t UIDLength, sNDEFCacheEntry_t **ppEntry );
+uint16_t NDEFCache_ReadNDEF( const sNDEFCacheEntry_t *pEntry, uint8_t *pNDEF );
+void NDEFCache_Invalidate( void );
+void NDEFCache_Clear( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LIB_NDEF_CACHE_H */
+
+#endif
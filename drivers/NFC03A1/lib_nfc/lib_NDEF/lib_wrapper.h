@@ -39,6 +39,8 @@
 
 uint16_t ReadData( uint16_t Offset, uint16_t DataSize, uint8_t* pData );
 uint16_t WriteData( uint16_t Offset, uint32_t DataSize, uint8_t* pData );
+uint16_t OpenTagNDEF( void );
+void CloseTagNDEF( void );
 
 #endif /* __LIB_WRAPPER_H */
 
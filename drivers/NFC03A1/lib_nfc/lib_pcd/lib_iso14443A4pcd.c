@@ -0,0 +1,625 @@
+/**
+  ******************************************************************************
+  * @file    lib_iso14443A4pcd.c
+  * @author  DEEP Project
+  * @date    Oct 17, 2026
+  * @brief   ISO14443-4 (ISO-DEP) layer for type A cards : RATS/PPS, block chaining, APDU
+  ******************************************************************************
+  * After the anticollision, ISO14443A4_Activate sends RATS with the largest frame size
+  * the 95HF can receive, reads the frame size, timings and bit rates of the card from
+  * its ATS, and sends a PPS to switch both directions to the highest rate supported by
+  * the card and the reader. The 95HF is then reconfigured with these rates and the frame
+  * waiting time of the card.
+  *
+  * ISO14443A4_Exchange sends a C-APDU in I-blocks of the card frame size (chaining) and
+  * gathers the chained R-APDU, handling WTX requests and transmission errors.
+  * ISO14443A4_ReadBinary sizes READ BINARY commands so that each R-APDU fills whole
+  * frames : a type 4 NDEF file is read with the smallest number of round trips.
+  *
+  * Each frame exchanged is counted and timed (DWT cycle counter) to measure the gain.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------------------ */
+#include "config.h"
+#if USE_NFC03A1
+#include "lib_iso14443A4pcd.h"
+#include "lib_iso7816pcd.h"
+#include <stdio.h>
+
+extern uint8_t	u95HFBuffer [RFTRANS_95HF_MAX_BUFFER_SIZE+3];
+
+/* Private defines ----------------------------------------------------------------------- */
+#define ISO14443A4_SENDRECV_CTRL		0x28	/* 8 significant bits in the last byte, append CRC */
+#define ISO14443A4_REPLY_TRAILER		(2 + ISO14443A_NBBYTE)	/* CRC and 95HF control bytes after the frame */
+
+/* PCB */
+#define ISO14443A4_PCB_TYPE_MASK		0xC0
+#define ISO14443A4_PCB_IBLOCK			0x02
+#define ISO14443A4_PCB_RBLOCK			0xA2
+#define ISO14443A4_PCB_SBLOCK			0xC2
+#define ISO14443A4_PCB_BLOCKNUMBER		0x01
+#define ISO14443A4_PCB_CHAINING			0x10	/* I-block */
+#define ISO14443A4_PCB_NAK				0x10	/* R-block */
+#define ISO14443A4_PCB_WTX				0x30	/* S-block, 0x00 : DESELECT */
+#define ISO14443A4_WTXM_MASK			0x3F
+
+/* ATS */
+#define ISO14443A4_T0_TA				0x10
+#define ISO14443A4_T0_TB				0x20
+#define ISO14443A4_T0_TC				0x40
+#define ISO14443A4_T0_FSCI_MASK			0x0F
+#define ISO14443A4_TA_SAME_D			0x80
+#define ISO14443A4_DEFAULT_FWI			4
+
+/* PPS */
+#define ISO14443A4_PPSS					COMMAND_PPS
+#define ISO14443A4_PPS0_PPS1			0x11
+
+/* Type 4 NDEF application */
+#define ISO14443A4_CC_FILE_ID			0xE103
+#define ISO14443A4_CC_SIZE				15
+#define ISO14443A4_SW_OK				0x9000
+
+/* Private variables --------------------------------------------------------------------- */
+ISO14443A4_SESSION			ISO14443A4_Session;
+static ISO14443A4_STATS		ISO14443A4_Stats;
+/* last frame received : u95HFBuffer is reused by the protocol select of a WTX */
+static uint8_t				ISO14443A4_Reply[RFTRANS_95HF_MAX_BUFFER_SIZE];
+
+static const uint16_t		FSTable[] = {16, 24, 32, 40, 48, 64, 96, 128, 256};
+static const uint8_t		NDEFApplication[] = {0xD2, 0x76, 0x00, 0x00, 0x85, 0x01, 0x01};
+
+
+/** @addtogroup _95HF_Libraries
+ * 	@{
+ */
+
+/** @addtogroup PCD
+ * 	@{
+ */
+
+/** @addtogroup ISO14443A4_pcd
+ * 	@{
+ *	@brief  This part of the library is used to follow ISO14443-4 with type A cards.
+ */
+
+/** @addtogroup lib_iso14443A4pcd_Private_Functions
+ *  @{
+ */
+
+/**
+* @brief  	sends a frame and returns the card frame, without its CRC
+* @param	pFrame			:	frame to send (without CRC)
+* @param	Length			:	number of bytes
+* @param	ppReply			:	frame received
+* @param	pReplyLength	:	number of bytes received
+* @retval 	ISO14443A4_SUCCESSCODE	: 	a valid frame has been received
+* @retval 	ISO14443A4_ERRORCODE_DEFAULT	: 	timeout, CRC or transmission error
+*/
+static int8_t ISO14443A4_Transceive(const uint8_t *pFrame, const uint16_t Length, uint8_t **ppReply, uint16_t *pReplyLength)
+{
+	uint8_t		Frame[ISO14443A4_PCD_MAX_FSC + 1];
+	uint8_t		*pDataRead = u95HFBuffer;
+	uint32_t	Start;
+	int8_t		status;
+
+	if (Length > ISO14443A4_PCD_MAX_FSC)
+		return ISO14443A4_ERRORCODE_DEFAULT;
+
+	memcpy(Frame, pFrame, Length);
+	Frame[Length] = ISO14443A4_SENDRECV_CTRL;
+
+	Start = DWT->CYCCNT;
+	status = PCD_SendRecv(Length + 1, Frame, pDataRead);
+	ISO14443A4_Stats.Cycles += DWT->CYCCNT - Start;
+	ISO14443A4_Stats.NbExchanges++;
+	ISO14443A4_Stats.NbTxBytes += Length;
+
+	if (status != PCD_SUCCESSCODE)
+		return ISO14443A4_ERRORCODE_DEFAULT;
+	if (PCD_IsCRCOk(PCD_PROTOCOL_ISO14443A, pDataRead) != PCD_SUCCESSCODE)
+		return ISO14443A4_ERRORCODE_DEFAULT;
+	if (pDataRead[PCD_LENGTH_OFFSET] <= ISO14443A4_REPLY_TRAILER)
+		return ISO14443A4_ERRORCODE_DEFAULT;
+
+	*pReplyLength = pDataRead[PCD_LENGTH_OFFSET] - ISO14443A4_REPLY_TRAILER;
+	memcpy(ISO14443A4_Reply, &pDataRead[PCD_DATA_OFFSET], *pReplyLength);
+	*ppReply = ISO14443A4_Reply;
+	ISO14443A4_Stats.NbRxBytes += *pReplyLength;
+	return ISO14443A4_SUCCESSCODE;
+}
+
+/**
+* @brief  	configures the 95HF with the negotiated bit rates and the frame waiting time of the card
+* @param	WTXM	:	frame waiting time multiplier (1 out of a WTX request)
+* @retval 	ISO14443A4_SUCCESSCODE	: 	95HF configured
+* @retval 	ISO14443A4_ERRORCODE_DEFAULT	: 	protocol select failed
+*/
+static int8_t ISO14443A4_SelectProtocol(const uint8_t WTXM)
+{
+	/* FWT = 2^PP * (MM+1) * (DD+128) * 32 / fc : PP = FWI, DD = 0 gives the FWT of the card */
+	uint8_t		ProtocolSelectParameters[] = {	(uint8_t)((ISO14443A4_Session.DR << 6) | (ISO14443A4_Session.DS << 4)),
+												ISO14443A4_Session.FWI,
+												(uint8_t)(WTXM - 1),
+												0x00 };
+	uint8_t		*pDataRead = u95HFBuffer;
+
+	if (PCD_ProtocolSelect(sizeof(ProtocolSelectParameters) + 1, PCD_PROTOCOL_ISO14443A, ProtocolSelectParameters, pDataRead) != PCD_SUCCESSCODE)
+		return ISO14443A4_ERRORCODE_DEFAULT;
+	if (PCD_IsReaderResultCodeOk(PROTOCOL_SELECT, pDataRead) != PCD_SUCCESSCODE)
+		return ISO14443A4_ERRORCODE_DEFAULT;
+
+	return ISO14443A4_SUCCESSCODE;
+}
+
+/**
+* @brief  	reads the frame size, the timings and the bit rates of the card from its ATS
+* @param	pATS	:	ATS (TL first)
+* @param	Length	:	number of bytes received
+*/
+static void ISO14443A4_ParseATS(const uint8_t *pATS, const uint16_t Length)
+{
+	uint8_t		TL = pATS[0],
+				T0 = 0x02,					/* FSCI = 2 (32 bytes) when T0 is absent */
+				TA = 0x00,
+				TB = ISO14443A4_DEFAULT_FWI << 4,
+				i = 1;
+	uint8_t		DS = 0, DR = 0;
+
+	ISO14443A4_Session.ATSLength = (Length < ISO14443A4_ATS_MAX_SIZE) ? Length : ISO14443A4_ATS_MAX_SIZE;
+	memcpy(ISO14443A4_Session.ATS, pATS, ISO14443A4_Session.ATSLength);
+
+	if (TL > Length)
+		TL = Length;
+	if (i < TL)
+		T0 = pATS[i++];
+	if ((T0 & ISO14443A4_T0_TA) && i < TL)
+		TA = pATS[i++];
+	if ((T0 & ISO14443A4_T0_TB) && i < TL)
+		TB = pATS[i++];
+
+	ISO14443A4_Session.FSC = FSTable[((T0 & ISO14443A4_T0_FSCI_MASK) < 8) ? (T0 & ISO14443A4_T0_FSCI_MASK) : 8];
+	if (ISO14443A4_Session.FSC > ISO14443A4_PCD_MAX_FSC)
+		ISO14443A4_Session.FSC = ISO14443A4_PCD_MAX_FSC;
+	ISO14443A4_Session.FWI = TB >> 4;
+	if (ISO14443A4_Session.FWI > 14)
+		ISO14443A4_Session.FWI = ISO14443A4_DEFAULT_FWI;
+	ISO14443A4_Session.SFGI = TB & 0x0F;
+	if (ISO14443A4_Session.SFGI > 14)
+		ISO14443A4_Session.SFGI = 0;
+
+	/* TA : bits 7-5 card to reader (DS = 8, 4, 2), bits 3-1 reader to card (DR = 8, 4, 2) */
+	for (i = 1; i <= 3; i++)
+	{
+		if ((TA & (0x08 << i)) && i <= ISO14443A4_PCD_MAX_DS)
+			DS = i;
+		if ((TA & (0x01 << (i - 1))) && i <= ISO14443A4_PCD_MAX_DR)
+			DR = i;
+	}
+	if (TA & ISO14443A4_TA_SAME_D)
+		DS = DR = (DS < DR) ? DS : DR;
+
+	ISO14443A4_Session.DS = DS;
+	ISO14443A4_Session.DR = DR;
+}
+
+/**
+* @brief  	sends a block and handles the card WTX requests and the transmission errors
+* @param	pFrame		:	block to send
+* @param	Length		:	number of bytes
+* @param	RecoveryPCB	:	R-block sent after a transmission error
+* @param	pPCB		:	PCB of the block received
+* @param	ppINF		:	INF field of the block received
+* @param	pINFLength	:	INF size
+* @retval 	ISO14443A4_SUCCESSCODE	: 	a block has been received
+* @retval 	ISO14443A4_ERRORCODE_DEFAULT	: 	no valid block after the retries
+*/
+static int8_t ISO14443A4_SendBlock(const uint8_t *pFrame, const uint16_t Length, const uint8_t RecoveryPCB, uint8_t *pPCB, uint8_t **ppINF, uint16_t *pINFLength)
+{
+	const uint8_t	*pSent = pFrame;
+	uint16_t		SentLength = Length;
+	uint8_t			Frame[2];
+	uint8_t			*pReply;
+	uint16_t		ReplyLength;
+	uint8_t			Retry = 0;
+	bool			Extended = false;
+
+	while (1)
+	{
+		if (ISO14443A4_Transceive(pSent, SentLength, &pReply, &ReplyLength) == ISO14443A4_SUCCESSCODE)
+		{
+			*pPCB = pReply[0];
+			*ppINF = &pReply[1];
+			*pINFLength = ReplyLength - 1;
+
+			/* S(WTX) : the card needs more time, acknowledged with the same multiplier */
+			if ((*pPCB & ~ISO14443A4_PCB_BLOCKNUMBER) == (ISO14443A4_PCB_SBLOCK | ISO14443A4_PCB_WTX) && *pINFLength >= 1)
+			{
+				Frame[0] = ISO14443A4_PCB_SBLOCK | ISO14443A4_PCB_WTX;
+				Frame[1] = (*ppINF)[0] & ISO14443A4_WTXM_MASK;
+				if (Frame[1] == 0 || ISO14443A4_SelectProtocol(Frame[1]) != ISO14443A4_SUCCESSCODE)
+					return ISO14443A4_ERRORCODE_DEFAULT;
+				ISO14443A4_Stats.NbWTX++;
+				Extended = true;
+				pSent = Frame;
+				SentLength = 2;
+				continue;
+			}
+
+			/* back to the FWT of the card */
+			if (Extended && ISO14443A4_SelectProtocol(1) != ISO14443A4_SUCCESSCODE)
+				return ISO14443A4_ERRORCODE_DEFAULT;
+			return ISO14443A4_SUCCESSCODE;
+		}
+
+		if (++Retry > ISO14443A4_MAX_RETRY)
+			return ISO14443A4_ERRORCODE_DEFAULT;
+		ISO14443A4_Stats.NbRetries++;
+
+		/* transmission error : the R-block asks the card to repeat its last block, or to acknowledge ours */
+		Frame[0] = RecoveryPCB;
+		pSent = Frame;
+		SentLength = 1;
+	}
+}
+
+/**
+* @brief  	sends a C-APDU and checks the status word of the R-APDU
+* @param	pCAPDU		:	command
+* @param	CLength		:	command size
+* @param	pData		:	R-APDU data (may be NULL : the data, such as the FCI returned by a SELECT, is then discarded)
+* @param	MaxLength	:	size of pData
+* @param	pLength		:	R-APDU data size (may be NULL)
+* @retval 	ISO14443A4_SUCCESSCODE	: 	SW = 90 00
+* @retval 	ISO14443A4_ERRORCODE_STATUS	: 	other status word
+*/
+static int8_t ISO14443A4_Command(const uint8_t *pCAPDU, const uint16_t CLength, uint8_t *pData, const uint16_t MaxLength, uint16_t *pLength)
+{
+	uint8_t		RAPDU[256 + 2];
+	uint16_t	RLength;
+	int8_t		status;
+
+	errchk(ISO14443A4_Exchange(pCAPDU, CLength, RAPDU, sizeof(RAPDU), &RLength));
+	if (RLength < 2 || (uint16_t)((RAPDU[RLength - 2] << 8) | RAPDU[RLength - 1]) != ISO14443A4_SW_OK)
+		return ISO14443A4_ERRORCODE_STATUS;
+
+	RLength -= 2;
+	if (pData == NULL)
+		RLength = 0;
+	else if (RLength > MaxLength)
+		return ISO14443A4_ERRORCODE_OVERFLOW;
+	if (RLength)
+		memcpy(pData, RAPDU, RLength);
+	if (pLength)
+		*pLength = RLength;
+	return ISO14443A4_SUCCESSCODE;
+Error:
+	return status;
+}
+
+/**
+  * @}
+  */
+
+/** @addtogroup lib_iso14443A4pcd_Public_Functions
+ *  @{
+ */
+
+/**
+* @brief  	activates the ISO14443-4 protocol on the selected card (SAK bit 6 set) :
+* @brief	RATS, PPS to the highest common bit rate, 95HF reconfiguration
+* @retval 	ISO14443A4_SUCCESSCODE	: 	the card is ready for APDU
+* @retval 	ISO14443A4_ERRORCODE_DEFAULT	: 	no ATS
+*/
+int8_t ISO14443A4_Activate(void)
+{
+	uint8_t		RATS[] = {COMMAND_RATS, (ISO14443A4_PCD_FSDI << 4) & ISO14443A_FSDI_MASK};
+	uint8_t		PPS[3];
+	uint8_t		*pReply;
+	uint16_t	ReplyLength;
+
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	memset(&ISO14443A4_Session, 0x00, sizeof(ISO14443A4_Session));
+	ISO14443A4_Session.FSD = FSTable[ISO14443A4_PCD_FSDI];
+	ISO14443A4_Session.MaxLe = 0xFF;
+
+	if (ISO14443A_ConfigFDTforRATS() != ISO14443A_SUCCESSCODE)
+		return ISO14443A4_ERRORCODE_DEFAULT;
+	if (ISO14443A4_Transceive(RATS, sizeof(RATS), &pReply, &ReplyLength) != ISO14443A4_SUCCESSCODE)
+		return ISO14443A4_ERRORCODE_DEFAULT;
+	ISO14443A4_ParseATS(pReply, ReplyLength);
+
+	/* start-up frame guard time : 302 us * 2^SFGI */
+	if (ISO14443A4_Session.SFGI)
+		HAL_Delay(((302UL << ISO14443A4_Session.SFGI) + 999) / 1000);
+
+	if (ISO14443A4_Session.DS || ISO14443A4_Session.DR)
+	{
+		PPS[0] = ISO14443A4_PPSS;
+		PPS[1] = ISO14443A4_PPS0_PPS1;
+		PPS[2] = (ISO14443A4_Session.DS << 2) | ISO14443A4_Session.DR;
+		/* no PPS response : the card stays at 106 kbps */
+		if (ISO14443A4_Transceive(PPS, sizeof(PPS), &pReply, &ReplyLength) != ISO14443A4_SUCCESSCODE || pReply[0] != ISO14443A4_PPSS)
+			ISO14443A4_Session.DS = ISO14443A4_Session.DR = 0;
+	}
+
+	if (ISO14443A4_SelectProtocol(1) != ISO14443A4_SUCCESSCODE)
+		return ISO14443A4_ERRORCODE_DEFAULT;
+
+	ISO14443A4_Session.IsActive = true;
+	return ISO14443A4_SUCCESSCODE;
+}
+
+/**
+* @brief  	sends S(DESELECT) : the card goes to HALT state
+* @retval 	ISO14443A4_SUCCESSCODE	: 	the card acknowledged
+* @retval 	ISO14443A4_ERRORCODE_DEFAULT	: 	no acknowledge
+*/
+int8_t ISO14443A4_Deselect(void)
+{
+	uint8_t		Deselect = ISO14443A4_PCB_SBLOCK;
+	uint8_t		*pReply;
+	uint16_t	ReplyLength;
+
+	ISO14443A4_Session.IsActive = false;
+	if (ISO14443A4_Transceive(&Deselect, 1, &pReply, &ReplyLength) != ISO14443A4_SUCCESSCODE || pReply[0] != Deselect)
+		return ISO14443A4_ERRORCODE_DEFAULT;
+	return ISO14443A4_SUCCESSCODE;
+}
+
+/**
+* @brief  	exchanges an APDU with the card : the C-APDU is chained in blocks of FSC bytes,
+* @brief	the chained blocks of the R-APDU are acknowledged and gathered
+* @param	pCAPDU		:	command
+* @param	CLength		:	command size
+* @param	pRAPDU		:	response, status word included
+* @param	RMaxLength	:	size of pRAPDU
+* @param	pRLength	:	response size
+* @retval 	ISO14443A4_SUCCESSCODE	: 	R-APDU received
+* @retval 	ISO14443A4_ERRORCODE_PROTOCOL	: 	unexpected block
+* @retval 	ISO14443A4_ERRORCODE_OVERFLOW	: 	R-APDU larger than RMaxLength
+* @retval 	ISO14443A4_ERRORCODE_DEFAULT	: 	transmission error
+*/
+int8_t ISO14443A4_Exchange(const uint8_t *pCAPDU, const uint16_t CLength, uint8_t *pRAPDU, const uint16_t RMaxLength, uint16_t *pRLength)
+{
+	uint8_t		Frame[ISO14443A4_PCD_MAX_FSC];
+	uint8_t		PCB, *pINF;
+	uint16_t	INFLength, Chunk, Remaining = CLength;
+	uint16_t	MaxINF = ISO14443A4_Session.FSC - 3;		/* PCB and CRC */
+	uint8_t		Retry;
+	bool		Last;
+	int8_t		status;
+
+	*pRLength = 0;
+	if (!ISO14443A4_Session.IsActive)
+		return ISO14443A4_ERRORCODE_DEFAULT;
+	ISO14443A4_Stats.NbAPDU++;
+
+	/* C-APDU : chained I-blocks, each one acknowledged by R(ACK) except the last one */
+	do
+	{
+		Chunk = (Remaining < MaxINF) ? Remaining : MaxINF;
+		Last = (Chunk == Remaining);
+		Frame[0] = ISO14443A4_PCB_IBLOCK | ISO14443A4_Session.BlockNumber | (Last ? 0 : ISO14443A4_PCB_CHAINING);
+		memcpy(&Frame[1], pCAPDU, Chunk);
+
+		for (Retry = 0; ; Retry++)
+		{
+			errchk(ISO14443A4_SendBlock(Frame, Chunk + 1, ISO14443A4_PCB_RBLOCK | ISO14443A4_PCB_NAK | ISO14443A4_Session.BlockNumber, &PCB, &pINF, &INFLength));
+
+			if (Last && (PCB & ISO14443A4_PCB_TYPE_MASK) == 0x00)
+				break;
+			if ((PCB & ~(ISO14443A4_PCB_BLOCKNUMBER | ISO14443A4_PCB_NAK)) != ISO14443A4_PCB_RBLOCK || (PCB & ISO14443A4_PCB_NAK))
+				return ISO14443A4_ERRORCODE_PROTOCOL;
+			/* R(ACK) of this block : next chunk */
+			if (!Last && (PCB & ISO14443A4_PCB_BLOCKNUMBER) == ISO14443A4_Session.BlockNumber)
+				break;
+			/* R(ACK) of the previous block : the card did not receive this one */
+			if (Retry >= ISO14443A4_MAX_RETRY)
+				return ISO14443A4_ERRORCODE_DEFAULT;
+			ISO14443A4_Stats.NbRetries++;
+		}
+		ISO14443A4_Session.BlockNumber ^= ISO14443A4_PCB_BLOCKNUMBER;
+
+		pCAPDU += Chunk;
+		Remaining -= Chunk;
+	} while (!Last);
+
+	/* R-APDU : chained I-blocks, each one acknowledged by R(ACK) */
+	while (1)
+	{
+		if (*pRLength + INFLength > RMaxLength)
+			return ISO14443A4_ERRORCODE_OVERFLOW;
+		memcpy(&pRAPDU[*pRLength], pINF, INFLength);
+		*pRLength += INFLength;
+
+		if (!(PCB & ISO14443A4_PCB_CHAINING))
+			return ISO14443A4_SUCCESSCODE;
+
+		Frame[0] = ISO14443A4_PCB_RBLOCK | ISO14443A4_Session.BlockNumber;
+		errchk(ISO14443A4_SendBlock(Frame, 1, Frame[0], &PCB, &pINF, &INFLength));
+		if ((PCB & ISO14443A4_PCB_TYPE_MASK) != 0x00)
+			return ISO14443A4_ERRORCODE_PROTOCOL;
+		ISO14443A4_Session.BlockNumber ^= ISO14443A4_PCB_BLOCKNUMBER;
+	}
+
+Error:
+	return status;
+}
+
+/**
+* @brief  	sends a SELECT command
+* @param	P1			:	0x04 select by name (AID), 0x00 select by file identifier
+* @param	P2			:	0x00 first or only occurence, 0x0C no response data
+* @param	pID			:	AID or file identifier
+* @param	IDLength	:	size of pID
+* @retval 	ISO14443A4_SUCCESSCODE	: 	file selected
+* @retval 	ISO14443A4_ERRORCODE_STATUS	: 	file not found
+*/
+int8_t ISO14443A4_SelectFile(const uint8_t P1, const uint8_t P2, const uint8_t *pID, const uint8_t IDLength)
+{
+	uint8_t		CAPDU[5 + 16 + 1];
+	uint8_t		Length = 0;
+
+	if (IDLength > 16)
+		return ISO14443A4_ERRORCODE_DEFAULT;
+
+	CAPDU[Length++] = ISO7816_CLASS_0X00;
+	CAPDU[Length++] = ISO7816_SELECT_FILE;
+	CAPDU[Length++] = P1;
+	CAPDU[Length++] = P2;
+	CAPDU[Length++] = IDLength;
+	memcpy(&CAPDU[Length], pID, IDLength);
+	Length += IDLength;
+	if (P1 == 0x04)
+		CAPDU[Length++] = 0x00;				/* Le */
+
+	return ISO14443A4_Command(CAPDU, Length, NULL, 0, NULL);
+}
+
+/**
+* @brief  	largest READ BINARY that fills whole frames : the R-APDU (data + SW) is
+* @brief	received in the smallest number of blocks
+* @retval 	number of bytes
+*/
+uint16_t ISO14443A4_GetMaxReadSize(void)
+{
+	uint16_t	MaxINF = ISO14443A4_Session.FSD - 3;		/* PCB and CRC */
+	uint16_t	MaxLe = (ISO14443A4_Session.MaxLe < 0xFF) ? ISO14443A4_Session.MaxLe : 0xFF;
+	uint16_t	NbBlocks = (MaxLe + 2) / MaxINF;
+
+	if (NbBlocks == 0)
+		return MaxLe;
+	return NbBlocks * MaxINF - 2;
+}
+
+/**
+* @brief  	reads a part of the selected file with READ BINARY commands of ISO14443A4_GetMaxReadSize bytes
+* @param	Offset	:	first byte
+* @param	Size	:	number of bytes
+* @param	pData	:	buffer
+* @retval 	ISO14443A4_SUCCESSCODE	: 	all the bytes have been read
+*/
+int8_t ISO14443A4_ReadBinary(const uint16_t Offset, uint16_t Size, uint8_t *pData)
+{
+	uint8_t		CAPDU[5] = {ISO7816_CLASS_0X00, ISO7816_READ_BINARY, 0, 0, 0};
+	uint16_t	Position = Offset, Le, Read;
+	uint16_t	MaxRead = ISO14443A4_GetMaxReadSize();
+	int8_t		status;
+
+	while (Size > 0)
+	{
+		Le = (Size < MaxRead) ? Size : MaxRead;
+		CAPDU[2] = Position >> 8;
+		CAPDU[3] = Position & 0xFF;
+		CAPDU[4] = (uint8_t)Le;
+		errchk(ISO14443A4_Command(CAPDU, sizeof(CAPDU), pData, Le, &Read));
+		if (Read == 0)
+			return ISO14443A4_ERRORCODE_DEFAULT;
+
+		Position += Read;
+		pData += Read;
+		Size -= Read;
+	}
+	return ISO14443A4_SUCCESSCODE;
+Error:
+	return status;
+}
+
+/**
+* @brief  	reads the NDEF file of a type 4 tag : NDEF application, CC file (MLe and NDEF file),
+* @brief	NDEF file length, then the message
+* @param	pNDEF	:	NDEF file (2 bytes of length + message)
+* @param	MaxSize	:	size of pNDEF
+* @param	pSize	:	number of bytes read
+* @retval 	ISO14443A4_SUCCESSCODE	: 	NDEF file read
+* @retval 	ISO14443A4_ERRORCODE_OVERFLOW	: 	message larger than MaxSize
+*/
+int8_t ISO14443A4_ReadNDEFFile(uint8_t *pNDEF, const uint16_t MaxSize, uint16_t *pSize)
+{
+	uint8_t		CC[ISO14443A4_CC_SIZE];
+	uint8_t		FileID[2] = {ISO14443A4_CC_FILE_ID >> 8, ISO14443A4_CC_FILE_ID & 0xFF};
+	uint16_t	Length;
+	int8_t		status;
+
+	*pSize = 0;
+	errchk(ISO14443A4_SelectFile(0x04, 0x00, NDEFApplication, sizeof(NDEFApplication)));
+	errchk(ISO14443A4_SelectFile(0x00, 0x0C, FileID, sizeof(FileID)));
+	errchk(ISO14443A4_ReadBinary(0, sizeof(CC), CC));
+
+	/* CCLEN (2) | version | MLe (2) | MLc (2) | T=04 | L=06 | file id (2) | max size (2) | read | write */
+	Length = (CC[3] << 8) | CC[4];
+	if (Length > 0 && Length < ISO14443A4_Session.MaxLe)
+		ISO14443A4_Session.MaxLe = Length;
+	FileID[0] = CC[9];
+	FileID[1] = CC[10];
+
+	errchk(ISO14443A4_SelectFile(0x00, 0x0C, FileID, sizeof(FileID)));
+	errchk(ISO14443A4_ReadBinary(0, 2, pNDEF));
+	Length = ((pNDEF[0] << 8) | pNDEF[1]) + 2;
+	if (Length > MaxSize)
+		return ISO14443A4_ERRORCODE_OVERFLOW;
+	errchk(ISO14443A4_ReadBinary(2, Length - 2, &pNDEF[2]));
+
+	*pSize = Length;
+	return ISO14443A4_SUCCESSCODE;
+Error:
+	return status;
+}
+
+/**
+* @brief  	clears the exchange counters
+*/
+void ISO14443A4_ResetStats(void)
+{
+	memset(&ISO14443A4_Stats, 0x00, sizeof(ISO14443A4_Stats));
+}
+
+/**
+* @brief  	exchange counters since the last ISO14443A4_ResetStats
+*/
+const ISO14443A4_STATS* ISO14443A4_GetStats(void)
+{
+	return &ISO14443A4_Stats;
+}
+
+/**
+* @brief  	prints the exchange counters and the negotiated parameters
+*/
+void ISO14443A4_PrintStats(void)
+{
+	static const uint16_t	Rates[] = {106, 212, 424, 848};
+	uint32_t	Us = ISO14443A4_Stats.Cycles / (SystemCoreClock / 1000000);
+
+	printf("ISO14443-4 : %d/%d kbps, FSC %d, FSD %d, FWI %d\n",
+			Rates[ISO14443A4_Session.DR], Rates[ISO14443A4_Session.DS],
+			ISO14443A4_Session.FSC, ISO14443A4_Session.FSD, ISO14443A4_Session.FWI);
+	printf("%lu APDU, %lu exchanges (%lu retries, %lu WTX), %lu bytes sent, %lu bytes received\n",
+			ISO14443A4_Stats.NbAPDU, ISO14443A4_Stats.NbExchanges, ISO14443A4_Stats.NbRetries, ISO14443A4_Stats.NbWTX,
+			ISO14443A4_Stats.NbTxBytes, ISO14443A4_Stats.NbRxBytes);
+	if (ISO14443A4_Stats.NbExchanges)
+		printf("%lu us, %lu us per exchange, %lu bytes/s received\n",
+				Us, Us / ISO14443A4_Stats.NbExchanges,
+				Us ? (uint32_t)((uint64_t)ISO14443A4_Stats.NbRxBytes * 1000000 / Us) : 0);
+}
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+#endif
@@ -0,0 +1,87 @@
+/**
+  ******************************************************************************
+  * @file    lib_iso14443A4pcd.h
+  * @author  DEEP Project
+  * @date    Oct 17, 2026
+  * @brief   ISO14443-4 (ISO-DEP) layer for type A cards : RATS/PPS, block chaining, APDU
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _LIB_ISO14443A4PCD_H
+#define _LIB_ISO14443A4PCD_H
+#include "config.h"
+#if USE_NFC03A1
+
+#include "lib_iso14443Apcd.h"
+
+/*  status and error code ----------------------------------------------------*/
+#define ISO14443A4_SUCCESSCODE					RESULTOK
+#define ISO14443A4_ERRORCODE_DEFAULT			0x64
+#define ISO14443A4_ERRORCODE_PROTOCOL			0x65	/* unexpected block from the card */
+#define ISO14443A4_ERRORCODE_OVERFLOW			0x66	/* R-APDU larger than the buffer */
+#define ISO14443A4_ERRORCODE_STATUS				0x67	/* SW1 SW2 different from 90 00 */
+
+/* Reader limits -------------------------------------------------------------*/
+/* FSD = 128 bytes : the largest frame (with its CRC and the 3 control bytes) fitting in a 95HF reply */
+#ifndef ISO14443A4_PCD_FSDI
+#define ISO14443A4_PCD_FSDI						7
+#endif
+/* frames sent are limited by the SendRecv command buffer */
+#ifndef ISO14443A4_PCD_MAX_FSC
+#define ISO14443A4_PCD_MAX_FSC					128
+#endif
+/* highest bit rates of the reader : 0 106 kbps, 1 212 kbps, 2 424 kbps, 3 848 kbps */
+#ifndef ISO14443A4_PCD_MAX_DS
+#define ISO14443A4_PCD_MAX_DS					2		/* card to reader */
+#endif
+#ifndef ISO14443A4_PCD_MAX_DR
+#define ISO14443A4_PCD_MAX_DR					2		/* reader to card */
+#endif
+#define ISO14443A4_MAX_RETRY					2
+#define ISO14443A4_ATS_MAX_SIZE					20
+
+/* Session -------------------------------------------------------------------*/
+typedef struct {
+	uint8_t		ATS[ISO14443A4_ATS_MAX_SIZE];
+	uint8_t		ATSLength;
+	uint16_t	FSC;						/* largest frame accepted by the card */
+	uint16_t	FSD;						/* largest frame accepted by the reader */
+	uint8_t		FWI;
+	uint8_t		SFGI;
+	uint8_t		DS;							/* negotiated rates, same coding as DSI/DRI */
+	uint8_t		DR;
+	uint16_t	MaxLe;						/* R-APDU data limit (MLe of the type 4 CC file) */
+	uint8_t		BlockNumber;
+	bool		IsActive;
+} ISO14443A4_SESSION;
+
+/* Measure of the exchanges --------------------------------------------------*/
+typedef struct {
+	uint32_t	NbExchanges;				/* frames exchanged with the card (round trips) */
+	uint32_t	NbAPDU;
+	uint32_t	NbTxBytes;
+	uint32_t	NbRxBytes;
+	uint32_t	NbRetries;
+	uint32_t	NbWTX;
+	uint32_t	Cycles;						/* time spent in the exchanges, in core cycles */
+} ISO14443A4_STATS;
+
+extern ISO14443A4_SESSION ISO14443A4_Session;
+
+/* Functions -----------------------------------------------------------------*/
+int8_t ISO14443A4_Activate		( void );
+int8_t ISO14443A4_Deselect		( void );
+int8_t ISO14443A4_Exchange		( const uint8_t *pCAPDU, const uint16_t CLength, uint8_t *pRAPDU, const uint16_t RMaxLength, uint16_t *pRLength );
+int8_t ISO14443A4_SelectFile	( const uint8_t P1, const uint8_t P2, const uint8_t *pID, const uint8_t IDLength );
+int8_t ISO14443A4_ReadBinary	( const uint16_t Offset, uint16_t Size, uint8_t *pData );
+uint16_t ISO14443A4_GetMaxReadSize	( void );
+int8_t ISO14443A4_ReadNDEFFile	( uint8_t *pNDEF, const uint16_t MaxSize, uint16_t *pSize );
+
+void ISO14443A4_ResetStats		( void );
+const ISO14443A4_STATS* ISO14443A4_GetStats	( void );
+void ISO14443A4_PrintStats		( void );
+
+#endif /* USE_NFC03A1 */
+
+#endif /* _LIB_ISO14443A4PCD_H */
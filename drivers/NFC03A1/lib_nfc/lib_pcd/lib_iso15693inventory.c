@@ -0,0 +1,618 @@
+/**
+  ******************************************************************************
+  * @file    lib_iso15693inventory.c
+  * @author  DEEP Project
+  * @date    Oct 17, 2026
+  * @brief   Multi-tag ISO15693 inventory and block-read pipeline
+  ******************************************************************************
+  * The exchanges go through the asynchronous 95HF transport (drv95HF_SendReceiveAsync)
+  * with two frame / reply buffers : the next request is sent as soon as the previous
+  * reply is available, and that reply is checked and copied while the 95HF and the
+  * tag handle the next one. With the UART interface the exchanges are simply blocking.
+  *
+  * Inventory : a one slot inventory is tried first (a lone tag costs a single exchange).
+  * On collision, 16 slots inventories are run on a stack of masks : only the slots where
+  * a collision occured are pushed (mask + 4 bits) and inventoried again. Each found tag
+  * is set quiet, so it does not answer in the next rounds.
+  *
+  * Block read : Get System Info gives the block size and the number of blocks of each tag,
+  * Read Multiple Blocks requests are then sized to fill the 95HF buffer, without crossing
+  * a sector boundary.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------------------ */
+#include "config.h"
+#if USE_NFC03A1
+#include "lib_iso15693inventory.h"
+#include "stm32g4_crc.h"
+
+/* Private defines ----------------------------------------------------------------------- */
+/* SEND_RECEIVE | length | flags | command | UID (8) | block number (2) | nb blocks */
+#define ISO15693INV_FRAME_SIZE			20
+/* tag reply : flags | data | CRC (2), followed by the 95HF control byte */
+#define ISO15693INV_MAX_DATA			(RFTRANS_95HF_MAX_BUFFER_SIZE - CONTROL_15693_NBBYTE - 3)
+
+/* Private types ------------------------------------------------------------------------- */
+typedef enum {
+	ISO15693INV_SLOT_EMPTY = 0,
+	ISO15693INV_SLOT_TAG,
+	ISO15693INV_SLOT_COLLISION
+} ISO15693INV_SLOT;
+
+typedef struct {
+	uint8_t		Length;								/* number of bits */
+	uint8_t		Value[ISO15693_NBBYTE_UID];
+} ISO15693INV_MASK;
+
+/* Private variables --------------------------------------------------------------------- */
+static uint8_t				InvFrame[2][ISO15693INV_FRAME_SIZE];
+static uint8_t				InvReply[2][RFTRANS_95HF_MAX_BUFFER_SIZE+3];
+static ISO15693INV_MASK		MaskStack[ISO15693INV_MASK_STACK_SIZE];
+static volatile bool		InvPending = false;
+static volatile uint32_t	InvDoneCycle;
+
+static const uint8_t		EOFFrame[] = {SEND_RECEIVE, 0x00};
+
+
+/** @addtogroup _95HF_Libraries
+ * 	@{
+ */
+
+/** @addtogroup PCD
+ * 	@{
+ */
+
+ /** @addtogroup ISO15693_inventory
+ * 	@{
+ *	@brief  Fast multi-tag inventory and memory read.
+ */
+
+
+/** @addtogroup lib_iso15693inventory_Private_Functions
+ *  @{
+ */
+
+/**
+* @brief  	end of exchange, called by the 95HF driver in interrupt context
+*/
+static void ISO15693INV_ExchangeDone(int8_t status)
+{
+	(void)status;
+	InvDoneCycle = DWT->CYCCNT;
+	InvPending = false;
+}
+
+/**
+* @brief  	starts an exchange with the 95HF device
+* @param  	pFrame		:	SEND_RECEIVE frame
+* @param	pReply		:	95HF reply, valid after ISO15693INV_Wait
+*/
+static void ISO15693INV_Start(const uint8_t *pFrame, uint8_t *pReply)
+{
+	pReply[READERREPLY_STATUSOFFSET] = PCD_ERRORCODE_DEFAULT;
+	pReply[PCD_LENGTH_OFFSET] = 0x00;
+
+	InvPending = true;
+	if (drv95HF_SendReceiveAsync(pFrame, pReply, &ISO15693INV_ExchangeDone) != RFTRANS_95HF_SUCCESS_CODE)
+	{
+		// UART interface or transport used by someone else : blocking exchange
+		InvPending = false;
+		drv95HF_SendReceive(pFrame, pReply);
+		InvDoneCycle = DWT->CYCCNT;
+	}
+}
+
+/**
+* @brief  	waits for the end of the exchange in progress (if any)
+*/
+static void ISO15693INV_Wait(void)
+{
+	while (InvPending)
+		__WFI();
+}
+
+/**
+* @brief  	waits until t2 has elapsed since the last tag reply, before sending an EOF
+*/
+static void ISO15693INV_WaitGuardTime(void)
+{
+	uint32_t Guard = (SystemCoreClock / 1000000) * ISO15693INV_EOF_GUARD_US;
+
+	while (DWT->CYCCNT - InvDoneCycle < Guard);
+}
+
+/**
+* @brief  	writes the SEND_RECEIVE header, the request flags, the command code and the UID (addressed mode)
+* @retval 	pointer on the next byte of the frame
+*/
+static uint8_t *ISO15693INV_NewFrame(uint8_t *pFrame, const uint8_t Flags, const uint8_t Command, const uint8_t *pUID)
+{
+	uint8_t *p = &pFrame[PCD_DATA_OFFSET];
+
+	pFrame[PCD_COMMAND_OFFSET] = SEND_RECEIVE;
+	*p++ = Flags;
+	*p++ = Command;
+	if ((Flags & (ISO15693INV_FLAG_INVENTORY | ISO15693INV_FLAG_ADDRORNBSLOTS)) == ISO15693INV_FLAG_ADDRORNBSLOTS)
+	{
+		memcpy(p, pUID, ISO15693_NBBYTE_UID);
+		p += ISO15693_NBBYTE_UID;
+	}
+	return p;
+}
+
+/**
+* @brief  	writes the length of the frame
+* @param	pEnd		:	pointer after the last byte of the frame
+*/
+static void ISO15693INV_CloseFrame(uint8_t *pFrame, const uint8_t *pEnd)
+{
+	pFrame[PCD_LENGTH_OFFSET] = pEnd - &pFrame[PCD_DATA_OFFSET];
+}
+
+/**
+* @brief  	builds an inventory request
+* @param  	Flags		:	request flags (the NbSlot flag selects 1 or 16 slots)
+*/
+static void ISO15693INV_BuildInventory(uint8_t *pFrame, const uint8_t Flags, const uint8_t AFI, const ISO15693INV_MASK *pMask)
+{
+	uint8_t		*p = ISO15693INV_NewFrame(pFrame, Flags, ISO15693_CMDCODE_INVENTORY, NULL),
+				NbMaskBytes = (pMask->Length + 7) / 8;
+
+	if ((Flags & ISO15693INV_FLAG_SELECTORAFI) != 0x00)
+		*p++ = AFI;
+	*p++ = pMask->Length;
+	memcpy(p, pMask->Value, NbMaskBytes);
+	// unused bits of the last mask byte are 0
+	if ((pMask->Length % 8) != 0)
+		p[NbMaskBytes-1] &= (1 << (pMask->Length % 8)) - 1;
+	p += NbMaskBytes;
+
+	ISO15693INV_CloseFrame(pFrame, p);
+}
+
+/**
+* @brief  	builds a Read Single Block or Read Multiple Blocks request
+* @param  	Block		:	first block of the request
+* @param	End			:	block after the last block to read
+* @retval 	number of blocks requested
+*/
+static uint16_t ISO15693INV_BuildRead(uint8_t *pFrame, const ISO15693_TAG_INFO *pTag, const uint16_t Block, const uint16_t End)
+{
+	uint16_t	Count = pTag->MaxBlocksPerRead,
+				SectorEnd = (Block / ISO15693INV_SECTOR_NB_BLOCKS + 1) * ISO15693INV_SECTOR_NB_BLOCKS;
+	uint8_t		*p;
+
+	if (Count == 0)
+		Count = 1;
+	if (Block + Count > SectorEnd)
+		Count = SectorEnd - Block;
+	if (Block + Count > End)
+		Count = End - Block;
+
+	p = ISO15693INV_NewFrame(pFrame, pTag->RequestFlags & ~ISO15693INV_FLAG_OPTION,
+							 (Count > 1) ? ISO15693_CMDCODE_READMULBLOCKS : ISO15693_CMDCODE_READSINGLEBLOCK,
+							 pTag->UID);
+	*p++ = Block & 0x00FF;
+	if ((pTag->RequestFlags & ISO15693INV_FLAG_PROTEXT) != 0x00)
+		*p++ = (Block & 0xFF00) >> 8;
+	if (Count > 1)
+		*p++ = Count - 1;
+
+	ISO15693INV_CloseFrame(pFrame, p);
+	return Count;
+}
+
+/**
+* @brief  	checks a tag reply : 95HF result code, collision & CRC bits, CRC16 residue and error flag
+* @param	MinLength	:	minimum number of bytes of the tag reply (CRC included)
+* @retval 	ISO15693_SUCCESSCODE : the reply can be used
+* @retval 	ISO15693_ERRORCODE_CRCRESIDUE : CRC16 residue is erroneous
+* @retval 	ISO15693_ERRORCODE_DEFAULT : no reply or error reply
+*/
+static int8_t ISO15693INV_CheckReply(const uint8_t *pReply, const uint8_t MinLength)
+{
+	uint8_t Length = pReply[PCD_LENGTH_OFFSET];
+
+	if (pReply[READERREPLY_STATUSOFFSET] != SENDRECV_RESULTSCODE_OK || Length < MinLength + CONTROL_15693_NBBYTE)
+		return ISO15693_ERRORCODE_DEFAULT;
+	if ((pReply[PCD_LENGTH_OFFSET + Length] & (CONTROL_15693_CRCMASK | CONTROL_15693_COLISIONMASK)) != 0x00)
+		return ISO15693_ERRORCODE_DEFAULT;
+	if (!BSP_CRC_check(CRC_ISO15693, &pReply[PCD_DATA_OFFSET], Length - CONTROL_15693_NBBYTE))
+		return ISO15693_ERRORCODE_CRCRESIDUE;
+	if ((pReply[PCD_DATA_OFFSET] & ISO15693INV_RESPFLAG_ERROR) != 0x00)
+		return ISO15693_ERRORCODE_DEFAULT;
+
+	return ISO15693_SUCCESSCODE;
+}
+
+/**
+* @brief  	classifies the reply of an inventory slot
+*/
+static ISO15693INV_SLOT ISO15693INV_ClassifySlot(const uint8_t *pReply)
+{
+	switch (pReply[READERREPLY_STATUSOFFSET])
+	{
+		case SENDRECV_RESULTSCODE_OK :
+			break;
+		// several tags answered : the 95HF may not even decode a valid SOF
+		case SENDRECV_ERRORCODE_SOF :
+		case SENDRECV_ERRORCODE_RECEPTIONLOST :
+			return ISO15693INV_SLOT_COLLISION;
+		default :
+			return ISO15693INV_SLOT_EMPTY;
+	}
+
+	// a reply with bad CRC is handled as a collision : the slot is inventoried again with a longer mask
+	if (ISO15693INV_CheckReply(pReply, 2 + ISO15693_NBBYTE_UID + 2) != ISO15693_SUCCESSCODE)
+		return ISO15693INV_SLOT_COLLISION;
+
+	return ISO15693INV_SLOT_TAG;
+}
+
+/**
+* @brief  	adds the tag of an inventory reply to the list (unless already known)
+* @param	Flags		:	inventory request flags, data rate and sub-carrier are kept for the next requests
+* @retval 	true if the tag has been added
+*/
+static bool ISO15693INV_AddTag(const uint8_t *pReply, const uint8_t Flags, ISO15693_TAG_INFO *pTags, const uint8_t MaxTags, uint8_t *NbTag)
+{
+	const uint8_t	*pUID = &pReply[PCD_DATA_OFFSET + ISO15693_INVENTORYOFFSET_UID];
+	ISO15693_TAG_INFO	*pTag;
+	uint8_t			i;
+
+	// a tag which missed its Stay Quiet answers again
+	for (i = 0; i < *NbTag; i++)
+	{
+		if (memcmp(pTags[i].UID, pUID, ISO15693_NBBYTE_UID) == 0)
+			return false;
+	}
+	if (*NbTag >= MaxTags)
+		return false;
+
+	pTag = &pTags[(*NbTag)++];
+	memset(pTag, 0x00, sizeof(ISO15693_TAG_INFO));
+	memcpy(pTag->UID, pUID, ISO15693_NBBYTE_UID);
+	pTag->DSFID = pReply[PCD_DATA_OFFSET + ISO15693_INVENTORYOFFSET_DSFID];
+	pTag->RequestFlags = (Flags & (ISO15693INV_FLAG_SUBCARRIER | ISO15693INV_FLAG_DATARATE)) | ISO15693INV_FLAG_ADDRORNBSLOTS;
+	// until Get System Info tells otherwise
+	pTag->BlockSize = ISO15693_NBBYTE_BLOCKLENGTH;
+	pTag->MaxBlocksPerRead = 1;
+	return true;
+}
+
+/**
+* @brief  	sends a Stay Quiet command to the tags First to Last-1, each frame is built while the previous one is on air
+*/
+static void ISO15693INV_StayQuiet(const ISO15693_TAG_INFO *pTags, const uint8_t First, const uint8_t Last)
+{
+	uint8_t i,
+			Nth = 0,
+			*p;
+
+	for (i = First; i < Last; i++)
+	{
+		p = ISO15693INV_NewFrame(InvFrame[Nth], pTags[i].RequestFlags & ~ISO15693INV_FLAG_PROTEXT, ISO15693_CMDCODE_STAYQUIET, pTags[i].UID);
+		ISO15693INV_CloseFrame(InvFrame[Nth], p);
+		// no reply is expected : the exchange ends on the 95HF timeout
+		ISO15693INV_Wait();
+		ISO15693INV_Start(InvFrame[Nth], InvReply[Nth]);
+		Nth ^= 1;
+	}
+	ISO15693INV_Wait();
+}
+
+/**
+* @brief  	runs a 16 slots inventory, the reply of a slot is parsed while the EOF of the next slot is sent
+* @param	pNbMask		:	number of masks on the stack, collided slots are pushed
+* @retval 	false if a collided slot could not be pushed (stack full or mask complete)
+*/
+static bool ISO15693INV_Run16Slots(const uint8_t Flags, const uint8_t AFI, const ISO15693INV_MASK *pMask, uint8_t *pNbMask,
+									ISO15693_TAG_INFO *pTags, const uint8_t MaxTags, uint8_t *NbTag)
+{
+	ISO15693INV_MASK	*pChild;
+	uint8_t				Slot,
+						Nth = 0;
+	bool				Complete = true;
+
+	ISO15693INV_BuildInventory(InvFrame[0], Flags & ~ISO15693INV_FLAG_ADDRORNBSLOTS, AFI, pMask);
+	ISO15693INV_Start(InvFrame[0], InvReply[0]);
+	ISO15693INV_Wait();
+
+	for (Slot = 0; Slot < 16; Slot++)
+	{
+		if (Slot < 15)
+		{
+			ISO15693INV_WaitGuardTime();
+			ISO15693INV_Start(EOFFrame, InvReply[Nth ^ 1]);
+		}
+
+		switch (ISO15693INV_ClassifySlot(InvReply[Nth]))
+		{
+			case ISO15693INV_SLOT_TAG :
+				ISO15693INV_AddTag(InvReply[Nth], Flags, pTags, MaxTags, NbTag);
+				break;
+
+			case ISO15693INV_SLOT_COLLISION :
+				// the slot number becomes the next 4 bits of the mask
+				if (pMask->Length + 4 <= ISO15693_NBBITS_MASKPARAMETER && *pNbMask < ISO15693INV_MASK_STACK_SIZE)
+				{
+					pChild = &MaskStack[(*pNbMask)++];
+					*pChild = *pMask;
+					pChild->Value[pMask->Length / 8] |= Slot << (pMask->Length % 8);
+					pChild->Length = pMask->Length + 4;
+				}
+				else
+					Complete = false;
+				break;
+
+			default :
+				break;
+		}
+
+		ISO15693INV_Wait();
+		Nth ^= 1;
+	}
+
+	return Complete;
+}
+
+/**
+* @brief  	parses a Get System Info reply
+*/
+static int8_t ISO15693INV_ParseSystemInfo(ISO15693_TAG_INFO *pTag, const uint8_t *pReply)
+{
+	const uint8_t	*pData = &pReply[PCD_DATA_OFFSET];
+	uint8_t			InfoFlags,
+					Index = 2 + ISO15693_NBBYTE_UID;
+	int8_t			status;
+
+	errchk(ISO15693INV_CheckReply(pReply, Index + 2));
+
+	InfoFlags = pData[1];
+	if ((InfoFlags & ISO15693INV_INFO_DSFID) != 0x00)
+		pTag->DSFID = pData[Index++];
+	if ((InfoFlags & ISO15693INV_INFO_AFI) != 0x00)
+		pTag->AFI = pData[Index++];
+	if ((InfoFlags & ISO15693INV_INFO_MEMSIZE) != 0x00)
+	{
+		// the number of blocks is on 2 bytes with the protocol extension
+		if ((pTag->RequestFlags & ISO15693INV_FLAG_PROTEXT) != 0x00)
+		{
+			pTag->NbBlocks = (pData[Index] | (pData[Index+1] << 8)) + 1;
+			Index += 2;
+		}
+		else
+			pTag->NbBlocks = pData[Index++] + 1;
+		pTag->BlockSize = (pData[Index++] & 0x1F) + 1;
+	}
+	if ((InfoFlags & ISO15693INV_INFO_ICREF) != 0x00)
+		pTag->ICRef = pData[Index++];
+
+	if (Index + 2 + CONTROL_15693_NBBYTE > pReply[PCD_LENGTH_OFFSET])
+		return ISO15693_ERRORCODE_DEFAULT;
+
+	pTag->InfoFlags = InfoFlags | ISO15693INV_INFO_VALID;
+
+	/*LRiS2K don't support read multiple*/
+	if ((pTag->ICRef & 0xFC) == ISO15693_LRiS2K)
+		pTag->MaxBlocksPerRead = 1;
+	else if (ISO15693INV_MAX_DATA / pTag->BlockSize < ISO15693INV_SECTOR_NB_BLOCKS)
+		pTag->MaxBlocksPerRead = ISO15693INV_MAX_DATA / pTag->BlockSize;
+	else
+		pTag->MaxBlocksPerRead = ISO15693INV_SECTOR_NB_BLOCKS;
+
+	return ISO15693_SUCCESSCODE;
+Error:
+	return status;
+}
+
+/**
+* @brief  	builds a Get System Info request
+*/
+static void ISO15693INV_BuildGetSystemInfo(uint8_t *pFrame, const ISO15693_TAG_INFO *pTag)
+{
+	uint8_t *p = ISO15693INV_NewFrame(pFrame, pTag->RequestFlags & ~ISO15693INV_FLAG_OPTION, ISO15693_CMDCODE_GETSYSINFO, pTag->UID);
+
+	ISO15693INV_CloseFrame(pFrame, p);
+}
+
+/**
+* @brief  	enables the cycle counter used for the EOF guard time
+*/
+static void ISO15693INV_EnableCycleCounter(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+  * @}
+  */
+
+
+/** @addtogroup lib_iso15693inventory_Public_Functions
+ *  @{
+ */
+
+/**
+* @brief  	runs an anticollision sequence and returns the tags seen. Each tag found is set quiet.
+* @brief	The protocol select command has to be send first (ISO15693_Init).
+* @param  	Flags		: 	request flags : sub-carrier and AFI flags are used, the high data rate is always requested
+* @param  	AFI			: 	AFI parameter (optional)
+* @param	pTags		:	tags found (UID, DSFID and request flags)
+* @param	MaxTags		:	size of pTags
+* @param  	NbTag		: 	Number of tag seen
+* @retval 	ISO15693_SUCCESSCODE	: 	all the tags in the field have been inventoried
+* @retval 	ISO15693_ERRORCODE_DEFAULT	: 	pTags or the mask stack is full, some tags may be missing
+*/
+int8_t ISO15693_RunFastInventory(const uint8_t Flags, const uint8_t AFI, ISO15693_TAG_INFO *pTags, const uint8_t MaxTags, uint8_t *NbTag)
+{
+	static const ISO15693INV_MASK	RootMask = {0};
+	ISO15693INV_MASK				Mask;
+	ISO15693INV_SLOT				Slot;
+	uint8_t		InvFlags = (Flags & (ISO15693INV_FLAG_SUBCARRIER | ISO15693INV_FLAG_SELECTORAFI)) | ISO15693INV_FLAG_DATARATE | ISO15693INV_FLAG_INVENTORY,
+				NbMask = 0,
+				First;
+	bool		Complete = true;
+
+	ISO15693INV_EnableCycleCounter();
+	*NbTag = 0;
+
+	// one slot first : a lone tag is found with a single exchange
+	do {
+		First = *NbTag;
+		ISO15693INV_BuildInventory(InvFrame[0], InvFlags | ISO15693INV_FLAG_ADDRORNBSLOTS, AFI, &RootMask);
+		ISO15693INV_Start(InvFrame[0], InvReply[0]);
+		ISO15693INV_Wait();
+		Slot = ISO15693INV_ClassifySlot(InvReply[0]);
+		if (Slot == ISO15693INV_SLOT_TAG && ISO15693INV_AddTag(InvReply[0], InvFlags, pTags, MaxTags, NbTag))
+			ISO15693INV_StayQuiet(pTags, First, *NbTag);
+	} while (Slot == ISO15693INV_SLOT_TAG && *NbTag > First && *NbTag < MaxTags);
+
+	if (Slot == ISO15693INV_SLOT_COLLISION)
+		MaskStack[NbMask++] = RootMask;
+
+	// preorder traversal of the UID tree, limited to the collided slots
+	while (NbMask > 0 && *NbTag < MaxTags)
+	{
+		Mask = MaskStack[--NbMask];
+		First = *NbTag;
+		if (!ISO15693INV_Run16Slots(InvFlags, AFI, &Mask, &NbMask, pTags, MaxTags, NbTag))
+			Complete = false;
+		ISO15693INV_StayQuiet(pTags, First, *NbTag);
+	}
+
+	if (!Complete || NbMask > 0 || (Slot == ISO15693INV_SLOT_TAG && *NbTag >= MaxTags))
+		return ISO15693_ERRORCODE_DEFAULT;
+	return ISO15693_SUCCESSCODE;
+}
+
+/**
+* @brief  	reads the memory layout (block size, number of blocks, IC reference) of each tag with Get System Info.
+* @brief	The request of a tag is sent while the reply of the previous one is parsed.
+* @brief	Tags which don't reply are asked again with the protocol extension flag (ST high density tags).
+* @param	pTags		:	tags found by ISO15693_RunFastInventory
+* @param	NbTag		:	number of tags
+* @retval 	ISO15693_SUCCESSCODE	: 	all the tags replied
+* @retval 	ISO15693_ERRORCODE_DEFAULT	: 	at least one tag did not reply, its descriptor keeps the defaults
+*/
+int8_t ISO15693_GetTagsMemoryLayout(ISO15693_TAG_INFO *pTags, const uint8_t NbTag)
+{
+	uint8_t		i,
+				Nth = 0;
+	int8_t		status = ISO15693_SUCCESSCODE;
+
+	if (NbTag == 0)
+		return ISO15693_SUCCESSCODE;
+
+	ISO15693INV_BuildGetSystemInfo(InvFrame[0], &pTags[0]);
+	ISO15693INV_Start(InvFrame[0], InvReply[0]);
+	for (i = 0; i < NbTag; i++)
+	{
+		ISO15693INV_Wait();
+		if (i + 1 < NbTag)
+		{
+			ISO15693INV_BuildGetSystemInfo(InvFrame[Nth ^ 1], &pTags[i + 1]);
+			ISO15693INV_Start(InvFrame[Nth ^ 1], InvReply[Nth ^ 1]);
+		}
+		ISO15693INV_ParseSystemInfo(&pTags[i], InvReply[Nth]);
+		Nth ^= 1;
+	}
+	ISO15693INV_Wait();
+
+	for (i = 0; i < NbTag; i++)
+	{
+		if ((pTags[i].InfoFlags & ISO15693INV_INFO_VALID) != 0x00)
+			continue;
+
+		pTags[i].RequestFlags |= ISO15693INV_FLAG_PROTEXT;
+		ISO15693INV_BuildGetSystemInfo(InvFrame[0], &pTags[i]);
+		ISO15693INV_Start(InvFrame[0], InvReply[0]);
+		ISO15693INV_Wait();
+		if (ISO15693INV_ParseSystemInfo(&pTags[i], InvReply[0]) != ISO15693_SUCCESSCODE)
+		{
+			pTags[i].RequestFlags &= ~ISO15693INV_FLAG_PROTEXT;
+			status = ISO15693_ERRORCODE_DEFAULT;
+		}
+	}
+
+	return status;
+}
+
+/**
+* @brief  	reads blocks of a tag. The requests are sized by the MaxBlocksPerRead field of the tag
+* @brief	and the reply of a request is copied while the next one is in progress.
+* @param	pTag		:	tag descriptor (ISO15693_GetTagsMemoryLayout or ISO15693_SetUnaddressedTag)
+* @param	FirstBlock	:	first block to read
+* @param	NbBlocks	:	number of blocks to read
+* @param	pData		:	NbBlocks * BlockSize bytes
+* @retval 	ISO15693_SUCCESSCODE	: 	all the blocks have been read
+* @retval 	ISO15693_ERRORCODE_DEFAULT	: 	a request failed
+*/
+int8_t ISO15693_ReadTagMemory(const ISO15693_TAG_INFO *pTag, const uint16_t FirstBlock, const uint16_t NbBlocks, uint8_t *pData)
+{
+	uint16_t	Block = FirstBlock,
+				End = FirstBlock + NbBlocks,
+				Count[2];
+	uint8_t		Nth = 0;
+
+	if (NbBlocks == 0)
+		return ISO15693_SUCCESSCODE;
+
+	Count[0] = ISO15693INV_BuildRead(InvFrame[0], pTag, Block, End);
+	ISO15693INV_Start(InvFrame[0], InvReply[0]);
+	while (Block < End)
+	{
+		ISO15693INV_Wait();
+		Block += Count[Nth];
+		if (Block < End)
+		{
+			Count[Nth ^ 1] = ISO15693INV_BuildRead(InvFrame[Nth ^ 1], pTag, Block, End);
+			ISO15693INV_Start(InvFrame[Nth ^ 1], InvReply[Nth ^ 1]);
+		}
+
+		if (ISO15693INV_CheckReply(InvReply[Nth], 1 + Count[Nth] * pTag->BlockSize + 2) != ISO15693_SUCCESSCODE)
+		{
+			ISO15693INV_Wait();
+			return ISO15693_ERRORCODE_DEFAULT;
+		}
+		memcpy(pData, &InvReply[Nth][PCD_DATA_OFFSET + 1], Count[Nth] * pTag->BlockSize);
+		pData += Count[Nth] * pTag->BlockSize;
+		Nth ^= 1;
+	}
+
+	return ISO15693_SUCCESSCODE;
+}
+
+/**
+* @brief  	fills a descriptor to read the tag in the field in non addressed mode (single tag)
+* @param	RequestFlags	:	data rate, sub-carrier and protocol extension flags
+* @param	BlockSize		:	bytes per block
+* @param	MaxBlocksPerRead	:	1 to use Read Single Block only
+*/
+void ISO15693_SetUnaddressedTag(ISO15693_TAG_INFO *pTag, const uint8_t RequestFlags, const uint8_t BlockSize, const uint8_t MaxBlocksPerRead)
+{
+	memset(pTag, 0x00, sizeof(ISO15693_TAG_INFO));
+	pTag->RequestFlags = RequestFlags & ~(ISO15693INV_FLAG_INVENTORY | ISO15693INV_FLAG_ADDRORNBSLOTS | ISO15693INV_FLAG_SELECTORAFI);
+	pTag->BlockSize = BlockSize;
+	pTag->MaxBlocksPerRead = MaxBlocksPerRead;
+}
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+#endif /* USE_NFC03A1 */
@@ -0,0 +1,76 @@
+/**
+  ******************************************************************************
+  * @file    lib_iso15693inventory.h
+  * @author  DEEP Project
+  * @date    Oct 17, 2026
+  * @brief   Multi-tag ISO15693 inventory and block-read pipeline
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef _LIB_ISO15693INVENTORY_H
+#define _LIB_ISO15693INVENTORY_H
+#include "config.h"
+#if USE_NFC03A1
+
+#include "lib_iso15693pcd.h"
+
+/* Request flags (ISO15693-3 table 3 & 4) ------------------------------------*/
+#define ISO15693INV_FLAG_SUBCARRIER				0x01
+#define ISO15693INV_FLAG_DATARATE				0x02
+#define ISO15693INV_FLAG_INVENTORY				0x04
+#define ISO15693INV_FLAG_PROTEXT				0x08
+#define ISO15693INV_FLAG_SELECTORAFI			0x10
+#define ISO15693INV_FLAG_ADDRORNBSLOTS			0x20
+#define ISO15693INV_FLAG_OPTION					0x40
+
+/* high data rate, single sub-carrier : the mode selected by ISO15693_Init */
+#define ISO15693INV_DEFAULT_FLAGS				ISO15693INV_FLAG_DATARATE
+
+/* Get System Info information flags -----------------------------------------*/
+#define ISO15693INV_INFO_DSFID					0x01
+#define ISO15693INV_INFO_AFI					0x02
+#define ISO15693INV_INFO_MEMSIZE				0x04
+#define ISO15693INV_INFO_ICREF					0x08
+#define ISO15693INV_INFO_VALID					0x80	/* set once Get System Info has been parsed (RFU bit in the tag reply) */
+
+/* Response flags ------------------------------------------------------------*/
+#define ISO15693INV_RESPFLAG_ERROR				0x01
+
+/* Limits --------------------------------------------------------------------*/
+#ifndef ISO15693INV_MAX_TAGS
+#define ISO15693INV_MAX_TAGS					16
+#endif
+/* masks waiting to be inventoried (one per collided slot) */
+#ifndef ISO15693INV_MASK_STACK_SIZE
+#define ISO15693INV_MASK_STACK_SIZE				32
+#endif
+/* Read Multiple Blocks never crosses a sector boundary (ST M24LR / LRi tags) */
+#define ISO15693INV_SECTOR_NB_BLOCKS			32
+/* time between a tag reply and the next EOF (t2 >= 309 us, ISO15693-3 9.1) */
+#ifndef ISO15693INV_EOF_GUARD_US
+#define ISO15693INV_EOF_GUARD_US				320
+#endif
+
+/* Tag descriptor ------------------------------------------------------------*/
+typedef struct {
+	uint8_t		UID[ISO15693_NBBYTE_UID];		/* LSB first, as sent by the tag */
+	uint8_t		DSFID;
+	uint8_t		AFI;
+	uint8_t		ICRef;
+	uint8_t		InfoFlags;							/* Get System Info information flags */
+	uint8_t		RequestFlags;						/* data rate, sub-carrier & protocol extension flags to use with this tag */
+	uint16_t	NbBlocks;							/* 0 : unknown */
+	uint8_t		BlockSize;							/* bytes per block */
+	uint8_t		MaxBlocksPerRead;					/* 1 : Read Multiple Blocks not supported */
+} ISO15693_TAG_INFO;
+
+/* Functions -----------------------------------------------------------------*/
+int8_t ISO15693_RunFastInventory	( const uint8_t Flags, const uint8_t AFI, ISO15693_TAG_INFO *pTags, const uint8_t MaxTags, uint8_t *NbTag );
+int8_t ISO15693_GetTagsMemoryLayout	( ISO15693_TAG_INFO *pTags, const uint8_t NbTag );
+int8_t ISO15693_ReadTagMemory		( const ISO15693_TAG_INFO *pTag, const uint16_t FirstBlock, const uint16_t NbBlocks, uint8_t *pData );
+void   ISO15693_SetUnaddressedTag	( ISO15693_TAG_INFO *pTag, const uint8_t RequestFlags, const uint8_t BlockSize, const uint8_t MaxBlocksPerRead );
+
+#endif /* USE_NFC03A1 */
+
+#endif /* _LIB_ISO15693INVENTORY_H */
@@ -31,6 +31,8 @@
 #include "config.h"
 #if USE_NFC03A1
 #include "lib_iso15693pcd.h"
+#include "lib_iso15693inventory.h"
+#include "stm32g4_crc.h"
 
  /** @ brief memory allocation for CR95Hf response */
 extern uint8_t 	u95HFBuffer [RFTRANS_95HF_MAX_BUFFER_SIZE+3]; 	// buffer for SPI ou UART reception
@@ -49,19 +51,14 @@ static int8_t ISO15693_GetProtocolExtensionFlag (const uint8_t FlagsByte);
 //static int8_t ISO15693_GetIcRef (uint8_t *IcRefOut);
 /* Invotory functions --- */
 static int8_t ISO15693_Inventory(const uint8_t Flags , const uint8_t AFI, const uint8_t MaskLength, const uint8_t *MaskValue, uint8_t *pResponse);
-static int8_t ISO15693_InventoryOneSlot(const uint8_t Flags , const uint8_t AFI, const uint8_t MaskLength, const uint8_t *MaskValue, uint8_t *pResponse);
 static int16_t ISO15693_Inventory16Slots(const uint8_t Flags , const uint8_t AFI, const uint8_t MaskLength, const uint8_t *MaskValue, uint8_t *NbTag, uint8_t *pResponse);
 /* Command functions --- */
 static int8_t ISO15693_CreateRequestFlag (const uint8_t SubCarrierFlag,const uint8_t DataRateFlag,const uint8_t InventoryFlag,const uint8_t ProtExtFlag,const uint8_t SelectOrAFIFlag,const uint8_t AddrOrNbSlotFlag,const uint8_t OptionFlag,const uint8_t RFUFlag);
-static int8_t ISO15693_StayQuiet(const uint8_t Flags,const uint8_t *UIDin);
-static int8_t ISO15693_ReadSingleBlock(const uint8_t Flags, const uint8_t *UID, const uint16_t BlockNumber,uint8_t *pResponse);
 static int8_t ISO15693_WriteSingleBlock(const uint8_t Flags, const uint8_t *UIDin, const uint16_t BlockNumber,const uint8_t *DataToWrite,uint8_t *pResponse);
-static int8_t ISO15693_ReadMultipleBlock(const uint8_t Flags, const uint8_t *UIDin, uint16_t BlockNumber, const uint8_t NbBlock, uint8_t *pResponse);
 static int8_t ISO15693_SendEOF(uint8_t *pResponse);
 /* Is functions --- */
 static int8_t ISO15693_IsInventoryFlag (const uint8_t FlagsByte);
 static int8_t ISO15693_IsAddressOrNbSlotsFlag(const uint8_t FlagsByte);
-static int8_t ISO15693_IsATagInTheField(const uint8_t *pTagReply);
 static int8_t ISO15693_IsCollisionDetected(const uint8_t *pTagReply);
 /* CRC16 commands --- */
 static int16_t ISO15693_CRC16(const uint8_t *DataIn,const uint8_t Length);
@@ -301,36 +298,6 @@ Error:
 }
 
 
-/**  
-* @brief  	this function send an inventory command to a contactless tag. 
-* @brief  	The NbSlot flag of Request flags is set (1 value). 
-* @param  	Flags		:  	Request flags
-* @param	AFI			:	AFI byte (optional)
-* @param	MaskLength 	: 	Number of bits of mask value
-* @param	MaskValue	:  	mask value which is compare to Contacless tag UID 
-* @param	pResponse	: 	pointer on PCD  response
-* @retval 	ISO15693_SUCCESSCODE	: 	PCD  returns a succesful code
-* @retval 	ISO15693_ERRORCODE_PARAMETERLENGTH	: 	MaskLength value is erroneous
-* @retval 	ISO15693_ERRORCODE_DEFAULT	: 	 PCD  returns an error code
-*/
-static int8_t ISO15693_InventoryOneSlot(const uint8_t Flags , const uint8_t AFI, const uint8_t MaskLength, const uint8_t *MaskValue, uint8_t *pResponse)
-{
-int8_t 	NewFlags,
-		status;
-	
-	// force NbSlot Flag to 1;
-	NewFlags = Flags | ISO15693_MASK_ADDRORNBSLOTSFLAG;
-	 
-	status = ISO15693_Inventory( 
-									NewFlags ,
-									AFI, 
-									MaskLength, 
-									MaskValue,  
-									pResponse  );
-
-	return status;
-}
-
 /**  
 * @brief  	this function send an inventory command to a contacless tag. 
 * @brief  	The NbSlot flag of Request flags is reset (0 value). 
@@ -395,80 +362,6 @@ uint8_t		pOneTagResponse [ISO15693_NBBYTE_UID+3+2];
 }
 
 
-/**  
-* @brief  	this function send an stay_quiet command to contacless tag.
-* @param  	Flags		:  	Request flags
-* @param		UIDin		:  	pointer on contactless tag UID
-* @retval 	ISO15693_SUCCESSCODE	: 	PCD  returns a succesful code
-* @retval 	ISO15693_ERRORCODE_DEFAULT	: 	 PCD  returns an error code
-*/
-static int8_t ISO15693_StayQuiet(const uint8_t Flags,const uint8_t *UIDin)
-{
-uint8_t DataToSend[ISO15693_MAXLENGTH_STAYQUIET],
-	 	NthByte = 0,
-		pResponse[ISO15693_MAXLENGTH_REPLYSTAYQUIET];
-int8_t	status;
-
-	/* the StayQuiet command shall always be executed in adrressed mode ( Select_flag is set 	*/
-	/* to 0 and addreess flag is set to 1)	*/
-	errchk (ISO15693_IsAddressOrNbSlotsFlag (Flags));
-
-	DataToSend[NthByte++] = Flags;
-	DataToSend[NthByte++] = ISO15693_CMDCODE_STAYQUIET;
-
-	memcpy(&(DataToSend[NthByte]),UIDin,ISO15693_NBBYTE_UID);
-	NthByte +=ISO15693_NBBYTE_UID;	
-
-   PCD_SendRecv(NthByte,DataToSend,pResponse);
-
-
-	return ISO15693_SUCCESSCODE;  
-Error:	
-	*pResponse = SENDRECV_ERRORCODE_SOFT;
-	*(pResponse+1) = 0x00;
-	return ISO15693_ERRORCODE_DEFAULT;
-	 
-}	
-
-/**  
-* @brief  	this function send an ReadSingleBlock command to contactless tag.
-* @param  	Flags		:  	Request flags
-* @param	UIDin		:  	pointer on contacless tag UID (optional) (depend on address flag of Request flags)
-* @param	BlockNumber	:  	index of block to read
-* @param	pResponse	: 	pointer on PCD  response
-* @retval 	ISO15693_SUCCESSCODE	: 	PCD  returns a succesful code
-* @retval 	ISO15693_ERRORCODE_DEFAULT	: 	 PCD  returns an error code
-*/
-static int8_t ISO15693_ReadSingleBlock(const uint8_t Flags, const uint8_t *UIDin, const uint16_t BlockNumber,uint8_t *pResponse)
-{
-uint8_t DataToSend[ISO15693_MAXLENGTH_READSINGLEBLOCK],
-		NthByte=0;
-
-	DataToSend[NthByte++] = Flags;
-	DataToSend[NthByte++] = ISO15693_CMDCODE_READSINGLEBLOCK;
-
-	if (ISO15693_GetAddressOrNbSlotsFlag (Flags) 	== true)
-	{	memcpy(&(DataToSend[NthByte]),UIDin,ISO15693_NBBYTE_UID);
-		NthByte +=ISO15693_NBBYTE_UID;	
-	}
-
-	if (ISO15693_GetProtocolExtensionFlag (Flags) 	== false)
-		DataToSend[NthByte++] = BlockNumber;
-	else 
-	{
-		DataToSend[NthByte++] = BlockNumber & 0x00FF;
-		DataToSend[NthByte++] = (BlockNumber & 0xFF00 ) >> 8;	
-	}
-
-	PCD_SendRecv(NthByte,DataToSend,pResponse);
-
-//	if (PCD_IsReaderResultCodeOk (SEND_RECEIVE,pResponse) == ISO15693_ERRORCODE_DEFAULT)
-//		return ISO15693_ERRORCODE_DEFAULT;
-
-	return ISO15693_SUCCESSCODE;
-}
-
-
 /**  
 * @brief  	this function send an WriteSingleblock command and returns ISO15693_SUCCESSCODE if the command 
 * @brief  	was correctly emmiting, ISO15693_ERRORCODE_DEFAULT otherwise
@@ -523,50 +416,6 @@ uint8_t DataToSend[MAX_BUFFER_SIZE],
 	
 }
 
-/**  
-* @brief  this function send an ReadSingleBlock command to contactless tag.
-* @param  	Flags		:  	Request flags
-* @param	UIDin		:  	pointer on contacless tag UID (optional) (depend on address flag of Request flags)
-* @param	BlockNumber	:  	index of block to read
-* @param	pResponse	: 	pointer on PCD  response
-* @retval 	ISO15693_SUCCESSCODE	: 	PCD  returns a succesful code
-* @retval 	ISO15693_ERRORCODE_DEFAULT	: 	 PCD  returns an error code
-*/
-static int8_t ISO15693_ReadMultipleBlock(const uint8_t Flags, const uint8_t *UIDin, uint16_t BlockNumber, const uint8_t NbBlock, uint8_t *pResponse)
-{
-uint8_t DataToSend[ISO15693_MAXLENGTH_READSINGLEBLOCK],
-		NthByte=0;
-
-
-	DataToSend[NthByte++] = Flags;
-	DataToSend[NthByte++] = ISO15693_CMDCODE_READMULBLOCKS;
-
-	if (ISO15693_GetAddressOrNbSlotsFlag (Flags) 	== true)
-	{	memcpy(&(DataToSend[NthByte]),UIDin,ISO15693_NBBYTE_UID);
-		NthByte +=ISO15693_NBBYTE_UID;	
-	}
-	BlockNumber=BlockNumber<<5; // *32
-	if (ISO15693_GetProtocolExtensionFlag (Flags) 	== false)
-		DataToSend[NthByte++] = BlockNumber;
-	else 
-	{
-		DataToSend[NthByte++] = BlockNumber & 0x00FF;
-		DataToSend[NthByte++] = (BlockNumber & 0xFF00 ) >> 8;
-		
-	}
-	
-	DataToSend[NthByte++] = NbBlock;
-
-	PCD_SendRecv(NthByte,DataToSend,pResponse);
-
-	if (PCD_IsReaderResultCodeOk (SEND_RECEIVE,pResponse) == PCD_ERRORCODE_DEFAULT)
-		return ISO15693_ERRORCODE_DEFAULT;
-
-	return ISO15693_SUCCESSCODE;
-
-
-}
-
 /**  
 * @brief  	this function send an EOF pulse to contactless tag.
 * @param	pResponse	: 	pointer on PCD  response
@@ -616,28 +465,6 @@ static int8_t ISO15693_IsAddressOrNbSlotsFlag(const uint8_t FlagsByte)
 
 
  /**  
-* @brief  	this function returns ISO15693_SUCCESSCODE if a tag has reply, ISO15693_ERRORCODE_DEFAULT otherwise
-* @param	pResponse	: 	pointer on PCD  response	
-* @retval 	ISO15693_SUCCESSCODE	: 	PCD  returns a succesful code
-* @retval 	ISO15693_ERRORCODE_DEFAULT	: 	 PCD  returns an error code
-*/
-static int8_t ISO15693_IsATagInTheField(const uint8_t *pResponse)
-{
-	
-	if ( pResponse[READERREPLY_STATUSOFFSET] == SENDRECV_RESULTSCODE_OK)
-		return ISO15693_SUCCESSCODE;
-	// When a collision occurs between two or more tags the PCD  response can be 88 00
-	if ( pResponse[READERREPLY_STATUSOFFSET] == SENDRECV_ERRORCODE_SOF)
-		return ISO15693_SUCCESSCODE;
-	// When a collision occurs between two or more tags the PCD  response can be 8E 00
-	if ( pResponse[READERREPLY_STATUSOFFSET] == SENDRECV_ERRORCODE_RECEPTIONLOST)
-		return ISO15693_SUCCESSCODE;
-
-	return ISO15693_ERRORCODE_DEFAULT;
-
-}
-
-/**  
 * @brief  	this function returns ISO15693_SUCCESSCODE if a collision has been detected, ISO15693_ERRORCODE_DEFAULT otherwise
 * @param	pResponse	: 	pointer on PCD  response 	
 * @retval 	ISO15693_SUCCESSCODE	: 	collision detected
@@ -676,21 +503,8 @@ static int8_t ISO15693_IsCollisionDetected(const uint8_t *pResponse)
 */
 static int16_t ISO15693_CRC16(const uint8_t *DataIn,const uint8_t NbByte) 
 { 
-int8_t 	i,
-		j; 
-int32_t ResCrc = ISO15693_PRELOADCRC16;
-	
-	for (i=0;i<NbByte;i++) 
-	{ 
-		ResCrc=ResCrc ^ DataIn[i];
-		for (j=8;j>0;j--) 
-		{
-			ResCrc = (ResCrc & ISO15693_MASKCRC16) ? (ResCrc>>1) ^ ISO15693_POLYCRC16 : (ResCrc>>1); 
-		}
-	} 
-
-	return ((~ResCrc) & 0xFFFF);
-	
+	/* polynomial 0x8408 (reflected), preload 0xFFFF, complemented result : see stm32g4_crc.c */
+	return (int16_t)BSP_CRC_compute(CRC_ISO15693, DataIn, NbByte);
 } 
 
 /**  
@@ -803,35 +617,23 @@ static uint8_t ISO15693_TagSave (uint8_t Tag_Density, uint16_t NbByte_To_Write,
 */
 static uint8_t ISO15693_ReadMultipleTagData(uint8_t Tag_Density, uint8_t *Data_To_Read, uint16_t NbBlock_To_Read, uint16_t FirstBlock_To_Read)
 {
-	uint8_t /*ReadMultipleBuffer [5]={0x02, 0x23, 0x00, 0x00, 0x00},*/
-				RepBuffer[140],
-				Requestflags = 0x02;
-
-	uint16_t NbSectorToRead = 0,
-				SectorStart = 0,
-				NthDataToRead;
+	ISO15693_TAG_INFO	Tag;
+	uint8_t		Requestflags = 0x02;
+	uint16_t	NbSectorToRead = 0,
+				SectorStart = 0;
 	
 	/*Convert the block number in sector number*/
-  NbSectorToRead = NbBlock_To_Read/32+1;	
+	NbSectorToRead = NbBlock_To_Read/32+1;
 	SectorStart = FirstBlock_To_Read/32;
 
 	// update the RequestFlags
-	/*if (Tag_Density == ISO15693_LOW_DENSITY)
-		NumSectorToRead = (NumSectorToRead*0x20) & 0x00FF;
-	else */if (Tag_Density == ISO15693_HIGH_DENSITY)
+	if (Tag_Density == ISO15693_HIGH_DENSITY)
 		Requestflags = 0x0A;	
-	/*else
-		return ISO15693_ERRORCODE_DEFAULT;*/
-	
-	for ( NthDataToRead=0; NthDataToRead < NbSectorToRead; NthDataToRead++)
-	{			
-			//NumSectorToRead += NthDataToRead;
-
-			if ( ISO15693_ReadMultipleBlock (Requestflags, 0x00,NthDataToRead+SectorStart,0x1F,RepBuffer ) !=ISO15693_SUCCESSCODE)
-						return ISO15693_ERRORCODE_DEFAULT;	
-			/*Data Temp*/
-			memcpy(&Data_To_Read[NthDataToRead*128],&RepBuffer[3],128);
-	}
+
+	/* whole sectors are read, each reply is copied into Data_To_Read while the next sector is read */
+	ISO15693_SetUnaddressedTag(&Tag, Requestflags, ISO15693_NBBYTE_BLOCKLENGTH, ISO15693INV_SECTOR_NB_BLOCKS);
+	if (ISO15693_ReadTagMemory(&Tag, SectorStart*ISO15693INV_SECTOR_NB_BLOCKS, NbSectorToRead*ISO15693INV_SECTOR_NB_BLOCKS, Data_To_Read) != ISO15693_SUCCESSCODE)
+		return ISO15693_ERRORCODE_DEFAULT;
 				
 	return ISO15693_SUCCESSCODE;
 }
@@ -848,48 +650,21 @@ static uint8_t ISO15693_ReadMultipleTagData(uint8_t Tag_Density, uint8_t *Data_T
 */	
 static uint8_t ISO15693_ReadSingleTagData(uint8_t Tag_Density, uint8_t *Data_To_Read, uint16_t NbBlock_To_Read, uint16_t FirstBlock_To_Read)
 {
-	uint8_t /*ReadBuffer [4]={0x02, 0x20, 0x00, 0x00},*/
-				RepBuffer[16],
-				Requestflags = 0x02;
-	uint16_t NthDataToRead= 0x0000;
-	uint16_t Num_DataToRead = FirstBlock_To_Read;
+	ISO15693_TAG_INFO	Tag;
+	uint8_t		Requestflags = 0x02;
 
 		// update the RequestFlags
 		if (Tag_Density == ISO15693_LOW_DENSITY)
-			Num_DataToRead &=  0x00FF;
+			FirstBlock_To_Read &=  0x00FF;
 		else if (Tag_Density == ISO15693_HIGH_DENSITY)
 			Requestflags = 0x0A;	
 		else
 			return ISO15693_ERRORCODE_DEFAULT;
 
-	for ( NthDataToRead= 0; NthDataToRead < NbBlock_To_Read; NthDataToRead++)
-	{			
-					Num_DataToRead += NthDataToRead;
-								
-// 					if (Tag_Density == ISO15693_LOW_DENSITY)
-// 					{
-// 						Num_DataToRead &=  0x00FF;
-// 						ReadBuffer [2] = (Num_DataToRead) & 0x00FF;
-//  					memset (RepBuffer, 0x00,8);
-//  					PCD_SendRecv (0x03,ReadBuffer,RepBuffer);
-// 					}
-// 					else if (Tag_Density == ISO15693_HIGH_DENSITY)
-// 					{
-// 					ReadBuffer [0] = 0x0A;	
-// 					ReadBuffer [2] = (Num_DataToRead) & 0x00FF;
-// 					ReadBuffer [3] = ((Num_DataToRead) & 0xFF00) >> 8;
-// 					memset (RepBuffer, 0x00,8);
-// 					PCD_SendRecv (0x04,ReadBuffer,RepBuffer);						
-// 					}
-// 					else
-// 						return ISO15693_ERRORCODE_DEFAULT;
-
-				if ( ISO15693_ReadSingleBlock (Requestflags, 0x00,Num_DataToRead,RepBuffer ) !=ISO15693_SUCCESSCODE)
-						return ISO15693_ERRORCODE_DEFAULT;
-					
- 				 /*Data Temp*/
-				 memcpy(&Data_To_Read[NthDataToRead*4],&RepBuffer[3],ISO15693_NBBYTE_BLOCKLENGTH);
-	}
+	/* one Read Single Block per block, the next request is sent while the last reply is copied */
+	ISO15693_SetUnaddressedTag(&Tag, Requestflags, ISO15693_NBBYTE_BLOCKLENGTH, 1);
+	if (ISO15693_ReadTagMemory(&Tag, FirstBlock_To_Read, NbBlock_To_Read, Data_To_Read) != ISO15693_SUCCESSCODE)
+		return ISO15693_ERRORCODE_DEFAULT;
 				
 	return ISO15693_SUCCESSCODE;
 }
@@ -1116,151 +891,28 @@ Error:
 * @param  	Flags		: 	request flags
 * @param  	AFI			: 	AFI parameter (optional)
 * @param  	NbTag		: 	Number of tag seen
-* @param	pUIDout		: 	pointer on tag UID
+* @param	pUIDout		: 	pointer on tag UID (DSFID and UID of each tag, ISO15693INV_MAX_TAGS tags at most)
 * @retval 	ISO15693_SUCCESSCODE	: 	function succesful executed  
-* @retval 	ISO15693_ERRORCODE_DEFAULT	: 	
+* @retval 	ISO15693_ERRORCODE_DEFAULT	: 	too many tags, some of them may be missing
 */
 int8_t ISO15693_RunAntiCollision(const uint8_t Flags , const uint8_t AFI,uint8_t *NbTag,uint8_t *pUIDout)
 {
+	ISO15693_TAG_INFO	Tags[ISO15693INV_MAX_TAGS];
+	uint8_t		i;
 	int8_t		status;
-	uint8_t		MaskValue[ISO15693_NBBYTE_UID],
-			MaskLength = 0,
-			MaskStack [0x80*ISO15693_NBBYTE_UID];	//	can save 16 mask. the size of a mask is ISO15693_NBBYTE_UID.
-												// the first byte is mask length (bit size). the orthers bytre are mask value
-	uint8_t		RequestFlags = Flags,
-			offset=0,
-			ReplyFlag,
-			NbTagInventoried,
-			DSFIDout,
-			NthStackValue=1,
-			i=0,
-			Nbloop = 0,
-			StayQuietFlags = (Flags & ~ISO15693_MASK_INVENTORYFLAG) | ISO15693_MASK_ADDRORNBSLOTSFLAG,
-			UIDoutOffet = PCD_DATA_OFFSET + 2 ;
-	uint16_t	SlotOccupancy= 0x0000	;
-
-	memset(MaskStack,0x00,16*ISO15693_NBBYTE_UID);
-	*NbTag = 0;
-
-	
-	// checks if at least a tag is in the field 
-	 ISO15693_InventoryOneSlot( 
-								RequestFlags ,
-								AFI,
-								MaskLength,
-								MaskValue,
-								u95HFBuffer);
-		
 
-	// no tag in the field
-	if (ISO15693_IsATagInTheField (u95HFBuffer) != ISO15693_SUCCESSCODE)
-		return ISO15693_SUCCESSCODE;
+	// mask recursion on the collided slots only, the tags found are set quiet (see lib_iso15693inventory.c)
+	status = ISO15693_RunFastInventory(Flags, AFI, Tags, ISO15693INV_MAX_TAGS, NbTag);
 
-	// check TagReply CRC residue and get tag UID
-	status = ISO15693_SplitInventoryResponse(	u95HFBuffer,
-												u95HFBuffer[PCD_LENGTH_OFFSET],
-												&ReplyFlag ,
-												&DSFIDout,
-												&UIDoutOffet);
-	
-	
-	
-	// residue CRC ok (=> Only one tag in the field)
-	if (status == ISO15693_SUCCESSCODE) 
+	for (i=0;i<*NbTag;i++)
 	{
-		*NbTag = 1;	
-		// send a stay quiet command to the inventoried tag 
-		ISO15693_StayQuiet(StayQuietFlags ,&(u95HFBuffer[UIDoutOffet]));
-		// no collision => copy DSFID
-		pUIDout[0] = DSFIDout ;
-		// no collision => copy tag UID
-		memcpy(&(pUIDout[1]),&(u95HFBuffer[UIDoutOffet]),ISO15693_NBBYTE_UID);
-		return ISO15693_SUCCESSCODE;
+		// copy DSFID
+		pUIDout[i*(ISO15693_NBBYTE_UID+1)] = Tags[i].DSFID;
+		// copy tag UID
+		memcpy(&(pUIDout[1+i*(ISO15693_NBBYTE_UID+1)]),Tags[i].UID,ISO15693_NBBYTE_UID);
 	}
 
-	HAL_Delay(10);
-
-	(*NbTag)=0;	
-
-	// the folowing anticollsion sequence is preorder traversal algorithm 
-	// the UIDs can be represnt as a binary tree
-	do{
-
-		memset(MaskValue,0x00,ISO15693_NBBYTE_UID);
-		// unstack mask value
-		NthStackValue -- ;
-	   	memcpy(MaskValue,(MaskStack+NthStackValue*ISO15693_NBBYTE_UID+1),ISO15693_NBBYTE_UID);	
-
-
-		// at this point : at least two tags are in the field
-		// => run an inventory 16 slots
-
-		// the u95HFBuffer is MAX_BUFFER_SIZE + 3 (=256 +3  bytes)
-		// if a response is available in eack slot => 16 * 15 (max size of inventory reply + 3 control bytes)
-		//						=>	16 * 15  = 240 bytes < MAX_BUFFER_SIZE + 3
-		SlotOccupancy =ISO15693_Inventory16Slots( 
-								RequestFlags ,
-								AFI,
-								MaskLength,
-								MaskValue,
-								&NbTagInventoried,
-								u95HFBuffer);
-		   	
-
-					
-		offset = 0;
-
-		// loop on tag inventoried and copy the UID,
-		for (i=0;i<NbTagInventoried;i++)
-		{
-			status = ISO15693_SplitInventoryResponse(&(u95HFBuffer[offset]),
-										u95HFBuffer[PCD_LENGTH_OFFSET],
-										&ReplyFlag ,
-										&DSFIDout,
-										&UIDoutOffet);
-		
-			if (status==ISO15693_SUCCESSCODE)
-			{
-				// send a stay quiet command to the inventoried tag 
-				ISO15693_StayQuiet(StayQuietFlags ,&(u95HFBuffer[offset + UIDoutOffet]));
-				// no collision => copy DSFID
-				pUIDout[(*NbTag)*(ISO15693_NBBYTE_UID+1)] = DSFIDout ;
-				// no collision => copy tag UID
-				memcpy((pUIDout+(1+(*NbTag)*(ISO15693_NBBYTE_UID+1))),&(u95HFBuffer[offset + UIDoutOffet]),ISO15693_NBBYTE_UID);
-				(*NbTag)++ ;
-			}
-			offset += u95HFBuffer[offset+PCD_LENGTH_OFFSET] + 2;
-		} // for (i=0;i<NbTagInventoried;i++)
-	
-	   		
-		// add 4 bits to the mask
-		MaskLength +=4;
-	 	// create and stack the masks for the next inventory commands
-		for (i=0;i<16;i++)
-		{
-			/*
-			A collision was detected in the inventory 16 slots
-				=> add 4 bits to the mask
-			*/
-		
-			if ((SlotOccupancy & (0x01 <<i)) != 0)
-			{
-				// create the mask which include the slot whare the collision occured
-				MaskValue[(MaskLength-4)/8] |= (i << ((MaskLength-4)%8)) ;  
-				// copy masklength and maskvalue into mask stack
-				MaskStack[NthStackValue*ISO15693_NBBYTE_UID]= MaskLength;
-				memcpy((MaskStack+(NthStackValue*ISO15693_NBBYTE_UID)+1),MaskValue,ISO15693_NBBYTE_UID);
-				NthStackValue++;
-			}
-		}
-
-		 			
-		Nbloop ++;
-
-	} while (NthStackValue >0 && Nbloop < 0x20);
-	
-	 return ISO15693_SUCCESSCODE;
-
+	return status;
 }
 
 
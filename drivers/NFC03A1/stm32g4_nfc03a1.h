@@ -106,15 +106,16 @@ For type A you can also adjust the Timer Window
 
 /* --------------------------------------------------------------------------
 * Delay TIMER configuration (ms)
+* TIM7 : TIM2, the only 32-bit timer, is the GPS PPS timebase (stm32g4_gps_pps.c)
 * -------------------------------------------------------------------------- */
-#define TIMER_DELAY					TIM2
+#define TIMER_DELAY					TIM7
 #define TIMER_DELAY_PERIOD			72
 #define TIMER_DELAY_PRESCALER		1000
 
 /* --------------------------------------------------------------------------
 * Delay TIMER configuration (us)
 * --------------------------------------------------------------------------- */
-#define TIMER_US_DELAY				TIM2
+#define TIMER_US_DELAY				TIM7
 #define TIMER_US_DELAY_PERIOD		35
 #define TIMER_US_DELAY_PRESCALER	1
 
@@ -161,7 +162,7 @@ For type A you can also adjust the Timer Window
 |---------------|-----------------------|-------------------|-------------------|
 | 95HF		|	0		|	0           |	EXTI15_10_IRQn	|
 |---------------|-----------------------|-------------------|-------------------|
-| delay		|	0		|	0           |	TIM2_IRQn	|
+| delay		|	0		|	0           |	TIM7_DAC_IRQn	|
 |---------------|-----------------------|-------------------|-------------------|
 | timeout	|	0		|	0           |	TIM3_IRQn	|
 |---------------|-----------------------|-------------------|-------------------|
@@ -173,7 +174,7 @@ For type A you can also adjust the Timer Window
 
 #define TIMER_DELAY_PREEMPTION_PRIORITY		1
 #define TIMER_DELAY_SUB_PRIORITY			3
-#define TIMER_DELAY_IRQ_CHANNEL				TIM2_IRQn
+#define TIMER_DELAY_IRQ_CHANNEL				TIM7_DAC_IRQn
 #define TIMER_DELAY_PREEMPTION_HIGHPRIORITY	0
 #define TIMER_DELAY_SUB_HIGHPRIORITY		0
 
@@ -186,7 +187,7 @@ For type A you can also adjust the Timer Window
 /**
  * @brief  IRQ handler functions names
  */
-#define TIMER_DELAY_IRQ_HANDLER			TIM2_IRQHandler
+#define TIMER_DELAY_IRQ_HANDLER			TIM7_DAC_IRQHandler
 
 
 /* Exported functions ------------------------------------------------------- */
@@ -0,0 +1,130 @@
+/**
+ *******************************************************************************
+ * @file	stm32g4_vl53l0x_calibration.c
+ * @author	DEEP Project
+ * @date	Oct 17, 2026
+ * @brief	Cache des données de calibration des VL53L0X dans la page d'EEPROM virtuelle (stm32g4_flash)
+ *******************************************************************************
+ * La gestion des SPAD de référence et la calibration VHV/phase coûtent plusieurs centaines de ms par capteur.
+ * Leur résultat (ainsi que l'offset et la diaphonie éventuellement calibrés par l'application) est conservé
+ * en flash, un enregistrement de 4 doubles-mots par capteur :
+ *
+ *	[0] magic (16) | version (8) | adresse (8) | VHV (8) | phase (8) | nb SPAD (8) | SPAD aperture (8)
+ *	[1] UID haut (32) | UID bas (32)
+ *	[2] offset en um (32) | taux de diaphonie 16.16 (32)
+ *	[3] température (8) | 0 (24) | somme de contrôle (32)
+ *
+ * Un enregistrement n'est réutilisé que si l'adresse et l'identifiant unique du capteur correspondent,
+ * et si sa somme de contrôle est correcte (page effacée, écriture interrompue...).
+ */
+#include "config.h"
+#if USE_VL53L0
+#include "stm32g4_vl53l0x_calibration.h"
+#include "stm32g4_flash.h"
+#include <assert.h>
+
+#define VL53_CAL_MAGIC		0x5643
+#define VL53_CAL_VERSION	1
+
+static uint32_t VL53L0X_calibration_checksum(const uint64_t * record)
+{
+	uint32_t sum = 0x1234ABCD;
+	//somme pondérée des mots de 32 bits : détecte un mot effacé ou une inversion de mots
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		sum = sum * 31 + (uint32_t)(record[i] >> 32);
+		sum = sum * 31 + (uint32_t)record[i];
+	}
+	sum = sum * 31 + (uint32_t)(record[3] >> 32);
+	return ~sum;
+}
+
+static void VL53L0X_calibration_encode(const VL53L0X_calibration_t * cal, uint64_t * record)
+{
+	record[0] = ((uint64_t)VL53_CAL_MAGIC << 48)
+			| ((uint64_t)VL53_CAL_VERSION << 40)
+			| ((uint64_t)cal->address << 32)
+			| ((uint64_t)cal->vhv_settings << 24)
+			| ((uint64_t)cal->phase_cal << 16)
+			| ((uint64_t)cal->ref_spad_count << 8)
+			| (uint64_t)cal->is_aperture_spads;
+	record[1] = ((uint64_t)cal->uid_upper << 32) | cal->uid_lower;
+	record[2] = ((uint64_t)(uint32_t)cal->offset_micro_meter << 32) | cal->xtalk_rate;
+	record[3] = (uint64_t)(uint8_t)cal->temperature << 56;
+	record[3] |= VL53L0X_calibration_checksum(record);
+}
+
+/*
+ * @brief	Lit l'enregistrement de calibration d'un capteur
+ * @param	slot : numéro d'enregistrement (id du capteur)
+ * @param	address, uid_upper, uid_lower : clé attendue
+ * @return	true si un enregistrement valide correspondant à cette clé a été trouvé (cal est alors rempli)
+ */
+bool VL53L0X_calibration_load(uint8_t slot, uint8_t address, uint32_t uid_upper, uint32_t uid_lower, VL53L0X_calibration_t * cal)
+{
+	uint64_t record[VL53_CAL_RECORD_SIZE];
+	uint32_t index = VL53_CAL_FLASH_INDEX + (uint32_t)slot * VL53_CAL_RECORD_SIZE;
+
+	for(uint8_t i = 0; i < VL53_CAL_RECORD_SIZE; i++)
+		record[i] = BSP_FLASH_read_doubleword(index + i);
+
+	if((uint16_t)(record[0] >> 48) != VL53_CAL_MAGIC || (uint8_t)(record[0] >> 40) != VL53_CAL_VERSION)
+		return false;
+	if((uint32_t)record[3] != VL53L0X_calibration_checksum(record))
+		return false;
+
+	cal->address = (uint8_t)(record[0] >> 32);
+	cal->uid_upper = (uint32_t)(record[1] >> 32);
+	cal->uid_lower = (uint32_t)record[1];
+	if(cal->address != address || cal->uid_upper != uid_upper || cal->uid_lower != uid_lower)
+		return false;	//autre capteur à cette place (échange de capteurs, changement d'adresse...)
+
+	cal->vhv_settings = (uint8_t)(record[0] >> 24);
+	cal->phase_cal = (uint8_t)(record[0] >> 16);
+	cal->ref_spad_count = (uint8_t)(record[0] >> 8);
+	cal->is_aperture_spads = (uint8_t)record[0];
+	cal->offset_micro_meter = (int32_t)(uint32_t)(record[2] >> 32);
+	cal->xtalk_rate = (FixPoint1616_t)record[2];
+	cal->temperature = (int8_t)(uint8_t)(record[3] >> 56);
+	return true;
+}
+
+/*
+ * @brief	Enregistre les données de calibration d'un capteur, en une transaction (pas d'enregistrement à moitié écrit)
+ * @pre		Ne pas appeler en interruption : une écriture peut nécessiter un compactage du journal (quelques dizaines de ms)
+ * @return	false si l'enregistrement n'a pas pu être écrit (journal plein, flash défectueuse) : l'ancien reste en place
+ * @note	Rien n'est écrit si l'enregistrement est déjà identique, pour ménager la flash.
+ */
+bool VL53L0X_calibration_store(uint8_t slot, const VL53L0X_calibration_t * cal)
+{
+	uint64_t record[VL53_CAL_RECORD_SIZE];
+	uint32_t indexes[VL53_CAL_RECORD_SIZE];
+	uint32_t index = VL53_CAL_FLASH_INDEX + (uint32_t)slot * VL53_CAL_RECORD_SIZE;
+	assert(index + VL53_CAL_RECORD_SIZE <= 256);
+
+	VL53L0X_calibration_encode(cal, record);
+	for(uint8_t i = 0; i < VL53_CAL_RECORD_SIZE; i++)
+		indexes[i] = index + i;
+	return BSP_FLASH_set_doublewords(indexes, record, VL53_CAL_RECORD_SIZE);
+}
+
+/*
+ * @brief	Invalide l'enregistrement d'un capteur : sa prochaine initialisation refera une calibration complète
+ * @return	false si l'enregistrement n'a pas pu être vidé
+ */
+bool VL53L0X_calibration_erase(uint8_t slot)
+{
+	uint64_t record[VL53_CAL_RECORD_SIZE];
+	uint32_t indexes[VL53_CAL_RECORD_SIZE];
+	uint32_t index = VL53_CAL_FLASH_INDEX + (uint32_t)slot * VL53_CAL_RECORD_SIZE;
+
+	//cases vidées : elles n'occupent plus de place dans le journal
+	for(uint8_t i = 0; i < VL53_CAL_RECORD_SIZE; i++)
+	{
+		indexes[i] = index + i;
+		record[i] = 0xFFFFFFFFFFFFFFFF;
+	}
+	return BSP_FLASH_set_doublewords(indexes, record, VL53_CAL_RECORD_SIZE);
+}
+
+#endif
@@ -0,0 +1,56 @@
+/**
+ *******************************************************************************
+ * @file	stm32g4_vl53l0x_calibration.h
+ * @author	DEEP Project
+ * @date	Oct 17, 2026
+ * @brief	Cache des données de calibration des VL53L0X dans la page d'EEPROM virtuelle (stm32g4_flash)
+ *******************************************************************************
+ */
+#ifndef BSP_VL53L0X_STM32G4_VL53L0X_CALIBRATION_H_
+#define BSP_VL53L0X_STM32G4_VL53L0X_CALIBRATION_H_
+
+#include "config.h"
+#if USE_VL53L0
+
+	#include <stdint.h>
+	#include <stdbool.h>
+	#include "vl53l0x_types.h"
+
+	/* Première case (double-mot) de la page de flash utilisée par le cache : 4 cases par capteur */
+	#ifndef VL53_CAL_FLASH_INDEX
+		#define VL53_CAL_FLASH_INDEX		224
+	#endif
+	#define VL53_CAL_RECORD_SIZE			4
+
+	/* Écart de température (°C) au-delà duquel la calibration de référence (VHV et phase) est refaite */
+	#ifndef VL53_CAL_TEMPERATURE_DELTA
+		#define VL53_CAL_TEMPERATURE_DELTA	8
+	#endif
+	#define VL53_CAL_NO_TEMPERATURE			INT8_MIN	//température inconnue
+
+	/*
+	 * Données de calibration d'un capteur, identifié par son adresse I2C et son identifiant unique
+	 */
+	typedef struct
+	{
+		uint8_t address;				//adresse I2C (8 bits) attribuée au capteur
+		uint32_t uid_upper;				//identifiant unique du capteur (NVM)
+		uint32_t uid_lower;
+		uint8_t ref_spad_count;			//VL53L0X_SetReferenceSpads()
+		uint8_t is_aperture_spads;
+		uint8_t vhv_settings;			//VL53L0X_SetRefCalibration()
+		uint8_t phase_cal;
+		int8_t temperature;				//°C lors de la calibration de référence, VL53_CAL_NO_TEMPERATURE si inconnue
+		int32_t offset_micro_meter;		//VL53L0X_SetOffsetCalibrationDataMicroMeter()
+		FixPoint1616_t xtalk_rate;		//VL53L0X_SetXTalkCompensationRateMegaCps(), 0 : compensation désactivée
+	}VL53L0X_calibration_t;
+
+	bool VL53L0X_calibration_load(uint8_t slot, uint8_t address, uint32_t uid_upper, uint32_t uid_lower, VL53L0X_calibration_t * cal);
+
+	bool VL53L0X_calibration_store(uint8_t slot, const VL53L0X_calibration_t * cal);
+
+	bool VL53L0X_calibration_erase(uint8_t slot);
+
+#endif
+
+#endif /* BSP_VL53L0X_STM32G4_VL53L0X_CALIBRATION_H_ */
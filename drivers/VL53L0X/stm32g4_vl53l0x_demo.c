@@ -31,6 +31,9 @@
 #include "stm32g4_sys.h"
 #include "stm32g4_gpio.h"
 #include "stm32g4_timer.h"
+#include "stm32g4_extit.h"
+#include "stm32g4_vl53l0x_calibration.h"
+#include "vl53l0x_api_core.h"
 
 #define VL53L0_DISTANCEMODE_SHORT 1
 #define VL53L0_DISTANCEMODE_LONG 2
@@ -38,6 +41,20 @@
 #define VL53_RESET_STATE	0
 #define VL53_ON_STATE		1
 
+/* Bloc de résultat lu d'un seul tenant à partir de VL53L0X_REG_RESULT_RANGE_STATUS */
+#define VL53_RESULT_SIZE			12
+#define VL53_RESULT_SIGNAL_RATE		6	//MCPS, format 9.7
+#define VL53_RESULT_RANGE			10	//mm
+
+/* Sans front sur GPIO1 depuis ce délai alors que la broche est basse, l'IT est considérée comme perdue */
+#define VL53_MISSED_IT_US			100000
+
+#if VL53_INTER_MEASUREMENT_MS
+	#define VL53_DEVICE_MODE		VL53L0X_DEVICEMODE_CONTINUOUS_TIMED_RANGING
+#else
+	#define VL53_DEVICE_MODE		VL53L0X_DEVICEMODE_CONTINUOUS_RANGING
+#endif
+
 
 typedef enum{
 	INIT,
@@ -56,7 +73,7 @@ typedef enum {
 	HIGH_ACCURACY	= 2, /*!< High accuracy mode */
 } RangingConfig_e;
 
-void VL53_Setup(VL53L0X_DEV Dev, RangingConfig_e rangingConfig, VL53L0X_DeviceModes deviceMode);
+void VL53_Setup(uint8_t id, RangingConfig_e rangingConfig, VL53L0X_DeviceModes deviceMode);
 
 typedef struct{
 	GPIO_TypeDef * GPIO_Port;
@@ -76,6 +93,13 @@ typedef struct{
 	VL53L0X_RangingMeasurementData_t measurementDatas;
 	state_vl53_e state;
 	bool asked;
+	volatile uint32_t timestamp;		//[us] instant de l'IT "donnée prête" de la mesure en attente de lecture
+	VL53L0X_measure_t measure;			//dernière mesure publiée
+	uint32_t read_count;				//measure.count lors du dernier VL53L0X_get_measure()
+	VL53L0X_calibration_t calibration;	//calibration appliquée au capteur (lue en flash ou mesurée)
+	volatile bool full_calibration;		//prochaine init : ignorer le cache et tout recalibrer
+	bool recalibrate_ref;				//prochaine init : refaire la calibration VHV/phase (dérive de température)
+	volatile bool store_calibration;	//calibration à enregistrer en flash (fait hors IT par VL53L0X_process_main)
 }BEACON_data_sensor;
 
 #if VL53_NB>8
@@ -86,6 +110,7 @@ typedef struct{
  */
 static BEACON_data_sensor sensors[VL53_NB];
 static volatile bool flag_send_can_msg = false;
+static volatile int8_t ambient_temperature = VL53_CAL_NO_TEMPERATURE;
 
 static const VL53L0X_config sensor_reset_pins[VL53_NB] = {
 #ifdef VL_0
@@ -104,16 +129,102 @@ static const VL53L0X_config sensor_reset_pins[VL53_NB] = {
 		,(VL53L0X_config){VL_4}
 #endif
 #ifdef VL_5
-		,(VL53L0X_config){VL_4}
+		,(VL53L0X_config){VL_5}
 #endif
 #ifdef VL_6
-		,(VL53L0X_config){VL_4}
+		,(VL53L0X_config){VL_6}
 #endif
 #ifdef VL_7
-		,(VL53L0X_config){VL_4}
+		,(VL53L0X_config){VL_7}
+#endif
+};
+
+/*
+ * Broches reliées aux sorties GPIO1 des capteurs (facultatives, {NULL, 0} si absentes)
+ */
+#define VL53_NO_INT		(VL53L0X_config){NULL, 0}
+static const VL53L0X_config sensor_int_pins[VL53_NB] = {
+#ifdef VL_0_INT
+		(VL53L0X_config){VL_0_INT}
+#else
+		VL53_NO_INT
+#endif
+#if VL53_NB > 1
+	#ifdef VL_1_INT
+		,(VL53L0X_config){VL_1_INT}
+	#else
+		,VL53_NO_INT
+	#endif
+#endif
+#if VL53_NB > 2
+	#ifdef VL_2_INT
+		,(VL53L0X_config){VL_2_INT}
+	#else
+		,VL53_NO_INT
+	#endif
+#endif
+#if VL53_NB > 3
+	#ifdef VL_3_INT
+		,(VL53L0X_config){VL_3_INT}
+	#else
+		,VL53_NO_INT
+	#endif
+#endif
+#if VL53_NB > 4
+	#ifdef VL_4_INT
+		,(VL53L0X_config){VL_4_INT}
+	#else
+		,VL53_NO_INT
+	#endif
+#endif
+#if VL53_NB > 5
+	#ifdef VL_5_INT
+		,(VL53L0X_config){VL_5_INT}
+	#else
+		,VL53_NO_INT
+	#endif
+#endif
+#if VL53_NB > 6
+	#ifdef VL_6_INT
+		,(VL53L0X_config){VL_6_INT}
+	#else
+		,VL53_NO_INT
+	#endif
+#endif
+#if VL53_NB > 7
+	#ifdef VL_7_INT
+		,(VL53L0X_config){VL_7_INT}
+	#else
+		,VL53_NO_INT
+	#endif
 #endif
 };
 
+/*
+ * Lecture des résultats : file de capteurs prêts, servie par DMA (une lecture de 12 octets puis l'acquittement de l'IT).
+ * Alimentée par les IT GPIO1 (EXTI), et par la scrutation des capteurs sans broche d'IT.
+ */
+typedef enum{
+	XFER_IDLE,
+	XFER_READ,
+	XFER_CLEAR
+}xfer_step_e;
+
+static volatile uint8_t pending_read_mask = 0;		//capteurs dont le résultat est à lire
+static volatile uint8_t pending_clear_mask = 0;		//capteurs dont l'IT est à acquitter
+static volatile xfer_step_e xfer_step = XFER_IDLE;
+static volatile uint8_t xfer_id = 0;
+static uint8_t result_buffer[VL53_RESULT_SIZE];
+static uint8_t interrupt_clear = 0x01;
+
+static volatile bool bus_reserved = false;			//accès bloquants en cours dans VL53L0X_process_1ms()
+
+static bool VL53L0X_reserve_bus(void);
+static bool VL53L0X_temperature_drift(uint8_t id);
+static void VL53L0X_sensor_stop(uint8_t id);
+static void VL53L0X_xfer_next(void);
+static void VL53L0X_int_callback(uint8_t pin_number);
+
 void VL53L0X_Demo(void)
 {
 	VL53L0X_init();
@@ -136,7 +247,8 @@ bool VL53L0X_init(void){
 		BSP_GPIO_pin_config(sensor_reset_pins[id].GPIO_Port, sensor_reset_pins[id].GPIO_Pin,GPIO_MODE_OUTPUT_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_NO_AF);
 		HAL_GPIO_WritePin(sensor_reset_pins[id].GPIO_Port, sensor_reset_pins[id].GPIO_Pin, VL53_RESET_STATE);
 	}
-	BSP_I2C_Init(VL53L0X_I2C, STANDARD_MODE, true);
+	//400kHz : une lecture de résultat + acquittement prend ~0,5ms, 8 capteurs à pleine cadence tiennent sur le bus
+	BSP_I2C_Init(VL53L0X_I2C, FAST_MODE, true);
 
 	BSP_TIMER_run_us(TIMER1_ID, 1000, true);
 
@@ -152,7 +264,12 @@ timeslot_e VL53L0X_process_1ms(void){
 	static VL53L0X_Error erro = VL53L0X_ERROR_NONE;
 	static uint8_t timeslot = 0;
 	static bool flag_one_sensor_is_on_default_address = false;
+	bool bus_available;
 	HAL_GPIO_WritePin(LED_GREEN_GPIO, LED_GREEN_PIN, 1);
+
+	//Les accès bloquants de ce timeslot ne doivent pas croiser une lecture de résultat par DMA
+	bus_available = VL53L0X_reserve_bus();
+
 	for (uint16_t id = 0;  id < VL53_NB; id++)
 	{
 		switch (sensors[id].state)
@@ -192,7 +309,7 @@ timeslot_e VL53L0X_process_1ms(void){
 			case SET_ADDRESS:	// premier contact avec le capteur + changement de son adresse
 				//2 timeslots après avoir lâché le reset, on peut causer au capteur
 				//	(il emprunte exceptionennellement le timeslot de qn d'autre !)
-				if(timeslot == ((timeslot_e)id + 2)%TIMESLOT_NB)
+				if(timeslot == ((timeslot_e)id + 2)%TIMESLOT_NB && bus_available)
 				{
 					uint8_t new_address;
 					new_address = (uint8_t)(sensors[id].dev.I2cDevAddr + 2*id + 2);
@@ -230,13 +347,26 @@ timeslot_e VL53L0X_process_1ms(void){
 				}
 				break;
 			case SENSOR_INIT:
-				if(timeslot == (timeslot_e)id)
+				if(timeslot == (timeslot_e)id && bus_available)
 				{
 					if(VL53L0X_DataInit(&sensors[id].dev) == 0)
 					{
 						sensors[id].dev.Present = 1;
-						VL53_Setup(&sensors[id].dev, HIGH_SPEED, VL53L0X_DEVICEMODE_CONTINUOUS_RANGING);	//VL53L0X_DEVICEMODE_SINGLE_RANGING
-						erro = VL53L0X_StartMeasurement(&sensors[id].dev);
+						VL53_Setup((uint8_t)id, HIGH_SPEED, VL53_DEVICE_MODE);
+						//GPIO1 passe au niveau bas à chaque nouvelle mesure, jusqu'à l'acquittement de l'IT
+						erro = VL53L0X_SetGpioConfig(&sensors[id].dev, 0, VL53_DEVICE_MODE, VL53L0X_REG_SYSTEM_INTERRUPT_GPIO_NEW_SAMPLE_READY, VL53L0X_INTERRUPTPOLARITY_LOW);
+#if VL53_INTER_MEASUREMENT_MS
+						erro |= VL53L0X_SetInterMeasurementPeriodMilliSeconds(&sensors[id].dev, VL53_INTER_MEASUREMENT_MS);
+#endif
+						erro |= VL53L0X_ClearInterruptMask(&sensors[id].dev, 0);
+						if(sensor_int_pins[id].GPIO_Port != NULL)
+						{
+							BSP_GPIO_pin_config(sensor_int_pins[id].GPIO_Port, sensor_int_pins[id].GPIO_Pin, GPIO_MODE_IT_FALLING, GPIO_PULLUP, GPIO_SPEED_FREQ_HIGH, GPIO_NO_AF);
+							BSP_EXTIT_set_callback(&VL53L0X_int_callback, BSP_EXTIT_gpiopin_to_pin_number(sensor_int_pins[id].GPIO_Pin), true);
+						}
+						sensors[id].measure.timestamp_us = BSP_systick_get_time_us();
+						//Les capteurs démarrent chacun dans leur timeslot : leurs mesures sont décalées d'au moins 1ms
+						erro |= VL53L0X_StartMeasurement(&sensors[id].dev);
 						if(!erro)
 						{
 							sensors[id].enable = true;
@@ -244,8 +374,8 @@ timeslot_e VL53L0X_process_1ms(void){
 						}
 						else
 						{
+							VL53L0X_sensor_stop((uint8_t)id);
 							HAL_GPIO_WritePin(sensor_reset_pins[id].GPIO_Port ,sensor_reset_pins[id].GPIO_Pin, VL53_RESET_STATE);
-							sensors[id].enable = false;
 							sensors[id].state = INIT;
 						}
 					}
@@ -253,28 +383,48 @@ timeslot_e VL53L0X_process_1ms(void){
 				break;
 
 			case ASK_AND_GET_DATA:
-				if(timeslot == (timeslot_e)id)
+				//Les résultats sont lus par DMA dès l'IT GPIO1 (VL53L0X_int_callback).
+				//Ce timeslot ne sert qu'aux capteurs sans broche d'IT, et à rattraper une IT perdue.
+				if(timeslot == (timeslot_e)id && bus_available)
 				{
-
-				//	VL53L0X_GetMeasurementDataReady(Dev, &NewDataReady);
-					erro = VL53L0X_GetRangingMeasurementData(&sensors[id].dev,	&sensors[id].measurementDatas);
-					//sensors[id].dev.Data.PalState = VL53L0X_STATE_IDLE;
-
-					//erro |= VL53L0X_ClearInterruptMask(&sensors[id].dev, 0);
-
-
-
-					if(!erro)
+					uint8_t mask = (uint8_t)(1 << id);
+					bool ready = false;
+					if((pending_read_mask | pending_clear_mask) & mask)
+						break;
+					//Recalibration demandée, ou température trop éloignée de celle de la calibration de référence : réinitialisation du capteur
+					if(sensors[id].full_calibration || VL53L0X_temperature_drift((uint8_t)id))
+					{
+						sensors[id].recalibrate_ref = true;
+						sensors[id].state = FAIL;
+						break;
+					}
+					if(sensor_int_pins[id].GPIO_Port != NULL)
 					{
-						sensors[id].distance = sensors[id].measurementDatas.RangeMilliMeter;
-						sensors[id].rangeStatus = sensors[id].measurementDatas.RangeStatus;
+						//GPIO1 reste bas tant que l'IT n'est pas acquittée : plus aucun front n'arrivera
+						ready = HAL_GPIO_ReadPin(sensor_int_pins[id].GPIO_Port, sensor_int_pins[id].GPIO_Pin) == GPIO_PIN_RESET
+								&& BSP_systick_get_time_us() - sensors[id].measure.timestamp_us > VL53_MISSED_IT_US;
 					}
 					else
-						sensors[id].state = FAIL;
+					{
+						uint8_t interrupt_status;
+						erro = VL53L0X_RdByte(&sensors[id].dev, VL53L0X_REG_RESULT_INTERRUPT_STATUS, &interrupt_status);
+						if(erro)
+						{
+							sensors[id].state = FAIL;
+							break;
+						}
+						ready = (interrupt_status & 0x07) != 0;
+					}
+					if(ready)
+					{
+						sensors[id].timestamp = BSP_systick_get_time_us();
+						pending_read_mask |= mask;
+					}
 				}
 				break;
 
 			case FAIL:
+				VL53L0X_sensor_stop((uint8_t)id);
 				sensors[id].state = INIT;
 				HAL_GPIO_WritePin(sensor_reset_pins[id].GPIO_Port ,sensor_reset_pins[id].GPIO_Pin, VL53_RESET_STATE);
 				break;
@@ -294,13 +444,26 @@ timeslot_e VL53L0X_process_1ms(void){
 	ret = timeslot;
 	timeslot = (timeslot + 1) % TIMESLOT_NB;
 
+	//Libère le bus et lance les lectures arrivées pendant ce timeslot
+	bus_reserved = false;
+	VL53L0X_xfer_next();
+
 
 	HAL_GPIO_WritePin(LED_GREEN_GPIO, LED_GREEN_PIN, 0);
 	return ret;
 }
 
 
-void VL53_Setup(VL53L0X_DEV Dev, RangingConfig_e rangingConfig, VL53L0X_DeviceModes deviceMode){
+/*
+ * @brief	Configuration d'un capteur après VL53L0X_DataInit()
+ * @note	Les SPAD de référence, la calibration VHV/phase, l'offset et la diaphonie sont repris du cache en flash
+ * 			lorsqu'il correspond au capteur (adresse et identifiant unique) : seule la première initialisation
+ * 			d'un capteur paie les calibrations. La calibration VHV/phase est refaite si la température a dérivé.
+ */
+void VL53_Setup(uint8_t id, RangingConfig_e rangingConfig, VL53L0X_DeviceModes deviceMode){
+	VL53L0X_DEV Dev = &sensors[id].dev;
+	VL53L0X_calibration_t * cal = &sensors[id].calibration;
+	bool cached = false;
     int i;
     int status;
     uint8_t VhvSettings;
@@ -319,14 +482,40 @@ void VL53_Setup(VL53L0X_DEV Dev, RangingConfig_e rangingConfig, VL53L0X_DeviceMo
 			debug_printf("VL53L0X_StaticInit %d failed\n",i);
 		}
 
-		status = VL53L0X_PerformRefCalibration(Dev, &VhvSettings, &PhaseCal);
-		if( status ){
-		   debug_printf("VL53L0X_PerformRefCalibration failed\n");
-		}
+		//Identifiant unique lu en NVM : clé du cache de calibration
+		status = VL53L0X_get_info_from_device(Dev, 4);
+		if(!status && !sensors[id].full_calibration)
+			cached = VL53L0X_calibration_load(id, Dev->I2cDevAddr,
+					VL53L0X_GETDEVICESPECIFICPARAMETER(Dev, PartUIDUpper),
+					VL53L0X_GETDEVICESPECIFICPARAMETER(Dev, PartUIDLower), cal);
+		sensors[id].full_calibration = false;
 
-		status = VL53L0X_PerformRefSpadManagement(Dev, &refSpadCount, &isApertureSpads);
-		if( status ){
-		   debug_printf("VL53L0X_PerformRefSpadManagement failed\n");
+		if(cached)
+		{
+			status = VL53L0X_SetReferenceSpads(Dev, cal->ref_spad_count, cal->is_aperture_spads);
+			status |= VL53L0X_SetOffsetCalibrationDataMicroMeter(Dev, cal->offset_micro_meter);
+			if(cal->xtalk_rate)
+			{
+				status |= VL53L0X_SetXTalkCompensationRateMegaCps(Dev, cal->xtalk_rate);
+				status |= VL53L0X_SetXTalkCompensationEnable(Dev, 1);
+			}
+			if( status ){
+			   debug_printf("VL53L0X cached calibration failed\n");
+			}
+		}
+		else
+		{
+			status = VL53L0X_PerformRefSpadManagement(Dev, &refSpadCount, &isApertureSpads);
+			if( status ){
+			   debug_printf("VL53L0X_PerformRefSpadManagement failed\n");
+			}
+			cal->address = Dev->I2cDevAddr;
+			cal->uid_upper = VL53L0X_GETDEVICESPECIFICPARAMETER(Dev, PartUIDUpper);
+			cal->uid_lower = VL53L0X_GETDEVICESPECIFICPARAMETER(Dev, PartUIDLower);
+			cal->ref_spad_count = (uint8_t)refSpadCount;
+			cal->is_aperture_spads = isApertureSpads;
+			VL53L0X_GetOffsetCalibrationDataMicroMeter(Dev, &cal->offset_micro_meter);
+			cal->xtalk_rate = 0;
 		}
 
 
@@ -396,10 +585,28 @@ void VL53_Setup(VL53L0X_DEV Dev, RangingConfig_e rangingConfig, VL53L0X_DeviceMo
 		   debug_printf("VL53L0X_SetVcselPulsePeriod failed\n");
 		}
 
-		status = VL53L0X_PerformRefCalibration(Dev, &VhvSettings, &PhaseCal);
-		if( status ){
-		   debug_printf("VL53L0X_PerformRefCalibration failed\n");
+		if(cached && !sensors[id].recalibrate_ref)
+		{
+			status = VL53L0X_SetRefCalibration(Dev, cal->vhv_settings, cal->phase_cal);
+			if( status ){
+			   debug_printf("VL53L0X_SetRefCalibration failed\n");
+			}
 		}
+		else
+		{
+			status = VL53L0X_PerformRefCalibration(Dev, &VhvSettings, &PhaseCal);
+			if( status ){
+			   debug_printf("VL53L0X_PerformRefCalibration failed\n");
+			}
+			else
+			{
+				cal->vhv_settings = VhvSettings;
+				cal->phase_cal = PhaseCal;
+				cal->temperature = ambient_temperature;
+				sensors[id].store_calibration = true;
+			}
+		}
+		sensors[id].recalibrate_ref = false;
 
 		Dev->LeakyFirst=1;
 
@@ -411,6 +618,25 @@ void VL53L0X_process_main(void)
 {
 	char buf[100];
 	uint8_t index = 0;
+
+	//Enregistrements en flash hors IT (un compactage du journal peut durer plusieurs dizaines de ms)
+	for(uint8_t id = 0; id < VL53_NB; id++)
+	{
+		if(sensors[id].store_calibration)
+		{
+			VL53L0X_calibration_t cal;
+			__disable_irq();
+			cal = sensors[id].calibration;
+			sensors[id].store_calibration = false;
+			__enable_irq();
+			if(!VL53L0X_calibration_store(id, &cal))
+			{
+				//l'ancien enregistrement ne correspond plus à la calibration en cours : il ne doit pas être repris au prochain démarrage
+				debug_printf("VL53L0X_calibration_store %d failed\n", id);
+				VL53L0X_calibration_erase(id);
+			}
+		}
+	}
 	if(flag_send_can_msg)
 	{
 		flag_send_can_msg = false;
@@ -435,6 +661,191 @@ uint16_t VL53L0X_get_distance(uint8_t id)
 	return sensors[id].distance;
 }
 
+/*
+ * @brief	Copie la dernière mesure du capteur id
+ * @return	true si cette mesure n'avait pas encore été lue par cette fonction
+ */
+bool VL53L0X_get_measure(uint8_t id, VL53L0X_measure_t * measure)
+{
+	bool new_measure;
+	assert(id<VL53_NB);
+	__disable_irq();
+	*measure = sensors[id].measure;
+	__enable_irq();
+	new_measure = (measure->count != sensors[id].read_count);
+	sensors[id].read_count = measure->count;
+	return new_measure;
+}
+
+/*
+ * @brief	Indique la température ambiante (°C, issue de n'importe quel capteur), pour détecter la dérive
+ * 			des capteurs depuis leur calibration VHV/phase (écart > VL53_CAL_TEMPERATURE_DELTA)
+ */
+void VL53L0X_set_temperature(int8_t celsius)
+{
+	ambient_temperature = celsius;
+}
+
+/*
+ * @brief	Demande une calibration complète du capteur id (SPAD et VHV/phase) sans tenir compte du cache en flash
+ * @note	Le capteur est réinitialisé lors de son prochain timeslot, puis le cache est mis à jour.
+ */
+void VL53L0X_request_calibration(uint8_t id)
+{
+	assert(id<VL53_NB);
+	sensors[id].full_calibration = true;
+}
+
+/*
+ * @brief	Vrai si la température ambiante s'est éloignée de celle de la dernière calibration VHV/phase du capteur id
+ */
+static bool VL53L0X_temperature_drift(uint8_t id)
+{
+	int8_t t = ambient_temperature;
+	int8_t t_cal = sensors[id].calibration.temperature;
+	if(!sensors[id].enable || t == VL53_CAL_NO_TEMPERATURE || t_cal == VL53_CAL_NO_TEMPERATURE)
+		return false;
+	return (t > t_cal + VL53_CAL_TEMPERATURE_DELTA) || (t < t_cal - VL53_CAL_TEMPERATURE_DELTA);
+}
+
+/*
+ * @brief	Réserve le bus I2C pour des accès bloquants (API ST) : aucune lecture DMA ne sera lancée jusqu'à la libération
+ * @return	false si une lecture DMA est en cours (le bus n'est alors pas réservé)
+ */
+static bool VL53L0X_reserve_bus(void)
+{
+	bus_reserved = true;
+	if(xfer_step != XFER_IDLE)
+	{
+		bus_reserved = false;
+		return false;
+	}
+	return true;
+}
+
+/*
+ * @brief	Désactive l'IT du capteur id et le retire des files de lecture
+ */
+static void VL53L0X_sensor_stop(uint8_t id)
+{
+	sensors[id].enable = false;
+	if(sensor_int_pins[id].GPIO_Port != NULL)
+		BSP_EXTIT_disable(BSP_EXTIT_gpiopin_to_pin_number(sensor_int_pins[id].GPIO_Pin));
+	__disable_irq();
+	pending_read_mask &= (uint8_t)~(1 << id);
+	pending_clear_mask &= (uint8_t)~(1 << id);
+	__enable_irq();
+}
+
+/*
+ * @brief	Statut de mesure à partir du statut brut du capteur (même correspondance que VL53L0X_get_pal_range_status, sans les contrôles sigma/signal)
+ */
+static uint8_t VL53L0X_range_status(uint8_t device_range_status)
+{
+	switch(device_range_status)
+	{
+		case 11:	return 0;		//Range valid
+		case 1:
+		case 2:
+		case 3:		return 5;		//HW fail
+		case 6:
+		case 9:		return 4;		//Phase fail
+		case 8:
+		case 10:	return 3;		//Min range
+		case 4:		return 2;		//Signal fail
+		default:	return 255;		//None
+	}
+}
+
+/*
+ * @brief	Fin d'un transfert DMA (IT) : publication du résultat lu, puis transfert suivant
+ */
+static void VL53L0X_xfer_callback(HAL_StatusTypeDef status)
+{
+	uint8_t id = xfer_id;
+	if(xfer_step == XFER_READ)
+	{
+		if(status == HAL_OK)
+		{
+			VL53L0X_measure_t * m = &sensors[id].measure;
+			m->range_status = VL53L0X_range_status((result_buffer[0] & 0x78) >> 3);
+			m->distance = (uint16_t)(result_buffer[VL53_RESULT_RANGE] << 8 | result_buffer[VL53_RESULT_RANGE + 1]);
+			m->signal_rate = (uint16_t)(result_buffer[VL53_RESULT_SIGNAL_RATE] << 8 | result_buffer[VL53_RESULT_SIGNAL_RATE + 1]);
+			m->timestamp_us = sensors[id].timestamp;
+			m->count++;
+			sensors[id].distance = m->distance;
+			sensors[id].rangeStatus = m->range_status;
+		}
+		//Acquittement même en cas d'échec : sinon GPIO1 reste bas et plus aucune IT n'arrive
+		pending_clear_mask |= (uint8_t)(1 << id);
+	}
+	xfer_step = XFER_IDLE;
+	VL53L0X_xfer_next();
+}
+
+/*
+ * @brief	Lance le prochain transfert DMA en attente, si le bus est libre
+ * @note	Appelée depuis les IT EXTI, DMA et timer : la sélection se fait IT masquées.
+ * 			Les acquittements passent avant les lectures, et les lectures sont servies à tour de rôle.
+ */
+static void VL53L0X_xfer_next(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if(!bus_reserved && xfer_step == XFER_IDLE)
+	{
+		uint8_t id = xfer_id;
+		if(pending_clear_mask)
+		{
+			id = (uint8_t)__builtin_ctz(pending_clear_mask);
+			xfer_step = XFER_CLEAR;
+			if(BSP_I2C_WriteMulti_DMA(VL53L0X_I2C, sensors[id].dev.I2cDevAddr, VL53L0X_REG_SYSTEM_INTERRUPT_CLEAR, &interrupt_clear, 1, &VL53L0X_xfer_callback) == HAL_OK)
+			{
+				pending_clear_mask &= (uint8_t)~(1 << id);
+				xfer_id = id;
+			}
+			else
+				xfer_step = XFER_IDLE;
+		}
+		else if(pending_read_mask)
+		{
+			for(uint8_t i = 1; i <= VL53_NB; i++)
+			{
+				id = (uint8_t)((xfer_id + i) % VL53_NB);
+				if(pending_read_mask & (1 << id))
+					break;
+			}
+			xfer_step = XFER_READ;
+			if(BSP_I2C_ReadMulti_DMA(VL53L0X_I2C, sensors[id].dev.I2cDevAddr, VL53L0X_REG_RESULT_RANGE_STATUS, result_buffer, VL53_RESULT_SIZE, &VL53L0X_xfer_callback) == HAL_OK)
+			{
+				pending_read_mask &= (uint8_t)~(1 << id);
+				xfer_id = id;
+			}
+			else
+				xfer_step = XFER_IDLE;
+		}
+	}
+	__set_PRIMASK(primask);
+}
+
+/*
+ * @brief	IT GPIO1 (front descendant) : horodatage, et lecture du résultat dès que le bus est libre
+ */
+static void VL53L0X_int_callback(uint8_t pin_number)
+{
+	uint32_t now = BSP_systick_get_time_us();
+	for(uint8_t id = 0; id < VL53_NB; id++)
+	{
+		if(sensors[id].enable && sensor_int_pins[id].GPIO_Port != NULL
+				&& BSP_EXTIT_gpiopin_to_pin_number(sensor_int_pins[id].GPIO_Pin) == pin_number)
+		{
+			sensors[id].timestamp = now;
+			pending_read_mask |= (uint8_t)(1 << id);
+		}
+	}
+	VL53L0X_xfer_next();
+}
+
 
 
 
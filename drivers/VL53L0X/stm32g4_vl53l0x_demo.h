@@ -24,6 +24,18 @@
 		TIMESLOT_NB
 	}timeslot_e;
 
+	/*
+	 * Dernière mesure publiée d'un capteur
+	 */
+	typedef struct
+	{
+		uint16_t distance;			//mm
+		uint8_t range_status;		//0 : mesure valide, sinon statut d'erreur (même codes que VL53L0X_RangingMeasurementData_t.RangeStatus)
+		uint16_t signal_rate;		//MCPS, format virgule fixe 9.7
+		uint32_t timestamp_us;		//instant de l'IT "donnée prête" (BSP_systick_get_time_us)
+		uint32_t count;				//nombre de mesures publiées depuis le démarrage du capteur
+	}VL53L0X_measure_t;
+
 	void VL53L0X_Demo(void);
 
 	bool VL53L0X_init(void);
@@ -34,6 +46,12 @@
 
 	uint16_t VL53L0X_get_distance(uint8_t id);
 
+	bool VL53L0X_get_measure(uint8_t id, VL53L0X_measure_t * measure);
+
+	void VL53L0X_set_temperature(int8_t celsius);
+
+	void VL53L0X_request_calibration(uint8_t id);
+
 #endif
 
 #endif /* BSP_VL53L0X_STM32G4_VL53L0X_DEMO_H_ */
@@ -1367,6 +1367,9 @@ VL53L0X_Error VL53L0X_load_tuning_settings(VL53L0X_DEV Dev,
 
 	Index = 0;
 
+	/* Hundreds of single register writes: let the platform merge and queue them */
+	VL53L0X_WriteBatchBegin(Dev);
+
 	while ((*(pTuningSettingBuffer + Index) != 0) &&
 			(Status == VL53L0X_ERROR_NONE)) {
 		NumberOfWrites = *(pTuningSettingBuffer + Index);
@@ -1431,6 +1434,10 @@ VL53L0X_Error VL53L0X_load_tuning_settings(VL53L0X_DEV Dev,
 		}
 	}
 
+	if (VL53L0X_WriteBatchEnd(Dev) != VL53L0X_ERROR_NONE &&
+			Status == VL53L0X_ERROR_NONE)
+		Status = VL53L0X_ERROR_CONTROL_INTERFACE;
+
 	LOG_FUNCTION_END(Status);
 	return Status;
 }
@@ -62,7 +62,7 @@ VL53L0X_Error VL53L0X_WriteMulti(VL53L0X_DEV Dev, uint8_t index, uint8_t *pdata,
         return VL53L0X_ERROR_INVALID_PARAMS;
     }
     HAL_StatusTypeDef status;
-    status = BSP_I2C_WriteMulti(VL53L0X_I2C, Dev->I2cDevAddr, index, pdata, (uint16_t)count);
+    status = BSP_I2C_batch_write(VL53L0X_I2C, Dev->I2cDevAddr, index, pdata, (uint16_t)count);
     if (status != 0)
        	Status = VL53L0X_ERROR_CONTROL_INTERFACE;
 
@@ -70,10 +70,35 @@ VL53L0X_Error VL53L0X_WriteMulti(VL53L0X_DEV Dev, uint8_t index, uint8_t *pdata,
     return Status;
 }
 
+/* Write-combining: between VL53L0X_WriteBatchBegin() and VL53L0X_WriteBatchEnd(), writes to consecutive
+ * registers are merged into one auto-increment transaction and the others are queued and sent by DMA,
+ * in order. Reads first wait for the queued writes. Write errors are reported by the next read or by
+ * VL53L0X_WriteBatchEnd(). */
+VL53L0X_Error VL53L0X_WriteBatchBegin(VL53L0X_DEV Dev) {
+    UNUSED(Dev);
+    BSP_I2C_batch_begin(VL53L0X_I2C);
+    return VL53L0X_ERROR_NONE;
+}
+
+VL53L0X_Error VL53L0X_WriteBatchEnd(VL53L0X_DEV Dev) {
+    UNUSED(Dev);
+    if (BSP_I2C_batch_end(VL53L0X_I2C) != HAL_OK)
+        return VL53L0X_ERROR_CONTROL_INTERFACE;
+    return VL53L0X_ERROR_NONE;
+}
+
+/* Sends the queued writes before a read, so that the read sees them */
+static VL53L0X_Error _WriteBatchFlush(void) {
+    if (BSP_I2C_batch_flush(VL53L0X_I2C) != HAL_OK)
+        return VL53L0X_ERROR_CONTROL_INTERFACE;
+    return VL53L0X_ERROR_NONE;
+}
+
 // the ranging_sensor_comms.dll will take care of the page selection
 VL53L0X_Error VL53L0X_ReadMulti(VL53L0X_DEV Dev, uint8_t index, uint8_t *pdata, uint32_t count) {
-    VL53L0X_Error Status = VL53L0X_ERROR_NONE;
+    VL53L0X_Error Status;
     VL53L0X_GetI2cBus();
+    Status = _WriteBatchFlush();
     HAL_StatusTypeDef status;
     status = BSP_I2C_ReadMulti(VL53L0X_I2C, Dev->I2cDevAddr, index, pdata, (uint16_t)count);
 
@@ -87,7 +112,7 @@ VL53L0X_Error VL53L0X_ReadMulti(VL53L0X_DEV Dev, uint8_t index, uint8_t *pdata,
 VL53L0X_Error VL53L0X_WrByte(VL53L0X_DEV Dev, uint8_t index, uint8_t data) {
     VL53L0X_Error Status = VL53L0X_ERROR_NONE;
 
-    if(BSP_I2C_WriteMulti(VL53L0X_I2C, Dev->I2cDevAddr, index, &data, 1))
+    if(BSP_I2C_batch_write(VL53L0X_I2C, Dev->I2cDevAddr, index, &data, 1))
     	Status = VL53L0X_ERROR_CONTROL_INTERFACE;
 
     VL53L0X_PutI2cBus();
@@ -103,7 +128,7 @@ VL53L0X_Error VL53L0X_WrWord(VL53L0X_DEV Dev, uint8_t index, uint16_t data) {
 
     VL53L0X_GetI2cBus();
 
-    if(BSP_I2C_WriteMulti(VL53L0X_I2C, Dev->I2cDevAddr, index, &_I2CBuffer[1], 2))
+    if(BSP_I2C_batch_write(VL53L0X_I2C, Dev->I2cDevAddr, index, &_I2CBuffer[1], 2))
         Status = VL53L0X_ERROR_CONTROL_INTERFACE;
 
     VL53L0X_PutI2cBus();
@@ -119,7 +144,7 @@ VL53L0X_Error VL53L0X_WrDWord(VL53L0X_DEV Dev, uint8_t index, uint32_t data) {
     _I2CBuffer[4] = (uint8_t)((data >> 0 ) & 0xFF);
     VL53L0X_GetI2cBus();
 
-    if(BSP_I2C_WriteMulti(VL53L0X_I2C, Dev->I2cDevAddr, index, &_I2CBuffer[1], 4))
+    if(BSP_I2C_batch_write(VL53L0X_I2C, Dev->I2cDevAddr, index, &_I2CBuffer[1], 4))
           Status = VL53L0X_ERROR_CONTROL_INTERFACE;
 
 
@@ -142,9 +167,10 @@ done:
 }
 
 VL53L0X_Error VL53L0X_RdByte(VL53L0X_DEV Dev, uint8_t index, uint8_t *data) {
-    VL53L0X_Error Status = VL53L0X_ERROR_NONE;
+    VL53L0X_Error Status;
 
     VL53L0X_GetI2cBus();
+    Status = _WriteBatchFlush();
 
     if(BSP_I2C_ReadMulti(VL53L0X_I2C, Dev->I2cDevAddr, index, data, 1))
           Status = VL53L0X_ERROR_CONTROL_INTERFACE;
@@ -154,9 +180,10 @@ VL53L0X_Error VL53L0X_RdByte(VL53L0X_DEV Dev, uint8_t index, uint8_t *data) {
 }
 
 VL53L0X_Error VL53L0X_RdWord(VL53L0X_DEV Dev, uint8_t index, uint16_t *data) {
-    VL53L0X_Error Status = VL53L0X_ERROR_NONE;
+    VL53L0X_Error Status;
 
     VL53L0X_GetI2cBus();
+    Status = _WriteBatchFlush();
 
     if(BSP_I2C_ReadMulti(VL53L0X_I2C, Dev->I2cDevAddr, index, _I2CBuffer, 2))
         Status = VL53L0X_ERROR_CONTROL_INTERFACE;
@@ -171,9 +198,10 @@ VL53L0X_Error VL53L0X_RdWord(VL53L0X_DEV Dev, uint8_t index, uint16_t *data) {
 }
 
 VL53L0X_Error VL53L0X_RdDWord(VL53L0X_DEV Dev, uint8_t index, uint32_t *data) {
-    VL53L0X_Error Status = VL53L0X_ERROR_NONE;
+    VL53L0X_Error Status;
 
     VL53L0X_GetI2cBus();
+    Status = _WriteBatchFlush();
 
     if(BSP_I2C_ReadMulti(VL53L0X_I2C, Dev->I2cDevAddr, index, _I2CBuffer, 4))
            Status = VL53L0X_ERROR_CONTROL_INTERFACE;
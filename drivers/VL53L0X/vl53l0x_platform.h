@@ -236,6 +236,25 @@ VL53L0X_Error VL53L0X_RdDWord(VL53L0X_DEV Dev, uint8_t index, uint32_t *data);
  */
 VL53L0X_Error VL53L0X_UpdateByte(VL53L0X_DEV Dev, uint8_t index, uint8_t AndData, uint8_t OrData);
 
+/**
+ * Start write-combining on the device bus
+ *
+ * Until VL53L0X_WriteBatchEnd(), writes to consecutive registers are merged into
+ * a single auto-increment transaction, other writes are queued and sent by DMA in order.
+ * Reads wait for the queued writes first.
+ * @param   Dev       Device Handle
+ * @return  VL53L0X_ERROR_NONE        Success
+ */
+VL53L0X_Error VL53L0X_WriteBatchBegin(VL53L0X_DEV Dev);
+
+/**
+ * Send the queued writes, wait for them and stop write-combining
+ * @param   Dev       Device Handle
+ * @return  VL53L0X_ERROR_NONE        Success
+ * @return  VL53L0X_ERROR_CONTROL_INTERFACE    A queued write failed
+ */
+VL53L0X_Error VL53L0X_WriteBatchEnd(VL53L0X_DEV Dev);
+
 /** @} end of VL53L0X_registerAccess_group */
 
     
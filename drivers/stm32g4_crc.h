@@ -0,0 +1,47 @@
+/**
+ *******************************************************************************
+ * @file	stm32g4_crc.h
+ * @author	DEEP Project
+ * @date	Oct 17, 2026
+ * @brief	Calcul des CRC utilisés par les modules (NFC, LD19, 1-Wire, images flash)
+ *******************************************************************************
+ */
+#ifndef BSP_STM32G4_CRC_H_
+#define BSP_STM32G4_CRC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Taille (octets) à partir de laquelle l'unité CRC matérielle est utilisée, si elle est libre */
+#ifndef CRC_HW_THRESHOLD
+	#define CRC_HW_THRESHOLD	32
+#endif
+
+typedef enum
+{
+	CRC_ISO15693 = 0,	//CRC-16 ISO/IEC 13239 : polynôme 0x1021 réfléchi, init 0xFFFF, résultat complémenté
+	CRC_ISO14443A,		//CRC_A ISO/IEC 14443-3 : polynôme 0x1021 réfléchi, init 0x6363
+	CRC_ISO14443B,		//CRC_B ISO/IEC 14443-3 : identique au CRC ISO15693
+	CRC_LD19,			//CRC-8 des trames du lidar LD19 : polynôme 0x4D, init 0
+	CRC_DALLAS,			//CRC-8 Dallas/Maxim (1-Wire) : polynôme 0x31 réfléchi, init 0
+	CRC_32,				//CRC-32 IEEE 802.3 : polynôme 0x04C11DB7 réfléchi, init 0xFFFFFFFF, résultat complémenté
+	CRC_TYPE_NB
+}CRC_type_e;
+
+uint32_t BSP_CRC_compute(CRC_type_e type, const uint8_t * data, uint32_t len);
+
+uint32_t BSP_CRC_init(CRC_type_e type);
+
+uint32_t BSP_CRC_update(CRC_type_e type, uint32_t crc, const uint8_t * data, uint32_t len);
+
+uint32_t BSP_CRC_final(CRC_type_e type, uint32_t crc);
+
+bool BSP_CRC_check(CRC_type_e type, const uint8_t * data, uint32_t len);
+
+uint8_t BSP_CRC_size(CRC_type_e type);
+
+bool BSP_CRC_self_test(void);
+
+void BSP_CRC_demo(void);
+
+#endif /* BSP_STM32G4_CRC_H_ */
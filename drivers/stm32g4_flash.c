@@ -6,22 +6,99 @@
  * @date	Jun 11, 2024
  * @brief	Adaptation du module cr par Samuel Poiraud pour la stm32f103rbt6
  *******************************************************************************
+ * Les 256 cases (doubles-mots) sont tenues dans un journal sur les deux dernires pages de la flash
+ * (rgion VIRTUAL_EEPROM du script de l'diteur de liens) :
+ *	- la page active reoit les critures les unes  la suite des autres, un double-mot n'est jamais rcrit,
+ *	- l'autre page reoit, lors d'un compactage, la dernire valeur de chaque case, puis devient la page active.
+ *
+ * Une page commence par son en-tte (CRC32 | gnration), suivi de 127 enregistrements de 2 doubles-mots :
+ *	- la nouvelle valeur de la case (non programme si elle vaut 0xFFFFFFFFFFFFFFFF, valeur d'une case vide),
+ *	- l'en-tte de l'enregistrement : drapeaux (bits 56-63) | case (48-55) | squence (32-47) | CRC32 (0-31).
+ *	  Programm aprs la valeur, c'est lui qui valide l'enregistrement.
+ * Une mise  jour cote donc deux programmations : la valeur occupe  elle seule un double-mot, l'unit de
+ * programmation de la flash (protge par ECC, programmable une seule fois), et la case, la squence et le CRC
+ * ne peuvent pas l'accompagner.
+ * Une coupure d'alimentation  n'importe quel instant laisse chaque case  son ancienne ou  sa nouvelle valeur :
+ *	- un enregistrement dont l'en-tte est absent ou incomplet (CRC faux, erreur ECC double  la lecture) est ignor,
+ *	- les enregistrements d'une transaction (BSP_FLASH_set_doublewords) partagent un numro de squence et le dernier
+ *	  porte le drapeau RECORD_LAST : une transaction incomplte est ignore en entier,
+ *	- l'en-tte de la page compacte est crit en dernier : jusque-l, l'ancienne page reste la page active.
+ *
+ * En RAM, un index donne la position de la dernire valeur de chaque case. Il est construit au premier accs,
+ * en parcourant la page active (celle dont l'en-tte est valide et la gnration la plus grande).
+ *
+ * Le compactage commence lorsque la page active est presque pleine. Il avance par tapes dans BSP_FLASH_process(),
+ * appele dans la boucle principale (app/main.c), ou se termine d'un coup si une criture ne trouve plus de place.
+ * Les cases modifies pendant le compactage, aprs leur copie, sont recopies avant l'criture de l'en-tte.
+ * Le nombre de cases non vides est limit par la taille d'une page : au plus RECORDS_PER_PAGE - COMPACTION_THRESHOLD.
  */
 #include "stm32g4_flash.h"
+#include "stm32g4_crc.h"
 #include "stm32g4xx_hal.h"
 #include "stm32g4xx_hal_flash_ex.h"
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 
-#define BASE_ADDRESS					0x0801F800		//adresse du dbut de la dernire page (2kBytes)
-#define PAGE_USED_FOR_THIS_MODULE    	63
+#define BASE_ADDRESS					0x0801F000		//adresse du dbut des deux dernires pages (2x2kBytes)
+#define FIRST_PAGE_USED_FOR_THIS_MODULE	62
 #define	SIZE_SECTOR_IN_BYTES			(2048)
 #define SIZE_SECTOR_IN_DOUBLEWORDS		(SIZE_SECTOR_IN_BYTES/8)
+#define NB_DOUBLEWORDS					256				//nombre de cases
 
+#define RECORDS_PER_PAGE				((SIZE_SECTOR_IN_DOUBLEWORDS-1)/2)
+#define PAGE_ADDRESS(page)				(BASE_ADDRESS + (page)*SIZE_SECTOR_IN_BYTES)
+#define RECORD_ADDRESS(page, record)	(PAGE_ADDRESS(page) + 8 + 16*(record))	//valeur, puis en-tte  +8
 
-static void FLASH_write_doubleword(uint32_t index, uint64_t data);
-static void FLASH_keeping_everything_else(uint32_t index);
-static void FLASH_erase(void);
+#define ERASED_DOUBLEWORD				((uint64_t)0xFFFFFFFFFFFFFFFF)
+#define JOURNAL_MAGIC					0x4A524E4C		//"JRNL", entre dans le CRC de l'en-tte de page
+#define RECORD_LAST						0x01			//dernier enregistrement d'une transaction
+#define NO_POSITION						0xFF
+
+#define COMPACTION_THRESHOLD			32				//le compactage commence lorsqu'il reste moins d'enregistrements libres
+#define COMPACTION_RECORDS_PER_STEP		16				//copies par appel de BSP_FLASH_process : 32 programmations de 82s, environ 3ms
+															//(l'tape d'effacement dure environ 22ms). Le programme s'excutant
+															//depuis la flash, la CPU et les interruptions attendent pendant ce temps.
+#define COMPACTION_MAX_STEPS			64				//compactage complet : effacement, copies et en-tte, avec quelques reprises
+#define WRITE_ATTEMPTS					3				//tentatives d'criture d'une transaction (double-mot dfectueux)
+
+typedef enum
+{
+	COMPACTION_IDLE = 0,
+	COMPACTION_ERASE,		//effacement de l'autre page
+	COMPACTION_COPY,		//copie des dernires valeurs
+	COMPACTION_COMMIT		//criture de l'en-tte : l'autre page devient active
+}compaction_state_e;
+
+static struct
+{
+	bool ready;
+	uint8_t active;							//page active : 0 ou 1
+	uint32_t generation;					//gnration de la page active
+	uint8_t next;							//premier enregistrement libre de la page active
+	uint16_t sequence;						//squence de la prochaine transaction
+	uint8_t position[NB_DOUBLEWORDS];		//enregistrement de la dernire valeur de chaque case, NO_POSITION si la case est vide
+	compaction_state_e compaction;
+	uint16_t cursor;						//prochaine case  copier
+	uint8_t copied;							//premier enregistrement libre de l'autre page
+	uint32_t recopy[NB_DOUBLEWORDS/32];		//cases modifies aprs leur copie
+}journal;
+
+static volatile bool ecc_error = false;
+
+static void FLASH_init(void);
+static void FLASH_scan(void);
+static bool FLASH_reserve(uint32_t nb);
+static void FLASH_compaction_step(void);
+static bool FLASH_copy(uint8_t index);
+static uint32_t FLASH_nb_used(void);
+static bool FLASH_read(uint32_t address, uint64_t * data);
+static bool FLASH_read_page_header(uint8_t page, uint32_t * generation);
+static uint64_t FLASH_page_header(uint32_t generation);
+static uint64_t FLASH_record_header(uint8_t index, uint64_t data, uint8_t flags, uint16_t sequence);
+static bool FLASH_write_record(uint8_t page, uint8_t record, uint8_t index, uint64_t data, uint8_t flags, uint16_t sequence);
+static bool FLASH_program(uint32_t address, uint64_t data);
+static bool FLASH_erase_page(uint8_t page);
 extern void FLASH_PageErase(uint32_t PageAddress, uint32_t Banks);
 
 
@@ -52,45 +129,147 @@ void FLASH_demo(void)
 /**
  * @brief	Enregistre une donne dans la case souhaite, sans toucher aux autres cases
  * @param  	index: Numro de la case (de 0  255).
- * @post  	ATTENTION : si la case est dj occupe par une donne diffrente de 0xFFFFFFFF (valeur par dfaut aprs effacement), une sauvegarde complte du secteur est faite, puis un effacement, puis une restitution !
- * @post  	le temps d'excution de cette fonction peut nettement varier !
- * @pre		//ATTENTION : ne pas appeler cette fonction trop frquemment. Risque d'endommager la flash en cas d'critures trop nombreuses. (>10000 sur le cycle de vie complet du produit)
+ * @return	true si la donne est enregistre, false si le journal est plein (trop de cases non vides) ou la flash dfectueuse
+ * @post  	la donne est ajoute au journal (deux doubles-mots). Si la page active est pleine, le compactage est termin
+ * 			d'abord : le temps d'excution de cette fonction peut alors atteindre quelques dizaines de ms.
+ * @pre		Ne pas appeler en interruption.
  */
-void BSP_FLASH_set_doubleword(uint32_t index, uint64_t data)
+bool BSP_FLASH_set_doubleword(uint32_t index, uint64_t data)
 {
-	uint64_t current_doubleword;
-	assert(index < SIZE_SECTOR_IN_DOUBLEWORDS);
-	current_doubleword = BSP_FLASH_read_doubleword(index);
-	if((current_doubleword & data) != data)	//il n'est pas possible d'crire le mot sans tre pollu par des zros qui seraient dj crit ici
-		FLASH_keeping_everything_else(index);
+	return BSP_FLASH_set_doublewords(&index, &data, 1);
+}
+
+/**
+ * @brief	Enregistre plusieurs cases de faon atomique : aprs une coupure d'alimentation, toutes les cases
+ * 			ont leur nouvelle valeur, ou toutes ont leur ancienne valeur.
+ * @param	indexes : numros des cases (de 0  255, chacune au plus une fois)
+ * @param	data : nouvelles valeurs
+ * @param	nb : nombre de cases (au plus FLASH_MAX_TRANSACTION)
+ * @return	true si les donnes sont enregistres
+ * @note	Les cases dont la valeur ne change pas ne sont pas rcrites.
+ * @pre		Ne pas appeler en interruption.
+ */
+bool BSP_FLASH_set_doublewords(const uint32_t * indexes, const uint64_t * data, uint32_t nb)
+{
+	uint8_t changed_indexes[FLASH_MAX_TRANSACTION];
+	uint64_t changed_data[FLASH_MAX_TRANSACTION];
+	uint32_t nb_changed = 0;
+	uint32_t i;
+	uint8_t attempt;
+	bool written = false;
+
+	assert(nb <= FLASH_MAX_TRANSACTION);
+	if(nb > FLASH_MAX_TRANSACTION)
+		return false;
+	for(i = 0; i < nb; i++)
+	{
+		assert(indexes[i] < NB_DOUBLEWORDS);
+		if(BSP_FLASH_read_doubleword(indexes[i]) != data[i])
+		{
+			changed_indexes[nb_changed] = (uint8_t)indexes[i];
+			changed_data[nb_changed] = data[i];
+			nb_changed++;
+		}
+	}
+	if(nb_changed == 0)
+		return true;
+
+	for(attempt = 0; attempt < WRITE_ATTEMPTS && !written; attempt++)
+	{
+		if(!FLASH_reserve(nb_changed))
+			return false;
+		//un double-mot qui ne se programme pas est abandonn : la transaction recommence plus loin, avec une autre squence
+		written = true;
+		for(i = 0; i < nb_changed && written; i++)
+		{
+			written = FLASH_write_record(journal.active, journal.next, changed_indexes[i], changed_data[i],
+										(i == nb_changed - 1) ? RECORD_LAST : 0, journal.sequence);
+			journal.next++;
+		}
+		journal.sequence++;
+	}
+	if(!written)
+		return false;
+
+	for(i = 0; i < nb_changed; i++)
+	{
+		uint8_t index = changed_indexes[i];
+		journal.position[index] = (changed_data[i] == ERASED_DOUBLEWORD) ? NO_POSITION : (uint8_t)(journal.next - nb_changed + i);
+		if(journal.compaction == COMPACTION_COPY && index < journal.cursor)
+			journal.recopy[index/32] |= (uint32_t)1 << (index%32);
+	}
 
-	FLASH_write_doubleword(index, data);
+	//compactage  l'approche de la fin de la page, s'il libre de la place
+	if(journal.compaction == COMPACTION_IDLE
+			&& RECORDS_PER_PAGE - journal.next < COMPACTION_THRESHOLD
+			&& FLASH_nb_used() <= RECORDS_PER_PAGE - COMPACTION_THRESHOLD)
+		journal.compaction = COMPACTION_ERASE;
+	return true;
 }
 
 
 /**
  * @brief	Lit une donnee situee dans la case souhaitee.
- * @param	index: Numero de la case (de 0 a SIZE_SECTOR_IN_WORDS-1).
+ * @param	index: Numero de la case (de 0 a 255).
+ * @return	la derniere valeur enregistree, 0xFFFFFFFFFFFFFFFF si la case est vide
  */
 uint64_t BSP_FLASH_read_doubleword(uint32_t index)
 {
-	assert(index < SIZE_SECTOR_IN_DOUBLEWORDS);
+	uint64_t data;
+	assert(index < NB_DOUBLEWORDS);
+
+	FLASH_init();
+	if(journal.position[index] == NO_POSITION)
+		return ERASED_DOUBLEWORD;
+	if(!FLASH_read(RECORD_ADDRESS(journal.active, journal.position[index]), &data))
+		return ERASED_DOUBLEWORD;
+	return data;
+}
 
-	uint64_t * p;
-	p = (uint64_t *)(BASE_ADDRESS + 8*index);
+/**
+ * @brief	Fait avancer le compactage du journal d'une tape : effacement de l'autre page (environ 20ms),
+ * 			copie de quelques cases (quelques ms) ou changement de page active.
+ * @pre		A appeler en tche de fond, lorsque ces dures sont acceptables. Sans appel, le compactage est fait
+ * 			en une fois par l'criture qui ne trouve plus de place.
+ */
+void BSP_FLASH_process(void)
+{
+	if(journal.ready && journal.compaction != COMPACTION_IDLE)
+		FLASH_compaction_step();
+}
 
-	return (uint64_t)(*p);
+/**
+ * @brief	Traitement d'une erreur ECC double lors d'une lecture du journal,  appeler dans NMI_Handler.
+ * 			Un double-mot dont la programmation a t interrompue par une coupure peut dclencher cette erreur :
+ * 			sa lecture est alors signale  FLASH_read, qui ignore l'enregistrement.
+ * @return	true si l'erreur concernait le journal (le programme peut reprendre), false sinon
+ */
+bool BSP_FLASH_ecc_error_handler(void)
+{
+	uint32_t offset;
+	if(!(FLASH->ECCR & FLASH_ECCR_ECCD))
+		return false;
+	offset = FLASH->ECCR & FLASH_ECCR_ADDR_ECC;
+	if(offset < BASE_ADDRESS - FLASH_BASE || offset >= BASE_ADDRESS - FLASH_BASE + 2*SIZE_SECTOR_IN_BYTES)
+		return false;
+	FLASH->ECCR |= FLASH_ECCR_ECCD;
+	ecc_error = true;
+	return true;
 }
 
 
 /**
- * @brief Cette fonction affiche les SIZE_SECTOR donnes (32 bits) disponibles dans le dernier secteur de la FLASH
+ * @brief Cette fonction affiche l'tat du journal et les 256 donnes (64 bits) qu'il contient
  */
 void BSP_FLASH_dump(void){
 	uint32_t index;
 	uint64_t v;
-	printf("Affichage des %d donnees (64 bits) disponibles dans le dernier secteur de la FLASH\n", SIZE_SECTOR_IN_DOUBLEWORDS);
-	for(index = 0; index<SIZE_SECTOR_IN_DOUBLEWORDS; index++)
+	FLASH_init();
+	printf("Journal : page %d active (generation %lu), %d enregistrements sur %d, %lu cases utilisees%s\n",
+			FIRST_PAGE_USED_FOR_THIS_MODULE + journal.active, journal.generation, journal.next, RECORDS_PER_PAGE,
+			FLASH_nb_used(), (journal.compaction != COMPACTION_IDLE) ? ", compactage en cours" : "");
+	printf("Affichage des %d donnees (64 bits) disponibles dans le journal en FLASH\n", NB_DOUBLEWORDS);
+	for(index = 0; index<NB_DOUBLEWORDS; index++)
 	{
 		v = BSP_FLASH_read_doubleword(index);
 		uint32_t low = (uint32_t)(v & 0xFFFFFFFF);
@@ -100,38 +279,285 @@ void BSP_FLASH_dump(void){
 }
 
 
-static void FLASH_keeping_everything_else(uint32_t index)
+/*
+ * @brief	Choix de la page active et construction de l'index, au premier accs.
+ * 			Sans page valide (premier dmarrage), la premire page est formate.
+ */
+static void FLASH_init(void)
 {
-	uint64_t saved_values[SIZE_SECTOR_IN_DOUBLEWORDS];
-	uint32_t i;
-	assert(index < SIZE_SECTOR_IN_DOUBLEWORDS);
-	for(i=0; i<SIZE_SECTOR_IN_DOUBLEWORDS; i++)
-		saved_values[i] = BSP_FLASH_read_doubleword(i);
-	FLASH_erase();
-	for(i=0; i<SIZE_SECTOR_IN_DOUBLEWORDS; i++)
+	uint32_t generation[2];
+	bool valid[2];
+	if(journal.ready)
+		return;
+	journal.ready = true;
+	journal.compaction = COMPACTION_IDLE;
+
+	valid[0] = FLASH_read_page_header(0, &generation[0]);
+	valid[1] = FLASH_read_page_header(1, &generation[1]);
+	if(valid[0] || valid[1])
+	{
+		journal.active = (valid[1] && (!valid[0] || generation[1] > generation[0])) ? 1 : 0;
+		journal.generation = generation[journal.active];
+	}
+	else
+	{
+		journal.active = 0;
+		journal.generation = 1;
+		if(!FLASH_erase_page(0) || !FLASH_program(PAGE_ADDRESS(0), FLASH_page_header(1)))
+		{
+			//flash dfectueuse : journal plein, le compactage vers l'autre page est tent  la prochaine criture
+			memset(journal.position, NO_POSITION, sizeof(journal.position));
+			journal.next = RECORDS_PER_PAGE;
+			return;
+		}
+	}
+	FLASH_scan();
+}
+
+/*
+ * @brief	Parcours de la page active : index des dernires valeurs, premier enregistrement libre et squence.
+ * 			Les enregistrements invalides et les transactions incompltes sont ignors.
+ */
+static void FLASH_scan(void)
+{
+	uint8_t pending_indexes[FLASH_MAX_TRANSACTION];
+	uint8_t pending_positions[FLASH_MAX_TRANSACTION];
+	uint8_t nb_pending = 0;
+	uint16_t pending_sequence = 0;
+	uint8_t record;
+
+	memset(journal.position, NO_POSITION, sizeof(journal.position));
+	journal.next = 0;
+	journal.sequence = 0;
+	for(record = 0; record < RECORDS_PER_PAGE; record++)
+	{
+		uint32_t address = RECORD_ADDRESS(journal.active, record);
+		uint64_t data, header;
+		bool data_ok = FLASH_read(address, &data);
+		bool header_ok = FLASH_read(address + 8, &header);
+		if(data_ok && header_ok && data == ERASED_DOUBLEWORD && header == ERASED_DOUBLEWORD)
+			break;		//fin du journal
+		journal.next = record + 1;
+
+		uint8_t flags = (uint8_t)(header >> 56);
+		uint8_t index = (uint8_t)(header >> 48);
+		uint16_t sequence = (uint16_t)(header >> 32);
+		if(!data_ok || !header_ok || (flags & ~RECORD_LAST) || header != FLASH_record_header(index, data, flags, sequence))
+		{
+			nb_pending = 0;		//enregistrement interrompu : la transaction en cours est abandonne
+			continue;
+		}
+		journal.sequence = sequence + 1;
+		if(nb_pending != 0 && sequence != pending_sequence)
+			nb_pending = 0;		//transaction prcdente incomplte
+		if(nb_pending == FLASH_MAX_TRANSACTION)
+			nb_pending = 0;
+		pending_sequence = sequence;
+		pending_indexes[nb_pending] = index;
+		pending_positions[nb_pending] = (data == ERASED_DOUBLEWORD) ? NO_POSITION : record;
+		nb_pending++;
+		if(flags & RECORD_LAST)
+		{
+			for(uint8_t i = 0; i < nb_pending; i++)
+				journal.position[pending_indexes[i]] = pending_positions[i];
+			nb_pending = 0;
+		}
+	}
+}
+
+/*
+ * @brief	Garantit nb enregistrements libres dans la page active, en terminant le compactage si ncessaire
+ * @return	false si la place manque mme aprs compactage
+ */
+static bool FLASH_reserve(uint32_t nb)
+{
+	uint32_t generation;
+	uint32_t step;
+	if(journal.next + nb <= RECORDS_PER_PAGE)
+		return true;
+	if(FLASH_nb_used() + nb > RECORDS_PER_PAGE)
+		return false;	//le compactage ne librerait pas assez de place
+	if(journal.compaction == COMPACTION_IDLE)
+		journal.compaction = COMPACTION_ERASE;
+	generation = journal.generation;
+	for(step = 0; step < COMPACTION_MAX_STEPS && journal.compaction != COMPACTION_IDLE && journal.generation == generation; step++)
+		FLASH_compaction_step();
+	return journal.next + nb <= RECORDS_PER_PAGE;
+}
+
+/*
+ * @brief	Une tape du compactage vers l'autre page. Un chec le fait reprendre  l'effacement,
+ * 			sauf si les cases non vides ne tiennent pas dans une page (il est alors abandonn).
+ */
+static void FLASH_compaction_step(void)
+{
+	uint8_t spare = journal.active ^ 1;
+	uint8_t nb;
+
+	switch(journal.compaction)
+	{
+		case COMPACTION_ERASE:
+			if(!FLASH_erase_page(spare))
+				break;
+			journal.cursor = 0;
+			journal.copied = 0;
+			memset(journal.recopy, 0, sizeof(journal.recopy));
+			journal.compaction = COMPACTION_COPY;
+			break;
+		case COMPACTION_COPY:
+			for(nb = 0; nb < COMPACTION_RECORDS_PER_STEP && journal.compaction == COMPACTION_COPY; )
+			{
+				uint32_t index;
+				if(journal.cursor < NB_DOUBLEWORDS)
+				{
+					index = journal.cursor++;
+					if(journal.position[index] == NO_POSITION)
+						continue;	//case vide : rien  copier
+				}
+				else
+				{
+					for(index = 0; index < NB_DOUBLEWORDS && !(journal.recopy[index/32] & ((uint32_t)1 << (index%32))); index++);
+					if(index == NB_DOUBLEWORDS)
+					{
+						journal.compaction = COMPACTION_COMMIT;
+						break;
+					}
+					journal.recopy[index/32] &= ~((uint32_t)1 << (index%32));
+				}
+				if(!FLASH_copy((uint8_t)index))
+					journal.compaction = COMPACTION_IDLE;	//les cases non vides et leurs recopies ne tiennent pas dans une page
+				nb++;
+			}
+			if(journal.compaction != COMPACTION_COMMIT)
+				break;
+			//pas de break : l'en-tte est crit dans la mme tape, aucune criture ne doit s'intercaler aprs la dernire copie
+		case COMPACTION_COMMIT:
+			if(!FLASH_program(PAGE_ADDRESS(spare), FLASH_page_header(journal.generation + 1)))
+			{
+				journal.compaction = COMPACTION_ERASE;
+				break;
+			}
+			journal.active = spare;
+			journal.generation++;
+			journal.compaction = COMPACTION_IDLE;
+			FLASH_scan();
+			break;
+		default:
+			journal.compaction = COMPACTION_IDLE;
+			break;
+	}
+}
+
+/*
+ * @brief	Copie la dernire valeur d'une case dans l'autre page (enregistrement vide si la case a t vide)
+ */
+static bool FLASH_copy(uint8_t index)
+{
+	uint64_t data = BSP_FLASH_read_doubleword(index);
+	while(journal.copied < RECORDS_PER_PAGE)
 	{
-		if(i!=index && saved_values[i]!=(uint64_t)0xFFFFFFFFFFFFFFFF)
-			FLASH_write_doubleword(i, saved_values[i]);	//on rcrit tout sauf le mot
+		if(FLASH_write_record(journal.active ^ 1, journal.copied++, index, data, RECORD_LAST, 0))
+			return true;
 	}
+	return false;
+}
+
+static uint32_t FLASH_nb_used(void)
+{
+	uint32_t nb = 0;
+	for(uint32_t index = 0; index < NB_DOUBLEWORDS; index++)
+		if(journal.position[index] != NO_POSITION)
+			nb++;
+	return nb;
+}
+
+/*
+ * @brief	Lecture d'un double-mot du journal
+ * @return	false si la lecture a dclench une erreur ECC double (double-mot dont la programmation a t interrompue)
+ */
+static bool FLASH_read(uint32_t address, uint64_t * data)
+{
+	ecc_error = false;
+	*data = *(volatile uint64_t *)address;
+	__DSB();	//la NMI de l'erreur ECC est prise avant le test
+	__ISB();
+	return !ecc_error;
+}
+
+static bool FLASH_read_page_header(uint8_t page, uint32_t * generation)
+{
+	uint64_t header;
+	if(!FLASH_read(PAGE_ADDRESS(page), &header) || header == ERASED_DOUBLEWORD)
+		return false;
+	*generation = (uint32_t)header;
+	return header == FLASH_page_header(*generation);
 }
 
-static void FLASH_erase(void)
+static uint64_t FLASH_page_header(uint32_t generation)
 {
+	uint32_t words[2] = {JOURNAL_MAGIC, generation};
+	return (uint64_t)BSP_CRC_compute(CRC_32, (const uint8_t *)words, sizeof(words)) << 32 | generation;
+}
+
+static uint64_t FLASH_record_header(uint8_t index, uint64_t data, uint8_t flags, uint16_t sequence)
+{
+	uint8_t bytes[12];
+	uint64_t header = (uint64_t)flags << 56 | (uint64_t)index << 48 | (uint64_t)sequence << 32;
+	memcpy(bytes, &data, 8);
+	memcpy(bytes + 8, (const uint8_t *)&header + 4, 4);
+	return header | BSP_CRC_compute(CRC_32, bytes, sizeof(bytes));
+}
+
+static bool FLASH_write_record(uint8_t page, uint8_t record, uint8_t index, uint64_t data, uint8_t flags, uint16_t sequence)
+{
+	uint32_t address = RECORD_ADDRESS(page, record);
+	if(data != ERASED_DOUBLEWORD && !FLASH_program(address, data))
+		return false;
+	return FLASH_program(address + 8, FLASH_record_header(index, data, flags, sequence));
+}
+
+/*
+ * @brief	Programmation d'un double-mot effac, vrifie par relecture
+ */
+static bool FLASH_program(uint32_t address, uint64_t data)
+{
+	uint64_t check;
+	HAL_StatusTypeDef status;
+	HAL_FLASH_Unlock();
+	status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, address, data);
+	HAL_FLASH_Lock();
+	if(status != HAL_OK)
+		return false;
+	return FLASH_read(address, &check) && check == data;
+}
+
+/*
+ * @brief	Effacement d'une page du journal, vrifi par relecture (un effacement interrompu laisse des bits  0)
+ */
+static bool FLASH_erase_page(uint8_t page)
+{
+	uint64_t data;
 	HAL_FLASH_Unlock();
-	FLASH_PageErase(PAGE_USED_FOR_THIS_MODULE, FLASH_BANK_1);
+	FLASH_PageErase(FIRST_PAGE_USED_FOR_THIS_MODULE + page, FLASH_BANK_1);
 	 /* Wait for last operation to be completed */
 	FLASH_WaitForLastOperation((uint32_t)FLASH_TIMEOUT_VALUE);
 
 	/* If the erase operation is completed, disable the PER Bit */
 	CLEAR_BIT(FLASH->CR, FLASH_CR_PER);
 	HAL_FLASH_Lock();
-}
 
+	/* Le cache de donnes peut contenir l'ancien contenu de la page */
+	if(READ_BIT(FLASH->ACR, FLASH_ACR_DCEN))
+	{
+		__HAL_FLASH_DATA_CACHE_DISABLE();
+		__HAL_FLASH_DATA_CACHE_RESET();
+		__HAL_FLASH_DATA_CACHE_ENABLE();
+	}
 
-static void FLASH_write_doubleword(uint32_t index, uint64_t data)
-{
-	assert(index < SIZE_SECTOR_IN_DOUBLEWORDS);
-	HAL_FLASH_Unlock();
-	HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, BASE_ADDRESS+8*index, (uint64_t)(data));
-	HAL_FLASH_Lock();
+	for(uint32_t i = 0; i < SIZE_SECTOR_IN_DOUBLEWORDS; i++)
+	{
+		if(!FLASH_read(PAGE_ADDRESS(page) + 8*i, &data) || data != ERASED_DOUBLEWORD)
+			return false;
+	}
+	return true;
 }
@@ -10,9 +10,19 @@
 #define BSP_STM32G4_FLASH_H_
 
 #include "stm32g4_sys.h"
+#include <stdbool.h>
+
+#define FLASH_MAX_TRANSACTION	16		//nombre maximal de cases écrites par BSP_FLASH_set_doublewords
+
+//Les cases sont numérotées de 0 à 255, mais le journal tient dans une page : prévoir au plus 95 cases non vides à la fois
+//(127 enregistrements par page, moins la réserve du compactage). Au-delà, le compactage se fait pendant les écritures,
+//et elles échouent (retour false) lorsque 127 cases sont occupées. Une case remise à 0xFFFFFFFFFFFFFFFF libère sa place.
 
 uint64_t BSP_FLASH_read_doubleword(uint32_t index);
-void BSP_FLASH_set_doubleword(uint32_t index, uint64_t data);
+bool BSP_FLASH_set_doubleword(uint32_t index, uint64_t data);
+bool BSP_FLASH_set_doublewords(const uint32_t * indexes, const uint64_t * data, uint32_t nb);
+void BSP_FLASH_process(void);
+bool BSP_FLASH_ecc_error_handler(void);
 void BSP_FLASH_dump(void);
 void FLASH_demo(void);
 
@@ -18,6 +18,56 @@
 
 /* Private variables ---------------------------------------------------------*/
 static I2C_HandleTypeDef  hi2c[I2C_NB];
+static DMA_HandleTypeDef  hdma_rx[I2C_NB];
+static DMA_HandleTypeDef  hdma_tx[I2C_NB];
+static bool dma_initialized[I2C_NB] = {false};
+static volatile callback_i2c_t async_callbacks[I2C_NB] = {NULL};
+
+/* Écritures groupées : file de transactions par bus, la dernière restant ouverte aux écritures contiguës */
+#define I2C_BATCH_RUNS			8		//transactions en file (puissance de 2)
+#define I2C_BATCH_RUN_SIZE		32		//octets max par transaction
+#define I2C_BATCH_RUNS_MASK		(I2C_BATCH_RUNS - 1)
+
+typedef struct
+{
+	uint8_t address;
+	uint8_t reg;
+	uint8_t count;
+	uint8_t data[I2C_BATCH_RUN_SIZE];
+}I2C_batch_run_t;
+
+typedef struct
+{
+	bool active;
+	I2C_batch_run_t runs[I2C_BATCH_RUNS];
+	volatile uint8_t head;				//runs[head] : transaction ouverte, pas encore lancée
+	volatile uint8_t tail;				//plus ancienne transaction fermée non terminée
+	volatile bool in_flight;			//runs[tail] est en cours de transfert par DMA
+	volatile HAL_StatusTypeDef status;	//première erreur depuis le dernier BSP_I2C_batch_flush()
+}I2C_batch_t;
+
+static I2C_batch_t batches[I2C_NB];
+
+/* Private constants ---------------------------------------------------------*/
+/* Canaux DMA2 réservés aux transferts asynchrones (le DMA1_Channel1 est utilisé par le module ADC) */
+static DMA_Channel_TypeDef * const dma_rx_channels[I2C_NB] = {DMA2_Channel1, DMA2_Channel3, DMA2_Channel5};
+static DMA_Channel_TypeDef * const dma_tx_channels[I2C_NB] = {DMA2_Channel2, DMA2_Channel4, DMA2_Channel6};
+static const IRQn_Type dma_rx_irqs[I2C_NB] = {DMA2_Channel1_IRQn, DMA2_Channel3_IRQn, DMA2_Channel5_IRQn};
+static const IRQn_Type dma_tx_irqs[I2C_NB] = {DMA2_Channel2_IRQn, DMA2_Channel4_IRQn, DMA2_Channel6_IRQn};
+static const uint32_t dma_rx_requests[I2C_NB] = {DMA_REQUEST_I2C1_RX, DMA_REQUEST_I2C2_RX, DMA_REQUEST_I2C3_RX};
+static const uint32_t dma_tx_requests[I2C_NB] = {DMA_REQUEST_I2C1_TX, DMA_REQUEST_I2C2_TX, DMA_REQUEST_I2C3_TX};
+static const IRQn_Type ev_irqs[I2C_NB] = {I2C1_EV_IRQn, I2C2_EV_IRQn, I2C3_EV_IRQn};
+static const IRQn_Type er_irqs[I2C_NB] = {I2C1_ER_IRQn, I2C2_ER_IRQn, I2C3_ER_IRQn};
+
+/* Private functions declarations --------------------------------------------*/
+static void I2C_DMA_init(I2C_id_e id);
+static void I2C_async_done(I2C_HandleTypeDef *hi2c_done, HAL_StatusTypeDef status);
+static void I2C_batch_kick(I2C_id_e id);
+static void I2C_batch_done(I2C_id_e id, HAL_StatusTypeDef status);
+static void I2C1_batch_done(HAL_StatusTypeDef status);
+static void I2C2_batch_done(HAL_StatusTypeDef status);
+static void I2C3_batch_done(HAL_StatusTypeDef status);
+static const callback_i2c_t batch_callbacks[I2C_NB] = {I2C1_batch_done, I2C2_batch_done, I2C3_batch_done};
 
 
 
@@ -376,6 +426,282 @@ bool BSP_I2C_IsDeviceConnected(I2C_TypeDef* I2Cx, uint8_t address)
 }
 
 
+/**
+ * @brief  Lance la lecture de plusieurs octets de l'esclave, sans attendre la fin du transfert (DMA)
+ * @param  *I2Cx: I2C utilisé
+ * @param  address: Adresse 7 bits de l'esclave, alignée à gauche, les bits 7:1 sont utilisés, le bit LSB n'est pas utilisé
+ * @param  reg: registre à lire
+ * @param  *data: tableau de destination, qui doit rester valide jusqu'à l'appel du callback
+ * @param  count: nombre d'octets à lire
+ * @param  cb: fonction appelée en interruption à la fin du transfert (peut être NULL)
+ * @return HAL_BUSY si un transfert est déjà en cours sur ce bus, HAL_OK si le transfert est lancé
+ * @note   Tant que le transfert n'est pas terminé, les fonctions bloquantes de ce module renvoient HAL_BUSY pour ce bus.
+ */
+HAL_StatusTypeDef BSP_I2C_ReadMulti_DMA(I2C_TypeDef* I2Cx, uint8_t address, uint8_t reg, uint8_t* data, uint16_t count, callback_i2c_t cb)
+{
+	HAL_StatusTypeDef ret;
+	uint32_t primask;
+	assert(I2Cx == I2C1 || I2Cx == I2C2 || I2Cx == I2C3);
+	I2C_id_e id = ((I2Cx == I2C1)?I2C1_NORMAL:((I2Cx == I2C2)?I2C2_NORMAL:I2C3_NORMAL));
+	if(!dma_initialized[id])
+		I2C_DMA_init(id);
+	primask = __get_PRIMASK();
+	__disable_irq();	//prise du bus sans qu'une IT (ou un callback qui enchaîne) ne s'intercale
+	if(async_callbacks[id] != NULL || HAL_I2C_GetState(&hi2c[id]) != HAL_I2C_STATE_READY)
+		ret = HAL_BUSY;
+	else
+	{
+		async_callbacks[id] = cb;
+		ret = HAL_I2C_Mem_Read_DMA(&hi2c[id],address,reg,I2C_MEMADD_SIZE_8BIT,data,count);
+		if(ret != HAL_OK)
+			async_callbacks[id] = NULL;
+	}
+	__set_PRIMASK(primask);
+	return ret;
+}
+
+
+/**
+ * @brief  Lance l'écriture de plusieurs octets à l'esclave, sans attendre la fin du transfert (DMA)
+ * @param  *I2Cx: I2C utilisé
+ * @param  address: Adresse 7 bits de l'esclave, alignée à gauche, les bits 7:1 sont utilisés, le bit LSB n'est pas utilisé
+ * @param  reg: registre où écrire
+ * @param  *data: tableau des données à écrire, qui doit rester valide jusqu'à l'appel du callback
+ * @param  count: nombre d'octets à écrire
+ * @param  cb: fonction appelée en interruption à la fin du transfert (peut être NULL)
+ * @return HAL_BUSY si un transfert est déjà en cours sur ce bus, HAL_OK si le transfert est lancé
+ */
+HAL_StatusTypeDef BSP_I2C_WriteMulti_DMA(I2C_TypeDef* I2Cx, uint8_t address, uint8_t reg, uint8_t* data, uint16_t count, callback_i2c_t cb)
+{
+	HAL_StatusTypeDef ret;
+	uint32_t primask;
+	assert(I2Cx == I2C1 || I2Cx == I2C2 || I2Cx == I2C3);
+	I2C_id_e id = ((I2Cx == I2C1)?I2C1_NORMAL:((I2Cx == I2C2)?I2C2_NORMAL:I2C3_NORMAL));
+	if(!dma_initialized[id])
+		I2C_DMA_init(id);
+	primask = __get_PRIMASK();
+	__disable_irq();	//prise du bus sans qu'une IT (ou un callback qui enchaîne) ne s'intercale
+	if(async_callbacks[id] != NULL || HAL_I2C_GetState(&hi2c[id]) != HAL_I2C_STATE_READY)
+		ret = HAL_BUSY;
+	else
+	{
+		async_callbacks[id] = cb;
+		ret = HAL_I2C_Mem_Write_DMA(&hi2c[id],address,reg,I2C_MEMADD_SIZE_8BIT,data,count);
+		if(ret != HAL_OK)
+			async_callbacks[id] = NULL;
+	}
+	__set_PRIMASK(primask);
+	return ret;
+}
+
+
+/**
+ * @brief  Lance la lecture de plusieurs octets de l'esclave sans registre, sans attendre la fin du transfert (DMA)
+ * @param  *I2Cx: I2C utilisé
+ * @param  address: Adresse 7 bits de l'esclave, alignée à gauche, les bits 7:1 sont utilisés, le bit LSB n'est pas utilisé
+ * @param  *data: tableau de destination, qui doit rester valide jusqu'à l'appel du callback
+ * @param  count: nombre d'octets à lire
+ * @param  cb: fonction appelée en interruption à la fin du transfert (peut être NULL)
+ * @return HAL_BUSY si un transfert est déjà en cours sur ce bus, HAL_OK si le transfert est lancé
+ */
+HAL_StatusTypeDef BSP_I2C_ReadMultiNoRegister_DMA(I2C_TypeDef* I2Cx, uint8_t address, uint8_t* data, uint16_t count, callback_i2c_t cb)
+{
+	HAL_StatusTypeDef ret;
+	uint32_t primask;
+	assert(I2Cx == I2C1 || I2Cx == I2C2 || I2Cx == I2C3);
+	I2C_id_e id = ((I2Cx == I2C1)?I2C1_NORMAL:((I2Cx == I2C2)?I2C2_NORMAL:I2C3_NORMAL));
+	if(!dma_initialized[id])
+		I2C_DMA_init(id);
+	primask = __get_PRIMASK();
+	__disable_irq();	//prise du bus sans qu'une IT (ou un callback qui enchaîne) ne s'intercale
+	if(async_callbacks[id] != NULL || HAL_I2C_GetState(&hi2c[id]) != HAL_I2C_STATE_READY)
+		ret = HAL_BUSY;
+	else
+	{
+		async_callbacks[id] = cb;
+		ret = HAL_I2C_Master_Receive_DMA(&hi2c[id],address,data,count);
+		if(ret != HAL_OK)
+			async_callbacks[id] = NULL;
+	}
+	__set_PRIMASK(primask);
+	return ret;
+}
+
+
+/**
+ * @brief  Lance l'écriture de plusieurs octets à l'esclave sans registre, sans attendre la fin du transfert (DMA)
+ * @param  *I2Cx: I2C utilisé
+ * @param  address: Adresse 7 bits de l'esclave, alignée à gauche, les bits 7:1 sont utilisés, le bit LSB n'est pas utilisé
+ * @param  *data: tableau des données à écrire, qui doit rester valide jusqu'à l'appel du callback
+ * @param  count: nombre d'octets à écrire
+ * @param  cb: fonction appelée en interruption à la fin du transfert (peut être NULL)
+ * @return HAL_BUSY si un transfert est déjà en cours sur ce bus, HAL_OK si le transfert est lancé
+ */
+HAL_StatusTypeDef BSP_I2C_WriteMultiNoRegister_DMA(I2C_TypeDef* I2Cx, uint8_t address, uint8_t* data, uint16_t count, callback_i2c_t cb)
+{
+	HAL_StatusTypeDef ret;
+	uint32_t primask;
+	assert(I2Cx == I2C1 || I2Cx == I2C2 || I2Cx == I2C3);
+	I2C_id_e id = ((I2Cx == I2C1)?I2C1_NORMAL:((I2Cx == I2C2)?I2C2_NORMAL:I2C3_NORMAL));
+	if(!dma_initialized[id])
+		I2C_DMA_init(id);
+	primask = __get_PRIMASK();
+	__disable_irq();	//prise du bus sans qu'une IT (ou un callback qui enchaîne) ne s'intercale
+	if(async_callbacks[id] != NULL || HAL_I2C_GetState(&hi2c[id]) != HAL_I2C_STATE_READY)
+		ret = HAL_BUSY;
+	else
+	{
+		async_callbacks[id] = cb;
+		ret = HAL_I2C_Master_Transmit_DMA(&hi2c[id],address,data,count);
+		if(ret != HAL_OK)
+			async_callbacks[id] = NULL;
+	}
+	__set_PRIMASK(primask);
+	return ret;
+}
+
+
+/**
+ * @brief  Indique si un transfert (bloquant ou asynchrone) est en cours sur le bus
+ * @param  *I2Cx: I2C utilisé
+ * @return true si le bus est occupé
+ */
+bool BSP_I2C_is_busy(I2C_TypeDef* I2Cx)
+{
+	assert(I2Cx == I2C1 || I2Cx == I2C2 || I2Cx == I2C3);
+	I2C_id_e id = ((I2Cx == I2C1)?I2C1_NORMAL:((I2Cx == I2C2)?I2C2_NORMAL:I2C3_NORMAL));
+	return HAL_I2C_GetState(&hi2c[id]) != HAL_I2C_STATE_READY;
+}
+
+
+/**
+ * @brief  Ouvre un groupe d'écritures sur le bus (write-combining)
+ * @note   Jusqu'à BSP_I2C_batch_end(), les écritures passées à BSP_I2C_batch_write() sur ce bus sont mises en file :
+ *            - une écriture au registre qui suit immédiatement la précédente (même esclave) la prolonge :
+ *              elles partent en une seule transaction avec auto-incrément du registre,
+ *            - les autres écritures forment de nouvelles transactions, envoyées par DMA dans l'ordre d'appel,
+ *              pendant que l'appelant prépare les suivantes.
+ *         Les erreurs sont remontées par BSP_I2C_batch_flush() / BSP_I2C_batch_end().
+ * @pre    L'esclave doit incrémenter son pointeur de registre lors d'une écriture multiple (VL53L0X, APDS9960, MPU6050...).
+ * @pre    Pendant un groupe, toute lecture sur ce bus doit être précédée de BSP_I2C_batch_flush() (l'ordre est garanti par l'appelant).
+ * @param  *I2Cx: I2C utilisé
+ */
+void BSP_I2C_batch_begin(I2C_TypeDef* I2Cx)
+{
+	assert(I2Cx == I2C1 || I2Cx == I2C2 || I2Cx == I2C3);
+	I2C_id_e id = ((I2Cx == I2C1)?I2C1_NORMAL:((I2Cx == I2C2)?I2C2_NORMAL:I2C3_NORMAL));
+	if(batches[id].active)
+		return;
+	if(!dma_initialized[id])
+		I2C_DMA_init(id);
+	batches[id].head = 0;
+	batches[id].tail = 0;
+	batches[id].in_flight = false;
+	batches[id].runs[0].count = 0;
+	batches[id].status = HAL_OK;
+	batches[id].active = true;
+}
+
+/**
+ * @brief  Écrit plusieurs octets à partir d'un registre, en passant par le groupe d'écritures s'il est ouvert
+ * @param  *I2Cx: I2C utilisé
+ * @param  address: Adresse 7 bits de l'esclave, alignée à gauche
+ * @param  reg: premier registre écrit
+ * @param  *data: données (copiées, le tableau peut être réutilisé dès le retour)
+ * @param  count: nombre d'octets
+ * @return Hors groupe : le résultat de BSP_I2C_WriteMulti(). Dans un groupe : HAL_OK (l'écriture est en file).
+ */
+HAL_StatusTypeDef BSP_I2C_batch_write(I2C_TypeDef* I2Cx, uint8_t address, uint8_t reg, const uint8_t* data, uint16_t count)
+{
+	assert(I2Cx == I2C1 || I2Cx == I2C2 || I2Cx == I2C3);
+	I2C_id_e id = ((I2Cx == I2C1)?I2C1_NORMAL:((I2Cx == I2C2)?I2C2_NORMAL:I2C3_NORMAL));
+	I2C_batch_t * b = &batches[id];
+	I2C_batch_run_t * run;
+
+	if(!b->active)
+		return BSP_I2C_WriteMulti(I2Cx, address, reg, (uint8_t *)data, count);
+
+	while(count)
+	{
+		run = &b->runs[b->head];
+		if(run->count != 0
+				&& (run->address != address
+					|| (uint16_t)run->reg + run->count != reg			//pas contiguë (ou au-delà du registre 0xFF)
+					|| run->count == I2C_BATCH_RUN_SIZE))
+		{
+			//fermeture de la transaction ouverte : elle part dès que le bus est libre
+			while(((b->head + 1) & I2C_BATCH_RUNS_MASK) == b->tail)
+				I2C_batch_kick(id);		//file pleine : on attend qu'une transaction se termine
+			b->head = (b->head + 1) & I2C_BATCH_RUNS_MASK;
+			I2C_batch_kick(id);
+			run = &b->runs[b->head];
+			run->count = 0;
+		}
+		if(run->count == 0)
+		{
+			run->address = address;
+			run->reg = reg;
+		}
+		run->data[run->count++] = *data++;
+		reg++;
+		count--;
+	}
+	return HAL_OK;
+}
+
+/**
+ * @brief  Envoie toutes les écritures en file et attend la fin de leur transfert
+ * @param  *I2Cx: I2C utilisé
+ * @return HAL_OK, ou la première erreur rencontrée depuis le précédent flush
+ * @note   Le groupe reste ouvert. Ne pas appeler depuis une IT de priorité supérieure ou égale à celle des IT DMA de l'I2C.
+ */
+HAL_StatusTypeDef BSP_I2C_batch_flush(I2C_TypeDef* I2Cx)
+{
+	assert(I2Cx == I2C1 || I2Cx == I2C2 || I2Cx == I2C3);
+	I2C_id_e id = ((I2Cx == I2C1)?I2C1_NORMAL:((I2Cx == I2C2)?I2C2_NORMAL:I2C3_NORMAL));
+	I2C_batch_t * b = &batches[id];
+	HAL_StatusTypeDef status;
+
+	if(!b->active)
+		return HAL_OK;
+	if(b->runs[b->head].count != 0)
+	{
+		while(((b->head + 1) & I2C_BATCH_RUNS_MASK) == b->tail)
+			I2C_batch_kick(id);
+		b->head = (b->head + 1) & I2C_BATCH_RUNS_MASK;
+		b->runs[b->head].count = 0;
+	}
+	while(b->tail != b->head || b->in_flight)
+		I2C_batch_kick(id);		//relance si le bus était occupé par un autre transfert asynchrone
+	status = b->status;
+	b->status = HAL_OK;
+	return status;
+}
+
+/**
+ * @brief  Envoie les écritures en file, attend leur fin, puis ferme le groupe (les écritures redeviennent directes)
+ * @return HAL_OK, ou la première erreur rencontrée depuis le précédent flush
+ */
+HAL_StatusTypeDef BSP_I2C_batch_end(I2C_TypeDef* I2Cx)
+{
+	assert(I2Cx == I2C1 || I2Cx == I2C2 || I2Cx == I2C3);
+	I2C_id_e id = ((I2Cx == I2C1)?I2C1_NORMAL:((I2Cx == I2C2)?I2C2_NORMAL:I2C3_NORMAL));
+	HAL_StatusTypeDef status = BSP_I2C_batch_flush(I2Cx);
+	batches[id].active = false;
+	return status;
+}
+
+/**
+ * @brief  Indique si un groupe d'écritures est ouvert sur ce bus
+ */
+bool BSP_I2C_batch_is_active(I2C_TypeDef* I2Cx)
+{
+	assert(I2Cx == I2C1 || I2Cx == I2C2 || I2Cx == I2C3);
+	I2C_id_e id = ((I2Cx == I2C1)?I2C1_NORMAL:((I2Cx == I2C2)?I2C2_NORMAL:I2C3_NORMAL));
+	return batches[id].active;
+}
+
+
 I2C_HandleTypeDef * BSP_I2C_get_handle(I2C_TypeDef* I2Cx)
 {
 	assert(I2Cx == I2C1 || I2Cx == I2C2 || I2Cx == I2C3);
@@ -383,4 +709,210 @@ I2C_HandleTypeDef * BSP_I2C_get_handle(I2C_TypeDef* I2Cx)
 	return &hi2c[id];
 }
 
+
+/**
+ * @brief Initialise les canaux DMA et les interruptions nécessaires aux transferts asynchrones de l'I2C
+ * @pre   BSP_I2C_Init() a été appelée pour cet I2C
+ */
+static void I2C_DMA_init(I2C_id_e id)
+{
+	__HAL_RCC_DMAMUX1_CLK_ENABLE();
+	__HAL_RCC_DMA2_CLK_ENABLE();
+
+	hdma_rx[id].Instance = dma_rx_channels[id];
+	hdma_rx[id].Init.Request = dma_rx_requests[id];
+	hdma_rx[id].Init.Direction = DMA_PERIPH_TO_MEMORY;
+	hdma_rx[id].Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_rx[id].Init.MemInc = DMA_MINC_ENABLE;
+	hdma_rx[id].Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_rx[id].Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_rx[id].Init.Mode = DMA_NORMAL;
+	hdma_rx[id].Init.Priority = DMA_PRIORITY_HIGH;
+	if (HAL_DMA_Init(&hdma_rx[id]) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&hi2c[id], hdmarx, hdma_rx[id]);
+
+	hdma_tx[id].Instance = dma_tx_channels[id];
+	hdma_tx[id].Init.Request = dma_tx_requests[id];
+	hdma_tx[id].Init.Direction = DMA_MEMORY_TO_PERIPH;
+	hdma_tx[id].Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_tx[id].Init.MemInc = DMA_MINC_ENABLE;
+	hdma_tx[id].Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_tx[id].Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_tx[id].Init.Mode = DMA_NORMAL;
+	hdma_tx[id].Init.Priority = DMA_PRIORITY_MEDIUM;
+	if (HAL_DMA_Init(&hdma_tx[id]) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&hi2c[id], hdmatx, hdma_tx[id]);
+
+	/* Le HAL a besoin des IT évènement/erreur de l'I2C pour enchaîner la phase registre et la phase DMA */
+	HAL_NVIC_SetPriority(dma_rx_irqs[id], 1, 0);
+	HAL_NVIC_EnableIRQ(dma_rx_irqs[id]);
+	HAL_NVIC_SetPriority(dma_tx_irqs[id], 1, 0);
+	HAL_NVIC_EnableIRQ(dma_tx_irqs[id]);
+	HAL_NVIC_SetPriority(ev_irqs[id], 1, 0);
+	HAL_NVIC_EnableIRQ(ev_irqs[id]);
+	HAL_NVIC_SetPriority(er_irqs[id], 1, 0);
+	HAL_NVIC_EnableIRQ(er_irqs[id]);
+
+	dma_initialized[id] = true;
+}
+
+
+/**
+ * @brief Lance la plus ancienne transaction fermée du groupe d'écritures, si aucune n'est en cours
+ * @note  Appelée par l'application (file pleine, flush) et par l'IT de fin de transfert : sélection IT masquées
+ */
+static void I2C_batch_kick(I2C_id_e id)
+{
+	I2C_batch_t * b = &batches[id];
+	I2C_batch_run_t * run;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if(!b->in_flight && b->tail != b->head)
+	{
+		run = &b->runs[b->tail];
+		b->in_flight = true;
+		if(async_callbacks[id] != NULL || HAL_I2C_GetState(&hi2c[id]) != HAL_I2C_STATE_READY)
+			b->in_flight = false;		//bus occupé : sera relancée au prochain appel
+		else
+		{
+			async_callbacks[id] = batch_callbacks[id];
+			if(HAL_I2C_Mem_Write_DMA(&hi2c[id], run->address, run->reg, I2C_MEMADD_SIZE_8BIT, run->data, run->count) != HAL_OK)
+			{
+				async_callbacks[id] = NULL;
+				b->in_flight = false;
+			}
+		}
+	}
+	__set_PRIMASK(primask);
+}
+
+static void I2C_batch_done(I2C_id_e id, HAL_StatusTypeDef status)
+{
+	I2C_batch_t * b = &batches[id];
+	if(status != HAL_OK && b->status == HAL_OK)
+		b->status = status;
+	b->tail = (b->tail + 1) & I2C_BATCH_RUNS_MASK;
+	b->in_flight = false;
+	I2C_batch_kick(id);
+}
+
+static void I2C1_batch_done(HAL_StatusTypeDef status)
+{
+	I2C_batch_done(I2C1_NORMAL, status);
+}
+
+static void I2C2_batch_done(HAL_StatusTypeDef status)
+{
+	I2C_batch_done(I2C2_NORMAL, status);
+}
+
+static void I2C3_batch_done(HAL_StatusTypeDef status)
+{
+	I2C_batch_done(I2C3_NORMAL, status);
+}
+
+/**
+ * @brief Libère le bus et appelle le callback de l'utilisateur à la fin d'un transfert asynchrone
+ */
+static void I2C_async_done(I2C_HandleTypeDef *hi2c_done, HAL_StatusTypeDef status)
+{
+	callback_i2c_t cb;
+	I2C_id_e id = ((hi2c_done->Instance == I2C1)?I2C1_NORMAL:((hi2c_done->Instance == I2C2)?I2C2_NORMAL:I2C3_NORMAL));
+	cb = async_callbacks[id];
+	async_callbacks[id] = NULL;	//le bus est libéré avant l'appel : le callback peut enchaîner un nouveau transfert
+	if(cb)
+		cb(status);
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c_done)
+{
+	I2C_async_done(hi2c_done, HAL_OK);
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c_done)
+{
+	I2C_async_done(hi2c_done, HAL_OK);
+}
+
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c_done)
+{
+	I2C_async_done(hi2c_done, HAL_OK);
+}
+
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c_done)
+{
+	I2C_async_done(hi2c_done, HAL_OK);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c_done)
+{
+	I2C_async_done(hi2c_done, HAL_ERROR);
+}
+
+void I2C1_EV_IRQHandler(void)
+{
+	HAL_I2C_EV_IRQHandler(&hi2c[I2C1_NORMAL]);
+}
+
+void I2C1_ER_IRQHandler(void)
+{
+	HAL_I2C_ER_IRQHandler(&hi2c[I2C1_NORMAL]);
+}
+
+void I2C2_EV_IRQHandler(void)
+{
+	HAL_I2C_EV_IRQHandler(&hi2c[I2C2_NORMAL]);
+}
+
+void I2C2_ER_IRQHandler(void)
+{
+	HAL_I2C_ER_IRQHandler(&hi2c[I2C2_NORMAL]);
+}
+
+void I2C3_EV_IRQHandler(void)
+{
+	HAL_I2C_EV_IRQHandler(&hi2c[I2C3_NORMAL]);
+}
+
+void I2C3_ER_IRQHandler(void)
+{
+	HAL_I2C_ER_IRQHandler(&hi2c[I2C3_NORMAL]);
+}
+
+void DMA2_Channel1_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_rx[I2C1_NORMAL]);
+}
+
+void DMA2_Channel2_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_tx[I2C1_NORMAL]);
+}
+
+void DMA2_Channel3_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_rx[I2C2_NORMAL]);
+}
+
+void DMA2_Channel4_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_tx[I2C2_NORMAL]);
+}
+
+void DMA2_Channel5_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_rx[I2C3_NORMAL]);
+}
+
+void DMA2_Channel6_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_tx[I2C3_NORMAL]);
+}
+
 #endif
@@ -33,6 +33,14 @@ typedef enum{
 	SUPERFAST_MODE 	// Speed frequency: 1000KHz
 }I2C_speed_mode_e;
 
+/* Public types --------------------------------------------------------------*/
+/**
+ * @brief Type pointeur sur fonction de callback appelée (en interruption) à la fin d'un transfert asynchrone
+ *
+ * @param status : HAL_OK si le transfert s'est bien déroulé, HAL_ERROR sinon
+ */
+typedef void(*callback_i2c_t)(HAL_StatusTypeDef status);
+
 
 /* Public functions declarations ---------------------------------------------*/
 HAL_StatusTypeDef BSP_I2C_Init(I2C_TypeDef* I2Cx, I2C_speed_mode_e speed_mode, bool analog_filter);
@@ -53,6 +61,26 @@ HAL_StatusTypeDef BSP_I2C_WriteNoRegister(I2C_TypeDef* I2Cx, uint8_t address, ui
 
 HAL_StatusTypeDef BSP_I2C_WriteMultiNoRegister(I2C_TypeDef* I2Cx, uint8_t address, uint8_t* data, uint16_t count);
 
+HAL_StatusTypeDef BSP_I2C_ReadMulti_DMA(I2C_TypeDef* I2Cx, uint8_t address, uint8_t reg, uint8_t* data, uint16_t count, callback_i2c_t cb);
+
+HAL_StatusTypeDef BSP_I2C_WriteMulti_DMA(I2C_TypeDef* I2Cx, uint8_t address, uint8_t reg, uint8_t* data, uint16_t count, callback_i2c_t cb);
+
+HAL_StatusTypeDef BSP_I2C_ReadMultiNoRegister_DMA(I2C_TypeDef* I2Cx, uint8_t address, uint8_t* data, uint16_t count, callback_i2c_t cb);
+
+HAL_StatusTypeDef BSP_I2C_WriteMultiNoRegister_DMA(I2C_TypeDef* I2Cx, uint8_t address, uint8_t* data, uint16_t count, callback_i2c_t cb);
+
+bool BSP_I2C_is_busy(I2C_TypeDef* I2Cx);
+
+void BSP_I2C_batch_begin(I2C_TypeDef* I2Cx);
+
+HAL_StatusTypeDef BSP_I2C_batch_write(I2C_TypeDef* I2Cx, uint8_t address, uint8_t reg, const uint8_t* data, uint16_t count);
+
+HAL_StatusTypeDef BSP_I2C_batch_flush(I2C_TypeDef* I2Cx);
+
+HAL_StatusTypeDef BSP_I2C_batch_end(I2C_TypeDef* I2Cx);
+
+bool BSP_I2C_batch_is_active(I2C_TypeDef* I2Cx);
+
 bool BSP_I2C_IsDeviceConnected(I2C_TypeDef* I2Cx, uint8_t address);
 
 I2C_HandleTypeDef * BSP_I2C_get_handle(I2C_TypeDef* I2Cx);
@@ -0,0 +1,207 @@
+/**
+ *******************************************************************************
+ * @file	stm32g4_log.c
+ * @author	DEEP Project
+ * @date	Oct 17, 2026
+ * @brief	Journal binaire différé : remplace printf dans les chemins critiques
+ *******************************************************************************
+ * Un appel de LOG range dans le buffer circulaire un message de 2 + n mots :
+ *	- en-tête : nombre d'arguments (bits 24-31) | perte (bit 23) | identifiant + 1 (bits 0-22). Jamais nul : il est
+ *	  écrit en dernier et valide le message. Le bit de perte marque le premier message écrit après des messages perdus,
+ *	- date (HAL_GetTick, en ms),
+ *	- les n arguments, bruts.
+ * La place est réservée sans section critique (LDREX/STREX sur l'indice d'écriture) : LOG est utilisable dans
+ * les interruptions, et un message interrompu par un autre n'est pas mélangé avec lui. Buffer plein : le message
+ * est perdu et compté.
+ *
+ * BSP_LOG_process vide le buffer dans l'ordre, jusqu'au premier message réservé mais pas encore validé,
+ * en trames MIDI System Exclusive (identifiant 0x7D, usage non commercial), dont tous les octets sont < 0x80 :
+ *	F0 7D | message | message | ... | F7
+ *	message : identifiant + 1 | écart de date (ms) avec le message précédent | arguments
+ * Chaque champ est un entier de longueur variable, 6 bits par octet en commençant par les poids faibles,
+ * le bit 6 indiquant qu'un octet suit. Les arguments sont codés en zigzag (0, -1, 1, -2... -> 0, 1, 2, 3...) :
+ * les petits entiers, signés ou non, tiennent en un ou deux octets. Leur nombre n'est pas transmis : le décodeur
+ * le déduit de la chaîne de format.
+ * Message d'identifiant 0 : nombre de messages perdus (sans date), placé avant le message qui a suivi la perte.
+ * Les trames peuvent donc partager une liaison MIDI (ou le terminal de printf) : les récepteurs MIDI les ignorent.
+ */
+#include "config.h"
+#if USE_LOG
+#include "stm32g4_log.h"
+#include "stm32g4_uart.h"
+#include <string.h>
+
+#ifndef LOG_UART_ID
+	#define LOG_UART_ID		UART2_ID	//sortie par défaut : l'UART de printf
+#endif
+
+#define LOG_SYSEX_START		0xF0
+#define LOG_SYSEX_ID		0x7D
+#define LOG_SYSEX_END		0xF7
+#define LOG_ID_MASK			0x007FFFFF
+#define LOG_LOSS_FLAG		0x00800000
+#define LOG_LOST_ID			0
+
+#if (LOG_RING_WORDS & (LOG_RING_WORDS - 1)) != 0
+	#error "LOG_RING_WORDS doit être une puissance de 2"
+#endif
+#if LOG_FRAME_MAX_SIZE < LOG_MESSAGE_MAX_SIZE + 3
+	#error "LOG_FRAME_MAX_SIZE : une trame doit pouvoir contenir le message le plus long"
+#endif
+
+static volatile uint32_t ring[LOG_RING_WORDS];
+static volatile uint32_t head = 0;		//indice de réservation (producteurs)
+static volatile uint32_t tail = 0;		//indice de lecture (BSP_LOG_process)
+static volatile uint32_t lost = 0;		//messages perdus, total
+static volatile uint32_t loss_pending = 0;	//message perdu depuis le dernier message écrit
+static uint32_t lost_sent = 0;			//messages perdus déjà signalés
+static uint32_t last_tick = 0;			//date de la trame précédente
+static log_output_t output = NULL;
+
+static void LOG_uart_output(const uint8_t * frame, uint32_t size);
+static uint32_t LOG_put_varint(uint8_t * frame, uint32_t value);
+
+/**
+ * @brief	Initialise le journal
+ * @param	out : fonction d'envoi des trames, NULL pour LOG_UART_ID (qui doit être initialisé)
+ */
+void BSP_LOG_init(log_output_t out)
+{
+	output = (out != NULL) ? out : LOG_uart_output;
+	last_tick = HAL_GetTick();
+}
+
+/**
+ * @brief	Ajoute un message au buffer. Appelée par la macro LOG, utilisable en interruption.
+ * @param	words : identifiant du message, puis ses arguments
+ * @param	nb_args : nombre d'arguments
+ */
+void BSP_LOG_write(const uint32_t * words, uint32_t nb_args)
+{
+	uint32_t index, lost_count, loss, size = 2 + nb_args;
+
+	//réservation de size mots, sans bloquer les interruptions
+	do
+	{
+		index = __LDREXW(&head);
+		if(index + size - tail > LOG_RING_WORDS)
+		{
+			__CLREX();
+			do
+			{
+				lost_count = __LDREXW(&lost) + 1;
+			}while(__STREXW(lost_count, &lost));
+			loss_pending = 1;
+			return;
+		}
+	}while(__STREXW(index + size, &head));
+	do
+	{
+		loss = __LDREXW(&loss_pending);
+	}while(__STREXW(0, &loss_pending));
+
+	ring[(index + 1) & (LOG_RING_WORDS - 1)] = HAL_GetTick();
+	for(uint32_t i = 0; i < nb_args; i++)
+		ring[(index + 2 + i) & (LOG_RING_WORDS - 1)] = words[1 + i];
+	__DMB();	//l'en-tête est visible après le contenu du message
+	ring[index & (LOG_RING_WORDS - 1)] = (nb_args << 24) | (loss ? LOG_LOSS_FLAG : 0) | ((words[0] + 1) & LOG_ID_MASK);
+}
+
+/**
+ * @brief	Envoie les messages validés, groupés en trames entières, tant qu'ils tiennent dans max_bytes.
+ * @param	max_bytes : nombre maximal d'octets à envoyer (au moins LOG_FRAME_MAX_SIZE pour assurer l'avancement)
+ * @return	le nombre d'octets envoyés
+ * @pre		A appeler en tâche de fond, pas en interruption (l'envoi peut être bloquant).
+ */
+uint32_t BSP_LOG_process(uint32_t max_bytes)
+{
+	uint8_t frame[LOG_FRAME_MAX_SIZE];
+	uint8_t message[LOG_MESSAGE_MAX_SIZE];
+	uint32_t sent = 0, size = 2, n;
+
+	if(output == NULL)
+		return 0;
+	frame[0] = LOG_SYSEX_START;
+	frame[1] = LOG_SYSEX_ID;
+	while(1)
+	{
+		uint32_t lost_now = lost;
+		uint32_t header = ring[tail & (LOG_RING_WORDS - 1)];
+		uint32_t nb_args = header >> 24;
+
+		n = 0;
+		if((header & LOG_LOSS_FLAG) && lost_now != lost_sent)
+		{
+			n += LOG_put_varint(&message[n], LOG_LOST_ID);
+			n += LOG_put_varint(&message[n], lost_now - lost_sent);
+		}
+		else if(header != 0)
+		{
+			__DMB();	//contenu lu après l'en-tête
+			n += LOG_put_varint(&message[n], header & LOG_ID_MASK);
+			n += LOG_put_varint(&message[n], ring[(tail + 1) & (LOG_RING_WORDS - 1)] - last_tick);
+			for(uint32_t i = 0; i < nb_args; i++)
+			{
+				int32_t arg = (int32_t)ring[(tail + 2 + i) & (LOG_RING_WORDS - 1)];
+				n += LOG_put_varint(&message[n], ((uint32_t)arg << 1) ^ (uint32_t)(arg >> 31));	//zigzag
+			}
+		}
+
+		if(n != 0 && size + n + 1 <= LOG_FRAME_MAX_SIZE && sent + size + n + 1 <= max_bytes)
+		{
+			memcpy(&frame[size], message, n);
+			size += n;
+			if((header & LOG_LOSS_FLAG) && lost_now != lost_sent)
+				lost_sent = lost_now;
+			else
+			{
+				last_tick = ring[(tail + 1) & (LOG_RING_WORDS - 1)];
+				for(uint32_t i = 0; i < 2 + nb_args; i++)
+					ring[(tail + i) & (LOG_RING_WORDS - 1)] = 0;	//chaque mot peut devenir un en-tête
+				__DMB();	//place libérée après sa remise à zéro
+				tail += 2 + nb_args;
+			}
+			continue;
+		}
+		if(size == 2)
+			break;		//buffer vide, prochain message en cours d'écriture, ou budget épuisé
+		frame[size++] = LOG_SYSEX_END;
+		output(frame, size);
+		sent += size;
+		size = 2;
+		if(n == 0)
+			break;
+	}
+	return sent;
+}
+
+/**
+ * @brief	Nombre de messages perdus (buffer plein) depuis le démarrage
+ */
+uint32_t BSP_LOG_get_lost(void)
+{
+	return lost;
+}
+
+static void LOG_uart_output(const uint8_t * frame, uint32_t size)
+{
+	BSP_UART_puts(LOG_UART_ID, frame, (uint16_t)size);
+}
+
+/*
+ * @brief	Entier de longueur variable : 6 bits par octet, poids faibles en premier, bit 6 = un octet suit
+ * @return	nombre d'octets écrits (1 à 6)
+ */
+static uint32_t LOG_put_varint(uint8_t * frame, uint32_t value)
+{
+	uint32_t n = 0;
+	while(value >= 0x40)
+	{
+		frame[n++] = 0x40 | (value & 0x3F);
+		value >>= 6;
+	}
+	frame[n++] = (uint8_t)value;
+	return n;
+}
+
+#endif /* USE_LOG */
@@ -0,0 +1,102 @@
+/**
+ *******************************************************************************
+ * @file	stm32g4_log.h
+ * @author	DEEP Project
+ * @date	Oct 17, 2026
+ * @brief	Journal binaire différé : remplace printf dans les chemins critiques
+ *******************************************************************************
+ * Usage, comme printf (au plus LOG_MAX_ARGS arguments de 32 bits au plus) :
+ *	LOG("[MIDI] Note ON  - Position (%d,%d) '%c' -> MIDI:%d\r\n", row, col, key_char, midi_note);
+ *
+ * La chaîne de format n'est pas dans la flash : elle est rangée dans la section .log_strings de l'ELF,
+ * non chargée, et l'appel ne copie que son identifiant et ses arguments dans un buffer circulaire.
+ * BSP_LOG_process, en tâche de fond, envoie les messages en trames binaires, que tools/log_decoder.py
+ * remet en texte à l'aide de l'ELF.
+ * Un argument %s n'est affiché que s'il désigne une chaîne constante (en flash, lue dans l'ELF).
+ *
+ * Avec USE_LOG à 0 (config.h), LOG est un simple printf.
+ */
+#ifndef BSP_STM32G4_LOG_H_
+#define BSP_STM32G4_LOG_H_
+
+#include "config.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#ifndef USE_LOG
+	#define USE_LOG		0
+#endif
+
+#if USE_LOG
+
+/* Taille du buffer circulaire en mots de 32 bits (puissance de 2). Un message occupe 2 mots + 1 par argument. */
+#ifndef LOG_RING_WORDS
+	#define LOG_RING_WORDS		256
+#endif
+
+/* Taille maximale d'une trame (octets) : plusieurs messages y sont regroupés */
+#ifndef LOG_FRAME_MAX_SIZE
+	#define LOG_FRAME_MAX_SIZE		64
+#endif
+
+#define LOG_MAX_ARGS			8
+#define LOG_MESSAGE_MAX_SIZE	(6*(2 + LOG_MAX_ARGS))		//message le plus long, codé (octets)
+
+/* Sortie des trames : la trame complète est passée en une fois, elle ne doit pas être entrecoupée d'autres octets */
+typedef void (*log_output_t)(const uint8_t * frame, uint32_t size);
+
+void BSP_LOG_init(log_output_t output);
+
+uint32_t BSP_LOG_process(uint32_t max_bytes);
+
+uint32_t BSP_LOG_get_lost(void);
+
+void BSP_LOG_write(const uint32_t * words, uint32_t nb_args);
+
+/* Conversion d'un argument en mot de 32 bits : flottants par leur représentation en float, pointeurs par leur adresse */
+static inline uint32_t LOG_word(uint32_t x)				{ return x; }
+static inline uint32_t LOG_pointer(const void * p)		{ return (uint32_t)(uintptr_t)p; }
+static inline uint32_t LOG_float(float f)				{ union { float f; uint32_t w; } u = { .f = f }; return u.w; }
+static inline uint32_t LOG_double(double d)				{ return LOG_float((float)d); }
+
+#define LOG_ARG(x)	_Generic((x),				\
+		float: LOG_float,						\
+		double: LOG_double,						\
+		char *: LOG_pointer,					\
+		const char *: LOG_pointer,				\
+		void *: LOG_pointer,					\
+		const void *: LOG_pointer,				\
+		default: LOG_word)(x)
+
+#define LOG_NB_ARGS(...)			LOG_NB_ARGS_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_NB_ARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, n, ...)	n
+#define LOG_CAT(a, b)				LOG_CAT_(a, b)
+#define LOG_CAT_(a, b)				a##b
+#define LOG_ARGS_0()
+#define LOG_ARGS_1(a)				LOG_ARG(a)
+#define LOG_ARGS_2(a, ...)			LOG_ARG(a), LOG_ARGS_1(__VA_ARGS__)
+#define LOG_ARGS_3(a, ...)			LOG_ARG(a), LOG_ARGS_2(__VA_ARGS__)
+#define LOG_ARGS_4(a, ...)			LOG_ARG(a), LOG_ARGS_3(__VA_ARGS__)
+#define LOG_ARGS_5(a, ...)			LOG_ARG(a), LOG_ARGS_4(__VA_ARGS__)
+#define LOG_ARGS_6(a, ...)			LOG_ARG(a), LOG_ARGS_5(__VA_ARGS__)
+#define LOG_ARGS_7(a, ...)			LOG_ARG(a), LOG_ARGS_6(__VA_ARGS__)
+#define LOG_ARGS_8(a, ...)			LOG_ARG(a), LOG_ARGS_7(__VA_ARGS__)
+
+/* L'identifiant du message est l'adresse de sa chaîne de format dans la section .log_strings (placée en 0) */
+#define LOG(format, ...)																		\
+	do																							\
+	{																							\
+		__attribute__((section(".log_strings"), used)) static const char log_format[] = format;	\
+		BSP_LOG_write((const uint32_t[]){ (uint32_t)(uintptr_t)log_format,						\
+				LOG_CAT(LOG_ARGS_, LOG_NB_ARGS(__VA_ARGS__))(__VA_ARGS__) },						\
+				LOG_NB_ARGS(__VA_ARGS__));														\
+	}while(0)
+
+#else
+
+#define LOG(format, ...)			printf(format, ##__VA_ARGS__)
+
+#endif /* USE_LOG */
+
+#endif /* BSP_STM32G4_LOG_H_ */
@@ -42,6 +42,22 @@ void SPI_Cmd(SPI_TypeDef* SPIx, FunctionalState NewState);
 
 
 static SPI_HandleTypeDef  hSPI[SPI_NB];
+static DMA_HandleTypeDef  hdma_spi_rx[SPI_NB];
+static DMA_HandleTypeDef  hdma_spi_tx[SPI_NB];
+static bool dma_initialized[SPI_NB] = {false};
+static volatile callback_spi_t async_callbacks[SPI_NB] = {NULL};
+
+/* Canaux DMA1 réservés aux transferts asynchrones de SPI1 et SPI2 (DMA1_Channel1/2 : ADC et DAC, DMA2 : I2C) */
+static DMA_Channel_TypeDef * const dma_rx_channels[SPI_NB] = {DMA1_Channel3, DMA1_Channel5, NULL};
+static DMA_Channel_TypeDef * const dma_tx_channels[SPI_NB] = {DMA1_Channel4, DMA1_Channel6, NULL};
+static const IRQn_Type dma_rx_irqs[SPI_NB] = {DMA1_Channel3_IRQn, DMA1_Channel5_IRQn, 0};
+static const IRQn_Type dma_tx_irqs[SPI_NB] = {DMA1_Channel4_IRQn, DMA1_Channel6_IRQn, 0};
+static const uint32_t dma_rx_requests[SPI_NB] = {DMA_REQUEST_SPI1_RX, DMA_REQUEST_SPI2_RX, 0};
+static const uint32_t dma_tx_requests[SPI_NB] = {DMA_REQUEST_SPI1_TX, DMA_REQUEST_SPI2_TX, 0};
+static const IRQn_Type spi_irqs[SPI_NB] = {SPI1_IRQn, SPI2_IRQn, 0};
+
+static void SPI_DMA_init(SPI_ID_e id);
+static void SPI_async_done(SPI_HandleTypeDef *hspi_done, HAL_StatusTypeDef status);
 
 
 /**
@@ -361,6 +377,176 @@ void BSP_SPI_WriteReadBuffer(SPI_TypeDef* SPIx, const uint8_t *DataIn, uint8_t *
 }
 
 
+/**
+ * @brief  Lance l'envoi de plusieurs octets sur l'un des bus SPI, sans attendre la fin du transfert (DMA)
+ * @param  SPIx: SPI1 ou SPI2 (pas de canal DMA réservé pour SPI3)
+ * @param  *data: données à envoyer, qui doivent rester valides jusqu'à l'appel du callback
+ * @param  count: nombre d'octets à envoyer
+ * @param  cb: fonction appelée en interruption à la fin du transfert (peut être NULL)
+ * @return HAL_BUSY si un transfert est déjà en cours sur ce bus, HAL_OK si le transfert est lancé
+ * @note   Le chip select reste à la charge de l'appelant (NSS logiciel) : il peut être relâché dans le callback.
+ */
+HAL_StatusTypeDef BSP_SPI_WriteMultiNoRegister_DMA(SPI_TypeDef* SPIx, const uint8_t* data, uint16_t count, callback_spi_t cb)
+{
+	HAL_StatusTypeDef ret;
+	assert(SPIx == SPI1 || SPIx == SPI2 || SPIx == SPI3);
+	SPI_ID_e id = ((SPIx == SPI1)?SPI1_ID:(SPIx == SPI2)?SPI2_ID:SPI3_ID);
+	if(dma_tx_channels[id] == NULL)
+		return HAL_ERROR;
+	if(!dma_initialized[id])
+		SPI_DMA_init(id);
+	if(async_callbacks[id] != NULL || HAL_SPI_GetState(&hSPI[id]) != HAL_SPI_STATE_READY)
+		return HAL_BUSY;
+	async_callbacks[id] = cb;
+	ret = HAL_SPI_Transmit_DMA(&hSPI[id], (uint8_t*)data, count);
+	if(ret != HAL_OK)
+		async_callbacks[id] = NULL;
+	return ret;
+}
+
+/**
+ * @brief  Lance un échange full-duplex de plusieurs octets sur l'un des bus SPI, sans attendre la fin du transfert (DMA)
+ * @param  SPIx: SPI1 ou SPI2 (pas de canal DMA réservé pour SPI3)
+ * @param  *DataIn: octets à émettre
+ * @param  *DataOut: octets reçus (peut être le même tableau que DataIn)
+ * @param  DataLength: nombre d'octets échangés
+ * @param  cb: fonction appelée en interruption à la fin du transfert (peut être NULL)
+ * @return HAL_BUSY si un transfert est déjà en cours sur ce bus, HAL_OK si le transfert est lancé
+ * @note   Les deux tableaux doivent rester valides jusqu'à l'appel du callback.
+ */
+HAL_StatusTypeDef BSP_SPI_WriteReadBuffer_DMA(SPI_TypeDef* SPIx, const uint8_t *DataIn, uint8_t *DataOut, uint16_t DataLength, callback_spi_t cb)
+{
+	HAL_StatusTypeDef ret;
+	assert(SPIx == SPI1 || SPIx == SPI2 || SPIx == SPI3);
+	SPI_ID_e id = ((SPIx == SPI1)?SPI1_ID:(SPIx == SPI2)?SPI2_ID:SPI3_ID);
+	if(dma_rx_channels[id] == NULL)
+		return HAL_ERROR;
+	if(!dma_initialized[id])
+		SPI_DMA_init(id);
+	if(async_callbacks[id] != NULL || HAL_SPI_GetState(&hSPI[id]) != HAL_SPI_STATE_READY)
+		return HAL_BUSY;
+	async_callbacks[id] = cb;
+	ret = HAL_SPI_TransmitReceive_DMA(&hSPI[id], (uint8_t*)DataIn, DataOut, DataLength);
+	if(ret != HAL_OK)
+		async_callbacks[id] = NULL;
+	return ret;
+}
+
+/**
+ * @brief  Indique si un transfert asynchrone est en cours sur l'un des bus SPI
+ */
+bool BSP_SPI_is_busy(SPI_TypeDef* SPIx)
+{
+	assert(SPIx == SPI1 || SPIx == SPI2 || SPIx == SPI3);
+	SPI_ID_e id = ((SPIx == SPI1)?SPI1_ID:(SPIx == SPI2)?SPI2_ID:SPI3_ID);
+	return async_callbacks[id] != NULL || HAL_SPI_GetState(&hSPI[id]) != HAL_SPI_STATE_READY;
+}
+
+/**
+ * @brief Initialise les canaux DMA (réception et émission) d'un bus SPI, au premier transfert asynchrone
+ */
+static void SPI_DMA_init(SPI_ID_e id)
+{
+	__HAL_RCC_DMAMUX1_CLK_ENABLE();
+	__HAL_RCC_DMA1_CLK_ENABLE();
+
+	hdma_spi_rx[id].Instance = dma_rx_channels[id];
+	hdma_spi_rx[id].Init.Request = dma_rx_requests[id];
+	hdma_spi_rx[id].Init.Direction = DMA_PERIPH_TO_MEMORY;
+	hdma_spi_rx[id].Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_spi_rx[id].Init.MemInc = DMA_MINC_ENABLE;
+	hdma_spi_rx[id].Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_spi_rx[id].Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_spi_rx[id].Init.Mode = DMA_NORMAL;
+	hdma_spi_rx[id].Init.Priority = DMA_PRIORITY_HIGH;
+	if (HAL_DMA_Init(&hdma_spi_rx[id]) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&hSPI[id], hdmarx, hdma_spi_rx[id]);
+
+	hdma_spi_tx[id].Instance = dma_tx_channels[id];
+	hdma_spi_tx[id].Init.Request = dma_tx_requests[id];
+	hdma_spi_tx[id].Init.Direction = DMA_MEMORY_TO_PERIPH;
+	hdma_spi_tx[id].Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_spi_tx[id].Init.MemInc = DMA_MINC_ENABLE;
+	hdma_spi_tx[id].Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_spi_tx[id].Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_spi_tx[id].Init.Mode = DMA_NORMAL;
+	hdma_spi_tx[id].Init.Priority = DMA_PRIORITY_MEDIUM;
+	if (HAL_DMA_Init(&hdma_spi_tx[id]) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&hSPI[id], hdmatx, hdma_spi_tx[id]);
+
+	/* L'IT du SPI est nécessaire au HAL pour signaler les erreurs (overrun, mode fault) pendant un transfert DMA */
+	HAL_NVIC_SetPriority(dma_rx_irqs[id], 1, 0);
+	HAL_NVIC_EnableIRQ(dma_rx_irqs[id]);
+	HAL_NVIC_SetPriority(dma_tx_irqs[id], 1, 0);
+	HAL_NVIC_EnableIRQ(dma_tx_irqs[id]);
+	HAL_NVIC_SetPriority(spi_irqs[id], 1, 0);
+	HAL_NVIC_EnableIRQ(spi_irqs[id]);
+
+	dma_initialized[id] = true;
+}
+
+static void SPI_async_done(SPI_HandleTypeDef *hspi_done, HAL_StatusTypeDef status)
+{
+	callback_spi_t cb;
+	SPI_ID_e id = ((hspi_done->Instance == SPI1)?SPI1_ID:(hspi_done->Instance == SPI2)?SPI2_ID:SPI3_ID);
+	cb = async_callbacks[id];
+	async_callbacks[id] = NULL;	//le bus est libéré avant l'appel : le callback peut enchaîner un nouveau transfert
+	if(cb)
+		cb(status);
+}
+
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi_done)
+{
+	SPI_async_done(hspi_done, HAL_OK);
+}
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi_done)
+{
+	SPI_async_done(hspi_done, HAL_OK);
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi_done)
+{
+	SPI_async_done(hspi_done, HAL_ERROR);
+}
+
+void SPI1_IRQHandler(void)
+{
+	HAL_SPI_IRQHandler(&hSPI[SPI1_ID]);
+}
+
+void SPI2_IRQHandler(void)
+{
+	HAL_SPI_IRQHandler(&hSPI[SPI2_ID]);
+}
+
+void DMA1_Channel3_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_spi_rx[SPI1_ID]);
+}
+
+void DMA1_Channel4_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_spi_tx[SPI1_ID]);
+}
+
+void DMA1_Channel5_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_spi_rx[SPI2_ID]);
+}
+
+void DMA1_Channel6_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_spi_tx[SPI2_ID]);
+}
+
+
 /*
  * @brief Cette fonction sert à régler la taille d'une donnée
  * @param SPIx le SPI dont on veut régler la taille des donnée.
@@ -12,6 +12,8 @@
 #define BSP_STM32G4_SPI_H_
 
 #include "stm32g431xx.h"
+#include "stm32g4xx_hal_def.h"
+#include <stdbool.h>
 
 
 /* Public enumerations declarations ------------------------------------------*/
@@ -32,6 +34,9 @@ typedef enum {
 	TM_SPI_DataSize_16b /*!< SPI in 16-bits mode */
 } TM_SPI_DataSize_t;
 
+/* Fonction appelée en interruption à la fin d'un transfert asynchrone (DMA) */
+typedef void(*callback_spi_t)(HAL_StatusTypeDef status);
+
 /* Public functions declarations ---------------------------------------------*/
 void BSP_SPI_Init(SPI_TypeDef* SPIx, SPI_Mode_e SPI_Mode, SPI_Rank_e SPI_Rank, uint16_t SPI_BAUDRATEPRESCALER_x);
 
@@ -47,6 +52,12 @@ uint8_t BSP_SPI_WriteRead(SPI_TypeDef* SPIx, uint8_t Value);
 
 void BSP_SPI_WriteReadBuffer(SPI_TypeDef* SPIx, const uint8_t *DataIn, uint8_t *DataOut, uint16_t DataLength);
 
+HAL_StatusTypeDef BSP_SPI_WriteMultiNoRegister_DMA(SPI_TypeDef* SPIx, const uint8_t* data, uint16_t count, callback_spi_t cb);
+
+HAL_StatusTypeDef BSP_SPI_WriteReadBuffer_DMA(SPI_TypeDef* SPIx, const uint8_t *DataIn, uint8_t *DataOut, uint16_t DataLength, callback_spi_t cb);
+
+bool BSP_SPI_is_busy(SPI_TypeDef* SPIx);
+
 void BSP_SPI_setBaudRate(SPI_TypeDef* SPIx, uint16_t SPI_BaudRatePrescaler);
 
 uint32_t BSP_SPI_getBaudrate(SPI_TypeDef* SPIx);
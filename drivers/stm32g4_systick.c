@@ -20,6 +20,8 @@
 /* Tableau de pointeurs sur fonctions qui doivent être appelées périodiquement (1ms) par l'IT systick. */
 static callback_fun_t callback_functions[MAX_CALLBACK_FUNCTION_NB];
 static bool initialized = false;
+/* Base de temps de BSP_systick_get_time_us, si elle n'est pas le systick (ex : base disciplinée par le PPS du GPS) */
+static time_source_t time_source = NULL;
 
 
 /* Public functions definitions ----------------------------------------------*/
@@ -86,10 +88,18 @@ bool BSP_systick_remove_callback_function(callback_fun_t func)
 	return false;
 }
 
+/**
+ * @brief Current time in us, modulo 2^32: timestamps of the sensor drivers
+ *
+ * @return the time of the source given to BSP_systick_set_time_source, or the time since startup
+ */
 uint32_t BSP_systick_get_time_us(void)
 {
 	uint32_t t_us;
 	static uint32_t previous_t_us = 0;
+	time_source_t source = time_source;
+	if(source)
+		return source();
 	__disable_irq();
 	t_us = HAL_GetTick() * 1000 + 1000 - SysTick->VAL / SYSTEM_CLOCK_MHZ;
 	__enable_irq();
@@ -103,6 +113,18 @@ uint32_t BSP_systick_get_time_us(void)
 }
 
 
+/**
+ * @brief Replace the time base of BSP_systick_get_time_us
+ *
+ * @param source function returning the time in us (modulo 2^32, callable under interrupt), NULL for the systick
+ * @note The timestamps jump when the source changes: set it at startup, before the sensors are started
+ */
+void BSP_systick_set_time_source(time_source_t source)
+{
+	time_source = source;
+}
+
+
 /**
  * @brief Interrupt function called every 1ms
  *
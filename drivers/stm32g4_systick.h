@@ -16,6 +16,9 @@
 /* Public define -------------------------------------------------------------*/
 #define SYSTEM_CLOCK_MHZ 170
 
+/* Public types --------------------------------------------------------------*/
+typedef uint32_t (*time_source_t)(void);
+
 /* Public functions declarations ---------------------------------------------*/
 void BSP_systick_init(void);
 
@@ -25,4 +28,6 @@ bool BSP_systick_remove_callback_function(callback_fun_t func);
 
 uint32_t BSP_systick_get_time_us(void);
 
+void BSP_systick_set_time_source(time_source_t source);
+
 #endif /* BSP_STM32G4_SYSTICK_H_ */
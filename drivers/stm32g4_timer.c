@@ -34,9 +34,12 @@ static TIM_HandleTypeDef structure_handles[TIMER_ID_NB]; //Ce tableau contient l
 /* Private constants ---------------------------------------------------------*/
 static const TIM_TypeDef * instance_array[TIMER_ID_NB] = {TIM1, TIM2, TIM3, TIM4, TIM6};
 static const IRQn_Type nvic_irq_array[TIMER_ID_NB] = {TIM1_UP_TIM16_IRQn, TIM2_IRQn, TIM3_IRQn, TIM4_IRQn, TIM6_DAC_IRQn};
+static timer_capture_callback_t capture_callbacks[TIMER_ID_NB] = {NULL};	//Fonctions appelées à chaque capture (cf BSP_TIMER_enable_input_capture)
 
 
 /* Private functions declarations --------------------------------------------*/
+static void TIMER_pin_config(timer_id_t timer_id, uint16_t TIM_CHANNEL_x, bool remap, bool negative_channel);
+static void TIMER_capture_it(timer_id_t timer_id);
 
 
 /* Private functions definitions ---------------------------------------------*/
@@ -67,6 +70,91 @@ void clear_it_status(timer_id_t timer_id){
 	}
 }
 
+/**
+ * @brief	Configure la broche d'un canal du timer en fonction alternative (cf BSP_TIMER_enable_PWM pour la liste des broches)
+ */
+static void TIMER_pin_config(timer_id_t timer_id, uint16_t TIM_CHANNEL_x, bool remap, bool negative_channel)
+{
+    switch(timer_id)
+    {
+    case TIMER1_ID:
+    	if(negative_channel)
+    	{
+    		switch(TIM_CHANNEL_x)
+    		{
+    			case TIM_CHANNEL_1: BSP_GPIO_pin_config(GPIOA, 				(remap)?GPIO_PIN_11:GPIO_PIN_7, 	GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF6_TIM1); break;
+    			case TIM_CHANNEL_2: BSP_GPIO_pin_config((remap)?GPIOB:GPIOA,(remap)?GPIO_PIN_0:GPIO_PIN_12, 	GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF6_TIM1); break;
+    			case TIM_CHANNEL_3: BSP_GPIO_pin_config(GPIOF, 				GPIO_PIN_0, 						GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF6_TIM1); break;
+    			default: break;
+    		}
+    	}
+    	else
+    	{
+    		switch(TIM_CHANNEL_x)
+    		{
+    			case TIM_CHANNEL_1: BSP_GPIO_pin_config(GPIOA, 				GPIO_PIN_8, 					GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF6_TIM1); break;
+    			case TIM_CHANNEL_2: BSP_GPIO_pin_config(GPIOA, 				GPIO_PIN_9, 					GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF6_TIM1); break;
+    			case TIM_CHANNEL_3: BSP_GPIO_pin_config(GPIOA, 				GPIO_PIN_10, 					GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF6_TIM1); break;
+    			case TIM_CHANNEL_4: BSP_GPIO_pin_config(GPIOA, 				GPIO_PIN_11, 					GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF11_TIM1); break;
+    			default: break;
+    		}
+    	}
+    	break;
+    case TIMER2_ID:
+    	switch(TIM_CHANNEL_x)
+    	{
+    		case TIM_CHANNEL_1: BSP_GPIO_pin_config(GPIOA, 				(remap)?GPIO_PIN_5:GPIO_PIN_0,	GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF1_TIM2); break;
+    		case TIM_CHANNEL_2: BSP_GPIO_pin_config((remap)?GPIOB:GPIOA,(remap)?GPIO_PIN_3:GPIO_PIN_1,	GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF1_TIM2); break;
+    		case TIM_CHANNEL_3: BSP_GPIO_pin_config(GPIOA, 				(remap)?GPIO_PIN_9:GPIO_PIN_2, 	GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, (remap)?GPIO_AF10_TIM2:GPIO_AF1_TIM2); break;
+    		case TIM_CHANNEL_4: BSP_GPIO_pin_config(GPIOA, 				(remap)?GPIO_PIN_10:GPIO_PIN_3,	GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, (remap)?GPIO_AF10_TIM2:GPIO_AF1_TIM2); break;
+    		default: break;
+    	}
+    	break;
+    case TIMER3_ID:
+    	switch(TIM_CHANNEL_x)
+    	{
+    		case TIM_CHANNEL_1: BSP_GPIO_pin_config((remap)?GPIOB:GPIOA,(remap)?GPIO_PIN_4:GPIO_PIN_6, 	GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF2_TIM3); break;
+    		case TIM_CHANNEL_2: BSP_GPIO_pin_config(GPIOA, 				(remap)?GPIO_PIN_7:GPIO_PIN_4, 	GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF2_TIM3); break;
+    		case TIM_CHANNEL_3: BSP_GPIO_pin_config(GPIOB, 				GPIO_PIN_0, 					GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF2_TIM3); break;
+    		case TIM_CHANNEL_4: BSP_GPIO_pin_config(GPIOB, 				GPIO_PIN_7, 					GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF2_TIM3); break;
+    		default: break;
+    	}
+    	break;
+    case TIMER4_ID:
+    	switch(TIM_CHANNEL_x)
+    	{
+    	    case TIM_CHANNEL_1: BSP_GPIO_pin_config((remap)?GPIOB:GPIOA,(remap)?GPIO_PIN_6:GPIO_PIN_11, GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, (remap)?GPIO_AF2_TIM4:GPIO_AF10_TIM4); break;
+    	    case TIM_CHANNEL_2: BSP_GPIO_pin_config((remap)?GPIOB:GPIOA,(remap)?GPIO_PIN_7:GPIO_PIN_12, GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, (remap)?GPIO_AF2_TIM4:GPIO_AF10_TIM4); break;
+    	    case TIM_CHANNEL_3: BSP_GPIO_pin_config((remap)?GPIOB:GPIOA,(remap)?GPIO_PIN_8:GPIO_PIN_13, GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, (remap)?GPIO_AF2_TIM4:GPIO_AF10_TIM4); break;
+    	    default: break;
+    	}
+    	break;
+    default:
+		break;
+    }
+}
+
+/**
+ * @brief	Acquitte les IT de capture levées sur le timer et transmet les valeurs capturées à la fonction de l'utilisateur
+ */
+static void TIMER_capture_it(timer_id_t timer_id)
+{
+	static const uint32_t flags[4] = {TIM_FLAG_CC1, TIM_FLAG_CC2, TIM_FLAG_CC3, TIM_FLAG_CC4};
+	static const uint32_t its[4] = {TIM_IT_CC1, TIM_IT_CC2, TIM_IT_CC3, TIM_IT_CC4};
+	static const uint16_t channels[4] = {TIM_CHANNEL_1, TIM_CHANNEL_2, TIM_CHANNEL_3, TIM_CHANNEL_4};
+	uint8_t i;
+
+	for(i = 0; i < 4; i++)
+	{
+		if(__HAL_TIM_GET_FLAG(&structure_handles[timer_id], flags[i]) != RESET && __HAL_TIM_GET_IT_SOURCE(&structure_handles[timer_id], its[i]) != RESET)
+		{
+			__HAL_TIM_CLEAR_IT(&structure_handles[timer_id], its[i]);
+			if(capture_callbacks[timer_id] != NULL)
+				capture_callbacks[timer_id](channels[i], HAL_TIM_ReadCapturedValue(&structure_handles[timer_id], channels[i]));
+		}
+	}
+}
+
 /* Public functions definitions ----------------------------------------------*/
 
 /**
@@ -106,21 +194,7 @@ void BSP_TIMER_run_us(timer_id_t timer_id, uint32_t us, bool enable_irq)
 	structure_handles[timer_id].Instance = (TIM_TypeDef*)instance_array[timer_id]; //On donne le timer en instance à notre gestionnaire (Handle)
 
 	//On détermine la fréquence des évènements comptés par le timer.
-	uint32_t freq;
-	if(timer_id == TIMER1_ID)
-	{
-		//Fréquence du TIMER1 est PCLK2 lorsque APB2 Prescaler vaut 1, sinon : PCLK2*2
-		freq = HAL_RCC_GetPCLK2Freq();
-		if((RCC->CFGR & RCC_CFGR_PPRE2) >> 11 != RCC_HCLK_DIV1)
-			freq *= 2;
-	}
-	else
-	{
-		//Fréquence des TIMERS 2,3,4 est PCLK1 lorsque APB1 Prescaler vaut 1, sinon : PCLK1*2
-		freq = HAL_RCC_GetPCLK1Freq();
-		if((RCC->CFGR & RCC_CFGR_PPRE1) >> 8 != RCC_HCLK_DIV1)
-			freq *= 2;
-	}
+	uint32_t freq = BSP_TIMER_get_clock_frequency(timer_id);
 
 	uint64_t nb_psec_per_event = (uint64_t)(1000000000000/freq);
 	uint64_t period = (((uint64_t)(us))*1000000)/nb_psec_per_event;
@@ -172,6 +246,29 @@ void BSP_TIMER_run_us(timer_id_t timer_id, uint32_t us, bool enable_irq)
 	__HAL_TIM_ENABLE(&structure_handles[timer_id]);
 }
 
+/**
+ * @brief Fréquence de l'horloge du timer (avant le prescaler), en Hz
+ */
+uint32_t BSP_TIMER_get_clock_frequency(timer_id_t timer_id)
+{
+	uint32_t freq;
+	if(timer_id == TIMER1_ID)
+	{
+		//Fréquence du TIMER1 est PCLK2 lorsque APB2 Prescaler vaut 1, sinon : PCLK2*2
+		freq = HAL_RCC_GetPCLK2Freq();
+		if((RCC->CFGR & RCC_CFGR_PPRE2) >> 11 != RCC_HCLK_DIV1)
+			freq *= 2;
+	}
+	else
+	{
+		//Fréquence des TIMERS 2,3,4 est PCLK1 lorsque APB1 Prescaler vaut 1, sinon : PCLK1*2
+		freq = HAL_RCC_GetPCLK1Freq();
+		if((RCC->CFGR & RCC_CFGR_PPRE1) >> 8 != RCC_HCLK_DIV1)
+			freq *= 2;
+	}
+	return freq;
+}
+
 /**
  * @brief Arrêt du timer sélectionné.
  *
@@ -291,63 +388,7 @@ TIM_HandleTypeDef * BSP_TIMER_get_handler(timer_id_t timer_id)
  */
 void BSP_TIMER_enable_PWM(timer_id_t timer_id, uint16_t TIM_CHANNEL_x, uint16_t duty, bool remap, bool negative_channel)
 {
-    switch(timer_id)
-    {
-    case TIMER1_ID:
-    	if(negative_channel)
-    	{
-    		switch(TIM_CHANNEL_x)
-    		{
-    			case TIM_CHANNEL_1: BSP_GPIO_pin_config(GPIOA, 				(remap)?GPIO_PIN_11:GPIO_PIN_7, 	GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF6_TIM1); break;
-    			case TIM_CHANNEL_2: BSP_GPIO_pin_config((remap)?GPIOB:GPIOA,(remap)?GPIO_PIN_0:GPIO_PIN_12, 	GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF6_TIM1); break;
-    			case TIM_CHANNEL_3: BSP_GPIO_pin_config(GPIOF, 				GPIO_PIN_0, 						GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF6_TIM1); break;
-    			default: break;
-    		}
-    	}
-    	else
-    	{
-    		switch(TIM_CHANNEL_x)
-    		{
-    			case TIM_CHANNEL_1: BSP_GPIO_pin_config(GPIOA, 				GPIO_PIN_8, 					GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF6_TIM1); break;
-    			case TIM_CHANNEL_2: BSP_GPIO_pin_config(GPIOA, 				GPIO_PIN_9, 					GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF6_TIM1); break;
-    			case TIM_CHANNEL_3: BSP_GPIO_pin_config(GPIOA, 				GPIO_PIN_10, 					GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF6_TIM1); break;
-    			case TIM_CHANNEL_4: BSP_GPIO_pin_config(GPIOA, 				GPIO_PIN_11, 					GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF11_TIM1); break;
-    			default: break;
-    		}
-    	}
-    	break;
-    case TIMER2_ID:
-    	switch(TIM_CHANNEL_x)
-    	{
-    		case TIM_CHANNEL_1: BSP_GPIO_pin_config(GPIOA, 				(remap)?GPIO_PIN_5:GPIO_PIN_0,	GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF1_TIM2); break;
-    		case TIM_CHANNEL_2: BSP_GPIO_pin_config((remap)?GPIOB:GPIOA,(remap)?GPIO_PIN_3:GPIO_PIN_1,	GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF1_TIM2); break;
-    		case TIM_CHANNEL_3: BSP_GPIO_pin_config(GPIOA, 				(remap)?GPIO_PIN_9:GPIO_PIN_2, 	GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, (remap)?GPIO_AF10_TIM2:GPIO_AF1_TIM2); break;
-    		case TIM_CHANNEL_4: BSP_GPIO_pin_config(GPIOA, 				(remap)?GPIO_PIN_10:GPIO_PIN_3,	GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, (remap)?GPIO_AF10_TIM2:GPIO_AF1_TIM2); break;
-    		default: break;
-    	}
-    	break;
-    case TIMER3_ID:
-    	switch(TIM_CHANNEL_x)
-    	{
-    		case TIM_CHANNEL_1: BSP_GPIO_pin_config((remap)?GPIOB:GPIOA,(remap)?GPIO_PIN_4:GPIO_PIN_6, 	GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF2_TIM3); break;
-    		case TIM_CHANNEL_2: BSP_GPIO_pin_config(GPIOA, 				(remap)?GPIO_PIN_7:GPIO_PIN_4, 	GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF2_TIM3); break;
-    		case TIM_CHANNEL_3: BSP_GPIO_pin_config(GPIOB, 				GPIO_PIN_0, 					GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF2_TIM3); break;
-    		case TIM_CHANNEL_4: BSP_GPIO_pin_config(GPIOB, 				GPIO_PIN_7, 					GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, GPIO_AF2_TIM3); break;
-    		default: break;
-    	}
-    	break;
-    case TIMER4_ID:
-    	switch(TIM_CHANNEL_x)
-    	{
-    	    case TIM_CHANNEL_1: BSP_GPIO_pin_config((remap)?GPIOB:GPIOA,(remap)?GPIO_PIN_6:GPIO_PIN_11, GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, (remap)?GPIO_AF2_TIM4:GPIO_AF10_TIM4); break;
-    	    case TIM_CHANNEL_2: BSP_GPIO_pin_config((remap)?GPIOB:GPIOA,(remap)?GPIO_PIN_7:GPIO_PIN_12, GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, (remap)?GPIO_AF2_TIM4:GPIO_AF10_TIM4); break;
-    	    case TIM_CHANNEL_3: BSP_GPIO_pin_config((remap)?GPIOB:GPIOA,(remap)?GPIO_PIN_8:GPIO_PIN_13, GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH, (remap)?GPIO_AF2_TIM4:GPIO_AF10_TIM4); break;
-    	    default: break;
-    	}
-    	break;
-    default:
-		break;
-    }
+    TIMER_pin_config(timer_id, TIM_CHANNEL_x, remap, negative_channel);
 
     TIM_OC_InitTypeDef TIM_OCInitStructure = {0};
 	TIM_OCInitStructure.OCMode = TIM_OCMODE_PWM1;
@@ -366,6 +407,39 @@ void BSP_TIMER_enable_PWM(timer_id_t timer_id, uint16_t TIM_CHANNEL_x, uint16_t
 	BSP_TIMER_set_duty(timer_id, TIM_CHANNEL_x, duty);
 }
 
+/**
+ * @brief Fonction de configuration d'une capture d'entrée
+ *
+ * A chaque front montant sur la broche du canal, la valeur du compteur est capturée par le timer, puis transmise à la fonction callback (sous interruption).
+ * @param timer_id id du timer : TIMER2_ID, TIMER3_ID ou TIMER4_ID (les captures du TIMER1 ont un vecteur d'interruption distinct, non géré)
+ * @param TIM_CHANNEL_x canal d'entrée (mêmes broches que pour BSP_TIMER_enable_PWM)
+ * @param remap permet de choisir la broche alternative
+ * @param callback fonction appelée à chaque capture, avec le canal et la valeur capturée
+ * @pre Le timer est initialisé (BSP_TIMER_run_us), sa période fixe la plage des valeurs capturées.
+ * @post Les captures et l'interruption du timer sont activées.
+ */
+void BSP_TIMER_enable_input_capture(timer_id_t timer_id, uint16_t TIM_CHANNEL_x, bool remap, timer_capture_callback_t callback)
+{
+	TIM_IC_InitTypeDef TIM_ICInitStructure = {0};
+
+	if(timer_id == TIMER1_ID || timer_id == TIMER6_ID)
+		return;
+
+	TIMER_pin_config(timer_id, TIM_CHANNEL_x, remap, false);
+	capture_callbacks[timer_id] = callback;
+
+	TIM_ICInitStructure.ICPolarity = TIM_INPUTCHANNELPOLARITY_RISING;
+	TIM_ICInitStructure.ICSelection = TIM_ICSELECTION_DIRECTTI;
+	TIM_ICInitStructure.ICPrescaler = TIM_ICPSC_DIV1;
+	TIM_ICInitStructure.ICFilter = 0x3;		//Le front doit être stable pendant 8 périodes de l'horloge du timer
+	HAL_TIM_IC_Init(&structure_handles[timer_id]);
+	HAL_TIM_IC_ConfigChannel(&structure_handles[timer_id], &TIM_ICInitStructure, TIM_CHANNEL_x);
+
+	HAL_NVIC_SetPriority(nvic_irq_array[timer_id] , 4,  1);
+	HAL_NVIC_EnableIRQ(nvic_irq_array[timer_id]);
+	HAL_TIM_IC_Start_IT(&structure_handles[timer_id], TIM_CHANNEL_x);
+}
+
 /**
  * @brief Fonction de configuration du rapport cyclique
  *
@@ -449,27 +523,30 @@ void TIM1_UP_TIM16_IRQHandler(void){
 }
 
 void TIM2_IRQHandler(void){
-	if(__HAL_TIM_GET_IT_SOURCE(&structure_handles[TIMER2_ID], TIM_IT_UPDATE) != RESET) 	//Si le flag est levé...
+	if(__HAL_TIM_GET_FLAG(&structure_handles[TIMER2_ID], TIM_FLAG_UPDATE) != RESET && __HAL_TIM_GET_IT_SOURCE(&structure_handles[TIMER2_ID], TIM_IT_UPDATE) != RESET) 	//Si le flag est levé...
 	{
 		__HAL_TIM_CLEAR_IT(&structure_handles[TIMER2_ID], TIM_IT_UPDATE);				//...On l'acquitte...
 		TIMER2_user_handler_it();									//...Et on appelle la fonction qui nous intéresse
 	}
+	TIMER_capture_it(TIMER2_ID);
 }
 
 void TIM3_IRQHandler(void){
-	if(__HAL_TIM_GET_IT_SOURCE(&structure_handles[TIMER3_ID], TIM_IT_UPDATE) != RESET) 	//Si le flag est levé...
+	if(__HAL_TIM_GET_FLAG(&structure_handles[TIMER3_ID], TIM_FLAG_UPDATE) != RESET && __HAL_TIM_GET_IT_SOURCE(&structure_handles[TIMER3_ID], TIM_IT_UPDATE) != RESET) 	//Si le flag est levé...
 	{
 		__HAL_TIM_CLEAR_IT(&structure_handles[TIMER3_ID], TIM_IT_UPDATE);				//...On l'acquitte...
 		TIMER3_user_handler_it();									//...Et on appelle la fonction qui nous intéresse
 	}
+	TIMER_capture_it(TIMER3_ID);
 }
 
 void TIM4_IRQHandler(void){
-	if(__HAL_TIM_GET_IT_SOURCE(&structure_handles[TIMER4_ID], TIM_IT_UPDATE) != RESET) 	//Si le flag est levé...
+	if(__HAL_TIM_GET_FLAG(&structure_handles[TIMER4_ID], TIM_FLAG_UPDATE) != RESET && __HAL_TIM_GET_IT_SOURCE(&structure_handles[TIMER4_ID], TIM_IT_UPDATE) != RESET) 	//Si le flag est levé...
 	{
 		__HAL_TIM_CLEAR_IT(&structure_handles[TIMER4_ID], TIM_IT_UPDATE);				//...On l'acquitte...
 		TIMER4_user_handler_it();									//...Et on appelle la fonction qui nous intéresse
 	}
+	TIMER_capture_it(TIMER4_ID);
 }
 
 void TIM6_DAC_IRQHandler(void)
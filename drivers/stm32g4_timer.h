@@ -19,6 +19,8 @@
 
 
 /* Public types --------------------------------------------------------------*/
+typedef void(*timer_capture_callback_t)(uint16_t TIM_CHANNEL_x, uint32_t capture);
+
 typedef enum
 {
 	TIMER1_ID = 0,
@@ -40,6 +42,8 @@ void BSP_TIMER_stop(timer_id_t id);
 
 TIM_HandleTypeDef * BSP_TIMER_get_handler(timer_id_t timer_id);
 
+uint32_t BSP_TIMER_get_clock_frequency(timer_id_t timer_id);
+
 uint32_t BSP_TIMER_read(timer_id_t timer_id);
 
 void BSP_TIMER_write(timer_id_t timer_id, uint32_t counter);
@@ -56,6 +60,8 @@ void BSP_TIMER_enable_output_trigger(timer_id_t timer_id);
 
 void BSP_TIMER_enable_PWM(timer_id_t timer_id, uint16_t TIM_CHANNEL_x, uint16_t duty, bool remap, bool negative_channel);
 
+void BSP_TIMER_enable_input_capture(timer_id_t timer_id, uint16_t TIM_CHANNEL_x, bool remap, timer_capture_callback_t callback);
+
 void BSP_TIMER_set_duty(timer_id_t timer_id, uint16_t TIM_CHANNEL_x, uint16_t duty);
 
 void BSP_TIMER_set_period_with_same_duty(timer_id_t timer_id, uint16_t TIM_CHANNEL_x, uint32_t period);
@@ -0,0 +1,284 @@
+#!/usr/bin/env python3
+"""
+Décodeur du journal binaire (drivers/stm32g4_log.c) : remet en texte les trames envoyées par BSP_LOG_process.
+
+Les chaînes de format ne sont pas transmises : elles sont lues dans la section .log_strings de l'ELF du programme,
+l'identifiant d'une trame étant l'adresse de sa chaîne (+ 1). L'ELF doit donc être celui du programme qui tourne.
+
+Trame (MIDI System Exclusive, octets < 0x80 entre F0 et F7) : F0 7D | message | message | ... | F7
+  message : identifiant + 1 | écart de date (ms) | arguments (zigzag), leur nombre étant celui du format
+  message d'identifiant 0 : 0 | nombre de messages perdus, avant le message qui a suivi la perte
+Champs : entiers de longueur variable, 6 bits par octet, poids faibles en premier, bit 6 = un octet suit.
+
+Le reste du flux est affiché tel quel (printf), sauf les messages MIDI, ignorés : la liaison peut être partagée.
+
+Usage :
+  log_decoder.py programme.elf --port /dev/ttyACM0 --baudrate 115200
+  log_decoder.py programme.elf capture.bin --stats
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+SYSEX_START = 0xF0
+SYSEX_END = 0xF7
+SYSEX_ID = 0x7D
+LOST_ID = 0
+SHT_PROGBITS = 1
+SHF_ALLOC = 0x2
+
+# nombre d'octets de données des messages MIDI de canal, selon le quartet de poids fort du statut
+MIDI_DATA_BYTES = {0x8: 2, 0x9: 2, 0xA: 2, 0xB: 2, 0xC: 1, 0xD: 1, 0xE: 2}
+
+CONVERSION = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(?:hh|h|ll|l|j|z|t|L)?([diouxXcsfFeEgGaAp%])")
+
+
+class Elf:
+    """Lecture minimale d'un ELF (32 ou 64 bits, petit-boutiste) : sections et leur contenu."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[5] != 1:
+            raise ValueError("%s : pas un ELF petit-boutiste" % path)
+        is64 = self.data[4] == 2
+        if is64:
+            shoff, = struct.unpack_from("<Q", self.data, 0x28)
+            shentsize, shnum, shstrndx = struct.unpack_from("<HHH", self.data, 0x3A)
+            fmt = "<IIQQQQIIQQ"
+        else:
+            shoff, = struct.unpack_from("<I", self.data, 0x20)
+            shentsize, shnum, shstrndx = struct.unpack_from("<HHH", self.data, 0x2E)
+            fmt = "<IIIIIIIIII"
+        headers = [struct.unpack_from(fmt, self.data, shoff + i * shentsize) for i in range(shnum)]
+        names = headers[shstrndx]
+        self.sections = {}
+        for name, sh_type, flags, addr, offset, size in (h[:6] for h in headers):
+            end = self.data.index(b"\0", names[4] + name)
+            section_name = self.data[names[4] + name:end].decode("ascii", "replace")
+            content = self.data[offset:offset + size] if sh_type != 8 else b""     # SHT_NOBITS : pas de contenu
+            self.sections[section_name] = (sh_type, flags, addr, content)
+
+    def section(self, name):
+        if name not in self.sections:
+            raise ValueError("section %s absente : programme compilé sans USE_LOG ?" % name)
+        return self.sections[name]
+
+    def read_string(self, address):
+        """Chaîne constante d'une section chargée (flash), None si l'adresse n'y est pas."""
+        for sh_type, flags, addr, content in self.sections.values():
+            if sh_type == SHT_PROGBITS and flags & SHF_ALLOC and addr <= address < addr + len(content):
+                start = address - addr
+                end = content.find(b"\0", start)
+                return content[start:end if end >= 0 else len(content)].decode("latin-1")
+        return None
+
+
+def read_varints(payload):
+    values, value, shift = [], 0, 0
+    for byte in payload:
+        value |= (byte & 0x3F) << shift
+        shift += 6
+        if not byte & 0x40:
+            values.append(value & 0xFFFFFFFF)
+            value, shift = 0, 0
+    return values
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+class Formatter:
+    def __init__(self, elf):
+        self.elf = elf
+        _, _, self.base, self.strings = elf.section(".log_strings")
+
+    def format_string(self, identifier):
+        offset = identifier - (self.base & 0x7FFFFF)
+        if not 0 <= offset < len(self.strings):
+            return None
+        end = self.strings.index(b"\0", offset)
+        return self.strings[offset:end].decode("utf-8", "replace")
+
+    @staticmethod
+    def nb_args(fmt):
+        """Nombre de mots d'arguments d'un message (les largeurs et précisions '*' en sont)."""
+        return sum((c != "%") + (w == "*") + (p == "*") for _, w, p, c in CONVERSION.findall(fmt))
+
+    def convert(self, conversion, word):
+        unsigned = word & 0xFFFFFFFF
+        if conversion in "di":
+            return unsigned - (1 << 32) if unsigned & 0x80000000 else unsigned
+        if conversion in "ouxXc":
+            return unsigned if conversion != "c" else chr(unsigned & 0xFF)
+        if conversion in "fFeEgGaA":
+            return struct.unpack("<f", struct.pack("<I", unsigned))[0]
+        if conversion == "s":
+            text = self.elf.read_string(unsigned)
+            return text if text is not None else "<0x%08x>" % unsigned
+        return "0x%08x" % unsigned      # %p
+
+    def format(self, fmt, args):
+        args = list(args)
+        out = []
+        position = 0
+        for match in CONVERSION.finditer(fmt):
+            out.append(fmt[position:match.start()])
+            position = match.end()
+            flags, width, precision, conversion = match.groups()
+            if conversion == "%":
+                out.append("%")
+                continue
+            if width == "*":
+                width = str(self.convert("d", args.pop(0))) if args else ""
+            if precision == "*":
+                precision = str(self.convert("d", args.pop(0))) if args else ""
+            if not args:
+                out.append("<?>")
+                continue
+            value = self.convert(conversion, args.pop(0))
+            spec = "%" + flags + (width or "") + ("." + precision if precision is not None else "")
+            if conversion in "aA":
+                conversion = "e"
+            if conversion in "csp":
+                spec += "s"
+            elif conversion == "u":
+                spec += "d"
+            else:
+                spec += conversion
+            out.append(spec % value)
+        out.append(fmt[position:])
+        return "".join(out)
+
+
+class Decoder:
+    """Découpe du flux : trames du journal, messages MIDI (ignorés) et texte."""
+
+    def __init__(self, formatter, show_time=True, out=sys.stdout):
+        self.formatter = formatter
+        self.show_time = show_time
+        self.out = out
+        self.time = 0
+        self.sysex = None
+        self.midi = bytearray()             # message MIDI en cours
+        self.text = bytearray()             # texte hors trames, affiché ligne par ligne
+        self.line_start = True
+        self.frames = self.messages = self.frame_bytes = self.text_equivalent = self.lost = 0
+
+    def feed(self, data):
+        for byte in data:
+            if self.sysex is not None:
+                if byte == SYSEX_END:
+                    self.frame(self.sysex)
+                    self.sysex = None
+                elif byte < 0x80:
+                    self.sysex.append(byte)
+                elif byte < 0xF8:
+                    self.sysex = None       # trame interrompue : abandonnée
+                    self.text.append(byte)
+            elif byte == SYSEX_START:
+                self.sysex = bytearray()
+            elif self.midi:
+                self.midi.append(byte)
+                if byte >= 0x80:
+                    self.text += self.midi  # pas un message MIDI : texte UTF-8 (printf)
+                    self.midi = bytearray()
+                elif len(self.midi) == 1 + MIDI_DATA_BYTES[self.midi[0] >> 4]:
+                    self.midi = bytearray()
+            elif 0x80 <= byte < 0xF0:
+                self.midi = bytearray([byte])
+            elif byte < 0x80:
+                self.text.append(byte)
+                if byte == 0x0A:
+                    self.flush_text()
+            # >= 0xF8 : messages MIDI temps réel, ignorés
+
+    def prefix(self):
+        return "[%10.3f] " % (self.time / 1000.0) if self.show_time else ""
+
+    def write(self, text):
+        for line in text.splitlines(True):
+            if self.line_start:
+                self.out.write(self.prefix())
+            self.out.write(line.replace("\r", ""))
+            self.line_start = line.endswith("\n")
+        self.out.flush()
+
+    def flush_text(self):
+        if self.text:
+            self.write(self.text.decode("utf-8", "replace"))
+            self.text = bytearray()
+
+    def frame(self, payload):
+        if not payload or payload[0] != SYSEX_ID:
+            return                          # autre System Exclusive
+        values = read_varints(payload[1:])
+        self.flush_text()
+        self.frames += 1
+        self.frame_bytes += len(payload) + 2
+        while len(values) >= 2:
+            identifier, value = values[0], values[1]
+            if identifier == LOST_ID:
+                self.lost += value
+                self.write("*** %d messages perdus (buffer plein) ***\n" % value)
+                values = values[2:]
+                continue
+            self.time = (self.time + value) & 0xFFFFFFFF
+            fmt = self.formatter.format_string(identifier - 1)
+            if fmt is None:
+                self.write("<message inconnu 0x%x : ELF d'un autre programme ?>\n" % (identifier - 1))
+                return                      # nombre d'arguments inconnu : fin de la trame illisible
+            nb_args = self.formatter.nb_args(fmt)
+            text = self.formatter.format(fmt, [unzigzag(v) & 0xFFFFFFFF for v in values[2:2 + nb_args]])
+            self.messages += 1
+            self.text_equivalent += len(text.encode("utf-8"))
+            self.write(text)
+            values = values[2 + nb_args:]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Décodage du journal binaire")
+    parser.add_argument("elf", help="ELF du programme qui s'exécute sur la carte")
+    parser.add_argument("capture", nargs="?", help="fichier capturé (sinon --port, ou l'entrée standard)")
+    parser.add_argument("--port", help="port série")
+    parser.add_argument("--baudrate", type=int, default=115200)
+    parser.add_argument("--no-time", action="store_true", help="sans la date des messages")
+    parser.add_argument("--stats", action="store_true", help="taille des trames et du texte équivalent")
+    args = parser.parse_args()
+
+    try:
+        decoder = Decoder(Formatter(Elf(args.elf)), show_time=not args.no_time)
+    except (OSError, ValueError) as e:
+        print("erreur : %s" % e, file=sys.stderr)
+        return 1
+    try:
+        if args.port:
+            import serial
+            link = serial.Serial(args.port, args.baudrate, timeout=0.1)
+            while True:
+                decoder.feed(link.read(4096))
+        else:
+            stream = open(args.capture, "rb") if args.capture else sys.stdin.buffer
+            with stream:
+                while True:
+                    data = stream.read(4096)
+                    if not data:
+                        break
+                    decoder.feed(data)
+    except KeyboardInterrupt:
+        pass
+    decoder.flush_text()
+    if args.stats and decoder.frames:
+        equivalent = decoder.text_equivalent
+        print("%d messages en %d trames, %d octets (%.1f par message) pour %d octets de texte : %.1f fois moins, "
+              "%d messages perdus" % (decoder.messages, decoder.frames, decoder.frame_bytes,
+                                       decoder.frame_bytes / max(decoder.messages, 1), equivalent,
+                                       equivalent / decoder.frame_bytes, decoder.lost), file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
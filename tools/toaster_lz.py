@@ -0,0 +1,252 @@
+#!/usr/bin/env python3
+"""
+Compression des morceaux pour le bootloader en flux (SID_TOASTER_CHUNK_LZ, voir core/Startup/bootloader.c).
+
+Chaque morceau de 256 octets est compressé séparément, à la manière de LZ4 : une suite de séquences
+jeton | littéraux | source de la copie (3 octets). La source d'une copie est :
+  - une adresse dans la flash (< 0x20000, relative à son début) : le dictionnaire est le contenu de la flash
+    au moment où le bootloader décompresse le morceau. Avec le programme installé (--base), une mise à jour
+    s'envoie comme une différence (delta) : le code déplacé par une petite modification est recopié depuis
+    son ancienne adresse.
+  - 0x800000 + distance : recopie des octets déjà décompressés du morceau (répétitions, fin de page en 0xFF).
+
+Le bootloader écrit les pages l'une après l'autre, une page n'étant écrite qu'une fois complète. Pendant la
+décompression d'une page, la flash contient donc :
+  - le nouveau contenu des pages déjà écrites et des pages reconnues identiques (CRC de page),
+  - l'ancien contenu des autres pages, dont la page en cours : il n'est connu que si le programme installé l'est.
+Les pages du bootloader et celles dont le contenu est inconnu ne servent pas de dictionnaire.
+
+Usage (estimation de la taille transférée) :
+  toaster_lz.py programme.bin
+  toaster_lz.py programme.bin --base ancien.bin
+"""
+
+import argparse
+import itertools
+import sys
+
+FLASH_TOTAL_SIZE = 0x20000
+FLASH_PAGE_SIZE = 0x800
+CHUNK_SIZE = 256
+BOOTLOADER_PAGES = (1, 2, 3)
+VIRTUAL_EEPROM_START = 0x1F000  # relative au début de la flash : pages 62 et 63 de l'EEPROM virtuelle, modifiées par le programme
+MAX_PROGRAM_SIZE = VIRTUAL_EEPROM_START
+LOCAL_COPY = 0x800000
+MIN_MATCH = 5           # une copie coûte au moins 4 octets (jeton et source)
+MAX_CANDIDATES = 32
+EMPTY_KEYS = (b"\xFF" * 4, b"\x00" * 4)     # trop fréquents : les répétitions locales les couvrent
+
+
+def match_length(a, ai, b, bi, limit):
+    n = 0
+    while n + 16 <= limit and a[ai + n:ai + n + 16] == b[bi + n:bi + n + 16]:
+        n += 16
+    while n < limit and a[ai + n] == b[bi + n]:
+        n += 1
+    return n
+
+
+def put_length(out, value):
+    while value >= 255:
+        out.append(255)
+        value -= 255
+    out.append(value)
+
+
+def encode_sequences(sequences):
+    """sequences : liste de (littéraux, source, longueur), source None pour la dernière séquence."""
+    out = bytearray()
+    for literals, source, length in sequences:
+        n = len(literals)
+        m = 0 if source is None else length - 4
+        out.append(min(n, 15) << 4 | min(m, 15))
+        if n >= 15:
+            put_length(out, n - 15)
+        out += literals
+        if source is not None:
+            out += source.to_bytes(3, "big")
+            if m >= 15:
+                put_length(out, m - 15)
+    return bytes(out)
+
+
+def decode_chunk(payload, flash):
+    """Décompression d'un morceau, comme STREAM_decode du bootloader. Renvoie None si les données sont invalides."""
+    out = bytearray()
+    i = 0
+    end = len(payload)
+    while i < end:
+        token = payload[i]
+        i += 1
+        n = token >> 4
+        if n == 15:
+            while True:
+                c = payload[i]
+                i += 1
+                n += c
+                if c != 255 or i >= end:
+                    break
+        if len(out) + n > CHUNK_SIZE or i + n > end:
+            return None
+        out += payload[i:i + n]
+        i += n
+        if i == end:
+            break
+        if i + 3 > end:
+            return None
+        source = int.from_bytes(payload[i:i + 3], "big")
+        i += 3
+        n = (token & 0x0F) + 4
+        if n == 19:
+            while i < end:
+                c = payload[i]
+                i += 1
+                n += c
+                if c != 255:
+                    break
+        if len(out) + n > CHUNK_SIZE:
+            return None
+        if source >= LOCAL_COPY:
+            distance = source - LOCAL_COPY
+            if distance == 0 or distance > len(out):
+                return None
+            for _ in range(n):
+                out.append(out[-distance])
+        elif source + n <= FLASH_TOTAL_SIZE:
+            out += flash[source:source + n]
+        else:
+            return None
+    return bytes(out) if len(out) == CHUNK_SIZE else None
+
+
+class FlashModel:
+    """Contenu de la flash vu par le bootloader, avec un index des séquences de 4 octets des pages connues."""
+
+    def __init__(self):
+        self.mem = bytearray(b"\xFF" * FLASH_TOTAL_SIZE)
+        self.known = set()
+        self.index = {}
+
+    def _keys(self, page):
+        start = page * FLASH_PAGE_SIZE
+        for p in range(start, start + FLASH_PAGE_SIZE - MIN_MATCH + 1):
+            key = bytes(self.mem[p:p + 4])
+            if key not in EMPTY_KEYS:
+                yield key, p
+
+    def set_page(self, page, data):
+        if page in self.known:
+            for key, p in self._keys(page):
+                self.index[key].discard(p)
+        data = bytes(data) + b"\xFF" * (FLASH_PAGE_SIZE - len(data))
+        self.mem[page * FLASH_PAGE_SIZE:(page + 1) * FLASH_PAGE_SIZE] = data
+        self.known.add(page)
+        for key, p in self._keys(page):
+            self.index.setdefault(key, set()).add(p)
+
+    def longest_match(self, target, pos):
+        best, source = 0, None
+        for p in itertools.islice(self.index.get(bytes(target[pos:pos + 4]), ()), MAX_CANDIDATES):
+            limit = min(len(target) - pos, (p // FLASH_PAGE_SIZE + 1) * FLASH_PAGE_SIZE - p)
+            n = match_length(target, pos, self.mem, p, limit)
+            if n > best:
+                best, source = n, p
+                if n == len(target) - pos:
+                    break
+        return best, source
+
+
+def encode_chunk(target, model):
+    """Compression gloutonne d'un morceau : à chaque position, la plus longue copie (flash ou morceau)."""
+    sequences = []
+    local = {}
+    pos = literal_start = 0
+    while pos < len(target):
+        best, source = 0, None
+        if pos + 4 <= len(target):
+            best, source = model.longest_match(target, pos)
+            for p in local.get(bytes(target[pos:pos + 4]), [])[-MAX_CANDIDATES:]:
+                # copie locale : les recouvrements répètent un motif, comme au décodage
+                n = match_length(target, pos, target, p, len(target) - pos)
+                if n > best:
+                    best, source = n, LOCAL_COPY + pos - p
+        if best >= MIN_MATCH:
+            sequences.append((bytes(target[literal_start:pos]), source, best))
+            for p in range(pos, min(pos + best, len(target) - 3)):
+                local.setdefault(bytes(target[p:p + 4]), []).append(p)
+            pos += best
+            literal_start = pos
+        else:
+            local.setdefault(bytes(target[pos:pos + 4]), []).append(pos)
+            pos += 1
+    if literal_start < len(target) or not sequences:
+        sequences.append((bytes(target[literal_start:]), None, 0))
+    return encode_sequences(sequences)
+
+
+class Encoder:
+    """
+    Compression des pages d'une image dans l'ordre de leur écriture.
+    changed : pages à envoyer (les autres pages de l'image sont identiques en flash), base : programme installé.
+    """
+
+    def __init__(self, image, changed, base=None):
+        self.image = bytes(image)
+        self.model = FlashModel()
+        nb_pages = (len(self.image) + FLASH_PAGE_SIZE - 1) // FLASH_PAGE_SIZE
+        if base:
+            for page in range((min(len(base), MAX_PROGRAM_SIZE) + FLASH_PAGE_SIZE - 1) // FLASH_PAGE_SIZE):
+                if page not in BOOTLOADER_PAGES:
+                    self.model.set_page(page, base[page * FLASH_PAGE_SIZE:(page + 1) * FLASH_PAGE_SIZE])
+        for page in range(nb_pages):
+            if page not in changed and page not in BOOTLOADER_PAGES:
+                self.commit(page)
+
+    def page(self, page):
+        return self.image[page * FLASH_PAGE_SIZE:(page + 1) * FLASH_PAGE_SIZE]
+
+    def encode(self, index):
+        """Données compressées du morceau index, ou None si la compression ne gagne rien."""
+        target = self.image[index * CHUNK_SIZE:(index + 1) * CHUNK_SIZE]
+        payload = encode_chunk(target, self.model)
+        assert decode_chunk(payload, self.model.mem) == target
+        return payload if len(payload) < CHUNK_SIZE else None
+
+    def commit(self, page):
+        """La page vient d'être écrite : son nouveau contenu sert de dictionnaire aux pages suivantes."""
+        self.model.set_page(page, self.page(page))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Taille des morceaux compressés d'un programme")
+    parser.add_argument("image", help="fichier binaire, à partir de 0x08000000")
+    parser.add_argument("--base", help="programme installé : compression en différence")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    image += b"\xFF" * (-len(image) % CHUNK_SIZE)
+    base = None
+    if args.base:
+        with open(args.base, "rb") as f:
+            base = f.read()
+    nb_pages = (len(image) + FLASH_PAGE_SIZE - 1) // FLASH_PAGE_SIZE
+    changed = [p for p in range(nb_pages) if p not in BOOTLOADER_PAGES]
+    if base:
+        changed = [p for p in changed if image[p * FLASH_PAGE_SIZE:(p + 1) * FLASH_PAGE_SIZE]
+                   != base[p * FLASH_PAGE_SIZE:(p + 1) * FLASH_PAGE_SIZE]]
+    encoder = Encoder(image, changed, base)
+    raw = compressed = 0
+    for page in [p for p in changed if p != 0] + [p for p in changed if p == 0]:
+        for index in range(page * FLASH_PAGE_SIZE // CHUNK_SIZE, min((page + 1) * FLASH_PAGE_SIZE, len(image)) // CHUNK_SIZE):
+            payload = encoder.encode(index)
+            raw += CHUNK_SIZE
+            compressed += len(payload) if payload else CHUNK_SIZE
+        encoder.commit(page)
+    print("%d pages à envoyer : %d octets, %d octets compressés (%.1f %%)"
+          % (len(changed), raw, compressed, 100.0 * compressed / raw if raw else 0))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
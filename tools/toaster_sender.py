@@ -0,0 +1,649 @@
+#!/usr/bin/env python3
+"""
+Emetteur de référence (TOASTER) pour le bootloader en flux de core/Startup/bootloader.c.
+
+Déroulement :
+  1. envoi de 0xB0 jusqu'à la demande de programme (SID 0x70), pendant le reset de la carte
+  2. annonce du programme (version, nombre de morceaux, taille), puis attente de READY
+  3. négociation de la vitesse (optionnelle) : demande à l'ancienne vitesse, confirmation à la nouvelle
+  4. envoi du CRC-32 de chaque page de 2 ko : le bootloader indique les pages qui ont changé. Les pages
+     identiques ne sont ni effacées, ni envoyées (mise à jour incrémentale).
+  5. envoi des morceaux de 256 octets des pages modifiées avec une fenêtre glissante : seuls les morceaux
+     non acquittés sont renvoyés. Le bootloader écrit une page lorsqu'elle est complète : les pages sont
+     envoyées l'une après l'autre, la page 0 (vecteur de reset) en dernier.
+     Les morceaux sont compressés (tools/toaster_lz.py), en différence avec le programme installé s'il est
+     connu (--base) : une petite modification ne transfère que quelques ko.
+  6. fin du transfert : le bootloader répond puis fait un reset
+
+Usage :
+  toaster_sender.py programme.bin --port /dev/ttyUSB0 --baudrate 2000000
+  toaster_sender.py programme.bin --port /dev/ttyUSB0 --base programme_installé.bin
+  toaster_sender.py programme.bin --simulate --loss 0.01      (cible simulée, avec une flash simulée)
+  toaster_sender.py programme.bin --simulate --base ancien.bin (mise à jour depuis ancien.bin)
+  toaster_sender.py programme.bin --simulate --legacy          (ancien bootloader : refus attendu)
+
+Migration des cartes déjà livrées : l'ancien bootloader (paquets de 16 ko, page 1 seulement) ne se remplace
+pas lui-même, et il effacerait la flash dès l'annonce du programme. Ce protocole est donc détecté à la
+connexion (taille de paquet annoncée) et refusé avant toute annonce. Ces cartes doivent être reprogrammées
+une fois par SWD (ST-LINK) avec un programme contenant le nouveau bootloader (pages 1 à 3). Ensuite les
+mises à jour passent par cet émetteur.
+
+Le mode simulé vérifie le protocole (fenêtre, retransmissions, contenu final de la flash) et estime
+la durée du transfert sur la cible, à partir des temps d'effacement et de programmation de la flash
+(programmation rapide par rangées de 32 doubles mots).
+"""
+
+import argparse
+import random
+import sys
+import time
+import zlib
+
+import toaster_lz
+
+SOH = 0x01
+EOT = 0x04
+SID_TOASTER_REQUEST_FOR_PROGRAM = 0x70
+SID_BOOTLOADER_PROGRAM_AVAILABLE = 0x71
+SID_TOASTER_SET_BAUDRATE = 0x75
+SID_BOOTLOADER_BAUDRATE = 0x76
+SID_TOASTER_CHUNK = 0x77
+SID_BOOTLOADER_CHUNK_ACK = 0x78
+SID_TOASTER_END = 0x79
+SID_BOOTLOADER_END = 0x7A
+SID_BOOTLOADER_READY = 0x7B
+SID_TOASTER_PAGE_CRC = 0x7C
+SID_BOOTLOADER_PAGE_CRC = 0x7D
+SID_TOASTER_CHUNK_LZ = 0x7E
+STREAM_FORMAT_LZ = 0x01
+
+BL_FLASH_ERROR_PGS = 2
+BL_FLASH_ERROR_PGA = 4
+BL_FLASH_ERROR_PROGRAM = 6
+BL_FLASH_ERROR_CRC = 8
+BL_FLASH_COMPLETE = 9
+FLASH_BASE = 0x08000000
+FLASH_PAGE_SIZE = 0x800
+BOOTLOADER_PAGES = (1, 2, 3)          # jamais écrasées par le bootloader
+VIRTUAL_EEPROM_START = 0x0801F000     # pages 62 et 63, modifiées par le programme
+MAX_PROGRAM_SIZE = VIRTUAL_EEPROM_START - FLASH_BASE
+DEFAULT_BAUDRATE = 460800           # BRR = 0x171 à 170 MHz
+UART_CLOCK = 170000000
+
+
+class ProtocolError(Exception):
+    pass
+
+
+def msg(sid, data=b""):
+    return bytes([SOH, sid, len(data)]) + bytes(data) + bytes([EOT])
+
+
+def chunk_frame(index, data):
+    body = index.to_bytes(2, "big") + data
+    return bytes([SOH, SID_TOASTER_CHUNK]) + body + zlib.crc32(body).to_bytes(4, "big") + bytes([EOT])
+
+
+def chunk_lz_frame(index, data, payload):
+    body = index.to_bytes(2, "big") + len(payload).to_bytes(2, "big") + zlib.crc32(data).to_bytes(4, "big") + payload
+    return bytes([SOH, SID_TOASTER_CHUNK_LZ]) + body + zlib.crc32(body).to_bytes(4, "big") + bytes([EOT])
+
+
+class MessageParser:
+    """Découpe le flux reçu du bootloader en messages (sid, données)."""
+
+    def __init__(self):
+        self.buf = bytearray()
+
+    def feed(self, data):
+        self.buf += data
+        out = []
+        while len(self.buf) >= 4:
+            if self.buf[0] != SOH or self.buf[2] > 8:
+                del self.buf[0]
+                continue
+            n = self.buf[2] + 4
+            if len(self.buf) < n:
+                break
+            if self.buf[n - 1] != EOT:
+                del self.buf[0]
+                continue
+            out.append((self.buf[1], bytes(self.buf[3:n - 1])))
+            del self.buf[:n]
+        return out
+
+
+class SerialLink:
+    """Liaison réelle (pyserial)."""
+
+    def __init__(self, port, baudrate):
+        import serial
+        self.serial = serial.Serial(port, baudrate, timeout=0)
+        self.baudrate = baudrate
+
+    def now(self):
+        return time.monotonic()
+
+    def write(self, data):
+        self.serial.write(data)
+
+    def read(self, max_wait):
+        end = time.monotonic() + max_wait
+        while True:
+            data = self.serial.read(4096)
+            if data or time.monotonic() >= end:
+                return data
+            time.sleep(0.0005)
+
+    def set_baudrate(self, baudrate):
+        self.serial.flush()
+        self.serial.baudrate = baudrate
+        self.baudrate = baudrate
+
+    def wait(self, duration):
+        time.sleep(duration)
+
+
+class Sender:
+    def __init__(self, link, image, version, window=None, timeout=0.2, verbose=False, base=None, compress=True):
+        if not image or len(image) > MAX_PROGRAM_SIZE:
+            raise ProtocolError("taille de programme invalide : %d octets" % len(image))
+        self.link = link
+        self.image = bytes(image)
+        self.version = version
+        self.window = window
+        self.timeout = timeout
+        self.verbose = verbose
+        self.parser = MessageParser()
+        self.pending = []
+        self.chunk_size = 256
+        self.formats = 0
+        self.base = base
+        self.compress = compress
+        self.retransmissions = 0
+        self.sent = 0
+
+    def log(self, text):
+        if self.verbose:
+            print(text)
+
+    def receive(self, wanted, max_wait):
+        """Attend un message parmi les SID de wanted, renvoie (sid, données) ou None."""
+        end = self.link.now() + max_wait
+        while True:
+            for m in self.pending:
+                if m[0] in wanted:
+                    self.pending.remove(m)
+                    return m
+            remaining = end - self.link.now()
+            if remaining <= 0:
+                return None
+            self.pending += self.parser.feed(self.link.read(remaining))
+
+    def connect(self, max_wait=10.0):
+        end = self.link.now() + max_wait
+        while self.link.now() < end:
+            self.link.write(b"\xB0")
+            m = self.receive((SID_TOASTER_REQUEST_FOR_PROGRAM,), 0.005)
+            if m:
+                size = int.from_bytes(m[1][:4], "big")
+                if size == 0 or size > 0xFFFF or FLASH_PAGE_SIZE % size:
+                    # ancien bootloader (paquets de 16 ko) : l'annonce lui ferait effacer la flash
+                    raise ProtocolError("bootloader d'origine (paquets de %d octets) : protocole non géré, "
+                                        "mettre à jour le bootloader une fois par SWD (pages 1 à 3)" % size)
+                self.chunk_size = size
+                return
+        raise ProtocolError("pas de réponse du bootloader")
+
+    def announce(self):
+        nb_chunks = (len(self.image) + self.chunk_size - 1) // self.chunk_size
+        self.image += b"\xFF" * (nb_chunks * self.chunk_size - len(self.image))
+        data = bytes([self.version & 0xFF]) + nb_chunks.to_bytes(3, "big") + len(self.image).to_bytes(4, "big")
+        self.link.write(msg(SID_BOOTLOADER_PROGRAM_AVAILABLE, data))
+        m = self.receive((SID_BOOTLOADER_READY,), 5.0)
+        if m is None:
+            raise ProtocolError("le bootloader n'est pas prêt (même version ou programme refusé ?)")
+        ready = int.from_bytes(m[1], "big")      # taille des morceaux (2 octets), fenêtre, formats acceptés
+        if ready >> 16 != self.chunk_size:
+            raise ProtocolError("taille de morceau incohérente")
+        if self.window is None:
+            self.window = ready >> 8 & 0xFF
+        self.window = min(self.window, ready >> 8 & 0xFF)
+        self.formats = ready & 0xFF
+        return nb_chunks
+
+    def negotiate_baudrate(self, baudrate):
+        request = msg(SID_TOASTER_SET_BAUDRATE, baudrate.to_bytes(4, "big"))
+        self.link.write(request)
+        m = self.receive((SID_BOOTLOADER_BAUDRATE,), 0.5)
+        if m is None or int.from_bytes(m[1], "big") != baudrate:
+            self.log("vitesse %d refusée" % baudrate)
+            return False
+        previous = self.link.baudrate
+        self.link.set_baudrate(baudrate)
+        for _ in range(3):
+            self.link.write(request)
+            m = self.receive((SID_BOOTLOADER_BAUDRATE,), 0.1)
+            if m and int.from_bytes(m[1], "big") == baudrate:
+                self.log("vitesse %d bauds" % baudrate)
+                return True
+        # pas de confirmation : le bootloader revient seul à l'ancienne vitesse
+        self.link.set_baudrate(previous)
+        self.link.wait(2.0)
+        self.log("vitesse %d non confirmée, retour à %d bauds" % (baudrate, previous))
+        return False
+
+    def page_crc(self, page):
+        data = self.image[page * FLASH_PAGE_SIZE:(page + 1) * FLASH_PAGE_SIZE]
+        return zlib.crc32(data + b"\xFF" * (FLASH_PAGE_SIZE - len(data)))
+
+    def check_pages(self, pages, window=8, retries=3):
+        """Renvoie les pages qui diffèrent de celles programmées, d'après leur CRC."""
+        changed = set(pages)
+        todo = list(pages)
+        for _ in range(retries):
+            lost = []
+            while todo:
+                burst, todo = todo[:window], todo[window:]
+                for page in burst:
+                    self.link.write(msg(SID_TOASTER_PAGE_CRC, bytes([page]) + self.page_crc(page).to_bytes(4, "big")))
+                waiting = set(burst)
+                while waiting:
+                    m = self.receive((SID_BOOTLOADER_PAGE_CRC,), self.timeout)
+                    if m is None:
+                        break
+                    page, result = m[1][0], m[1][1]
+                    if page in waiting:
+                        waiting.discard(page)
+                        if result == 0:
+                            changed.discard(page)
+                lost += sorted(waiting)
+            if not lost:
+                break
+            todo = lost
+        # sans réponse (ancien bootloader), une page est considérée comme modifiée
+        self.log("%d pages modifiées sur %d" % (len(changed), len(pages)))
+        return changed
+
+    def raw_frame(self, index):
+        start = index * self.chunk_size
+        return chunk_frame(index, self.image[start:start + self.chunk_size])
+
+    def stream(self, frames):
+        """Envoie les trames {numéro de morceau: trame} avec la fenêtre glissante, jusqu'à leur acquittement."""
+        frames = dict(frames)
+        todo = sorted(frames)
+        in_flight = {}
+        errors = {}
+        while todo or in_flight:
+            while todo and len(in_flight) < self.window:
+                index = todo.pop(0)
+                self.link.write(frames[index])
+                self.sent += len(frames[index])
+                in_flight[index] = self.link.now()
+            m = self.receive((SID_BOOTLOADER_CHUNK_ACK,), self.timeout / 4)
+            if m:
+                index, status = int.from_bytes(m[1][:2], "big"), m[1][2]
+                if index not in in_flight:
+                    continue            # acquittement d'un morceau renvoyé entre-temps
+                sent = in_flight.pop(index)
+                for lost in [i for i, t in in_flight.items() if t < sent]:
+                    # la liaison conserve l'ordre : un morceau envoyé avant, toujours pas acquitté, est perdu
+                    del in_flight[lost]
+                    todo.insert(0, lost)
+                    self.retransmissions += 1
+                if status == BL_FLASH_ERROR_CRC and frames[index][1] == SID_TOASTER_CHUNK_LZ:
+                    # flash différente du dictionnaire supposé (programme installé inconnu) : envoi non compressé
+                    self.log("morceau %d renvoyé non compressé" % index)
+                    frames[index] = self.raw_frame(index)
+                    todo.insert(0, index)
+                    self.retransmissions += 1
+                elif status != BL_FLASH_COMPLETE:
+                    # acquittement corrompu ou erreur de programmation : le morceau est renvoyé
+                    # (s'il a bien été programmé, le bootloader ne fait que le comparer)
+                    errors[index] = errors.get(index, 0) + 1
+                    if errors[index] > 3:
+                        raise ProtocolError("erreur flash %d sur le morceau %d" % (status, index))
+                    todo.insert(0, index)
+                    self.retransmissions += 1
+                continue
+            now = self.link.now()
+            for index, sent in list(in_flight.items()):
+                if now - sent > self.timeout:
+                    # renvoi sélectif : trame ou acquittement perdu
+                    del in_flight[index]
+                    todo.insert(0, index)
+                    self.retransmissions += 1
+                    self.log("renvoi du morceau %d" % index)
+
+    def finish(self):
+        for _ in range(5):
+            self.link.write(msg(SID_TOASTER_END))
+            if self.receive((SID_BOOTLOADER_END,), 0.5):
+                return True
+        # la réponse a pu être perdue alors que le bootloader a déjà redémarré
+        print("attention : fin de transfert non acquittée", file=sys.stderr)
+        return False
+
+    def run(self, baudrate=None):
+        self.connect()
+        nb_chunks = self.announce()
+        if baudrate:
+            self.negotiate_baudrate(baudrate)
+        per_page = FLASH_PAGE_SIZE // self.chunk_size
+        pages = [p for p in range((nb_chunks + per_page - 1) // per_page) if p not in BOOTLOADER_PAGES]
+        changed = self.check_pages(pages)
+        encoder = None
+        if self.compress and self.formats & STREAM_FORMAT_LZ:
+            encoder = toaster_lz.Encoder(self.image, changed, self.base)
+        # une page est écrite lorsque tous ses morceaux sont arrivés : elles partent l'une après l'autre, la page 0 en dernier
+        for page in sorted(changed, key=lambda p: (p == 0, p)):
+            frames = {}
+            for index in range(page * per_page, min((page + 1) * per_page, nb_chunks)):
+                payload = encoder.encode(index) if encoder else None
+                if payload:
+                    start = index * self.chunk_size
+                    frames[index] = chunk_lz_frame(index, self.image[start:start + self.chunk_size], payload)
+                else:
+                    frames[index] = self.raw_frame(index)
+            self.stream(frames)
+            if encoder:
+                encoder.commit(page)
+        self.finish()
+        return nb_chunks
+
+
+class SimFlash:
+    """Flash du STM32G431 : effacement par page, programmation par double mot ou par rangée d'une zone effacée."""
+
+    PAGE_ERASE_TIME = 0.022
+    DOUBLEWORD_TIME = 0.000082
+    FAST_ROW_TIME = 0.00191         # 32 doubles mots en programmation rapide
+    PAGE_CRC_TIME = 0.0001
+
+    def __init__(self, size=128 * 1024, content=None):
+        self.mem = bytearray(content if content else bytes(size))
+        self.mem += b"\xFF" * (size - len(self.mem))
+        self.erases = 0
+        self.programs = 0
+
+    def erase(self, page):
+        self.mem[page * FLASH_PAGE_SIZE:(page + 1) * FLASH_PAGE_SIZE] = b"\xFF" * FLASH_PAGE_SIZE
+        self.erases += 1
+        return self.PAGE_ERASE_TIME
+
+    def program(self, offset, data):
+        if self.mem[offset:offset + 8] != b"\xFF" * 8:
+            raise ProtocolError("programmation d'un double mot non effacé à 0x%08X" % (FLASH_BASE + offset))
+        self.mem[offset:offset + 8] = data
+        self.programs += 1
+        return self.DOUBLEWORD_TIME
+
+    def program_row(self, offset, data):
+        if self.mem[offset:offset + len(data)] != b"\xFF" * len(data):
+            raise ProtocolError("programmation rapide d'une rangée non effacée à 0x%08X" % (FLASH_BASE + offset))
+        self.mem[offset:offset + len(data)] = data
+        self.programs += len(data) // 8
+        return self.FAST_ROW_TIME
+
+
+class SimLink:
+    """
+    Cible simulée en temps virtuel : liaison série (10 bits par octet), bootloader et flash.
+    Les trames sont perdues (CRC faux) avec la probabilité loss, dans les deux sens.
+    """
+
+    RING_SIZE = 1024
+    CHUNK_SIZE = 256
+    WINDOW = 3
+    FORMATS = STREAM_FORMAT_LZ
+    DECODE_TIME = 0.00005
+
+    def __init__(self, flash, version=0, loss=0.0, seed=1):
+        self.flash = flash
+        self.version = version
+        self.loss = loss
+        self.random = random.Random(seed)
+        self.t = 0.0
+        self.baudrate = DEFAULT_BAUDRATE
+        self.rx_line_free = 0.0         # liaison TOASTER -> bootloader
+        self.tx_line_free = 0.0         # liaison bootloader -> TOASTER
+        self.cpu_free = 0.0             # fin du traitement en cours du bootloader
+        self.rx_queue = []              # (heure de fin de réception, trame)
+        self.tx_queue = []              # (heure de fin d'émission, octets)
+        self.parser = MessageParser()
+        self.state = "wait_b0"
+        self.nb_chunks = 0
+        self.to_write = set()
+        self.page = None
+        self.received = set()
+        self.buffer = bytearray()
+        self.ring_max = 0
+        self.done = False
+
+    def now(self):
+        return self.t
+
+    def wait(self, duration):
+        self.t += duration
+
+    def set_baudrate(self, baudrate):
+        self.baudrate = baudrate
+
+    def byte_time(self):
+        return 10.0 / self.baudrate
+
+    def write(self, data):
+        start = max(self.t, self.rx_line_free)
+        self.rx_line_free = start + len(data) * self.byte_time()
+        if self.state == "stream" and self.loss and self.random.random() < self.loss:
+            data = bytes([data[0] ^ 0xFF]) + data[1:]       # trame corrompue, ignorée par le bootloader
+        self.rx_queue.append((self.rx_line_free, data))
+
+    def send(self, at, data):
+        if self.state == "stream" and self.loss and self.random.random() < self.loss:
+            return
+        start = max(at, self.tx_line_free)
+        self.tx_line_free = start + len(data) * self.byte_time()
+        self.tx_queue.append((self.tx_line_free, data))
+
+    def process(self, until):
+        """Traite les trames reçues par le bootloader jusqu'à l'heure until."""
+        while self.rx_queue and max(self.rx_queue[0][0], self.cpu_free) <= until:
+            arrival, frame = self.rx_queue.pop(0)
+            waiting = sum(len(f) for a, f in self.rx_queue if a <= max(arrival, self.cpu_free))
+            self.ring_max = max(self.ring_max, waiting + len(frame))
+            if self.ring_max >= self.RING_SIZE:
+                raise ProtocolError("débordement du buffer circulaire du bootloader")
+            t = max(arrival, self.cpu_free)
+            t = self.handle(t, frame)
+            self.cpu_free = t
+
+    def handle(self, t, frame):
+        if self.state == "wait_b0":
+            if frame == b"\xB0":
+                self.state = "handshake"
+                self.send(t, msg(SID_TOASTER_REQUEST_FOR_PROGRAM, self.CHUNK_SIZE.to_bytes(4, "big")))
+            return t
+        if frame[0] != SOH:
+            return t
+        sid = frame[1]
+        if self.state == "handshake" and sid == SID_BOOTLOADER_PROGRAM_AVAILABLE:
+            data = frame[3:-1]
+            if data[0] == self.version:
+                self.state = "exit"
+                return t
+            self.nb_chunks = int.from_bytes(data[1:4], "big")
+            size = self.nb_chunks * self.CHUNK_SIZE
+            self.to_write = set(range((size - 1) // FLASH_PAGE_SIZE + 1)) - set(BOOTLOADER_PAGES)
+            self.state = "stream"
+            ready = self.CHUNK_SIZE << 16 | self.WINDOW << 8 | self.FORMATS
+            self.send(t, msg(SID_BOOTLOADER_READY, ready.to_bytes(4, "big")))
+            return t
+        if self.state != "stream":
+            return t
+        if sid in (SID_TOASTER_CHUNK, SID_TOASTER_CHUNK_LZ):
+            body = frame[2:-5]
+            if zlib.crc32(body) != int.from_bytes(frame[-5:-1], "big"):
+                return t
+            index = int.from_bytes(body[:2], "big")
+            if sid == SID_TOASTER_CHUNK:
+                data = body[2:]
+            else:
+                t += self.DECODE_TIME
+                data = toaster_lz.decode_chunk(body[8:], self.flash.mem)
+                if data is not None and zlib.crc32(data) != int.from_bytes(body[4:8], "big"):
+                    data = None
+            t, status = self.chunk(t, index, data)
+            self.send(t, msg(SID_BOOTLOADER_CHUNK_ACK, index.to_bytes(2, "big") + bytes([status])))
+        elif sid == SID_TOASTER_PAGE_CRC:
+            page, crc = frame[3], int.from_bytes(frame[4:8], "big")
+            t += self.flash.PAGE_CRC_TIME
+            if page > (self.nb_chunks * self.CHUNK_SIZE - 1) // FLASH_PAGE_SIZE:
+                result = 0xFF
+            elif page not in self.to_write:
+                result = 0
+            elif self.received and page == self.page:
+                result = 1
+            elif zlib.crc32(self.flash.mem[page * FLASH_PAGE_SIZE:(page + 1) * FLASH_PAGE_SIZE]) != crc:
+                result = 1
+            else:
+                self.to_write.discard(page)
+                result = 0
+            self.send(t, msg(SID_BOOTLOADER_PAGE_CRC, bytes([page, result])))
+        elif sid == SID_TOASTER_SET_BAUDRATE:
+            baudrate = int.from_bytes(frame[3:7], "big")
+            ok = 0 < baudrate <= UART_CLOCK // 16
+            self.send(t, msg(SID_BOOTLOADER_BAUDRATE, (baudrate if ok else 0).to_bytes(4, "big")))
+        elif sid == SID_TOASTER_END:
+            self.send(t, msg(SID_BOOTLOADER_END))
+            self.done = True
+        return t
+
+    def chunk(self, t, index, data):
+        """Morceau rangé dans la page en cours, écrite lorsqu'elle est complète (data None : décompression fausse)."""
+        if index >= self.nb_chunks:
+            return t, BL_FLASH_ERROR_PGA
+        per_page = FLASH_PAGE_SIZE // self.CHUNK_SIZE
+        page = index // per_page
+        if page not in self.to_write:
+            return t, BL_FLASH_COMPLETE
+        if self.received and page != self.page:
+            return t, BL_FLASH_ERROR_PGS
+        if not self.received:
+            self.page = page
+            self.buffer = bytearray(b"\xFF" * FLASH_PAGE_SIZE)
+        self.received.discard(index)
+        if data is None:
+            return t, BL_FLASH_ERROR_CRC
+        offset = (index % per_page) * self.CHUNK_SIZE
+        self.buffer[offset:offset + self.CHUNK_SIZE] = data
+        self.received.add(index)
+        if len(self.received) < min(per_page, self.nb_chunks - page * per_page):
+            return t, BL_FLASH_COMPLETE
+        start = page * FLASH_PAGE_SIZE
+        if self.flash.mem[start:start + FLASH_PAGE_SIZE] != self.buffer:
+            t += self.flash.erase(page)
+            for offset in range(0, FLASH_PAGE_SIZE, self.CHUNK_SIZE):
+                row = self.buffer[offset:offset + self.CHUNK_SIZE]
+                if row != b"\xFF" * self.CHUNK_SIZE:
+                    t += self.flash.program_row(start + offset, row)
+        self.to_write.discard(page)
+        self.received = set()
+        return t, BL_FLASH_COMPLETE
+
+    def read(self, max_wait):
+        end = self.t + max_wait
+        while True:
+            ready = [item[0] for item in self.tx_queue if item[0] <= end]
+            if ready or not self.rx_queue or max(self.rx_queue[0][0], self.cpu_free) > end:
+                break
+            self.process(max(self.rx_queue[0][0], self.cpu_free))
+        if not ready:
+            self.t = end
+            return b""
+        self.t = max(self.t, min(ready))
+        out = b""
+        for item in list(self.tx_queue):
+            if item[0] <= self.t:
+                out += item[1]
+                self.tx_queue.remove(item)
+        return out
+
+
+def simulate(image, args):
+    old = bytes(random.Random(2).getrandbits(8) for _ in range(128 * 1024))
+    base = None
+    if args.base:
+        # flash déjà programmée avec l'ancienne version (pages du bootloader exceptées)
+        with open(args.base, "rb") as f:
+            base = f.read()
+        old = bytearray(old)
+        old[:len(base)] = base
+        old[len(base):(len(base) + FLASH_PAGE_SIZE - 1) // FLASH_PAGE_SIZE * FLASH_PAGE_SIZE] = \
+            b"\xFF" * (-len(base) % FLASH_PAGE_SIZE)
+        nb = len(BOOTLOADER_PAGES) * FLASH_PAGE_SIZE
+        old[FLASH_PAGE_SIZE:FLASH_PAGE_SIZE + nb] = bytes(random.Random(3).getrandbits(8) for _ in range(nb))
+        old = bytes(old)
+    flash = SimFlash(content=old)
+    link = SimLink(flash, loss=args.loss, seed=args.seed)
+    if args.legacy:
+        link.CHUNK_SIZE = 16384         # ancien bootloader : paquets de 16 ko
+    sender = Sender(link, image, args.version, window=args.window, verbose=args.verbose,
+                    base=base if args.base and not args.unknown_base else None, compress=not args.raw)
+    nb_chunks = sender.run(args.baudrate)
+    expected = bytearray(sender.image)
+    bootloader = slice(FLASH_PAGE_SIZE, (max(BOOTLOADER_PAGES) + 1) * FLASH_PAGE_SIZE)
+    expected[bootloader] = old[bootloader]
+    if flash.mem[:len(expected)] != expected or not link.done:
+        raise ProtocolError("contenu de la flash simulée incorrect")
+    print("%d octets, %d morceaux, %d octets envoyés, %d renvois, %d pages effacées, %d doubles mots programmés"
+          % (len(image), nb_chunks, sender.sent, sender.retransmissions, flash.erases, flash.programs))
+    print("durée estimée sur la cible : %.2f s (buffer circulaire : %d octets au plus)" % (link.now(), link.ring_max))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Envoi d'un programme au bootloader en flux")
+    parser.add_argument("image", help="fichier binaire, à partir de 0x08000000")
+    parser.add_argument("--port", help="port série")
+    parser.add_argument("--baudrate", type=int, default=None, help="vitesse négociée pour le transfert")
+    parser.add_argument("--version", type=int, default=1, help="version annoncée (0 : programmes étudiants)")
+    parser.add_argument("--window", type=int, default=None, help="nombre de morceaux non acquittés")
+    parser.add_argument("--simulate", action="store_true", help="cible et flash simulées")
+    parser.add_argument("--loss", type=float, default=0.0, help="simulation : taux de trames perdues")
+    parser.add_argument("--base", help="programme installé sur la cible : envoi en différence")
+    parser.add_argument("--raw", action="store_true", help="morceaux non compressés")
+    parser.add_argument("--unknown-base", action="store_true",
+                        help="simulation : programme installé (--base) non communiqué à l'émetteur")
+    parser.add_argument("--legacy", action="store_true",
+                        help="simulation : ancien bootloader (paquets de 16 ko), qui doit être refusé")
+    parser.add_argument("--seed", type=int, default=1, help="simulation : graine des pertes")
+    parser.add_argument("--verbose", action="store_true")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    try:
+        if args.simulate:
+            simulate(image, args)
+        elif args.port:
+            start = time.monotonic()
+            link = SerialLink(args.port, DEFAULT_BAUDRATE)
+            base = None
+            if args.base:
+                with open(args.base, "rb") as f:
+                    base = f.read()
+            sender = Sender(link, image, args.version, window=args.window, verbose=args.verbose,
+                            base=base, compress=not args.raw)
+            sender.run(args.baudrate)
+            print("programme envoyé en %.2f s (%d octets transférés)" % (time.monotonic() - start, sender.sent))
+        else:
+            parser.error("--port ou --simulate")
+    except ProtocolError as e:
+        print("erreur : %s" % e, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())